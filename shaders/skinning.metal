@@ -0,0 +1,50 @@
+#include <metal_stdlib>
+#include <simd/simd.h>
+
+using namespace metal;
+
+struct VertexData {
+   float4 position;
+   float3 normal;
+   float3 tangent;
+   float3 bitangent;
+   float2 uv;
+};
+
+/// same layout as game::SkinData
+struct SkinData {
+   float4 weights;
+   ushort4 joints;
+};
+
+struct SkinningParams {
+   uint vertexCount;
+   uint jointCount;
+};
+
+/// one thread per vertex and instance, palettes of all instances are
+/// packed one after the other, as are the skinned vertices
+kernel void skinVertices(device const VertexData* bind      [[buffer(0)]],
+                         device const SkinData* skin        [[buffer(1)]],
+                         device const float4x4* palettes    [[buffer(2)]],
+                         device VertexData* skinned         [[buffer(3)]],
+                         constant SkinningParams& params    [[buffer(4)]],
+                         uint2 gid                          [[thread_position_in_grid]]) {
+   if (gid.x >= params.vertexCount) {
+      return;
+   }
+   const SkinData s = skin[gid.x];
+   device const float4x4* palette = palettes + gid.y * params.jointCount;
+   const float4x4 m = palette[s.joints.x] * s.weights.x + palette[s.joints.y] * s.weights.y +
+                      palette[s.joints.z] * s.weights.z + palette[s.joints.w] * s.weights.w;
+   const float3x3 r = float3x3(m[0].xyz, m[1].xyz, m[2].xyz);
+
+   const VertexData in = bind[gid.x];
+   VertexData out;
+   out.position  = m * in.position;
+   out.normal    = normalize(r * in.normal);
+   out.tangent   = normalize(r * in.tangent);
+   out.bitangent = normalize(r * in.bitangent);
+   out.uv        = in.uv;
+   skinned[gid.y * params.vertexCount + gid.x] = out;
+}
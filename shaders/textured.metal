@@ -29,6 +29,12 @@ struct PointLight {
    float3 position;
 };
 
+/// L2 spherical harmonics of the irradiance, RGB in xyz: see
+/// IrradianceSH in image_based_lighting.hpp
+struct IrradianceSH {
+   float4 coefficients[9];
+};
+
 struct VertexPayload {              //Mesh Vertex Type
     float4 position [[position]];   //Qualified attribute
     float3 normal;
@@ -67,8 +73,48 @@ VertexPayload vertex vertexMain(uint vertexID [[vertex_id]],
 }
 
 
-float4 calcAmbientLight(constant AmbientLight& al, float4 albedo) {
-    return float4(al.strength * al.colour.rgb * albedo.rgb,1.0f);
+/// levels of the prefiltered specular cube from roughness 0 to 1, as baked by prefilterSpecular()
+constant constexpr float SPECULAR_ROUGHNESS_LEVELS = 6.0f;
+
+float3 evaluateIrradiance(constant IrradianceSH& sh, float3 n) {
+    const auto irradiance = sh.coefficients[0].rgb * 0.282095f
+        + sh.coefficients[1].rgb * 0.488603f * n.y
+        + sh.coefficients[2].rgb * 0.488603f * n.z
+        + sh.coefficients[3].rgb * 0.488603f * n.x
+        + sh.coefficients[4].rgb * 1.092548f * n.x * n.y
+        + sh.coefficients[5].rgb * 1.092548f * n.y * n.z
+        + sh.coefficients[6].rgb * 0.315392f * (3.0f * n.z * n.z - 1.0f)
+        + sh.coefficients[7].rgb * 1.092548f * n.x * n.z
+        + sh.coefficients[8].rgb * 0.546274f * (n.x * n.x - n.y * n.y);
+    /// L2 rings a little below zero opposite a bright sky
+    return max(irradiance, 0.0f);
+}
+
+/// the split sum's scale and bias of F0, Karis' fit: no lookup table to bake or bind
+float3 environmentBRDF(float3 F0, float roughness, float NdotV) {
+    const float4 c0 = float4(-1.0f, -0.0275f, -0.572f, 0.022f);
+    const float4 c1 = float4(1.0f, 0.0425f, 1.04f, -0.04f);
+    const float4 r = roughness * c0 + c1;
+    const float a004 = min(r.x * r.x, exp2(-9.28f * NdotV)) * r.x + r.y;
+    const float2 AB = float2(-1.04f, 1.04f) * a004 + r.zw;
+    return F0 * AB.x + AB.y;
+}
+
+/// the sky as ambient light: irradiance for the diffuse part, the
+/// prefiltered cube at the level of the roughness for the specular one
+float4 calcAmbientLight(constant AmbientLight& al,
+                        texturecube<float> specularMap,
+                        constant IrradianceSH& irradiance,
+                        float3 N, float3 V,
+                        float4 albedo, float roughness, float metalness) {
+    constexpr sampler cubeSampler(filter::linear, mip_filter::linear);
+    const auto NdotV = max(dot(N, V), 1e-4f);
+    const auto F0 = mix(float3(0.04f), albedo.rgb, metalness);
+    const auto prefiltered = specularMap.sample(cubeSampler, reflect(-V, N),
+                                                level(roughness * (SPECULAR_ROUGHNESS_LEVELS - 1.0f))).rgb;
+    const auto specular = prefiltered * environmentBRDF(F0, roughness, NdotV);
+    const auto diffuse = evaluateIrradiance(irradiance, N) * albedo.rgb / M_PI * (1.0f - metalness);
+    return float4(al.strength * al.colour.rgb * (diffuse + specular), 1.0f);
 }
 
 float4 calcDirectionalLight(constant DirectionalLight& dl, float3 normal, float4 albedo) {
@@ -174,30 +220,34 @@ float3 calcSpecularGGX(float3 lightPosition,
 */
 fragment float4 fragmentMain(VertexPayload frag [[stage_in]], texture2d_array<float> colorTexture [[texture(0)]],
                              texturecube<float> skyBox [[texture(1)]], texture2d<float> shadowPass [[texture(2)]],
+                             texture2d<float> normalTexture [[texture(3)]],
+                             texturecube<float> specularMap [[texture(4)]],
                              constant AmbientLight &al [[buffer(3)]], constant DirectionalLight &dl [[buffer(4)]],
                              constant PointLight &pl [[buffer(5)]], constant float3 &cameraPosition [[buffer(6)]],
-                             constant float4x4 &lightProjectionMatrix [[buffer(7)]])
+                             constant float4x4 &lightProjectionMatrix [[buffer(7)]],
+                             constant IrradianceSH &irradiance [[buffer(8)]])
 {
     const auto TBN = float3x3(frag.tangent, frag.bitangent, frag.normal);
-    constexpr sampler textureSampler (mag_filter::linear,min_filter::linear);
+    constexpr sampler textureSampler (mag_filter::linear,min_filter::linear,mip_filter::linear);
 
     const auto colorSample      = colorTexture.sample(textureSampler, frag.uv, 0);
-    const auto specularSample   = colorTexture.sample(textureSampler, frag.uv, 1);
-    const auto roughnessSample   = colorTexture.sample(textureSampler, frag.uv, 2);
-
-    const auto ambient_light    = calcAmbientLight(al, colorSample);
+    /// occlusion, roughness, metallic
+    const auto ormSample        = colorTexture.sample(textureSampler, frag.uv, 1);
 
-    const auto normalMap        = normalize(
-        colorTexture.sample(textureSampler, frag.uv, 3).rgb * 2.0f - 1.0f
-    );
+    /// only X and Y are stored, the normal faces out of the surface
+    const auto normalXY         = normalTexture.sample(textureSampler, frag.uv).rg * 2.0f - 1.0f;
+    const auto normalMap        = normalize(float3(normalXY, sqrt(saturate(1.0f - dot(normalXY, normalXY)))));
 
     const auto normal           = normalize(TBN * normalMap);
+    const auto ambient_light    = calcAmbientLight(al, specularMap, irradiance, normal,
+                                                   normalize(cameraPosition - frag.wPosition.xyz),
+                                                   colorSample, ormSample.g, ormSample.b) * ormSample.r;
     const auto dir_light        = calcDirectionalLight(dl, normal, colorSample);
 
     const auto point_light = calcSpecularGGX(pl.position, cameraPosition, frag.wPosition.xyz, normal,
                                              pl.colour.rgb * pl.strength, // light color/intensity
                                              colorSample.rgb, // albedo from texture
-                                             roughnessSample.r, specularSample.r);
+                                             ormSample.g, ormSample.b);
 
     // constexpr sampler skyBoxSampler(address::clamp_to_edge, filter::linear);
     // const auto Ivec = normalize(pl.position - cameraPosition);
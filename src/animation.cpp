@@ -0,0 +1,82 @@
+#include "animation.hpp"
+#include "error.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace game {
+
+namespace {
+
+/// the key pair around time and how far between them it is
+struct KeySpan {
+   size_t first;
+   size_t second;
+   float t;
+};
+
+auto locate(const std::span<const float> times, const float time) -> KeySpan {
+   const auto next = static_cast<size_t>(std::ranges::upper_bound(times, time) - times.begin());
+   if (next == 0) {
+      return {0, 0, 0.0f};
+   }
+   if (next == times.size()) {
+      return {next - 1, next - 1, 0.0f};
+   }
+   const auto span = times[next] - times[next - 1];
+   return {next - 1, next, span > 0.0f ? (time - times[next - 1]) / span : 0.0f};
+}
+
+template <class T, class Blend>
+auto sampleKeys(const Keys<T>& keys, const float time, T& value, Blend&& blend) -> void {
+   if (keys.empty()) {
+      return;
+   }
+   const auto [first, second, t] = locate(keys.times, time);
+   value = blend(keys.values[first], keys.values[second], t);
+}
+
+}
+
+auto nlerp(const simd::float4 a, simd::float4 b, const float t) -> simd::float4 {
+   if (simd::dot(a, b) < 0.0f) {
+      b = -b;
+   }
+   return simd::normalize(a + (b - a) * t);
+}
+
+auto toMatrix(const Transform& transform) -> simd::float4x4 {
+   const auto q = transform.rotation;
+   const auto s = transform.scale;
+   const auto xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+   const auto xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+   const auto wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+
+   simd::float4x4 m;
+   m.columns[0] = simd::make_float4(1.0f - 2.0f * (yy + zz), 2.0f * (xy + wz), 2.0f * (xz - wy), 0.0f) * s.x;
+   m.columns[1] = simd::make_float4(2.0f * (xy - wz), 1.0f - 2.0f * (xx + zz), 2.0f * (yz + wx), 0.0f) * s.y;
+   m.columns[2] = simd::make_float4(2.0f * (xz + wy), 2.0f * (yz - wx), 1.0f - 2.0f * (xx + yy), 0.0f) * s.z;
+   m.columns[3] = simd::make_float4(transform.translation, 1.0f);
+   return m;
+}
+
+auto AnimationClip::sample(float time, const std::span<Transform> pose) const -> void {
+   ensure(pose.size() == tracks.size(),
+      std::format("clip {} animates {} joints, the pose has {}", name, tracks.size(), pose.size()));
+   /// the end of the clip is still the end, only times past it wrap
+   if (duration > 0.0f and (time < 0.0f or time > duration)) {
+      time = std::fmod(time, duration);
+      time = time < 0.0f ? time + duration : time;
+   }
+
+   const auto lerp = [](const simd::float3 a, const simd::float3 b, const float t) {return a + (b - a) * t;};
+   for (auto j = 0u; j < tracks.size(); ++j) {
+      auto& local = pose[j];
+      local = {};
+      sampleKeys(tracks[j].translations, time, local.translation, lerp);
+      sampleKeys(tracks[j].rotations, time, local.rotation, nlerp);
+      sampleKeys(tracks[j].scales, time, local.scale, lerp);
+   }
+}
+
+}
@@ -0,0 +1,58 @@
+#ifndef GAME_TUTORIAL_ANIMATION_HPP
+#define GAME_TUTORIAL_ANIMATION_HPP
+
+/// Keyframed joint animation, cpu side only. Clips are stored as raw
+/// per joint tracks of keys, sampled into local joint transforms.
+
+#include <cstddef>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "simd_compat.hpp"
+
+namespace game {
+
+/// local transform of a joint relative to its parent,
+/// rotation is a unit quaternion (x, y, z, w)
+struct Transform {
+   simd::float3 translation{0.0f, 0.0f, 0.0f};
+   simd::float4 rotation{0.0f, 0.0f, 0.0f, 1.0f};
+   simd::float3 scale{1.0f, 1.0f, 1.0f};
+};
+
+/// key times in seconds, increasing, one value per time
+template <class T>
+struct Keys {
+   std::vector<float> times;
+   std::vector<T> values;
+   [[nodiscard]] auto empty() const -> bool {return times.empty();}
+};
+
+/// a joint without keys of a kind keeps that part of the default Transform
+struct JointTrack {
+   Keys<simd::float3> translations;
+   Keys<simd::float4> rotations;
+   Keys<simd::float3> scales;
+};
+
+struct AnimationClip {
+   std::string name;
+   float duration{0.0f};
+   /// one track per skeleton joint, in joint order
+   std::vector<JointTrack> tracks;
+
+   /// Local pose of every joint at time, which wraps around the clip
+   /// duration. Translations and scales are lerped, rotations nlerped
+   /// along the shortest arc.
+   auto sample(float time, std::span<Transform> pose) const -> void;
+};
+
+/// normalized lerp of unit quaternions, flipping b onto the side of a
+[[nodiscard]] auto nlerp(simd::float4 a, simd::float4 b, float t) -> simd::float4;
+/// translation * rotation * scale
+[[nodiscard]] auto toMatrix(const Transform& transform) -> simd::float4x4;
+
+}
+
+#endif // GAME_TUTORIAL_ANIMATION_HPP
@@ -0,0 +1,193 @@
+#include "asset_archive.hpp"
+#include "error.hpp"
+#include "lz_compression.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <vector>
+
+namespace game {
+
+namespace {
+
+/// FNV-1a, 0 is kept for empty slots
+auto nameHash(const std::string_view name) -> std::uint64_t {
+   auto hash = std::uint64_t{14695981039346656037u};
+   for (const auto c: name) {
+      hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211u;
+   }
+   return hash == 0 ? 1 : hash;
+}
+
+auto aligned(const std::uint64_t offset, const std::uint64_t alignment) -> std::uint64_t {
+   return (offset + alignment - 1) / alignment * alignment;
+}
+
+/// every entry fits the file and its names, and compressed entries say how,
+/// with an original size their block can decode to
+auto validEntries(const ArchiveHeader& h, const std::span<const ArchiveEntry> slots, const size_t file_size) -> bool {
+   auto count = size_t{0};
+   for (const auto& entry: slots) {
+      if (entry.hash == 0) {
+         continue;
+      }
+      ++count;
+      const auto fits = entry.offset <= file_size and entry.size <= file_size - entry.offset and
+         entry.nameOffset <= h.namesSize and entry.nameLength <= h.namesSize - entry.nameOffset;
+      const auto sized = entry.compression == ArchiveCompression::None ? entry.size == entry.originalSize :
+         entry.compression == ArchiveCompression::Lz and fits and entry.originalSize <= decompressBound(entry.size);
+      if (not fits or not sized) {
+         return false;
+      }
+   }
+   return count == h.entryCount;
+}
+
+}
+
+auto AssetArchive::write(const std::filesystem::path& path, const std::span<const ArchiveInput> inputs) -> void {
+   ensure(inputs.size() <= std::numeric_limits<std::uint32_t>::max() / 2,
+      std::format("{} entries do not fit an archive", inputs.size()));
+   auto header = ArchiveHeader{
+      .magic = ArchiveHeader::MAGIC,
+      .version = ArchiveHeader::VERSION,
+      .entryCount = static_cast<std::uint32_t>(inputs.size()),
+      .slotCount = std::bit_ceil(static_cast<std::uint32_t>(std::max<size_t>(inputs.size() * 2, 2))),
+      .tableOffset = 0,
+      .namesOffset = 0,
+      .namesSize = 0
+   };
+   auto slots = std::vector<ArchiveEntry>(header.slotCount);
+   auto names = std::string{};
+
+   /// the header is written last so that an interrupted write never
+   /// looks like a valid archive
+   std::ofstream file{path, std::ios::binary | std::ios::trunc};
+   ensure(file.is_open(), std::format("could not create {}", path.string()));
+   const auto blank = ArchiveHeader{.magic = 0, .version = 0, .entryCount = 0, .slotCount = 0, .tableOffset = 0,
+      .namesOffset = 0, .namesSize = 0};
+   file.write(reinterpret_cast<const char*>(&blank), sizeof(blank));
+
+   auto offset = std::uint64_t{sizeof(ArchiveHeader)};
+   for (const auto& input: inputs) {
+      const auto hash = nameHash(input.name);
+      auto slot = hash & (header.slotCount - 1);
+      for (; slots[slot].hash != 0; slot = (slot + 1) & (header.slotCount - 1)) {
+         ensure(slots[slot].hash != hash or std::string_view{names}.substr(slots[slot].nameOffset,
+            slots[slot].nameLength) != input.name, std::format("{} is in the archive twice", input.name));
+      }
+
+      const auto contents = FileContents::open(input.source, {.sequential = true, .willNeed = false,
+         .hugePages = false});
+      auto stored = contents.bytes();
+      auto compression = ArchiveCompression::None;
+      auto compressed = std::vector<std::byte>{};
+      if (input.compress) {
+         compressed = compressBlock(contents.bytes());
+         if (compressed.size() <= contents.size() / 8 * 7) {
+            stored = compressed;
+            compression = ArchiveCompression::Lz;
+         }
+      }
+      offset = aligned(offset, compression == ArchiveCompression::None and stored.size() >= ENTRY_ALIGNMENT ?
+         ENTRY_ALIGNMENT : alignof(std::max_align_t));
+      slots[slot] = ArchiveEntry{
+         .hash = hash,
+         .offset = offset,
+         .size = stored.size(),
+         .originalSize = contents.size(),
+         .stamp = stamp(input.source),
+         .nameOffset = static_cast<std::uint32_t>(names.size()),
+         .nameLength = static_cast<std::uint32_t>(input.name.size()),
+         .compression = compression,
+         .reserved = 0
+      };
+      names += input.name;
+      ensure(names.size() <= std::numeric_limits<std::uint32_t>::max(), "the names of an archive exceed 4 GB");
+
+      file.seekp(static_cast<std::streamoff>(offset));
+      file.write(reinterpret_cast<const char*>(stored.data()), static_cast<std::streamsize>(stored.size()));
+      offset += stored.size();
+   }
+
+   header.tableOffset = aligned(offset, alignof(ArchiveEntry));
+   header.namesOffset = header.tableOffset + slots.size() * sizeof(ArchiveEntry);
+   header.namesSize = names.size();
+   file.seekp(static_cast<std::streamoff>(header.tableOffset));
+   file.write(reinterpret_cast<const char*>(slots.data()),
+      static_cast<std::streamsize>(slots.size() * sizeof(ArchiveEntry)));
+   file.write(names.data(), static_cast<std::streamsize>(names.size()));
+   file.seekp(0);
+   file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+   file.close();
+   ensure(not file.fail(), std::format("could not write {}", path.string()));
+}
+
+auto AssetArchive::open(const std::filesystem::path& path) -> AssetArchive {
+   auto file = std::make_shared<const MappedFile>(MappedFile::open(path));
+   ensure(file->size() >= sizeof(ArchiveHeader), std::format("{} is not an asset archive", path.string()));
+   ArchiveHeader h;
+   std::memcpy(&h, file->data(), sizeof(h));
+
+   const auto size = file->size();
+   const auto valid =
+      h.magic == ArchiveHeader::MAGIC and h.version == ArchiveHeader::VERSION and
+      std::has_single_bit(h.slotCount) and h.slotCount >= size_t{h.entryCount} * 2 and
+      h.tableOffset % alignof(ArchiveEntry) == 0 and h.tableOffset <= size and
+      size_t{h.slotCount} * sizeof(ArchiveEntry) <= size - h.tableOffset and
+      h.namesOffset <= size and h.namesSize <= size - h.namesOffset;
+   ensure(valid, std::format("{} is not an asset archive of version {}", path.string(), ArchiveHeader::VERSION));
+   auto archive = AssetArchive{std::move(file), h};
+   ensure(validEntries(h, archive._slots, size), std::format("the table of {} is damaged", path.string()));
+   return archive;
+}
+
+AssetArchive::AssetArchive(std::shared_ptr<const MappedFile> file, const ArchiveHeader& header)
+   : _file(std::move(file)),
+     _header(header),
+     _slots{reinterpret_cast<const ArchiveEntry*>(_file->data() + header.tableOffset), header.slotCount},
+     _names{reinterpret_cast<const char*>(_file->data() + header.namesOffset), header.namesSize} {
+}
+
+auto AssetArchive::stamp(const std::filesystem::path& source) -> std::uint64_t {
+   const auto time = std::filesystem::last_write_time(source).time_since_epoch().count();
+   return static_cast<std::uint64_t>(time) * 31 + std::filesystem::file_size(source);
+}
+
+auto AssetArchive::find(const std::string_view name) const -> const ArchiveEntry* {
+   const auto hash = nameHash(name);
+   const auto mask = _slots.size() - 1;
+   /// at most half the slots are taken, probing ends on an empty one
+   for (auto slot = hash & mask;; slot = (slot + 1) & mask) {
+      const auto& entry = _slots[slot];
+      if (entry.hash == 0) {
+         return nullptr;
+      }
+      if (entry.hash == hash and this->name(entry) == name) {
+         return &entry;
+      }
+   }
+}
+
+auto AssetArchive::read(const std::string_view name) const -> std::optional<FileContents> {
+   const auto* const entry = find(name);
+   if (entry == nullptr) {
+      return std::nullopt;
+   }
+   return read(*entry);
+}
+
+auto AssetArchive::read(const ArchiveEntry& entry) const -> FileContents {
+   const auto stored = std::span<const std::byte>{_file->bytes()}.subspan(entry.offset, entry.size);
+   if (entry.compression == ArchiveCompression::None) {
+      return FileContents::view(_file, stored);
+   }
+   auto decoded = std::vector<std::byte>(entry.originalSize);
+   decompressBlock(stored, decoded);
+   return FileContents::buffer(std::move(decoded));
+}
+
+}
@@ -0,0 +1,99 @@
+#ifndef GAME_TUTORIAL_ASSET_ARCHIVE_HPP
+#define GAME_TUTORIAL_ASSET_ARCHIVE_HPP
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+
+#include "mapped_file.hpp"
+
+namespace game {
+
+/// On disk layout of an asset archive: the header, the entries, then a
+/// hash table of entries (open addressing, linear probing) and their
+/// names. Entries of a page or more start on a page boundary so that
+/// they can be wrapped by no-copy GPU buffers, smaller ones are packed.
+struct ArchiveHeader {
+   static constexpr std::uint32_t MAGIC = 0x4b415047; // "GPAK"
+   static constexpr std::uint32_t VERSION = 2;
+
+   std::uint32_t magic{MAGIC};
+   std::uint32_t version{VERSION};
+   std::uint32_t entryCount{0};
+   /// a power of two, at least twice entryCount
+   std::uint32_t slotCount{0};
+   std::uint64_t tableOffset{0};
+   std::uint64_t namesOffset{0};
+   std::uint64_t namesSize{0};
+};
+
+enum class ArchiveCompression : std::uint32_t {
+   None,
+   /// one block, see compressBlock()
+   Lz
+};
+
+/// a slot of the table, empty when hash is 0
+struct ArchiveEntry {
+   std::uint64_t hash{0};
+   std::uint64_t offset{0};
+   /// as stored, and once decompressed
+   std::uint64_t size{0};
+   std::uint64_t originalSize{0};
+   /// of the source when it was packed, see AssetArchive::stamp()
+   std::uint64_t stamp{0};
+   std::uint32_t nameOffset{0};
+   std::uint32_t nameLength{0};
+   ArchiveCompression compression{ArchiveCompression::None};
+   std::uint32_t reserved{0};
+};
+
+/// a file to pack, under name: a relative path with forward slashes,
+/// the way it is asked for through a ResourceLoader
+struct ArchiveInput {
+   std::string name;
+   std::filesystem::path source;
+   /// kept only where it saves an eighth or more
+   bool compress{false};
+};
+
+/// An asset archive mapped in memory. Uncompressed entries are read
+/// without a copy, compressed ones are decompressed into a buffer.
+class AssetArchive {
+public:
+   /// the largest page size around (Apple silicon), a multiple of the others
+   static constexpr size_t ENTRY_ALIGNMENT = 16384;
+
+   /// throws if two inputs share a name or a source cannot be read
+   static auto write(const std::filesystem::path& path, std::span<const ArchiveInput> inputs) -> void;
+   /// throws if the file is not a complete archive
+   [[nodiscard]] static auto open(const std::filesystem::path& path) -> AssetArchive;
+   /// modification time and size of a source, as MeshCache::stamp()
+   [[nodiscard]] static auto stamp(const std::filesystem::path& source) -> std::uint64_t;
+
+   /// nullptr if there is no entry of that name
+   [[nodiscard]] auto find(std::string_view name) const -> const ArchiveEntry*;
+   [[nodiscard]] auto read(std::string_view name) const -> std::optional<FileContents>;
+   /// entry is one of this archive, as find() returns them
+   [[nodiscard]] auto read(const ArchiveEntry& entry) const -> FileContents;
+   [[nodiscard]] auto name(const ArchiveEntry& entry) const -> std::string_view {
+      return _names.substr(entry.nameOffset, entry.nameLength);
+   }
+   [[nodiscard]] constexpr auto size() const -> size_t {return _header.entryCount;}
+
+private:
+   AssetArchive(std::shared_ptr<const MappedFile> file, const ArchiveHeader& header);
+
+   std::shared_ptr<const MappedFile> _file;
+   ArchiveHeader _header;
+   std::span<const ArchiveEntry> _slots;
+   std::string_view _names;
+};
+
+}
+
+#endif // GAME_TUTORIAL_ASSET_ARCHIVE_HPP
@@ -0,0 +1,267 @@
+#include "asset_importer.hpp"
+#include "block_compression.hpp"
+#include "environment_map.hpp"
+#include "error.hpp"
+#include "mapped_file.hpp"
+#include "mesh_cache.hpp"
+#include "mesh_factory.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <optional>
+
+namespace game {
+
+namespace {
+
+/// FNV-1a over whole values
+auto mix(const std::uint64_t stamp, const std::uint64_t value) -> std::uint64_t {
+   return (stamp ^ value) * 1099511628211u;
+}
+
+constexpr auto STAMP_SEED = std::uint64_t{14695981039346656037u};
+
+/// decoders and parsers go through a file front to back once
+constexpr auto READ_ONCE = MapHints{.sequential = true, .willNeed = true, .hugePages = false};
+
+/// the prefiltered cube is small: its rough levels are blurry and the
+/// mirror one only catches highlights on polished surfaces
+constexpr std::uint32_t SPECULAR_FACE_SIZE = 128;
+constexpr std::uint32_t SPECULAR_SAMPLES = 64;
+
+/// every image, the way it is packed and its mips are built, and the size it is brought to
+auto layersStamp(const std::span<const TextureLayer> layers, const TextureQuality quality) -> std::uint64_t {
+   auto stamp = STAMP_SEED;
+   const auto add = [&](const std::uint64_t value) {
+      stamp = mix(stamp, value);
+   };
+   add(static_cast<std::uint64_t>(quality));
+   for (const auto& layer: layers) {
+      for (const auto& source: layer.sources) {
+         add(source.empty() ? 0 : MeshCache::stamp(source));
+      }
+      add(static_cast<std::uint64_t>(layer.filter));
+      add(static_cast<std::uint64_t>(layer.space));
+      add(static_cast<std::uint64_t>(layer.packing));
+   }
+   return stamp;
+}
+
+auto decode(const std::filesystem::path& path) -> Image {
+   const auto file = MappedFile::open(path, READ_ONCE);
+   return game::decodeImage(file.bytes());
+}
+
+/// the sharp filter for colour, the one that barely rings for data
+auto resizeFilter(const TextureLayer& layer) -> MipFilter {
+   return layer.filter == MipFilter::Box ? MipFilter::Mitchell : MipFilter::Lanczos;
+}
+
+/// the size of the largest image of layer, from the headers alone
+auto layerSize(const TextureLayer& layer) -> ImageSize {
+   auto sizes = std::vector<ImageSize>{};
+   for (const auto& source: layer.sources) {
+      if (not source.empty()) {
+         sizes.push_back(imageSize(MappedFile::open(source).bytes()));
+      }
+   }
+   return arraySize(sizes, TextureQuality::High);
+}
+
+/// level 0 of layer at size, normals are packed once filtered
+auto baseImage(const TextureLayer& layer, const ImageSize size) -> Image {
+   const auto load = [&](const std::filesystem::path& path) {
+      auto image = decode(path);
+      if (image.width != size.width or image.height != size.height) {
+         image = resizeImage(image, size.width, size.height, resizeFilter(layer), layer.space);
+      }
+      return image;
+   };
+   if (layer.packing == ChannelPacking::ORM) {
+      ensure(layer.sources.size() == 3, "an ORM layer is made of occlusion, roughness and metallic");
+      const auto occlusion = layer.sources[0].empty() ? std::optional<Image>{} : load(layer.sources[0]);
+      return packOrm(occlusion ? &*occlusion : nullptr, load(layer.sources[1]), load(layer.sources[2]));
+   }
+   ensure(layer.sources.size() == 1, std::format("a layer made of {} images needs packing", layer.sources.size()));
+   return load(layer.sources.front());
+}
+
+}
+
+auto AssetImporter::importMesh(MeshRequest request) -> std::future<MeshData> {
+   return _pool.submit([request = std::move(request)] {
+      const auto file = MappedFile::open(request.path, READ_ONCE);
+      /// OBJ is read natively, anything else goes through assimp
+      auto mesh = request.path.extension() == ".obj"
+         ? MeshFactory::readObj(request.name, file.bytes())
+         : MeshFactory::importMesh(request.name, file.bytes());
+      ensure(mesh.has_value(), std::format("{} not found in {}", request.name, request.path.string()));
+      return std::move(*mesh);
+   });
+}
+
+auto AssetImporter::decodeImage(std::filesystem::path path) -> std::future<Image> {
+   return _pool.submit([path = std::move(path)] {
+      const auto file = MappedFile::open(path, READ_ONCE);
+      return game::decodeImage(file.bytes());
+   });
+}
+
+auto AssetImporter::mipChain(std::filesystem::path path, const MipFilter filter, const ColorSpace space,
+   std::filesystem::path cache) -> std::future<MipChain> {
+   return _pool.submit([path = std::move(path), filter, space, cache = std::move(cache)] {
+      const auto stamp = MeshCache::stamp(path);
+      if (auto chain = readMipCache(cache, stamp, filter, space)) {
+         return std::move(*chain);
+      }
+      const auto file = MappedFile::open(path, READ_ONCE);
+      auto chain = buildMipChain(game::decodeImage(file.bytes()), filter, space);
+      std::filesystem::create_directories(cache.parent_path());
+      writeMipCache(cache, stamp, chain);
+      return chain;
+   });
+}
+
+auto AssetImporter::textureFile(std::vector<TextureLayer> layers, const TextureFileFormat format,
+   std::filesystem::path file) -> std::future<TextureFile> {
+   return _pool.submit([layers = std::move(layers), format, file = std::move(file), quality = _quality] {
+      ensure(format != TextureFileFormat::RGBA16F, "half float texture files are baked from HDR images");
+      const auto stamp = layersStamp(layers, quality);
+      if (auto baked = TextureFile::open(file, stamp); baked and baked->format() == format) {
+         return std::move(*baked);
+      }
+      /// layers of other sizes are resized to the array, which the quality scales down
+      auto sizes = std::vector<ImageSize>{};
+      for (const auto& layer: layers) {
+         sizes.push_back(layerSize(layer));
+      }
+      const auto size = arraySize(sizes, quality);
+      /// one layer at a time, the mip builder and the encoder use every core
+      auto chains = std::vector<MipChain>{};
+      auto compressed = std::vector<CompressedChain>{};
+      for (const auto& layer: layers) {
+         auto chain = buildMipChain(baseImage(layer, size), layer.filter, layer.space);
+         if (layer.packing == ChannelPacking::NormalXY) {
+            for (auto& level: chain.levels) {
+               level = packNormalXY(level);
+            }
+         }
+         if (format == TextureFileFormat::RGBA8) {
+            chains.push_back(std::move(chain));
+         } else {
+            compressed.push_back(compressMipChain(chain, blockFormat(format), EncodeQuality::Normal));
+         }
+      }
+      std::filesystem::create_directories(file.parent_path());
+      if (format == TextureFileFormat::RGBA8) {
+         TextureFile::write(file, stamp, chains, 1);
+      } else {
+         TextureFile::write(file, stamp, compressed, 1);
+      }
+      auto baked = TextureFile::open(file, stamp);
+      ensure(baked.has_value(), std::format("could not read back {}", file.string()));
+      return std::move(*baked);
+   });
+}
+
+auto AssetImporter::environmentMap(std::filesystem::path equirect, std::filesystem::path file)
+   -> std::future<TextureFile> {
+   return _pool.submit([equirect = std::move(equirect), file = std::move(file), quality = _quality] {
+      const auto stamp = mix(mix(STAMP_SEED, MeshCache::stamp(equirect)), static_cast<std::uint64_t>(quality));
+      if (auto baked = TextureFile::open(file, stamp);
+         baked and baked->format() == TextureFileFormat::RGBA16F and baked->faces() == 6) {
+         return std::move(*baked);
+      }
+      const auto faces = [&] {
+         const auto source = MappedFile::open(equirect, READ_ONCE);
+         const auto image = decodeHdrImage(source.bytes());
+         return equirectToCube(image, cubeFaceSize({image.width, image.height}, quality));
+      }();
+      std::filesystem::create_directories(file.parent_path());
+      TextureFile::write(file, stamp, faces, 6);
+      auto baked = TextureFile::open(file, stamp);
+      ensure(baked.has_value(), std::format("could not read back {}", file.string()));
+      return std::move(*baked);
+   });
+}
+
+auto AssetImporter::environmentMap(std::vector<std::filesystem::path> faces, std::filesystem::path file)
+   -> std::future<TextureFile> {
+   return _pool.submit([faces = std::move(faces), file = std::move(file), quality = _quality] {
+      auto stamp = mix(STAMP_SEED, static_cast<std::uint64_t>(quality));
+      for (const auto& face: faces) {
+         stamp = mix(stamp, MeshCache::stamp(face));
+      }
+      if (auto baked = TextureFile::open(file, stamp);
+         baked and baked->format() == TextureFileFormat::RGBA16F and baked->faces() == CUBE_FACES) {
+         return std::move(*baked);
+      }
+      const auto cube = [&] {
+         auto images = std::vector<Image>{};
+         auto largest = 1u;
+         for (const auto& face: faces) {
+            auto& image = images.emplace_back(decode(face));
+            largest = std::max({largest, image.width, image.height});
+         }
+         const auto face_size = std::max(std::bit_floor(largest) >> static_cast<std::uint32_t>(quality), 1u);
+         return cubeFromFaces(images, face_size);
+      }();
+      std::filesystem::create_directories(file.parent_path());
+      TextureFile::write(file, stamp, cube, CUBE_FACES);
+      auto baked = TextureFile::open(file, stamp);
+      ensure(baked.has_value(), std::format("could not read back {}", file.string()));
+      return std::move(*baked);
+   });
+}
+
+auto AssetImporter::imageBasedLighting(TextureFile environment, std::filesystem::path specular,
+   std::filesystem::path irradiance) -> std::future<ImageBasedLighting> {
+   return _pool.submit([environment = std::move(environment), specular = std::move(specular),
+      irradiance = std::move(irradiance)] {
+      /// the stamp of the environment map stands for its sources and quality
+      const auto stamp = mix(mix(mix(STAMP_SEED, environment.stamp()), SPECULAR_FACE_SIZE), SPECULAR_SAMPLES);
+      auto baked_specular = TextureFile::open(specular, stamp);
+      auto baked_irradiance = readIrradianceCache(irradiance, stamp);
+      if (baked_specular and baked_specular->format() == TextureFileFormat::RGBA16F
+         and baked_specular->faces() == CUBE_FACES and baked_irradiance) {
+         return ImageBasedLighting{std::move(*baked_specular), *baked_irradiance};
+      }
+      /// the irradiance reads a smaller level than the prefiltering, and
+      /// nothing reads one larger than the prefiltered cube
+      const auto cube = toFloats(cubeFaces(environment, SPECULAR_FACE_SIZE));
+      const auto sh = irradianceSH(cube);
+      std::filesystem::create_directories(specular.parent_path());
+      std::filesystem::create_directories(irradiance.parent_path());
+      TextureFile::write(specular, stamp, prefilterSpecular(cube, SPECULAR_FACE_SIZE, SPECULAR_SAMPLES), CUBE_FACES);
+      writeIrradianceCache(irradiance, stamp, sh);
+      baked_specular = TextureFile::open(specular, stamp);
+      ensure(baked_specular.has_value(), std::format("could not read back {}", specular.string()));
+      return ImageBasedLighting{std::move(*baked_specular), sh};
+   });
+}
+
+auto AssetImporter::import(const std::span<const MeshRequest> meshes,
+   const std::span<const std::filesystem::path> images) -> Batch {
+   auto batch = Batch{};
+   batch.meshes.reserve(meshes.size());
+   batch.images.reserve(images.size());
+   /// images first, they are the long ones
+   for (const auto& path: images) {
+      batch.images.push_back(decodeImage(path));
+   }
+   for (const auto& request: meshes) {
+      batch.meshes.push_back(importMesh(request));
+   }
+   return batch;
+}
+
+auto AssetImporter::Batch::wait() const -> void {
+   for (const auto& m: meshes) {
+      m.wait();
+   }
+   for (const auto& i: images) {
+      i.wait();
+   }
+}
+
+}
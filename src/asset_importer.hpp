@@ -0,0 +1,107 @@
+#ifndef GAME_TUTORIAL_ASSET_IMPORTER_HPP
+#define GAME_TUTORIAL_ASSET_IMPORTER_HPP
+
+#include <filesystem>
+#include <future>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "channel_packing.hpp"
+#include "image.hpp"
+#include "image_based_lighting.hpp"
+#include "mip_chain.hpp"
+#include "texture_file.hpp"
+#include "thread_pool.hpp"
+#include "vertex_data.hpp"
+
+namespace game {
+
+struct MeshRequest {
+   std::string name;
+   std::filesystem::path path;
+};
+
+/// a layer of a baked texture, see AssetImporter::textureFile
+struct TextureLayer {
+   /// one image, or occlusion, roughness and metallic to pack as ORM;
+   /// an empty occlusion path leaves it white
+   std::vector<std::filesystem::path> sources;
+   MipFilter filter;
+   ColorSpace space;
+   ChannelPacking packing;
+};
+
+/// the lighting baked from an environment map, see AssetImporter::imageBasedLighting
+struct ImageBasedLighting {
+   TextureFile specular;
+   IrradianceSH irradiance;
+};
+
+/// Imports meshes and decodes images on the workers of a ThreadPool.
+/// Every file is mapped rather than read. OBJ meshes are parsed by
+/// MeshFactory::readObj, others go through MeshFactory::importMesh and
+/// so through the assimp importer of the worker.
+class AssetImporter {
+public:
+   /// quality scales down the textures baked by textureFile()
+   explicit AssetImporter(ThreadPool& pool, const TextureQuality quality = TextureQuality::High)
+      : _pool(pool), _quality(quality) {}
+
+   /// the future throws if the file cannot be read or has no such mesh
+   [[nodiscard]] auto importMesh(MeshRequest request) -> std::future<MeshData>;
+   [[nodiscard]] auto decodeImage(std::filesystem::path path) -> std::future<Image>;
+   /// read from cache when it was built from this file in the same way,
+   /// otherwise decoded, built and written to cache
+   [[nodiscard]] auto mipChain(std::filesystem::path path, MipFilter filter, ColorSpace space,
+      std::filesystem::path cache) -> std::future<MipChain>;
+   /// Opened as is when file was baked from these images in this format
+   /// and quality, otherwise every layer is decoded, packed, its mips
+   /// built and, for block formats, compressed at normal quality, and file
+   /// is written anew. NormalXY layers are packed level by level, after
+   /// filtering. Images are resized to the array size (see arraySize()):
+   /// Lanczos for layers whose mips use the Kaiser filter, Mitchell for
+   /// those that use the box.
+   [[nodiscard]] auto textureFile(std::vector<TextureLayer> layers, TextureFileFormat format,
+      std::filesystem::path file) -> std::future<TextureFile>;
+   /// Opened as is when file was baked from this equirectangular HDR
+   /// image at this quality, otherwise the image is decoded, resampled to
+   /// half float cube faces with their mips (see equirectToCube) and file
+   /// is written anew; one file read at startup instead of a decode and a
+   /// resample.
+   [[nodiscard]] auto environmentMap(std::filesystem::path equirect, std::filesystem::path file)
+      -> std::future<TextureFile>;
+   /// As above from six LDR faces in the order of CUBE_FACES (see
+   /// cubeFromFaces), the cube as large as the largest of them down to a
+   /// power of two, then scaled for quality.
+   [[nodiscard]] auto environmentMap(std::vector<std::filesystem::path> faces, std::filesystem::path file)
+      -> std::future<TextureFile>;
+   /// Both opened as is when they were baked from an environment map of
+   /// the same stamp, so from the same sources at the same quality,
+   /// otherwise its GGX prefiltered cube (see prefilterSpecular) and
+   /// irradiance (see irradianceSH) are baked and written anew, from its
+   /// levels no larger than the prefiltered cube.
+   [[nodiscard]] auto imageBasedLighting(TextureFile environment, std::filesystem::path specular,
+      std::filesystem::path irradiance) -> std::future<ImageBasedLighting>;
+
+   /// everything a batch asked for, in request order
+   struct Batch {
+      std::vector<std::future<MeshData>> meshes;
+      std::vector<std::future<Image>> images;
+
+      /// blocks until every request is done, failures are only
+      /// rethrown by get() on their own future
+      auto wait() const -> void;
+   };
+
+   [[nodiscard]] auto import(std::span<const MeshRequest> meshes,
+      std::span<const std::filesystem::path> images) -> Batch;
+
+private:
+   ThreadPool& _pool;
+   TextureQuality _quality;
+};
+
+}
+
+#endif // GAME_TUTORIAL_ASSET_IMPORTER_HPP
@@ -0,0 +1,442 @@
+#include "async_reader.hpp"
+#include "error.hpp"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <optional>
+#include <utility>
+
+#if defined(__linux__)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#endif
+
+namespace game {
+
+namespace {
+
+/// closes the descriptor on scope exit unless it was handed on
+struct FileDescriptor {
+   int fd;
+   ~FileDescriptor() {
+      if (fd >= 0) {
+         ::close(fd);
+      }
+   }
+   auto release() -> int {return std::exchange(fd, -1);}
+};
+
+auto openForReading(const std::filesystem::path& path) -> FileDescriptor {
+   auto file = FileDescriptor{::open(path.c_str(), O_RDONLY | O_CLOEXEC)};
+   ensure(file.fd >= 0, std::format("could not open {}: {}", path.string(), std::strerror(errno)));
+   return file;
+}
+
+auto fileSize(const FileDescriptor& file, const std::filesystem::path& path) -> size_t {
+   struct stat status{};
+   ensure(::fstat(file.fd, &status) == 0, std::format("could not stat {}: {}", path.string(), std::strerror(errno)));
+   return static_cast<size_t>(status.st_size);
+}
+
+/// the thread pool backend, and a whole file in one go
+auto readFile(const std::filesystem::path& path) -> std::vector<std::byte> {
+   const auto file = openForReading(path);
+   auto bytes = std::vector<std::byte>(fileSize(file, path));
+   for (auto done = size_t{0}; done < bytes.size();) {
+      const auto read = ::pread(file.fd, bytes.data() + done, bytes.size() - done, static_cast<off_t>(done));
+      if (read < 0 and errno == EINTR) {
+         continue;
+      }
+      ensure(read > 0, std::format("could not read {}: {}", path.string(),
+         read == 0 ? "it got shorter" : std::strerror(errno)));
+      done += static_cast<size_t>(read);
+   }
+   return bytes;
+}
+
+}
+
+#if defined(__linux__)
+
+/// An io_uring driven through its system calls. Callers only add their
+/// batch to the pending files and wake the reaper with a no-op. The
+/// reaper thread opens pending files while the ring has room for them,
+/// queues their reads and submits them with one enter, queues the rest
+/// of short reads and hands finished files to their callbacks.
+struct AsyncReader::Ring {
+   /// a file of a batch, not opened yet
+   struct Pending {
+      std::filesystem::path path;
+      size_t index;
+      std::shared_ptr<Callback> callback;
+   };
+
+   /// a file being read
+   struct Read {
+      std::filesystem::path path;
+      int fd;
+      size_t index;
+      std::vector<std::byte> bytes;
+      size_t done;
+      std::shared_ptr<Callback> callback;
+   };
+
+   /// the completion of the no-op that stops the reaper
+   static constexpr std::uint64_t STOP = ~std::uint64_t{0};
+   /// and of the one that has it look at the pending files
+   static constexpr std::uint64_t WAKE = STOP - 1;
+   /// reads larger than this are split, a read returns at most 2 GB
+   static constexpr size_t MAX_READ = size_t{1} << 30;
+
+   int fd{-1};
+   unsigned depth{0};
+   std::byte* sqRing{nullptr};
+   size_t sqRingSize{0};
+   std::byte* cqRing{nullptr};
+   size_t cqRingSize{0};
+   io_uring_sqe* sqes{nullptr};
+   size_t sqesSize{0};
+   io_uring_params params{};
+
+   std::mutex mutex;
+   std::condition_variable idle;
+   std::deque<Pending> pending;
+   std::unordered_map<std::uint64_t, Read> reads;
+   std::uint64_t nextId{0};
+   /// queued but not yet passed to the kernel
+   unsigned unsubmitted{0};
+   /// a wake up is in the ring, the reaper will see what is pending
+   bool waking{false};
+   /// why the ring stopped working, reads are failed with it from then on
+   std::string broken;
+   /// the reads failed with it, the kernel may still write to their bytes
+   /// until the ring is closed
+   std::vector<Read> abandoned;
+   std::jthread reaper;
+
+   /// nullptr when the kernel has no io_uring, refuses one (seccomp) or
+   /// is older than IORING_OP_READ
+   static auto create(const unsigned depth) -> std::unique_ptr<Ring> {
+      auto ring = std::make_unique<Ring>();
+      ring->fd = static_cast<int>(::syscall(__NR_io_uring_setup, depth, &ring->params));
+      /// IORING_OP_READ came with 5.6, and so did this feature
+      if (ring->fd < 0 or (ring->params.features & IORING_FEAT_RW_CUR_POS) == 0) {
+         return nullptr;
+      }
+      ring->depth = ring->params.sq_entries;
+      const auto& p = ring->params;
+      ring->sqRingSize = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+      ring->cqRingSize = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+      ring->sqesSize = p.sq_entries * sizeof(io_uring_sqe);
+      const auto map = [&](const size_t size, const off_t offset) -> std::byte* {
+         auto* data = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, offset);
+         return data == MAP_FAILED ? nullptr : static_cast<std::byte*>(data);
+      };
+      ring->sqRing = map(ring->sqRingSize, IORING_OFF_SQ_RING);
+      ring->cqRing = map(ring->cqRingSize, IORING_OFF_CQ_RING);
+      ring->sqes = reinterpret_cast<io_uring_sqe*>(map(ring->sqesSize, IORING_OFF_SQES));
+      if (ring->sqRing == nullptr or ring->cqRing == nullptr or ring->sqes == nullptr) {
+         return nullptr;
+      }
+      ring->reaper = std::jthread{[r = ring.get()] {r->reap();}};
+      return ring;
+   }
+
+   ~Ring() {
+      if (reaper.joinable()) {
+         {
+            std::unique_lock lock{mutex};
+            idle.wait(lock, [this] {return reads.empty() and pending.empty();});
+            if (broken.empty()) {
+               push(STOP, nullptr);
+               submit();
+            }
+         }
+         reaper.join();
+      }
+      if (sqRing != nullptr) {
+         ::munmap(sqRing, sqRingSize);
+      }
+      if (cqRing != nullptr) {
+         ::munmap(cqRing, cqRingSize);
+      }
+      if (sqes != nullptr) {
+         ::munmap(sqes, sqesSize);
+      }
+      if (fd >= 0) {
+         ::close(fd);
+      }
+   }
+
+   auto field(std::byte* const ring, const unsigned offset) -> std::atomic_ref<unsigned> {
+      return std::atomic_ref<unsigned>{*reinterpret_cast<unsigned*>(ring + offset)};
+   }
+
+   /// queues a read of the rest of read, or a no-op; the mutex is held
+   auto push(const std::uint64_t id, const Read* const read) -> void {
+      const auto tail = field(sqRing, params.sq_off.tail).load(std::memory_order_relaxed);
+      const auto head = field(sqRing, params.sq_off.head).load(std::memory_order_acquire);
+      if (tail - head == params.sq_entries) {
+         submit();
+      }
+      const auto index = tail & field(sqRing, params.sq_off.ring_mask).load(std::memory_order_relaxed);
+      auto& sqe = sqes[index];
+      std::memset(&sqe, 0, sizeof(sqe));
+      sqe.user_data = id;
+      if (read == nullptr) {
+         sqe.opcode = IORING_OP_NOP;
+      } else {
+         sqe.opcode = IORING_OP_READ;
+         sqe.fd = read->fd;
+         sqe.addr = reinterpret_cast<std::uint64_t>(read->bytes.data() + read->done);
+         sqe.len = static_cast<std::uint32_t>(std::min(read->bytes.size() - read->done, MAX_READ));
+         sqe.off = read->done;
+      }
+      reinterpret_cast<unsigned*>(sqRing + params.sq_off.array)[index] = index;
+      field(sqRing, params.sq_off.tail).store(tail + 1, std::memory_order_release);
+      ++unsubmitted;
+   }
+
+   /// passes everything queued to the kernel; the mutex is held
+   auto submit() -> void {
+      while (unsubmitted > 0) {
+         const auto submitted = ::syscall(__NR_io_uring_enter, fd, unsubmitted, 0, 0, nullptr, 0);
+         if (submitted < 0 and (errno == EINTR or errno == EAGAIN or errno == EBUSY)) {
+            continue;
+         }
+         ensure(submitted > 0, std::format("could not submit reads: {}", std::strerror(errno)));
+         unsubmitted -= static_cast<unsigned>(submitted);
+      }
+   }
+
+   /// hands the paths to the reaper, nothing is opened here: the caller
+   /// returns after one system call, however many files there are
+   auto enqueue(const std::span<const std::filesystem::path> paths, const std::shared_ptr<Callback>& callback) -> void {
+      if (paths.empty()) {
+         return;
+      }
+      auto lock = std::unique_lock{mutex};
+      if (not broken.empty()) {
+         const auto error = std::make_exception_ptr(Exception{broken});
+         lock.unlock();
+         for (auto i = size_t{0}; i < paths.size(); ++i) {
+            (*callback)(i, {}, error);
+         }
+         return;
+      }
+      for (auto i = size_t{0}; i < paths.size(); ++i) {
+         pending.push_back({paths[i], i, callback});
+      }
+      if (not waking) {
+         waking = true;
+         push(WAKE, nullptr);
+         submit();
+      }
+   }
+
+   auto reap() -> void {
+      while (true) {
+         const auto waited = ::syscall(__NR_io_uring_enter, fd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+         if (waited < 0 and errno != EINTR) {
+            fail(std::format("could not wait for reads: {}", std::strerror(errno)));
+            return;
+         }
+         auto head = field(cqRing, params.cq_off.head).load(std::memory_order_relaxed);
+         const auto tail = field(cqRing, params.cq_off.tail).load(std::memory_order_acquire);
+         const auto mask = field(cqRing, params.cq_off.ring_mask).load(std::memory_order_relaxed);
+         auto stopping = false;
+         for (; head != tail; ++head) {
+            const auto cqe = reinterpret_cast<const io_uring_cqe*>(cqRing + params.cq_off.cqes)[head & mask];
+            if (cqe.user_data == STOP) {
+               stopping = true;
+            } else if (cqe.user_data == WAKE) {
+               const std::lock_guard lock{mutex};
+               waking = false;
+            } else {
+               complete(cqe.user_data, cqe.res);
+            }
+         }
+         field(cqRing, params.cq_off.head).store(head, std::memory_order_release);
+         if (stopping) {
+            return;
+         }
+         start();
+      }
+   }
+
+   /// Opens pending files and queues their reads while the ring has room:
+   /// completions never outnumber what it can hold. The reads are
+   /// submitted together; what does not fit waits for a slot to free.
+   auto start() -> void {
+      auto started = false;
+      while (true) {
+         /// left pending until it is read or failed, for the destructor to wait for
+         auto next = [&]() -> std::optional<Pending> {
+            const std::lock_guard lock{mutex};
+            if (pending.empty() or reads.size() >= depth) {
+               return std::nullopt;
+            }
+            return pending.front();
+         }();
+         if (not next) {
+            break;
+         }
+         /// only this thread adds reads, the slot stays free while the file is opened
+         auto read = std::optional<Read>{};
+         auto error = std::exception_ptr{};
+         try {
+            auto file = openForReading(next->path);
+            const auto size = fileSize(file, next->path);
+            if (size > 0) {
+               read = Read{next->path, file.release(), next->index, std::vector<std::byte>(size), 0, next->callback};
+            }
+         } catch (...) {
+            error = std::current_exception();
+         }
+         if (not read) {
+            (*next->callback)(next->index, {}, error);
+            const std::lock_guard lock{mutex};
+            pending.pop_front();
+            continue;
+         }
+         const std::lock_guard lock{mutex};
+         pending.pop_front();
+         const auto id = nextId++;
+         push(id, &reads.emplace(id, std::move(*read)).first->second);
+         started = true;
+      }
+      if (started) {
+         const std::lock_guard lock{mutex};
+         submit();
+      }
+      /// the destructor waits for nothing to be pending either
+      idle.notify_all();
+   }
+
+   /// the ring cannot be waited on any more: every read in flight or
+   /// pending fails with reason, and so do the batches that come after
+   auto fail(const std::string& reason) -> void {
+      auto failed = std::vector<Read>{};
+      auto never_opened = std::deque<Pending>{};
+      {
+         const std::lock_guard lock{mutex};
+         broken = reason;
+         for (auto& [id, read]: reads) {
+            failed.push_back(std::move(read));
+         }
+         reads.clear();
+         never_opened.swap(pending);
+      }
+      const auto error = std::make_exception_ptr(Exception{reason});
+      for (auto& read: failed) {
+         ::close(read.fd);
+         (*read.callback)(read.index, {}, error);
+      }
+      for (const auto& file: never_opened) {
+         (*file.callback)(file.index, {}, error);
+      }
+      abandoned = std::move(failed);
+      idle.notify_all();
+   }
+
+   /// a short read is queued again for the rest, anything else is the end of the file
+   auto complete(const std::uint64_t id, const int result) -> void {
+      auto finished = [&]() -> std::optional<Read> {
+         const std::lock_guard lock{mutex};
+         auto& read = reads.at(id);
+         if (result > 0) {
+            read.done += static_cast<size_t>(result);
+            if (read.done < read.bytes.size()) {
+               push(id, &read);
+               submit();
+               return std::nullopt;
+            }
+         }
+         auto done = std::move(read);
+         reads.erase(id);
+         return done;
+      }();
+      if (not finished) {
+         return;
+      }
+      ::close(finished->fd);
+      auto error = std::exception_ptr{};
+      if (result <= 0) {
+         error = std::make_exception_ptr(Exception{std::format("could not read {}: {}", finished->path.string(),
+            result == 0 ? "it got shorter" : std::strerror(-result))});
+         finished->bytes.clear();
+      }
+      (*finished->callback)(finished->index, std::move(finished->bytes), error);
+      idle.notify_all();
+   }
+};
+
+#else
+
+struct AsyncReader::Ring {
+   static auto create(unsigned) -> std::unique_ptr<Ring> {return nullptr;}
+   auto enqueue(std::span<const std::filesystem::path>, const std::shared_ptr<Callback>&) -> void {}
+};
+
+#endif
+
+AsyncReader::AsyncReader(ThreadPool& pool, const AsyncBackend preferred, const unsigned queue_depth)
+   : _pool(pool), _ring(preferred == AsyncBackend::IoUring ? Ring::create(queue_depth) : nullptr) {
+}
+
+AsyncReader::~AsyncReader() = default;
+
+auto AsyncReader::read(const std::span<const std::filesystem::path> paths)
+   -> std::vector<std::future<std::vector<std::byte>>> {
+   auto promises = std::make_shared<std::vector<std::promise<std::vector<std::byte>>>>(paths.size());
+   auto futures = std::vector<std::future<std::vector<std::byte>>>{};
+   futures.reserve(paths.size());
+   for (auto& promise: *promises) {
+      futures.push_back(promise.get_future());
+   }
+   read(paths, [promises](const size_t index, std::vector<std::byte> bytes, const std::exception_ptr error) {
+      if (error) {
+         (*promises)[index].set_exception(error);
+      } else {
+         (*promises)[index].set_value(std::move(bytes));
+      }
+   });
+   return futures;
+}
+
+auto AsyncReader::read(const std::span<const std::filesystem::path> paths, Callback callback) -> void {
+   auto shared = std::make_shared<Callback>(std::move(callback));
+   if (_ring) {
+      _ring->enqueue(paths, shared);
+      return;
+   }
+   for (auto i = size_t{0}; i < paths.size(); ++i) {
+      (void)_pool.submit([path = paths[i], i, shared] {
+         auto bytes = std::vector<std::byte>{};
+         auto error = std::exception_ptr{};
+         try {
+            bytes = readFile(path);
+         } catch (...) {
+            error = std::current_exception();
+         }
+         (*shared)(i, std::move(bytes), error);
+      });
+   }
+}
+
+}
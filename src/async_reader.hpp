@@ -0,0 +1,63 @@
+#ifndef GAME_TUTORIAL_ASYNC_READER_HPP
+#define GAME_TUTORIAL_ASYNC_READER_HPP
+
+#include <cstddef>
+#include <exception>
+#include <filesystem>
+#include <functional>
+#include <future>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "thread_pool.hpp"
+
+namespace game {
+
+/// how an AsyncReader gets its reads done
+enum class AsyncBackend {
+   /// Linux: a batch is one system call, the kernel reads while nobody waits
+   IoUring,
+   /// anywhere: a blocking read per file on the workers of a thread pool
+   ThreadPool
+};
+
+/// Reads whole files without blocking the caller: files are opened,
+/// sized and read by the reaper thread of the ring or by the workers of
+/// the pool, read() only hands them over. io_uring is used where the kernel offers
+/// it (5.6 and later, with no liburing needed), the thread pool
+/// otherwise, or when it is asked for. Reads still in flight are
+/// finished on destruction.
+class AsyncReader {
+public:
+   /// the index of the file in its batch, and its bytes or why it could not be read
+   using Callback = std::function<void(size_t index, std::vector<std::byte> bytes, std::exception_ptr error)>;
+
+   /// pool runs the reads if io_uring cannot; queue_depth bounds the reads
+   /// the ring has in flight, more are started as the first ones finish
+   explicit AsyncReader(ThreadPool& pool, AsyncBackend preferred = AsyncBackend::IoUring,
+      unsigned queue_depth = 64);
+   ~AsyncReader();
+
+   AsyncReader(const AsyncReader&) = delete;
+   AsyncReader(AsyncReader&&) = delete;
+
+   /// one future per path, in order; get() throws if the file could not be read
+   [[nodiscard]] auto read(std::span<const std::filesystem::path> paths)
+      -> std::vector<std::future<std::vector<std::byte>>>;
+   /// callback is called once per path, in any order, on the thread that
+   /// completed the read; it must not throw
+   auto read(std::span<const std::filesystem::path> paths, Callback callback) -> void;
+
+   [[nodiscard]] auto backend() const -> AsyncBackend {return _ring ? AsyncBackend::IoUring : AsyncBackend::ThreadPool;}
+
+private:
+   struct Ring;
+
+   ThreadPool& _pool;
+   std::unique_ptr<Ring> _ring;
+};
+
+}
+
+#endif // GAME_TUTORIAL_ASYNC_READER_HPP
@@ -0,0 +1,650 @@
+#include "block_compression.hpp"
+#include "error.hpp"
+#include "parallel_for.hpp"
+#include "simd_compat.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <limits>
+
+namespace game {
+
+namespace {
+
+using Texel = simd::float4;
+using Block = std::array<Texel, 16>;
+
+constexpr size_t BLOCK_ROW_GRAIN = 4;
+constexpr size_t POWER_ITERATIONS = 8;
+
+/// interpolation weights out of 64, as the decoders use them
+constexpr auto BC7_WEIGHTS = std::array<int, 16>{0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+constexpr auto ASTC_WEIGHTS_2 = std::array<int, 4>{0, 21, 43, 64};
+constexpr auto ASTC_WEIGHTS_3 = std::array<int, 8>{0, 9, 18, 27, 37, 46, 55, 64};
+
+/// ASTC block modes of a 4x4 weight grid, one plane: 3 and 2 bit weights
+constexpr std::uint32_t ASTC_MODE_WEIGHTS_3 = 0x053;
+constexpr std::uint32_t ASTC_MODE_WEIGHTS_2 = 0x042;
+/// colour endpoint modes, LDR direct
+constexpr std::uint32_t ASTC_CEM_RGB = 8;
+constexpr std::uint32_t ASTC_CEM_RGBA = 12;
+
+auto zero() -> Texel {return Texel{0.0f, 0.0f, 0.0f, 0.0f};}
+
+auto clamp255(const Texel t) -> Texel {
+   return simd::clamp(t, zero(), Texel{255.0f, 255.0f, 255.0f, 255.0f});
+}
+
+/// the block at bx, by; texels past the edges repeat the edge
+auto fetch(const Image& image, const size_t bx, const size_t by) -> Block {
+   auto block = Block{};
+   const auto pixels = reinterpret_cast<const std::uint8_t*>(image.pixels.data());
+   for (auto i = size_t{0}; i < 16; ++i) {
+      const auto x = std::min<size_t>(bx * 4 + i % 4, image.width - 1);
+      const auto y = std::min<size_t>(by * 4 + i / 4, image.height - 1);
+      const auto p = pixels + (y * image.width + x) * 4;
+      block[i] = Texel{static_cast<float>(p[0]), static_cast<float>(p[1]), static_cast<float>(p[2]),
+         static_cast<float>(p[3])};
+   }
+   return block;
+}
+
+auto store(Image& image, const size_t bx, const size_t by, const std::array<std::array<std::uint8_t, 4>, 16>& texels) -> void {
+   const auto pixels = reinterpret_cast<std::uint8_t*>(image.pixels.data());
+   for (auto i = size_t{0}; i < 16; ++i) {
+      const auto x = bx * 4 + i % 4;
+      const auto y = by * 4 + i / 4;
+      if (x < image.width and y < image.height) {
+         std::copy_n(texels[i].data(), 4, pixels + (y * image.width + x) * 4);
+      }
+   }
+}
+
+/// little endian bit stream over one block
+struct Bits {
+   std::array<std::uint8_t, 16> bytes{};
+   size_t position{0};
+
+   auto put(const std::uint32_t value, const size_t count) -> void {
+      for (auto b = size_t{0}; b < count; ++b, ++position) {
+         bytes[position / 8] |= static_cast<std::uint8_t>(((value >> b) & 1u) << (position % 8));
+      }
+   }
+   auto get(const size_t count) -> std::uint32_t {
+      auto value = std::uint32_t{0};
+      for (auto b = size_t{0}; b < count; ++b, ++position) {
+         value |= static_cast<std::uint32_t>((bytes[position / 8] >> (position % 8)) & 1u) << b;
+      }
+      return value;
+   }
+};
+
+/// Endpoints spanning the block: the corners of its bounding box, or the
+/// extremes of its projection on the principal axis
+auto initialEndpoints(const Block& block, const EncodeQuality quality) -> std::pair<Texel, Texel> {
+   auto lo = block[0];
+   auto hi = block[0];
+   auto mean = zero();
+   for (const auto& t: block) {
+      lo = simd::min(lo, t);
+      hi = simd::max(hi, t);
+      mean += t;
+   }
+   mean = mean * (1.0f / 16.0f);
+   if (quality == EncodeQuality::Fast) {
+      /// the diagonal of the box that follows the block: channels that
+      /// fall while the widest one rises run the other way
+      const auto range = hi - lo;
+      auto widest = 0;
+      for (auto c = 1; c < 4; ++c) {
+         widest = range[c] > range[widest] ? c : widest;
+      }
+      auto covariance = zero();
+      for (const auto& t: block) {
+         covariance += (t - mean) * (t[widest] - mean[widest]);
+      }
+      for (auto c = 0; c < 4; ++c) {
+         if (covariance[c] < 0.0f) {
+            std::swap(lo[c], hi[c]);
+         }
+      }
+      return {lo, hi};
+   }
+
+   /// power iteration on the covariance, without building it
+   auto axis = hi - lo;
+   for (auto i = size_t{0}; i < POWER_ITERATIONS; ++i) {
+      auto next = zero();
+      for (const auto& t: block) {
+         const auto d = t - mean;
+         next += d * simd::dot(d, axis);
+      }
+      const auto length = simd::length(next);
+      if (length < 1e-6f) {
+         break;
+      }
+      axis = next * (1.0f / length);
+   }
+   if (simd::dot(axis, axis) < 1e-12f) {
+      return {mean, mean};
+   }
+   axis = simd::normalize(axis);
+   auto t_min = std::numeric_limits<float>::max();
+   auto t_max = std::numeric_limits<float>::lowest();
+   for (const auto& t: block) {
+      const auto projection = simd::dot(t - mean, axis);
+      t_min = std::min(t_min, projection);
+      t_max = std::max(t_max, projection);
+   }
+   return {clamp255(mean + axis * t_min), clamp255(mean + axis * t_max)};
+}
+
+/// least squares endpoints for the weights the texels picked, unchanged
+/// when the weights cannot tell the endpoints apart
+template <size_t N>
+auto refine(const Block& block, const std::array<int, N>& weights, const std::array<std::uint8_t, 16>& indexes,
+   const std::pair<Texel, Texel> endpoints) -> std::pair<Texel, Texel> {
+   auto a00 = 0.0f;
+   auto a01 = 0.0f;
+   auto a11 = 0.0f;
+   auto b0 = zero();
+   auto b1 = zero();
+   for (auto i = size_t{0}; i < 16; ++i) {
+      const auto a = static_cast<float>(weights[indexes[i]]) / 64.0f;
+      a00 += (1.0f - a) * (1.0f - a);
+      a01 += (1.0f - a) * a;
+      a11 += a * a;
+      b0 += block[i] * (1.0f - a);
+      b1 += block[i] * a;
+   }
+   const auto det = a00 * a11 - a01 * a01;
+   if (std::abs(det) < 1e-6f) {
+      return endpoints;
+   }
+   return {clamp255((b0 * a11 - b1 * a01) * (1.0f / det)), clamp255((b1 * a00 - b0 * a01) * (1.0f / det))};
+}
+
+/// nearest palette entry of every texel, returns the squared error
+template <size_t N>
+auto pick(const Block& block, const std::array<Texel, N>& palette, std::array<std::uint8_t, 16>& indexes) -> float {
+   auto error = 0.0f;
+   for (auto i = size_t{0}; i < 16; ++i) {
+      auto best = std::numeric_limits<float>::max();
+      for (auto k = size_t{0}; k < N; ++k) {
+         const auto d = block[i] - palette[k];
+         const auto e = simd::dot(d, d);
+         if (e < best) {
+            best = e;
+            indexes[i] = static_cast<std::uint8_t>(k);
+         }
+      }
+      error += best;
+   }
+   return error;
+}
+
+auto refinements(const EncodeQuality quality) -> size_t {
+   switch (quality) {
+      case EncodeQuality::Fast: return 0;
+      case EncodeQuality::Normal: return 1;
+      case EncodeQuality::High: default: return 4;
+   }
+}
+
+// ---- BC4 / BC5 -------------------------------------------------------------
+
+auto bc4Palette(const int r0, const int r1) -> std::array<int, 8> {
+   auto p = std::array<int, 8>{r0, r1, 0, 0, 0, 0, 0, 0};
+   if (r0 > r1) {
+      for (auto i = 2; i < 8; ++i) {
+         p[i] = ((8 - i) * r0 + (i - 1) * r1 + 3) / 7;
+      }
+   } else {
+      for (auto i = 2; i < 6; ++i) {
+         p[i] = ((6 - i) * r0 + (i - 1) * r1 + 2) / 5;
+      }
+      p[6] = 0;
+      p[7] = 255;
+   }
+   return p;
+}
+
+struct Bc4Block {
+   int r0{0};
+   int r1{0};
+   std::array<std::uint8_t, 16> indexes{};
+   int error{std::numeric_limits<int>::max()};
+};
+
+auto bc4Try(const std::array<int, 16>& values, const int r0, const int r1, Bc4Block& best) -> void {
+   const auto palette = bc4Palette(r0, r1);
+   auto candidate = Bc4Block{r0, r1, {}, 0};
+   for (auto i = size_t{0}; i < 16; ++i) {
+      auto e_best = std::numeric_limits<int>::max();
+      for (auto k = size_t{0}; k < 8; ++k) {
+         const auto e = (values[i] - palette[k]) * (values[i] - palette[k]);
+         if (e < e_best) {
+            e_best = e;
+            candidate.indexes[i] = static_cast<std::uint8_t>(k);
+         }
+      }
+      candidate.error += e_best;
+   }
+   if (candidate.error < best.error) {
+      best = candidate;
+   }
+}
+
+/// 8 interpolated values between the extremes; from Normal on also 6
+/// values between the extremes of what is not 0 or 255, which come free
+auto encodeBc4(const std::array<int, 16>& values, const EncodeQuality quality, std::byte* const out) -> void {
+   const auto [lo_it, hi_it] = std::ranges::minmax_element(values);
+   const auto lo = *lo_it;
+   const auto hi = *hi_it;
+   auto best = Bc4Block{};
+   bc4Try(values, hi, lo, best);
+   if (quality != EncodeQuality::Fast and best.error > 0) {
+      auto inner_lo = 255;
+      auto inner_hi = 0;
+      for (const auto v: values) {
+         if (v != 0 and v != 255) {
+            inner_lo = std::min(inner_lo, v);
+            inner_hi = std::max(inner_hi, v);
+         }
+      }
+      if (inner_lo <= inner_hi) {
+         bc4Try(values, inner_lo, inner_hi, best);
+      }
+      if (quality == EncodeQuality::High) {
+         for (auto d0 = -1; d0 <= 1; ++d0) {
+            for (auto d1 = -1; d1 <= 1; ++d1) {
+               const auto r0 = std::clamp(hi + d0, 0, 255);
+               const auto r1 = std::clamp(lo + d1, 0, 255);
+               if (r0 > r1) {
+                  bc4Try(values, r0, r1, best);
+               }
+               if (inner_lo <= inner_hi) {
+                  bc4Try(values, std::clamp(inner_lo + d1, 0, 255), std::clamp(inner_hi + d0, 0, 255), best);
+               }
+            }
+         }
+      }
+   }
+
+   auto bits = Bits{};
+   bits.put(static_cast<std::uint32_t>(best.r0), 8);
+   bits.put(static_cast<std::uint32_t>(best.r1), 8);
+   for (const auto index: best.indexes) {
+      bits.put(index, 3);
+   }
+   std::copy_n(reinterpret_cast<const std::byte*>(bits.bytes.data()), 8, out);
+}
+
+auto decodeBc4(const std::byte* const in) -> std::array<int, 16> {
+   auto bits = Bits{};
+   std::copy_n(reinterpret_cast<const std::uint8_t*>(in), 8, bits.bytes.data());
+   const auto r0 = static_cast<int>(bits.get(8));
+   const auto r1 = static_cast<int>(bits.get(8));
+   const auto palette = bc4Palette(r0, r1);
+   auto values = std::array<int, 16>{};
+   for (auto& v: values) {
+      v = palette[bits.get(3)];
+   }
+   return values;
+}
+
+auto channel(const Block& block, const size_t c) -> std::array<int, 16> {
+   auto values = std::array<int, 16>{};
+   for (auto i = size_t{0}; i < 16; ++i) {
+      values[i] = static_cast<int>(block[i][c]);
+   }
+   return values;
+}
+
+// ---- BC7 mode 6 ------------------------------------------------------------
+
+struct Bc7Endpoint {
+   std::array<int, 4> color{};
+   int p{0};
+
+   [[nodiscard]] auto value() const -> std::array<int, 4> {
+      return {color[0] << 1 | p, color[1] << 1 | p, color[2] << 1 | p, color[3] << 1 | p};
+   }
+};
+
+auto bc7Quantize(const Texel e, const int p) -> Bc7Endpoint {
+   auto q = Bc7Endpoint{{}, p};
+   for (auto c = 0; c < 4; ++c) {
+      q.color[c] = std::clamp(static_cast<int>(std::lround((e[c] - static_cast<float>(p)) / 2.0f)), 0, 127);
+   }
+   return q;
+}
+
+auto bc7Palette(const Bc7Endpoint& e0, const Bc7Endpoint& e1) -> std::array<Texel, 16> {
+   const auto a = e0.value();
+   const auto b = e1.value();
+   auto palette = std::array<Texel, 16>{};
+   for (auto k = size_t{0}; k < 16; ++k) {
+      const auto w = BC7_WEIGHTS[k];
+      auto v = std::array<float, 4>{};
+      for (auto c = 0; c < 4; ++c) {
+         v[c] = static_cast<float>(((64 - w) * a[c] + w * b[c] + 32) >> 6);
+      }
+      palette[k] = Texel{v[0], v[1], v[2], v[3]};
+   }
+   return palette;
+}
+
+struct Bc7Block {
+   Bc7Endpoint e0;
+   Bc7Endpoint e1;
+   std::array<std::uint8_t, 16> indexes{};
+   float error{std::numeric_limits<float>::max()};
+};
+
+auto encodeBc7(const Block& block, const EncodeQuality quality, std::byte* const out) -> void {
+   auto endpoints = initialEndpoints(block, quality);
+   auto best = Bc7Block{};
+   for (auto r = size_t{0}; r <= refinements(quality); ++r) {
+      /// High tries the four p-bit pairs, the others take the closest p-bit of each endpoint
+      auto pairs = std::array<std::pair<int, int>, 4>{{{0, 0}, {0, 1}, {1, 0}, {1, 1}}};
+      auto pair_count = pairs.size();
+      if (quality != EncodeQuality::High) {
+         const auto closest = [](const Texel e) {
+            const auto error = [&](const int p) {
+               const auto v = bc7Quantize(e, p).value();
+               auto sum = 0.0f;
+               for (auto c = 0; c < 4; ++c) {
+                  sum += (e[c] - static_cast<float>(v[c])) * (e[c] - static_cast<float>(v[c]));
+               }
+               return sum;
+            };
+            return error(1) < error(0) ? 1 : 0;
+         };
+         pairs[0] = {closest(endpoints.first), closest(endpoints.second)};
+         pair_count = 1;
+      }
+      auto round = Bc7Block{};
+      for (const auto& [p0, p1]: std::span{pairs}.first(pair_count)) {
+         auto candidate = Bc7Block{bc7Quantize(endpoints.first, p0), bc7Quantize(endpoints.second, p1), {}, 0.0f};
+         candidate.error = pick(block, bc7Palette(candidate.e0, candidate.e1), candidate.indexes);
+         if (candidate.error < round.error) {
+            round = candidate;
+         }
+      }
+      if (round.error < best.error) {
+         best = round;
+      }
+      if (best.error == 0.0f) {
+         break;
+      }
+      endpoints = refine(block, BC7_WEIGHTS, round.indexes, endpoints);
+   }
+
+   /// the first index is stored without its top bit, which has to be 0
+   if (best.indexes[0] >= 8) {
+      std::swap(best.e0, best.e1);
+      for (auto& i: best.indexes) {
+         i = static_cast<std::uint8_t>(15 - i);
+      }
+   }
+   auto bits = Bits{};
+   bits.put(1u << 6, 7);
+   for (auto c = 0; c < 4; ++c) {
+      bits.put(static_cast<std::uint32_t>(best.e0.color[c]), 7);
+      bits.put(static_cast<std::uint32_t>(best.e1.color[c]), 7);
+   }
+   bits.put(static_cast<std::uint32_t>(best.e0.p), 1);
+   bits.put(static_cast<std::uint32_t>(best.e1.p), 1);
+   for (auto i = size_t{0}; i < 16; ++i) {
+      bits.put(best.indexes[i], i == 0 ? 3 : 4);
+   }
+   std::copy_n(reinterpret_cast<const std::byte*>(bits.bytes.data()), 16, out);
+}
+
+/// mode 6 only, blocks in any other mode decode to zero
+auto decodeBc7(const std::byte* const in) -> std::array<std::array<std::uint8_t, 4>, 16> {
+   auto bits = Bits{};
+   std::copy_n(reinterpret_cast<const std::uint8_t*>(in), 16, bits.bytes.data());
+   auto texels = std::array<std::array<std::uint8_t, 4>, 16>{};
+   if (bits.get(7) != 1u << 6) {
+      return texels;
+   }
+   auto e0 = Bc7Endpoint{};
+   auto e1 = Bc7Endpoint{};
+   for (auto c = 0; c < 4; ++c) {
+      e0.color[c] = static_cast<int>(bits.get(7));
+      e1.color[c] = static_cast<int>(bits.get(7));
+   }
+   e0.p = static_cast<int>(bits.get(1));
+   e1.p = static_cast<int>(bits.get(1));
+   const auto palette = bc7Palette(e0, e1);
+   for (auto i = size_t{0}; i < 16; ++i) {
+      const auto& p = palette[bits.get(i == 0 ? 3 : 4)];
+      texels[i] = {static_cast<std::uint8_t>(p[0]), static_cast<std::uint8_t>(p[1]),
+         static_cast<std::uint8_t>(p[2]), static_cast<std::uint8_t>(p[3])};
+   }
+   return texels;
+}
+
+// ---- ASTC 4x4 ----------------------------------------------------------------
+
+/// LDR decoding of UNORM8: endpoints widened to 16 bit, interpolated,
+/// the top byte kept
+auto astcInterpolate(const int a, const int b, const int w) -> int {
+   return ((a * 257 * (64 - w) + b * 257 * w + 32) >> 6) >> 8;
+}
+
+template <size_t N>
+auto astcPalette(const std::array<int, 4>& e0, const std::array<int, 4>& e1, const std::array<int, N>& weights)
+   -> std::array<Texel, N> {
+   auto palette = std::array<Texel, N>{};
+   for (auto k = size_t{0}; k < N; ++k) {
+      palette[k] = Texel{static_cast<float>(astcInterpolate(e0[0], e1[0], weights[k])),
+         static_cast<float>(astcInterpolate(e0[1], e1[1], weights[k])),
+         static_cast<float>(astcInterpolate(e0[2], e1[2], weights[k])),
+         static_cast<float>(astcInterpolate(e0[3], e1[3], weights[k]))};
+   }
+   return palette;
+}
+
+auto astcQuantize(const Texel e) -> std::array<int, 4> {
+   return {static_cast<int>(std::lround(e[0])), static_cast<int>(std::lround(e[1])),
+      static_cast<int>(std::lround(e[2])), static_cast<int>(std::lround(e[3]))};
+}
+
+template <size_t N>
+auto encodeAstc(const Block& block, const EncodeQuality quality, const std::array<int, N>& weights,
+   const bool alpha, std::byte* const out) -> void {
+   auto endpoints = initialEndpoints(block, quality);
+   auto e0 = std::array<int, 4>{};
+   auto e1 = std::array<int, 4>{};
+   auto indexes = std::array<std::uint8_t, 16>{};
+   auto error = std::numeric_limits<float>::max();
+   for (auto r = size_t{0}; r <= refinements(quality); ++r) {
+      const auto q0 = astcQuantize(endpoints.first);
+      const auto q1 = astcQuantize(endpoints.second);
+      auto round = std::array<std::uint8_t, 16>{};
+      const auto e = pick(block, astcPalette(q0, q1, weights), round);
+      if (e < error) {
+         error = e;
+         e0 = q0;
+         e1 = q1;
+         indexes = round;
+      }
+      if (error == 0.0f) {
+         break;
+      }
+      endpoints = refine(block, weights, round, endpoints);
+   }
+
+   /// endpoints whose second sums lower than the first are decoded with
+   /// blue contraction, swapped they are taken as they are
+   if (e1[0] + e1[1] + e1[2] < e0[0] + e0[1] + e0[2]) {
+      std::swap(e0, e1);
+      for (auto& i: indexes) {
+         i = static_cast<std::uint8_t>(N - 1 - i);
+      }
+   }
+
+   auto bits = Bits{};
+   bits.put(alpha ? ASTC_MODE_WEIGHTS_2 : ASTC_MODE_WEIGHTS_3, 11);
+   /// one partition
+   bits.put(0, 2);
+   bits.put(alpha ? ASTC_CEM_RGBA : ASTC_CEM_RGB, 4);
+   for (auto c = 0; c < (alpha ? 4 : 3); ++c) {
+      bits.put(static_cast<std::uint32_t>(e0[c]), 8);
+      bits.put(static_cast<std::uint32_t>(e1[c]), 8);
+   }
+   /// weights are stored from the top bit of the block down
+   auto weight_bits = Bits{};
+   for (const auto index: indexes) {
+      weight_bits.put(index, std::bit_width(N - 1));
+   }
+   for (auto b = size_t{0}; b < weight_bits.position; ++b) {
+      const auto bit = (weight_bits.bytes[b / 8] >> (b % 8)) & 1u;
+      bits.bytes[(127 - b) / 8] |= static_cast<std::uint8_t>(bit << ((127 - b) % 8));
+   }
+   std::copy_n(reinterpret_cast<const std::byte*>(bits.bytes.data()), 16, out);
+}
+
+auto decodeAstc(const std::byte* const in) -> std::array<std::array<std::uint8_t, 4>, 16> {
+   auto bits = Bits{};
+   std::copy_n(reinterpret_cast<const std::uint8_t*>(in), 16, bits.bytes.data());
+   const auto mode = bits.get(11);
+   const auto partitions = bits.get(2);
+   const auto cem = bits.get(4);
+   const auto alpha = mode == ASTC_MODE_WEIGHTS_2 and cem == ASTC_CEM_RGBA;
+   ensure(partitions == 0 and (alpha or (mode == ASTC_MODE_WEIGHTS_3 and cem == ASTC_CEM_RGB)),
+      std::format("ASTC block of mode {:#x} with {} partitions and endpoint mode {} is not decoded",
+         mode, partitions + 1, cem));
+
+   auto e0 = std::array<int, 4>{0, 0, 0, 255};
+   auto e1 = std::array<int, 4>{0, 0, 0, 255};
+   for (auto c = 0; c < (alpha ? 4 : 3); ++c) {
+      e0[c] = static_cast<int>(bits.get(8));
+      e1[c] = static_cast<int>(bits.get(8));
+   }
+   const auto weight_bits = alpha ? 2u : 3u;
+   auto texels = std::array<std::array<std::uint8_t, 4>, 16>{};
+   for (auto i = size_t{0}; i < 16; ++i) {
+      auto index = 0u;
+      for (auto b = size_t{0}; b < weight_bits; ++b) {
+         const auto position = 127 - (i * weight_bits + b);
+         index |= ((bits.bytes[position / 8] >> (position % 8)) & 1u) << b;
+      }
+      const auto w = alpha ? ASTC_WEIGHTS_2[index] : ASTC_WEIGHTS_3[index];
+      for (auto c = 0; c < 4; ++c) {
+         texels[i][c] = static_cast<std::uint8_t>(astcInterpolate(e0[c], e1[c], w));
+      }
+   }
+   return texels;
+}
+
+}
+
+auto encodeBlocks(const Image& image, const BlockFormat format, const EncodeQuality quality) -> std::vector<std::byte> {
+   ensure(image.width > 0 and image.height > 0 and image.pixels.size() == image.bytesPerRow() * image.height,
+      std::format("cannot encode a {}x{} image of {} bytes", image.width, image.height, image.pixels.size()));
+   const auto blocks_wide = (size_t{image.width} + 3) / 4;
+   const auto blocks_high = (size_t{image.height} + 3) / 4;
+   const auto size = blockBytes(format);
+   auto blocks = std::vector<std::byte>(compressedSize(format, image.width, image.height));
+
+   parallelFor(blocks_high, BLOCK_ROW_GRAIN, [&](const size_t begin, const size_t end) {
+      for (auto by = begin; by < end; ++by) {
+         for (auto bx = size_t{0}; bx < blocks_wide; ++bx) {
+            const auto block = fetch(image, bx, by);
+            const auto out = blocks.data() + (by * blocks_wide + bx) * size;
+            switch (format) {
+               case BlockFormat::BC4:
+                  encodeBc4(channel(block, 0), quality, out);
+                  break;
+               case BlockFormat::BC5:
+                  encodeBc4(channel(block, 0), quality, out);
+                  encodeBc4(channel(block, 1), quality, out + 8);
+                  break;
+               case BlockFormat::BC7:
+                  encodeBc7(block, quality, out);
+                  break;
+               case BlockFormat::ASTC4x4: {
+                  const auto opaque = std::ranges::all_of(block, [](const Texel& t) {return t[3] == 255.0f;});
+                  if (opaque) {
+                     encodeAstc(block, quality, ASTC_WEIGHTS_3, false, out);
+                  } else {
+                     encodeAstc(block, quality, ASTC_WEIGHTS_2, true, out);
+                  }
+                  break;
+               }
+            }
+         }
+      }
+   });
+   return blocks;
+}
+
+auto decodeBlocks(const std::span<const std::byte> blocks, const BlockFormat format,
+   const size_t width, const size_t height) -> Image {
+   ensure(blocks.size() == compressedSize(format, width, height),
+      std::format("{} bytes of blocks for a {}x{} image", blocks.size(), width, height));
+   auto image = Image{static_cast<std::uint32_t>(width), static_cast<std::uint32_t>(height), {}};
+   image.pixels.resize(image.bytesPerRow() * image.height);
+   const auto blocks_wide = (width + 3) / 4;
+   const auto size = blockBytes(format);
+
+   parallelFor((height + 3) / 4, BLOCK_ROW_GRAIN, [&](const size_t begin, const size_t end) {
+      for (auto by = begin; by < end; ++by) {
+         for (auto bx = size_t{0}; bx < blocks_wide; ++bx) {
+            const auto in = blocks.data() + (by * blocks_wide + bx) * size;
+            auto texels = std::array<std::array<std::uint8_t, 4>, 16>{};
+            switch (format) {
+               case BlockFormat::BC4:
+               case BlockFormat::BC5: {
+                  const auto r = decodeBc4(in);
+                  const auto g = format == BlockFormat::BC5 ? decodeBc4(in + 8) : std::array<int, 16>{};
+                  for (auto i = size_t{0}; i < 16; ++i) {
+                     texels[i] = {static_cast<std::uint8_t>(r[i]), static_cast<std::uint8_t>(g[i]), 0, 255};
+                  }
+                  break;
+               }
+               case BlockFormat::BC7:
+                  texels = decodeBc7(in);
+                  break;
+               case BlockFormat::ASTC4x4:
+                  texels = decodeAstc(in);
+                  break;
+            }
+            store(image, bx, by, texels);
+         }
+      }
+   });
+   return image;
+}
+
+auto psnr(const Image& a, const Image& b, const size_t channels) -> double {
+   ensure(a.width == b.width and a.height == b.height and channels > 0 and channels <= 4,
+      std::format("cannot compare {} channels of {}x{} and {}x{}", channels, a.width, a.height, b.width, b.height));
+   auto sum = 0.0;
+   for (auto i = size_t{0}; i < a.pixels.size(); i += 4) {
+      for (auto c = i; c < i + channels; ++c) {
+         const auto d = static_cast<double>(a.pixels[c]) - static_cast<double>(b.pixels[c]);
+         sum += d * d;
+      }
+   }
+   const auto mse = sum / static_cast<double>(a.pixels.size() / 4 * channels);
+   return mse == 0.0 ? std::numeric_limits<double>::infinity() : 10.0 * std::log10(255.0 * 255.0 / mse);
+}
+
+auto compressMipChain(const MipChain& chain, const BlockFormat format, const EncodeQuality quality) -> CompressedChain {
+   ensure(not chain.levels.empty(), "cannot compress an empty mip chain");
+   auto compressed = CompressedChain{format, chain.levels.front().width, chain.levels.front().height, {}};
+   compressed.levels.reserve(chain.levels.size());
+   for (const auto& level: chain.levels) {
+      compressed.levels.push_back(encodeBlocks(level, format, quality));
+   }
+   return compressed;
+}
+
+}
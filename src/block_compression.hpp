@@ -0,0 +1,70 @@
+#ifndef GAME_TUTORIAL_BLOCK_COMPRESSION_HPP
+#define GAME_TUTORIAL_BLOCK_COMPRESSION_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "image.hpp"
+#include "mip_chain.hpp"
+
+namespace game {
+
+/// GPU formats of 4x4 texel blocks
+enum class BlockFormat : std::uint32_t {
+   /// one channel (R), 8 bytes a block: roughness, metallic, masks
+   BC4,
+   /// two BC4 blocks (R and G): normal maps with z rebuilt in the shader
+   BC5,
+   /// RGBA, written in mode 6 only (one subset, 4 bit indexes)
+   BC7,
+   /// RGBA, one partition with 8 bit endpoints: 3 bit weights for opaque
+   /// blocks, 2 bit weights when they have alpha
+   ASTC4x4
+};
+
+/// how hard the encoder looks for endpoints
+enum class EncodeQuality : std::uint32_t {
+   /// the bounding box of the block
+   Fast,
+   /// the principal axis of the block, refined once by least squares
+   Normal,
+   /// refined further, with every choice of BC7 p-bits and BC4 endpoints
+   /// close to the extremes tried
+   High
+};
+
+[[nodiscard]] constexpr auto blockBytes(const BlockFormat format) -> size_t {
+   return format == BlockFormat::BC4 ? 8 : 16;
+}
+
+/// blocks past the right and bottom edges count in full
+[[nodiscard]] constexpr auto compressedSize(const BlockFormat format, const size_t width, const size_t height) -> size_t {
+   return (width + 3) / 4 * ((height + 3) / 4) * blockBytes(format);
+}
+
+/// Blocks in rows, as the GPU reads them; texels past the edges repeat
+/// the edge. Rows of blocks are split across threads.
+[[nodiscard]] auto encodeBlocks(const Image& image, BlockFormat format, EncodeQuality quality) -> std::vector<std::byte>;
+/// back to RGBA8 as the GPU samples it: BC4 gives (r, 0, 0, 255), BC5
+/// (r, g, 0, 255); throws on ASTC blocks this encoder does not write
+[[nodiscard]] auto decodeBlocks(std::span<const std::byte> blocks, BlockFormat format,
+   size_t width, size_t height) -> Image;
+/// peak signal to noise ratio in dB over the first channels of every
+/// texel, infinite when the images are equal
+[[nodiscard]] auto psnr(const Image& a, const Image& b, size_t channels) -> double;
+
+/// a mip chain encoded level by level
+struct CompressedChain {
+   BlockFormat format{BlockFormat::BC7};
+   std::uint32_t width{0};
+   std::uint32_t height{0};
+   std::vector<std::vector<std::byte>> levels;
+};
+
+[[nodiscard]] auto compressMipChain(const MipChain& chain, BlockFormat format, EncodeQuality quality) -> CompressedChain;
+
+}
+
+#endif // GAME_TUTORIAL_BLOCK_COMPRESSION_HPP
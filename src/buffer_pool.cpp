@@ -0,0 +1,98 @@
+#include "buffer_pool.hpp"
+#include "error.hpp"
+#include "mapped_file.hpp"
+
+#include <algorithm>
+
+namespace game {
+
+BufferPool::BufferPool(MTL::Device* const device, const size_t unit, const std::uint32_t arena_units,
+   const MTL::ResourceOptions options)
+   : _device(device), _unit(unit), _arenaUnits(arena_units), _options(options) {
+}
+
+auto BufferPool::allocate(const std::uint32_t count) -> BufferRange {
+   for (auto a = 0u; a < _arenas.size(); ++a) {
+      if (const auto allocation = _arenas[a].allocator.allocate(count); allocation.valid()) {
+         return {a, count, allocation};
+      }
+   }
+
+   const auto units = std::max(count, _arenaUnits);
+   auto buffer = AutoRelease<MTL::Buffer*>{
+      _device->newBuffer(units * _unit, _options),
+      [](auto t) {t->release();}
+   };
+   ensure(buffer.get() != nullptr, std::format("could not allocate a {} bytes buffer arena", units * _unit));
+   _arenas.emplace_back(std::move(buffer), RangeAllocator{units});
+   const auto allocation = _arenas.back().allocator.allocate(count);
+   return {static_cast<std::uint32_t>(_arenas.size() - 1), count, allocation};
+}
+
+auto BufferPool::adopt(const std::span<std::byte> memory, const std::uint32_t count,
+   std::shared_ptr<const void> backing) -> BufferRange {
+   ensure(reinterpret_cast<std::uintptr_t>(memory.data()) % MappedFile::pageSize() == 0 and
+      memory.size() % MappedFile::pageSize() == 0,
+      "no-copy buffers need page aligned memory");
+   ensure(memory.size() >= count * _unit,
+      std::format("{} bytes cannot hold {} units of {} bytes", memory.size(), count, _unit));
+   auto buffer = AutoRelease<MTL::Buffer*>{
+      _device->newBuffer(memory.data(), memory.size(), MTL::ResourceStorageModeShared, nullptr),
+      [](auto t) {t->release();}
+   };
+   ensure(buffer.get() != nullptr, "could not wrap memory in a no-copy buffer");
+   _arenas.emplace_back(std::move(buffer), RangeAllocator{count}, std::move(backing));
+   const auto allocation = _arenas.back().allocator.allocate(count);
+   return {static_cast<std::uint32_t>(_arenas.size() - 1), count, allocation};
+}
+
+auto BufferPool::free(BufferRange& range) -> void {
+   if (not range.valid()) {
+      return;
+   }
+   _arenas[range.arena].allocator.free(range.allocation);
+   range = {};
+}
+
+auto BufferPool::getBuffer(const BufferRange& range) const -> MTL::Buffer* {
+   return range.valid() ? _arenas[range.arena].buffer.get() : nullptr;
+}
+
+auto BufferPool::defragment(const std::span<BufferRange* const> live, MTL::BlitCommandEncoder* const blit) -> size_t {
+   auto sorted = std::vector<BufferRange*>(live.begin(), live.end());
+   std::ranges::sort(sorted, [](const BufferRange* a, const BufferRange* b) {
+      return a->arena != b->arena ? a->arena < b->arena : a->offset() < b->offset();
+   });
+
+   /// blits cannot overlap source and destination, every arena that owns
+   /// its memory is copied into a new buffer. The old ones are released
+   /// here, the command buffer of blit keeps them alive until it is done.
+   /// Adopted arenas hold a single range at offset 0 and never move.
+   auto previous = std::vector<AutoRelease<MTL::Buffer*>>(_arenas.size());
+   for (auto a = 0u; a < _arenas.size(); ++a) {
+      auto& arena = _arenas[a];
+      arena.allocator.reset();
+      if (arena.backing == nullptr) {
+         previous[a] = std::move(arena.buffer);
+         arena.buffer = AutoRelease<MTL::Buffer*>{
+            _device->newBuffer(previous[a]->length(), _options),
+            [](auto t) {t->release();}
+         };
+         ensure(arena.buffer.get() != nullptr, "could not allocate a buffer arena to defragment into");
+      }
+   }
+   auto moved = size_t{0};
+   for (auto* range: sorted) {
+      auto& arena = _arenas[range->arena];
+      const auto allocation = arena.allocator.allocate(range->count);
+      if (arena.backing == nullptr) {
+         blit->copyFromBuffer(previous[range->arena].get(), byteOffset(*range),
+            arena.buffer.get(), allocation.offset * _unit, range->count * _unit);
+         moved += allocation.offset != range->offset() ? range->count : 0;
+      }
+      range->allocation = allocation;
+   }
+   return moved;
+}
+
+}
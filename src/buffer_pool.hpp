@@ -0,0 +1,92 @@
+#ifndef GAME_TUTORIAL_BUFFER_POOL_HPP
+#define GAME_TUTORIAL_BUFFER_POOL_HPP
+
+#include <Metal/Metal.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "auto_release.hpp"
+#include "range_allocator.hpp"
+#include "vertex_data.hpp"
+
+namespace game {
+
+/// a range of units inside one of the arenas of a BufferPool
+struct BufferRange {
+   std::uint32_t arena{RangeAllocator::INVALID};
+   std::uint32_t count{0};
+   RangeAllocator::Allocation allocation{};
+   [[nodiscard]] constexpr auto valid() const -> bool {return allocation.valid();}
+   [[nodiscard]] constexpr auto offset() const -> std::uint32_t {return allocation.offset;}
+};
+
+/// Sub-allocates ranges from a few large MTL::Buffers (arenas).
+/// Everything is measured in units of a fixed size, so a vertex pool
+/// hands out offsets that can be used directly as base vertex.
+/// A new arena is opened when no existing one has room, requests larger
+/// than an arena get an arena of their own.
+class BufferPool {
+public:
+   BufferPool(MTL::Device* device, size_t unit, std::uint32_t arena_units,
+      MTL::ResourceOptions options = MTL::ResourceStorageModeShared);
+   BufferPool(const BufferPool&) = delete;
+   BufferPool(BufferPool&&)      = delete;
+
+   [[nodiscard]] auto allocate(std::uint32_t count) -> BufferRange;
+   auto free(BufferRange& range) -> void;
+   /// Wraps page aligned memory (e.g. a mapped file) in a no-copy buffer
+   /// that becomes an arena of its own, fully taken by the returned range.
+   /// backing is kept alive as long as the arena.
+   [[nodiscard]] auto adopt(std::span<std::byte> memory, std::uint32_t count,
+      std::shared_ptr<const void> backing) -> BufferRange;
+
+   [[nodiscard]] auto getBuffer(const BufferRange& range) const -> MTL::Buffer*;
+   [[nodiscard]] constexpr auto byteOffset(const BufferRange& range) const -> size_t {return range.offset() * _unit;}
+   [[nodiscard]] constexpr auto getUnit() const -> size_t {return _unit;}
+   [[nodiscard]] constexpr auto getArenaCount() const -> size_t {return _arenas.size();}
+
+   /// Packs the given ranges at the start of their arena and updates them
+   /// in place. Anything not listed is treated as freed. Contents are
+   /// blitted into fresh arena buffers, so this works for private storage
+   /// too; draws must use the new buffers once blit has been committed.
+   /// Returns the number of units moved.
+   auto defragment(std::span<BufferRange* const> live, MTL::BlitCommandEncoder* blit) -> size_t;
+
+private:
+   struct Arena {
+      AutoRelease<MTL::Buffer*> buffer;
+      RangeAllocator allocator;
+      std::shared_ptr<const void> backing{};
+   };
+
+   MTL::Device* _device;
+   size_t _unit;
+   std::uint32_t _arenaUnits;
+   MTL::ResourceOptions _options;
+   std::vector<Arena> _arenas;
+};
+
+/// the two pools every mesh draws from
+struct MeshBufferPool {
+   /// 16MB arenas, indexes are allocated in 4 byte words so that every
+   /// index buffer offset is aligned for both 16 and 32 bit indexes.
+   /// Arenas are private, filled through an UploadManager.
+   static constexpr size_t ARENA_BYTES = size_t{16} << 20;
+
+   explicit MeshBufferPool(MTL::Device* device)
+      : vertices(device, sizeof(VertexData), static_cast<std::uint32_t>(ARENA_BYTES / sizeof(VertexData)),
+           MTL::ResourceStorageModePrivate),
+        indexes(device, sizeof(std::uint32_t), static_cast<std::uint32_t>(ARENA_BYTES / sizeof(std::uint32_t)),
+           MTL::ResourceStorageModePrivate) {}
+
+   BufferPool vertices;
+   BufferPool indexes;
+};
+
+}
+
+#endif // GAME_TUTORIAL_BUFFER_POOL_HPP
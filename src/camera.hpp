@@ -23,6 +23,10 @@ public:
    [[nodiscard]] constexpr auto getCamera() const -> const Matrix4& {return _camera;}
    [[nodiscard]] constexpr auto getLookAt() const -> Matrix4 {return Matrix4::lookAt(_eye, _lookAt, _up);}
    [[nodiscard]] constexpr auto getProj() const -> Matrix4 {return Matrix4::perspective(_fov, _width, _height, _nearPlane, _farPlane);}
+   /// vertical, in radians
+   [[nodiscard]] constexpr auto getFov() const -> float {return _fov;}
+   /// of the viewport, in pixels
+   [[nodiscard]] constexpr auto getHeight() const -> float {return _height;}
 
 
    [[nodiscard]] constexpr auto getRight() const -> Vector3 {
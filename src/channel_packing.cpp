@@ -0,0 +1,66 @@
+#include "channel_packing.hpp"
+#include "error.hpp"
+#include "parallel_for.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace game {
+
+namespace {
+
+constexpr size_t ROW_GRAIN = 16;
+
+auto unorm(const std::byte b) -> float {
+   return static_cast<float>(std::to_integer<std::uint8_t>(b)) / 255.0f * 2.0f - 1.0f;
+}
+
+auto snorm(const float v) -> std::byte {
+   return static_cast<std::byte>(std::lround(std::clamp(v * 0.5f + 0.5f, 0.0f, 1.0f) * 255.0f));
+}
+
+}
+
+auto packOrm(const Image* const occlusion, const Image& roughness, const Image& metallic) -> Image {
+   const auto same_size = [&](const Image& image) {
+      return image.width == roughness.width and image.height == roughness.height;
+   };
+   ensure(same_size(metallic) and (occlusion == nullptr or same_size(*occlusion)), std::format(
+      "cannot pack images of different sizes, roughness is {}x{}, metallic {}x{}",
+      roughness.width, roughness.height, metallic.width, metallic.height));
+
+   auto orm = Image{roughness.width, roughness.height, std::vector<std::byte>(roughness.pixels.size())};
+   parallelFor(orm.height, ROW_GRAIN, [&](const size_t begin, const size_t end) {
+      for (auto i = begin * orm.width; i < end * orm.width; ++i) {
+         orm.pixels[i * 4 + 0] = occlusion ? occlusion->pixels[i * 4] : std::byte{255};
+         orm.pixels[i * 4 + 1] = roughness.pixels[i * 4];
+         orm.pixels[i * 4 + 2] = metallic.pixels[i * 4];
+         orm.pixels[i * 4 + 3] = std::byte{255};
+      }
+   });
+   return orm;
+}
+
+auto packNormalXY(const Image& normal) -> Image {
+   auto xy = Image{normal.width, normal.height, std::vector<std::byte>(normal.pixels.size())};
+   parallelFor(xy.height, ROW_GRAIN, [&](const size_t begin, const size_t end) {
+      for (auto i = begin * xy.width; i < end * xy.width; ++i) {
+         auto x = unorm(normal.pixels[i * 4 + 0]);
+         auto y = unorm(normal.pixels[i * 4 + 1]);
+         /// Z is rebuilt positive, a normal pointing into the surface lies on it instead
+         const auto z = std::max(unorm(normal.pixels[i * 4 + 2]), 0.0f);
+         const auto length = std::sqrt(x * x + y * y + z * z);
+         if (length > 0.0f) {
+            x /= length;
+            y /= length;
+         }
+         xy.pixels[i * 4 + 0] = snorm(x);
+         xy.pixels[i * 4 + 1] = snorm(y);
+         xy.pixels[i * 4 + 2] = std::byte{0};
+         xy.pixels[i * 4 + 3] = std::byte{255};
+      }
+   });
+   return xy;
+}
+
+}
@@ -0,0 +1,34 @@
+#ifndef GAME_TUTORIAL_CHANNEL_PACKING_HPP
+#define GAME_TUTORIAL_CHANNEL_PACKING_HPP
+
+#include <cstdint>
+
+#include "image.hpp"
+
+namespace game {
+
+/// how the images of a texture layer make up its texels
+enum class ChannelPacking : std::uint32_t {
+   /// one image as it is
+   None,
+   /// occlusion, roughness and metallic in one image, see packOrm
+   ORM,
+   /// a tangent space normal map down to X and Y, see packNormalXY
+   NormalXY
+};
+
+/// Occlusion, roughness and metallic in R, G and B, the layout glTF
+/// uses; each comes from the red channel of its image. Occlusion is
+/// optional, without it R is white. Alpha is opaque. Throws unless the
+/// images are the same size.
+[[nodiscard]] auto packOrm(const Image* occlusion, const Image& roughness, const Image& metallic) -> Image;
+
+/// Keeps X and Y of every normal in R and G, normalised first and turned
+/// to face out of the surface, so that Z = sqrt(1 - X² - Y²) rebuilds it.
+/// B is zero and alpha opaque, two channel formats drop both. Meant for
+/// every level of a mip chain: the filtered normals are shorter than one.
+[[nodiscard]] auto packNormalXY(const Image& normal) -> Image;
+
+}
+
+#endif // GAME_TUTORIAL_CHANNEL_PACKING_HPP
@@ -0,0 +1,246 @@
+#include "compressed_clip.hpp"
+#include "error.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <numbers>
+
+namespace game {
+
+namespace {
+
+using Packed = std::array<std::uint16_t, 3>;
+
+constexpr auto QUAT_BITS = 15;
+constexpr auto QUAT_MAX = static_cast<float>((1 << QUAT_BITS) - 1);
+constexpr auto RANGE_MAX = 65535.0f;
+
+auto quantize(const float x, const float max) -> std::uint16_t {
+   return static_cast<std::uint16_t>(std::lround(std::clamp(x, 0.0f, 1.0f) * max));
+}
+
+/// smallest three: the largest component is dropped and rebuilt from the
+/// others, its index goes in the top bits of the first two words
+auto packRotation(simd::float4 q) -> Packed {
+   auto largest = 0u;
+   for (auto i = 1u; i < 4u; ++i) {
+      largest = std::abs(q[i]) > std::abs(q[largest]) ? i : largest;
+   }
+   if (q[largest] < 0.0f) {
+      q = -q;
+   }
+   auto packed = Packed{};
+   for (auto i = 0u, o = 0u; i < 4u; ++i) {
+      if (i != largest) {
+         /// the others are within +-1/sqrt(2)
+         packed[o++] = quantize(q[i] * std::numbers::sqrt2_v<float> * 0.5f + 0.5f, QUAT_MAX);
+      }
+   }
+   packed[0] |= static_cast<std::uint16_t>((largest & 1u) << QUAT_BITS);
+   packed[1] |= static_cast<std::uint16_t>((largest >> 1u) << QUAT_BITS);
+   return packed;
+}
+
+auto unpackRotation(const Packed& packed) -> simd::float4 {
+   constexpr auto mask = (1u << QUAT_BITS) - 1u;
+   const auto largest = (packed[0] >> QUAT_BITS) | ((packed[1] >> QUAT_BITS) << 1u);
+   auto q = simd::float4{0.0f, 0.0f, 0.0f, 0.0f};
+   auto sum = 0.0f;
+   for (auto i = 0u, o = 0u; i < 4u; ++i) {
+      if (i != largest) {
+         const auto x = (static_cast<float>(packed[o++] & mask) / QUAT_MAX - 0.5f) * std::numbers::sqrt2_v<float>;
+         q[i] = x;
+         sum += x * x;
+      }
+   }
+   q[largest] = std::sqrt(std::max(0.0f, 1.0f - sum));
+   return q;
+}
+
+auto packRange(const simd::float3 v, const simd::float3 min, const simd::float3 extent) -> Packed {
+   auto packed = Packed{};
+   for (auto i = 0u; i < 3u; ++i) {
+      packed[i] = extent[i] > 0.0f ? quantize((v[i] - min[i]) / extent[i], RANGE_MAX) : 0;
+   }
+   return packed;
+}
+
+auto unpackRange(const Packed& packed, const simd::float3 min, const simd::float3 extent) -> simd::float3 {
+   return min + extent * simd::make_float3(static_cast<float>(packed[0]), static_cast<float>(packed[1]), static_cast<float>(packed[2])) * (1.0f / RANGE_MAX);
+}
+
+auto distance(const simd::float3 a, const simd::float3 b) -> float {return simd::length(a - b);}
+auto distance(const simd::float4 a, const simd::float4 b) -> float {
+   return std::min(simd::length(a - b), simd::length(a + b));
+}
+auto blend(const simd::float3 a, const simd::float3 b, const float t) -> simd::float3 {return a + (b - a) * t;}
+auto blend(const simd::float4 a, const simd::float4 b, const float t) -> simd::float4 {return nlerp(a, b, t);}
+
+/// frames of values that must be kept so that interpolating between them
+/// stays within tolerance of every dropped one, always the first, and
+/// the last unless the whole run is constant
+template <class T>
+auto reduceKeys(const std::span<const T> values, const float tolerance) -> std::vector<std::uint8_t> {
+   if (std::ranges::all_of(values, [&](const T& v) {return distance(v, values[0]) <= tolerance;})) {
+      return {0};
+   }
+   auto kept = std::vector<std::uint8_t>{0};
+   auto anchor = size_t{0};
+   for (auto end = size_t{2}; end < values.size(); ++end) {
+      for (auto k = anchor + 1; k < end; ++k) {
+         const auto t = static_cast<float>(k - anchor) / static_cast<float>(end - anchor);
+         if (distance(blend(values[anchor], values[end], t), values[k]) > tolerance) {
+            anchor = end - 1;
+            kept.push_back(static_cast<std::uint8_t>(anchor));
+            break;
+         }
+      }
+   }
+   kept.push_back(static_cast<std::uint8_t>(values.size() - 1));
+   return kept;
+}
+
+template <class T, class Pack>
+auto writeChannel(std::vector<std::byte>& data, const std::span<const T> values, const float tolerance,
+   Pack&& pack) -> void {
+   const auto kept = reduceKeys(values, tolerance);
+   data.push_back(static_cast<std::byte>(kept.size()));
+   const auto frames = std::as_bytes(std::span{kept});
+   data.insert(data.end(), frames.begin(), frames.end());
+   for (const auto k: kept) {
+      const auto packed = pack(values[k]);
+      const auto bytes = std::as_bytes(std::span{packed});
+      data.insert(data.end(), bytes.begin(), bytes.end());
+   }
+}
+
+/// reads one channel at a position within the segment and moves past it
+template <class T, class Unpack>
+auto readChannel(const std::byte*& cursor, const float frame, Unpack&& unpack) -> T {
+   const auto count = static_cast<std::uint8_t>(*cursor);
+   const auto* frames = reinterpret_cast<const std::uint8_t*>(cursor + 1);
+   const auto* values = cursor + 1 + count;
+   cursor = values + count * sizeof(Packed);
+
+   auto k = 0u;
+   while (k + 1 < count and static_cast<float>(frames[k + 1]) <= frame) {
+      ++k;
+   }
+   const auto value = [&](const size_t i) {
+      auto packed = Packed{};
+      std::memcpy(packed.data(), values + i * sizeof(Packed), sizeof(Packed));
+      return unpack(packed);
+   };
+   if (k + 1 >= count) {
+      return value(k);
+   }
+   const auto t = (frame - static_cast<float>(frames[k])) / static_cast<float>(frames[k + 1] - frames[k]);
+   return blend(value(k), value(k + 1), t);
+}
+
+}
+
+auto CompressedClip::compress(const AnimationClip& clip, const ClipCompression& settings) -> CompressedClip {
+   ensure(settings.sampleRate > 0.0f and settings.segmentFrames >= 1 and settings.segmentFrames <= 254,
+      std::format("cannot compress {} at {} frames per second in segments of {} frames",
+         clip.name, settings.sampleRate, settings.segmentFrames));
+
+   auto result = CompressedClip{};
+   result._name = clip.name;
+   result._duration = clip.duration;
+   result._sampleRate = settings.sampleRate;
+   result._segmentFrames = settings.segmentFrames;
+   result._jointCount = static_cast<std::uint32_t>(clip.tracks.size());
+   result._frameCount = 1 + std::max(1u, static_cast<std::uint32_t>(std::ceil(clip.duration * settings.sampleRate)));
+   const auto joints = size_t{result._jointCount};
+   const auto frames = size_t{result._frameCount};
+
+   /// frame major, as sampled
+   auto poses = std::vector<Transform>(frames * joints);
+   for (auto f = 0u; f < frames; ++f) {
+      const auto time = std::min(static_cast<float>(f) / settings.sampleRate, clip.duration);
+      clip.sample(time, std::span{poses}.subspan(f * joints, joints));
+   }
+
+   result._ranges.reserve(joints * 2);
+   for (auto j = 0u; j < joints; ++j) {
+      for (const auto member: {&Transform::translation, &Transform::scale}) {
+         auto lo = poses[j].*member;
+         auto hi = lo;
+         for (auto f = 1u; f < frames; ++f) {
+            lo = simd::min(lo, poses[f * joints + j].*member);
+            hi = simd::max(hi, poses[f * joints + j].*member);
+         }
+         result._ranges.push_back({lo, hi - lo});
+      }
+   }
+
+   const auto segment_count = std::max<size_t>(1, (frames - 1 + settings.segmentFrames - 1) / settings.segmentFrames);
+   result._segments.reserve(segment_count);
+   auto translations = std::vector<simd::float3>{};
+   auto rotations = std::vector<simd::float4>{};
+   auto scales = std::vector<simd::float3>{};
+   for (auto s = size_t{0}; s < segment_count; ++s) {
+      result._segments.push_back(static_cast<std::uint32_t>(result._data.size()));
+      const auto first = s * settings.segmentFrames;
+      const auto last = std::min(first + settings.segmentFrames, frames - 1);
+      for (auto j = 0u; j < joints; ++j) {
+         translations.clear();
+         rotations.clear();
+         scales.clear();
+         for (auto f = first; f <= last; ++f) {
+            const auto& local = poses[f * joints + j];
+            translations.push_back(local.translation);
+            rotations.push_back(local.rotation);
+            scales.push_back(local.scale);
+         }
+         const auto& [t_min, t_extent] = result._ranges[j * 2];
+         const auto& [s_min, s_extent] = result._ranges[j * 2 + 1];
+         writeChannel<simd::float3>(result._data, translations, settings.translationTolerance,
+            [&](const simd::float3 v) {return packRange(v, t_min, t_extent);});
+         writeChannel<simd::float4>(result._data, rotations, settings.rotationTolerance, packRotation);
+         writeChannel<simd::float3>(result._data, scales, settings.scaleTolerance,
+            [&](const simd::float3 v) {return packRange(v, s_min, s_extent);});
+      }
+   }
+   return result;
+}
+
+auto CompressedClip::sample(float time, const std::span<Transform> pose) const -> void {
+   ensure(pose.size() == _jointCount,
+      std::format("clip {} animates {} joints, the pose has {}", _name, _jointCount, pose.size()));
+   if (_duration > 0.0f and (time < 0.0f or time > _duration)) {
+      time = std::fmod(time, _duration);
+      time = time < 0.0f ? time + _duration : time;
+   }
+   /// the last frame holds the pose at the duration, which need not be a
+   /// whole frame after the one before: the last interval is stretched
+   const auto before_last = static_cast<float>(_frameCount - 2);
+   const auto before_last_time = before_last / _sampleRate;
+   const auto frame = time <= before_last_time ? std::max(time * _sampleRate, 0.0f) :
+      _duration > before_last_time ?
+         before_last + std::min((time - before_last_time) / (_duration - before_last_time), 1.0f) :
+         before_last + 1.0f;
+   const auto segment = std::min(static_cast<size_t>(frame) / _segmentFrames, _segments.size() - 1);
+   const auto local = frame - static_cast<float>(segment * _segmentFrames);
+
+   const auto* cursor = _data.data() + _segments[segment];
+   for (auto j = 0u; j < _jointCount; ++j) {
+      const auto& [t_min, t_extent] = _ranges[j * 2];
+      const auto& [s_min, s_extent] = _ranges[j * 2 + 1];
+      pose[j].translation = readChannel<simd::float3>(cursor, local,
+         [&](const Packed& p) {return unpackRange(p, t_min, t_extent);});
+      pose[j].rotation = readChannel<simd::float4>(cursor, local, unpackRotation);
+      pose[j].scale = readChannel<simd::float3>(cursor, local,
+         [&](const Packed& p) {return unpackRange(p, s_min, s_extent);});
+   }
+}
+
+auto CompressedClip::byteSize() const -> size_t {
+   return sizeof(*this) + _name.size() + _ranges.size() * sizeof(Range) +
+      _segments.size() * sizeof(std::uint32_t) + _data.size();
+}
+
+}
@@ -0,0 +1,71 @@
+#ifndef GAME_TUTORIAL_COMPRESSED_CLIP_HPP
+#define GAME_TUTORIAL_COMPRESSED_CLIP_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "animation.hpp"
+#include "simd_compat.hpp"
+
+namespace game {
+
+struct ClipCompression {
+   /// keys are resampled at this rate before being reduced
+   float sampleRate{30.0f};
+   /// frames per segment, at most 254 so that key counts fit a byte
+   std::uint32_t segmentFrames{16};
+   /// largest error a dropped key may introduce: quaternion distance
+   /// (about half the angle in radians), model units, scale factor
+   float rotationTolerance{1e-4f};
+   float translationTolerance{1e-4f};
+   float scaleTolerance{1e-4f};
+};
+
+/// An AnimationClip resampled at a fixed rate and cut in segments of a
+/// few frames. In every segment each joint keeps only the keys that
+/// linear interpolation cannot rebuild within tolerance, its first and
+/// last frame always being kept, so a sample never looks outside its
+/// segment. Rotations are stored smallest-three in 48 bits, translations
+/// and scales as 16 bit fractions of the range of their track.
+/// A segment holds every joint one after the other, sampling a pose
+/// reads one small contiguous block front to back.
+class CompressedClip {
+public:
+   CompressedClip() = default;
+   [[nodiscard]] static auto compress(const AnimationClip& clip, const ClipCompression& settings = {}) -> CompressedClip;
+
+   /// same contract as AnimationClip::sample
+   auto sample(float time, std::span<Transform> pose) const -> void;
+
+   [[nodiscard]] auto getName() const -> const std::string& {return _name;}
+   [[nodiscard]] constexpr auto getDuration() const -> float {return _duration;}
+   [[nodiscard]] constexpr auto getJointCount() const -> size_t {return _jointCount;}
+   [[nodiscard]] auto byteSize() const -> size_t;
+
+private:
+   /// values of a 16 bit channel are min + extent * q / 65535
+   struct Range {
+      simd::float3 min;
+      simd::float3 extent;
+   };
+
+   std::string _name;
+   float _duration{0.0f};
+   float _sampleRate{30.0f};
+   std::uint32_t _frameCount{0};
+   std::uint32_t _segmentFrames{16};
+   std::uint32_t _jointCount{0};
+   /// translation then scale range of every joint
+   std::vector<Range> _ranges;
+   std::vector<std::uint32_t> _segments;
+   /// per segment, per joint, translation, rotation and scale channels of
+   /// [key count : u8][frames in segment : u8 x count][values : 3 x u16 x count]
+   std::vector<std::byte> _data;
+};
+
+}
+
+#endif // GAME_TUTORIAL_COMPRESSED_CLIP_HPP
@@ -1,79 +1,85 @@
 #include "cube_map.hpp"
 
+#include <algorithm>
 #include <cmath>
 #include <iostream>
 #include <filesystem>
 
 #include "error.hpp"
-
+#include "texture.hpp"
 #include "utils.hpp"
 
-#include "stb_image.h"
 namespace game {
 
 CubeMap::CubeMap(const std::vector<std::span<const std::byte>> &faces,
-   std::string_view shader,
-   const std::uint32_t width, const std::uint32_t height, MTL::Device * device, MeshFactory * mf)
+   std::string_view shader, MTL::Device * device, MeshFactory * mf, UploadManager& uploads,
+   const TextureQuality quality)
    : _texture{}, _device(device) {
-
-   auto w = static_cast<int>(width);
-   auto h = static_cast<int>(height);
-   auto num_channels = int{4};
-
-   const auto textureDescriptor = AutoRelease<MTL::TextureDescriptor*>{
-      MTL::TextureDescriptor::alloc()->init(),
-      [](auto t) {t->release();}
+   const auto size = arraySize(faces, quality);
+   _texture = {
+      _create(_device, MTL::PixelFormatRGBA8Unorm, size.width, size.height),
+      [](auto t) {return t;}
    };
-   const auto mipLevels = static_cast<size_t>(std::floor(std::log2(std::max(width,height)))+1);
-   textureDescriptor->setArrayLength(1);
-   textureDescriptor->setWidth(w);
-   textureDescriptor->setHeight(h);
-   textureDescriptor->setTextureType(MTL::TextureTypeCube);
-   textureDescriptor->setPixelFormat(MTL::PixelFormatRGBA8Unorm);
-   textureDescriptor->setUsage(MTL::TextureUsageShaderRead | MTL::TextureUsageRenderTarget);
-   textureDescriptor->setStorageMode(MTL::StorageModeShared);
-   textureDescriptor->setMipmapLevelCount(mipLevels);
 
+   /// the six faces decode concurrently, each uploaded once decoded; colour, so resized in sRGB
+   uploadLayers(_texture.get(), faces, ColorSpace::Srgb, uploads);
+   _load(shader, mf);
+}
+
+CubeMap::CubeMap(const TextureFile& file, std::string_view shader, MTL::Device * device, MeshFactory * mf,
+   UploadManager& uploads)
+   : _texture{}, _device(device) {
+   ensure(file.faces() == 6 and file.layers() == 1, "a cube map texture file has one layer of six faces");
    _texture = {
-      _device->newTexture(textureDescriptor.get()),
+      _create(_device, pixelFormat(_device, file.format()), file.width(), file.height()),
       [](auto t) {return t;}
    };
+   uploadTextureFile(_texture.get(), file, uploads);
+   _load(shader, mf);
+}
 
-   const AutoRelease<MTL::CommandQueue*> commandQueue = {
-      _device->newCommandQueue(),
-      [](auto t) {t->release();}
+CubeMap::CubeMap(const HdrImage& equirect, std::string_view shader, MTL::Device * device, MeshFactory * mf,
+   UploadManager& uploads, const TextureQuality quality)
+   : _texture{}, _device(device) {
+   const auto faces = equirectToCube(equirect, cubeFaceSize({equirect.width, equirect.height}, quality));
+   _texture = {
+      _create(_device, MTL::PixelFormatRGBA16Float, faces.front().width, faces.front().height),
+      [](auto t) {return t;}
    };
+   for (const auto& [index, face]: ::enumerate(faces)) {
+      for (const auto& [level, pixels]: ::enumerate(face.levels)) {
+         const auto size = std::max<size_t>(face.width >> level, 1);
+         uploads.upload(_texture.get(), static_cast<std::uint32_t>(index), static_cast<std::uint32_t>(level),
+            MTL::Region{0, 0, 0, size, size, 1}, size * 8, std::as_bytes(std::span{pixels}));
+      }
+   }
+   _load(shader, mf);
+}
 
-   AutoRelease<MTL::CommandBuffer*> commandBuffer = {
-      commandQueue->commandBuffer(),
+auto CubeMap::_create(MTL::Device* const device, const MTL::PixelFormat format, const size_t width,
+   const size_t height) -> MTL::Texture* {
+   const auto textureDescriptor = AutoRelease<MTL::TextureDescriptor*>{
+      MTL::TextureDescriptor::alloc()->init(),
       [](auto t) {t->release();}
    };
+   const auto mipLevels = static_cast<size_t>(std::floor(std::log2(std::max(width,height)))+1);
+   textureDescriptor->setArrayLength(1);
+   textureDescriptor->setWidth(width);
+   textureDescriptor->setHeight(height);
+   textureDescriptor->setTextureType(MTL::TextureTypeCube);
+   textureDescriptor->setPixelFormat(format);
+   /// generating mipmaps renders into the levels, baked files come with theirs
+   textureDescriptor->setUsage(format == MTL::PixelFormatRGBA8Unorm
+      ? MTL::TextureUsageShaderRead | MTL::TextureUsageRenderTarget : MTL::TextureUsageShaderRead);
+   textureDescriptor->setStorageMode(MTL::StorageModePrivate);
+   textureDescriptor->setMipmapLevelCount(mipLevels);
 
-   for (const auto &[index, face]: ::enumerate(faces)) {
-      const auto raw_data = std::unique_ptr<::stbi_uc,void (*)(void*)>(
-         ::stbi_load_from_memory(
-            reinterpret_cast<const ::stbi_uc*> (face.data()),
-            static_cast<int>(face.size()),
-            &w, &h, &num_channels,STBI_rgb_alpha),
-         ::stbi_image_free);
-
-      ensure(raw_data!=nullptr,
-         "Could not read texture");
-
-      const auto region = MTL::Region{0, 0, 0, width, height, 1};
-      const NS::UInteger bytesPerRow = 4 * width;
-      _texture->replaceRegion(region, 0, index, raw_data.get(), bytesPerRow,0);
-      const AutoRelease<MTL::BlitCommandEncoder*> blitEncoder = {
-         commandBuffer->blitCommandEncoder(),
-         [](auto t) {t->release();}
-      };
-      blitEncoder->generateMipmaps(_texture.get());
-      blitEncoder->endEncoding();
-   }
-   commandBuffer->commit();
-   commandBuffer->waitUntilCompleted();
-   
+   const auto texture = device->newTexture(textureDescriptor.get());
+   ensure(texture != nullptr, "could not create the texture");
+   return texture;
+}
 
+auto CubeMap::_load(std::string_view shader, MeshFactory* const mf) -> void {
    const auto shader_source = NS::String::string(shader.data(),NS::ASCIIStringEncoding);
    NS::Error * error = nullptr;
    MTL::Library * defaultLibrary = _device->newLibrary(shader_source, {}, &error);
@@ -8,8 +8,11 @@
 #include <map>
 
 #include "auto_release.hpp"
+#include "environment_map.hpp"
 #include "mesh.hpp"
 #include "mesh_factory.hpp"
+#include "mip_chain.hpp"
+#include "texture_file.hpp"
 
 #include <Metal/Metal.hpp>
 #include <QuartzCore/QuartzCore.hpp>
@@ -23,9 +26,20 @@ typedef std::map<std::string,MTL::Function *> ShaderFunctions;
 class CubeMap {
 
 public:
+   /// the faces are staged through uploads, usable once it has been flushed;
+   /// as large as the largest face, scaled down for lower qualities
    CubeMap(const std::vector<std::span<const std::byte>>& faces,
-      std::string_view shader,
-      std::uint32_t width, std::uint32_t height,MTL::Device * device, MeshFactory * mf);
+      std::string_view shader, MTL::Device * device, MeshFactory * mf, UploadManager& uploads,
+      TextureQuality quality = TextureQuality::High);
+   /// the six faces with their levels as baked in file (see
+   /// uploadTextureFile), nothing decoded or generated; the HDR ones
+   /// AssetImporter::environmentMap() bakes included
+   CubeMap(const TextureFile& file, std::string_view shader, MTL::Device * device, MeshFactory * mf,
+      UploadManager& uploads);
+   /// half float faces resampled from an equirectangular image (see
+   /// equirectToCube) every time, AssetImporter::environmentMap() does it once
+   CubeMap(const HdrImage& equirect, std::string_view shader, MTL::Device * device, MeshFactory * mf,
+      UploadManager& uploads, TextureQuality quality = TextureQuality::High);
 
    [[nodiscard]] auto getTextures() const -> MTL::Texture* {return _texture.get();}
 
@@ -61,18 +75,25 @@ public:
    }
 
    [[nodiscard]] constexpr auto getRenderPipelineState() const-> MTL::RenderPipelineState* {return _rps.get();}
-   constexpr auto createBuffers(MTL::Device * device) const-> void {_cubeMesh->createBuffers(device);}
+   auto createBuffers(MeshBufferPool& pool, UploadManager& uploads) const-> void {_cubeMesh->createBuffers(pool, uploads);}
 
    [[nodiscard]] constexpr auto getVertexData() const -> const VertexData*  { return _cubeMesh->getVertexArray().data();}
-   [[nodiscard]] constexpr auto getVertexBuffer() const -> MTL::Buffer*  { return _cubeMesh->getVertexBuffer();}
-   [[nodiscard]] constexpr auto getIndexBuffer() const -> MTL::Buffer*  { return _cubeMesh->getIndexBuffer();}
+   [[nodiscard]] auto getVertexBuffer() const -> MTL::Buffer*  { return _cubeMesh->getVertexBuffer();}
+   [[nodiscard]] auto getIndexBuffer() const -> MTL::Buffer*  { return _cubeMesh->getIndexBuffer();}
+   [[nodiscard]] constexpr auto getBaseVertex() const -> NS::Integer  { return _cubeMesh->getBaseVertex();}
+   [[nodiscard]] constexpr auto getIndexBufferOffset() const -> size_t  { return _cubeMesh->getIndexBufferOffset();}
    [[nodiscard]] constexpr auto getIndexCount() const -> size_t  { return _cubeMesh->getIndexCount();}
+   [[nodiscard]] constexpr auto getIndexType() const -> MTL::IndexType  { return _cubeMesh->getIndexType();}
    [[nodiscard]] constexpr auto size() const -> size_t { return _cubeMesh->size();}
    [[nodiscard]] constexpr auto getPrimitive() const -> MTL::PrimitiveType {return _cubeMesh->getPrimitiveType();}
    [[nodiscard]] constexpr auto getVertexCount() const -> size_t {return _cubeMesh->n_verts();}
    [[nodiscard]] constexpr auto getModel() const -> Matrix4 {return {};}
 
 private:
+   static auto _create(MTL::Device* device, MTL::PixelFormat format, size_t width, size_t height) -> MTL::Texture*;
+   /// the shader functions and the cube the faces are drawn on
+   auto _load(std::string_view shader, MeshFactory* mf) -> void;
+
    AutoRelease<MTL::Texture*,{}> _texture;
    ShaderFunctions _shaderFunctions;
    MTL::Device * const _device;
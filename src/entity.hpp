@@ -13,41 +13,54 @@ namespace game {
 
 class Entity {
 public:
-   Entity(Mesh * const mesh, Material * const material, Texture * const texture)
-      : _mesh(mesh), _material(material), _texture(texture) {}
+   /// texture holds colour and ORM layers, normal_map the X and Y of the normals
+   Entity(Mesh * const mesh, Material * const material, Texture * const texture, Texture * const normal_map)
+      : _mesh(mesh), _material(material), _texture(texture), _normalMap(normal_map) {}
 
-   Entity(Mesh * const mesh, Material * const material, Texture * const texture, const Vector3& position)
-      : Entity(mesh,material,texture) {
+   Entity(Mesh * const mesh, Material * const material, Texture * const texture, Texture * const normal_map,
+      const Vector3& position)
+      : Entity(mesh,material,texture,normal_map) {
       _model = Matrix4(position);
    }
 
-   Entity(Mesh *const mesh, Material *const material, Texture * const texture,
+   Entity(Mesh *const mesh, Material *const material, Texture * const texture, Texture * const normal_map,
       const Vector3 &position, const Vector3& axis, const float theta)
-      : Entity(mesh,material,texture) {
+      : Entity(mesh,material,texture,normal_map) {
       const auto translation = Matrix4(position);
       const auto rotation = Matrix4(axis,theta);
       _model = rotation * translation;
    }
 
    [[nodiscard]] constexpr auto getVertexData() const -> const VertexData*  { return _mesh->getVertexArray().data();}
-   [[nodiscard]] constexpr auto getVertexBuffer() const -> MTL::Buffer*  { return _mesh->getVertexBuffer();}
-   [[nodiscard]] constexpr auto getIndexBuffer() const -> MTL::Buffer*  { return _mesh->getIndexBuffer();}
+   [[nodiscard]] auto getVertexBuffer() const -> MTL::Buffer*  { return _mesh->getVertexBuffer();}
+   [[nodiscard]] auto getIndexBuffer() const -> MTL::Buffer*  { return _mesh->getIndexBuffer();}
+   [[nodiscard]] constexpr auto getBaseVertex() const -> NS::Integer  { return _mesh->getBaseVertex();}
+   [[nodiscard]] constexpr auto getIndexBufferOffset() const -> size_t  { return _mesh->getIndexBufferOffset();}
    [[nodiscard]] constexpr auto getIndexCount() const -> size_t  { return _mesh->getIndexCount();}
+   [[nodiscard]] constexpr auto getIndexType() const -> MTL::IndexType  { return _mesh->getIndexType();}
+   [[nodiscard]] constexpr auto getIndexSize() const -> size_t  { return _mesh->getIndexSize();}
    [[nodiscard]] constexpr auto size() const -> size_t { return _mesh->size();}
    [[nodiscard]] constexpr auto getShaderFunctions() const -> ShaderFunctions {return _material->getShaderFunctions();}
    [[nodiscard]] constexpr auto getRenderPipelineState() const -> MTL::RenderPipelineState * {return _material->getRenderPipelineState();}
    [[nodiscard]] constexpr auto getDepthStencilState() const -> MTL::DepthStencilState* {return _material->getDepthStencilState();}
    [[nodiscard]] constexpr auto getModel() const -> const Matrix4& {return _model;}
    [[nodiscard]] constexpr auto getTexture() const -> MTL::Texture * {return _texture->getTexture();}
+   /// what getTexture() comes from, streamed textures change what they bind
+   [[nodiscard]] constexpr auto getTextureAsset() const -> Texture * {return _texture;}
+   [[nodiscard]] constexpr auto getNormalMap() const -> MTL::Texture * {return _normalMap->getTexture();}
+   [[nodiscard]] constexpr auto getNormalMapAsset() const -> Texture * {return _normalMap;}
+   [[nodiscard]] constexpr auto getBounds() const -> simd::float4 {return _mesh->getBounds();}
 
    [[nodiscard]] constexpr auto getPrimitive() const -> MTL::PrimitiveType {return _mesh->getPrimitiveType();}
    [[nodiscard]] constexpr auto getVertexCount() const -> size_t {return _mesh->n_verts();}
+   [[nodiscard]] constexpr auto getMeshlets() const -> const MeshletData& {return _mesh->getMeshlets();}
 
 
 private:
    Mesh * _mesh{nullptr};
    Material * _material{nullptr};
    Texture * _texture{nullptr};
+   Texture * _normalMap{nullptr};
    Matrix4 _model{};
 };
 
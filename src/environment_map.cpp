@@ -0,0 +1,238 @@
+#include "environment_map.hpp"
+#include "error.hpp"
+#include "parallel_for.hpp"
+#include "simd_compat.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <numbers>
+#include <optional>
+
+namespace game {
+
+namespace {
+
+using Pixel = simd::float4;
+
+constexpr size_t ROW_GRAIN = 16;
+
+auto texel(const HdrImage& image, const size_t x, const size_t y) -> Pixel {
+   const auto* const p = image.pixels.data() + (y * image.width + x) * 4;
+   return Pixel{p[0], p[1], p[2], p[3]};
+}
+
+/// bilinear, wrapping around in longitude and clamped at the poles
+auto sample(const HdrImage& equirect, const simd::float3 direction) -> Pixel {
+   const auto length = std::sqrt(simd::dot(direction, direction));
+   const auto u = 0.5f + std::atan2(direction.z, direction.x) / (2.0f * std::numbers::pi_v<float>);
+   const auto v = std::acos(std::clamp(direction.y / length, -1.0f, 1.0f)) / std::numbers::pi_v<float>;
+
+   const auto x = u * static_cast<float>(equirect.width) - 0.5f;
+   const auto y = std::clamp(v * static_cast<float>(equirect.height) - 0.5f, 0.0f,
+      static_cast<float>(equirect.height - 1));
+   const auto fx = x - std::floor(x);
+   const auto fy = y - std::floor(y);
+   const auto width = static_cast<std::int64_t>(equirect.width);
+   const auto x0 = static_cast<size_t>(((static_cast<std::int64_t>(std::floor(x)) % width) + width) % width);
+   const auto x1 = (x0 + 1) % equirect.width;
+   const auto y0 = static_cast<size_t>(y);
+   const auto y1 = std::min<size_t>(y0 + 1, equirect.height - 1);
+
+   const auto top = texel(equirect, x0, y0) + (texel(equirect, x1, y0) - texel(equirect, x0, y0)) * fx;
+   const auto bottom = texel(equirect, x0, y1) + (texel(equirect, x1, y1) - texel(equirect, x0, y1)) * fx;
+   return top + (bottom - top) * fy;
+}
+
+auto store(const Pixel& pixel, std::uint16_t* const destination) -> void {
+   for (auto c = 0; c < 4; ++c) {
+      destination[c] = toHalf(pixel[c]);
+   }
+}
+
+/// level 0 of the six faces in floats, face after face, to half float
+/// chains; every level from the floats of the one before
+auto buildLevels(std::vector<Pixel> current, const std::uint32_t face_size) -> std::array<HalfChain, 6> {
+   const auto level_count = static_cast<size_t>(std::bit_width(face_size));
+   auto faces = std::array<HalfChain, 6>{};
+   for (auto& face: faces) {
+      face.width = face_size;
+      face.height = face_size;
+      face.levels.resize(level_count);
+      for (auto level = size_t{0}; level < level_count; ++level) {
+         const auto size = size_t{face_size >> level};
+         face.levels[level].resize(size * size * 4);
+      }
+   }
+
+   parallelFor(CUBE_FACES * face_size, ROW_GRAIN, [&](const size_t begin, const size_t end) {
+      for (auto row = begin; row < end; ++row) {
+         auto* const destination = faces[row / face_size].levels[0].data() + row % face_size * face_size * 4;
+         for (auto x = size_t{0}; x < face_size; ++x) {
+            store(current[row * face_size + x], destination + x * 4);
+         }
+      }
+   });
+   for (auto level = size_t{1}; level < level_count; ++level) {
+      const auto source = size_t{face_size >> (level - 1)};
+      const auto size = source / 2;
+      auto next = std::vector<Pixel>(CUBE_FACES * size * size);
+      parallelFor(CUBE_FACES * size, ROW_GRAIN, [&](const size_t begin, const size_t end) {
+         for (auto row = begin; row < end; ++row) {
+            const auto face = row / size;
+            const auto y = row % size;
+            const auto* const above = current.data() + (face * source + y * 2) * source;
+            const auto* const below = above + source;
+            for (auto x = size_t{0}; x < size; ++x) {
+               const auto pixel = (above[x * 2] + above[x * 2 + 1] + below[x * 2] + below[x * 2 + 1]) * 0.25f;
+               next[row * size + x] = pixel;
+               store(pixel, faces[face].levels[level].data() + (y * size + x) * 4);
+            }
+         }
+      });
+      current = std::move(next);
+   }
+   return faces;
+}
+
+auto srgbToLinear(const float c) -> float {
+   return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+}
+
+}
+
+auto toHalf(const float value) -> std::uint16_t {
+   const auto bits = std::bit_cast<std::uint32_t>(value);
+   const auto sign = (bits >> 16) & 0x8000u;
+   const auto exponent = static_cast<int>((bits >> 23) & 0xffu);
+   auto mantissa = bits & 0x7fffffu;
+   if (exponent == 0xff) {
+      /// infinity stays infinity, NaN stays NaN
+      return static_cast<std::uint16_t>(sign | 0x7c00u | (mantissa != 0 ? 0x200u : 0u));
+   }
+   const auto biased = exponent - 127 + 15;
+   if (biased >= 0x1f) {
+      return static_cast<std::uint16_t>(sign | 0x7c00u);
+   }
+   if (biased <= 0) {
+      /// subnormal, or too small for even that
+      if (biased < -10) {
+         return static_cast<std::uint16_t>(sign);
+      }
+      mantissa |= 0x800000u;
+      const auto shift = static_cast<std::uint32_t>(14 - biased);
+      auto half = mantissa >> shift;
+      const auto rest = mantissa & ((1u << shift) - 1);
+      const auto halfway = 1u << (shift - 1);
+      if (rest > halfway or (rest == halfway and (half & 1u) != 0)) {
+         ++half;
+      }
+      return static_cast<std::uint16_t>(sign | half);
+   }
+   auto half = (static_cast<std::uint32_t>(biased) << 10) | (mantissa >> 13);
+   const auto rest = mantissa & 0x1fffu;
+   /// a carry out of the mantissa bumps the exponent, up to infinity at most
+   if (rest > 0x1000u or (rest == 0x1000u and (half & 1u) != 0)) {
+      ++half;
+   }
+   return static_cast<std::uint16_t>(sign | half);
+}
+
+auto fromHalf(const std::uint16_t value) -> float {
+   const auto sign = static_cast<std::uint32_t>(value & 0x8000u) << 16;
+   const auto exponent = static_cast<std::uint32_t>(value >> 10) & 0x1fu;
+   const auto mantissa = static_cast<std::uint32_t>(value) & 0x3ffu;
+   if (exponent == 0) {
+      const auto magnitude = std::ldexp(static_cast<float>(mantissa), -24);
+      return sign != 0 ? -magnitude : magnitude;
+   }
+   if (exponent == 0x1f) {
+      return std::bit_cast<float>(sign | 0x7f800000u | (mantissa << 13));
+   }
+   return std::bit_cast<float>(sign | ((exponent + 112) << 23) | (mantissa << 13));
+}
+
+auto cubeDirection(const size_t face, const float s, const float t) -> simd::float3 {
+   switch (face) {
+      case 0: return simd::float3{1.0f, -t, -s};
+      case 1: return simd::float3{-1.0f, -t, s};
+      case 2: return simd::float3{s, 1.0f, t};
+      case 3: return simd::float3{s, -1.0f, -t};
+      case 4: return simd::float3{s, -t, 1.0f};
+      default: return simd::float3{-s, -t, -1.0f};
+   }
+}
+
+auto cubeCoordinates(const simd::float3 direction) -> CubeCoordinates {
+   const auto x = std::abs(direction.x);
+   const auto y = std::abs(direction.y);
+   const auto z = std::abs(direction.z);
+   if (x >= y and x >= z) {
+      return direction.x > 0.0f
+         ? CubeCoordinates{0, -direction.z / x, -direction.y / x}
+         : CubeCoordinates{1, direction.z / x, -direction.y / x};
+   }
+   if (y >= z) {
+      return direction.y > 0.0f
+         ? CubeCoordinates{2, direction.x / y, direction.z / y}
+         : CubeCoordinates{3, direction.x / y, -direction.z / y};
+   }
+   return direction.z > 0.0f
+      ? CubeCoordinates{4, direction.x / z, -direction.y / z}
+      : CubeCoordinates{5, -direction.x / z, -direction.y / z};
+}
+
+auto cubeFaceSize(const ImageSize equirect, const TextureQuality quality) -> std::uint32_t {
+   const auto face = std::bit_floor(std::max(equirect.width / 4, 1u));
+   return std::max(face >> static_cast<std::uint32_t>(quality), 1u);
+}
+
+auto equirectToCube(const HdrImage& equirect, const std::uint32_t face_size) -> std::array<HalfChain, 6> {
+   ensure(equirect.width != 0 and equirect.height != 0
+      and equirect.pixels.size() == size_t{equirect.width} * equirect.height * 4, "not an HDR image");
+   ensure(std::has_single_bit(face_size), std::format("cube faces of {} texels do not halve down to one", face_size));
+
+   /// the rows of every face together, six faces make plenty of work even for small cubes
+   auto base = std::vector<Pixel>(CUBE_FACES * face_size * face_size);
+   parallelFor(CUBE_FACES * face_size, ROW_GRAIN, [&](const size_t begin, const size_t end) {
+      for (auto row = begin; row < end; ++row) {
+         const auto t = (static_cast<float>(row % face_size) + 0.5f) / static_cast<float>(face_size) * 2.0f - 1.0f;
+         for (auto x = size_t{0}; x < face_size; ++x) {
+            const auto s = (static_cast<float>(x) + 0.5f) / static_cast<float>(face_size) * 2.0f - 1.0f;
+            base[row * face_size + x] = sample(equirect, cubeDirection(row / face_size, s, t));
+         }
+      }
+   });
+   return buildLevels(std::move(base), face_size);
+}
+
+auto cubeFromFaces(const std::span<const Image> faces, const std::uint32_t face_size) -> std::array<HalfChain, 6> {
+   ensure(faces.size() == CUBE_FACES, std::format("a cube has {} faces, not {}", CUBE_FACES, faces.size()));
+   ensure(std::has_single_bit(face_size), std::format("cube faces of {} texels do not halve down to one", face_size));
+   const auto decode = [] {
+      auto table = std::array<float, 256>{};
+      for (auto i = size_t{0}; i < table.size(); ++i) {
+         table[i] = srgbToLinear(static_cast<float>(i) / 255.0f);
+      }
+      return table;
+   }();
+
+   auto base = std::vector<Pixel>(CUBE_FACES * face_size * face_size);
+   for (auto index = size_t{0}; index < CUBE_FACES; ++index) {
+      const auto& face = faces[index];
+      const auto resized = face.width == face_size and face.height == face_size
+         ? std::optional<Image>{} : resizeImage(face, face_size, face_size, MipFilter::Lanczos, ColorSpace::Srgb);
+      const auto& pixels = resized ? resized->pixels : face.pixels;
+      auto* const destination = base.data() + index * face_size * face_size;
+      parallelFor(face_size, ROW_GRAIN, [&](const size_t begin, const size_t end) {
+         for (auto i = begin * face_size; i < end * face_size; ++i) {
+            const auto channel = [&](const size_t c) {return std::to_integer<std::uint8_t>(pixels[i * 4 + c]);};
+            destination[i] = Pixel{decode[channel(0)], decode[channel(1)], decode[channel(2)],
+               static_cast<float>(channel(3)) / 255.0f};
+         }
+      });
+   }
+   return buildLevels(std::move(base), face_size);
+}
+
+}
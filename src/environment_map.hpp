@@ -0,0 +1,61 @@
+#ifndef GAME_TUTORIAL_ENVIRONMENT_MAP_HPP
+#define GAME_TUTORIAL_ENVIRONMENT_MAP_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "image.hpp"
+#include "mip_chain.hpp"
+#include "simd_compat.hpp"
+
+namespace game {
+
+/// IEEE half precision, rounded to nearest even; too large goes to infinity
+[[nodiscard]] auto toHalf(float value) -> std::uint16_t;
+[[nodiscard]] auto fromHalf(std::uint16_t value) -> float;
+
+/// a face of a cube with every level, RGBA half floats in tightly packed rows
+struct HalfChain {
+   std::uint32_t width{0};
+   std::uint32_t height{0};
+   std::vector<std::vector<std::uint16_t>> levels;
+};
+
+/// Metal's cube faces, in order: +X, -X, +Y, -Y, +Z, -Z
+constexpr size_t CUBE_FACES = 6;
+
+/// the direction through (s, t) of face, s and t in [-1, 1] with t down its rows
+[[nodiscard]] auto cubeDirection(size_t face, float s, float t) -> simd::float3;
+
+/// where direction leaves the cube, the inverse of cubeDirection()
+struct CubeCoordinates {
+   size_t face;
+   float s;
+   float t;
+};
+[[nodiscard]] auto cubeCoordinates(simd::float3 direction) -> CubeCoordinates;
+
+/// the faces of the cube an equirectangular image wraps: a quarter of its
+/// width, down to a power of two so that every level halves exactly, then
+/// scaled down for lower qualities
+[[nodiscard]] auto cubeFaceSize(ImageSize equirect, TextureQuality quality) -> std::uint32_t;
+
+/// Resamples an equirectangular image (the centre column looks along +X,
+/// the top row up +Y) onto the six faces of a cube, in the order of
+/// CUBE_FACES. Every texel is a bilinear sample
+/// along its direction, four channels at a time, with the rows of all
+/// faces split across threads. face_size is a power of two; the levels
+/// are box filtered in floats and rounded to halves once.
+[[nodiscard]] auto equirectToCube(const HdrImage& equirect, std::uint32_t face_size) -> std::array<HalfChain, 6>;
+
+/// Six sRGB faces, in the order above, as linear radiance: resized to
+/// face_size with the Lanczos filter if they are not that size, levels
+/// built as for equirectToCube(). LDR skies, white is a radiance of 1.
+[[nodiscard]] auto cubeFromFaces(std::span<const Image> faces, std::uint32_t face_size) -> std::array<HalfChain, 6>;
+
+}
+
+#endif // GAME_TUTORIAL_ENVIRONMENT_MAP_HPP
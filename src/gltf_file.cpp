@@ -0,0 +1,271 @@
+#include "gltf_file.hpp"
+#include "error.hpp"
+#include "utils.hpp"
+
+#include <algorithm>
+#include <numeric>
+
+namespace game {
+
+namespace {
+
+constexpr std::uint32_t GLB_MAGIC = 0x46546c67;      // "glTF"
+constexpr std::uint32_t GLB_JSON_CHUNK = 0x4e4f534a; // "JSON"
+constexpr std::uint32_t GLB_BIN_CHUNK = 0x004e4942;  // "BIN\0"
+constexpr std::uint32_t MODE_TRIANGLES = 4;
+
+auto readU32(const std::span<const std::byte> data, const size_t offset) -> std::uint32_t {
+   auto value = std::uint32_t{0};
+   std::memcpy(&value, data.data() + offset, sizeof(value));
+   return value;
+}
+
+auto componentsOf(const std::string_view type) -> std::uint32_t {
+   if (type == "SCALAR") return 1;
+   if (type == "VEC2") return 2;
+   if (type == "VEC3") return 3;
+   if (type == "VEC4") return 4;
+   if (type == "MAT2") return 4;
+   if (type == "MAT3") return 9;
+   if (type == "MAT4") return 16;
+   ensure(false, std::format("unknown accessor type {}", type));
+   return 0;
+}
+
+/// min or max of the positions of mesh, three numbers
+auto corner(const Json& positions, const std::string_view key, const std::string_view mesh) -> std::array<float, 3> {
+   const auto* const values = positions.find(key);
+   ensure(values != nullptr and values->asArray().size() == 3,
+      std::format("the positions of {} have no {}", mesh, key));
+   return {static_cast<float>(values->at(0).asNumber()), static_cast<float>(values->at(1).asNumber()),
+      static_cast<float>(values->at(2).asNumber())};
+}
+
+auto isComponentType(const size_t type) -> bool {
+   return type == 5120 or type == 5121 or type == 5122 or type == 5123 or type == 5125 or type == 5126;
+}
+
+/// the accessor named by a primitive attribute, checked for what we read from it
+auto attribute(const GltfFile& file, const Json& attributes, const std::string_view name,
+   const std::uint32_t components) -> std::optional<GltfAccessor> {
+   const auto index = attributes.find(name);
+   if (index == nullptr) {
+      return std::nullopt;
+   }
+   auto accessor = file.accessor(index->asIndex());
+   ensure(accessor.components == components,
+      std::format("{} has {} components, expected {}", name, accessor.components, components));
+   return accessor;
+}
+
+}
+
+auto GltfAccessor::floatAt(const size_t i, const size_t c) const -> float {
+   const auto p = bytes.data() + i * stride + c * componentSize(componentType);
+   const auto read = [p]<class T>(T) {
+      auto value = T{};
+      std::memcpy(&value, p, sizeof(T));
+      return value;
+   };
+   switch (componentType) {
+      case ComponentType::Float: return read(float{});
+      case ComponentType::UnsignedByte: {
+         const auto v = static_cast<float>(read(std::uint8_t{}));
+         return normalized ? v / 255.0f : v;
+      }
+      case ComponentType::UnsignedShort: {
+         const auto v = static_cast<float>(read(std::uint16_t{}));
+         return normalized ? v / 65535.0f : v;
+      }
+      case ComponentType::Byte: {
+         const auto v = static_cast<float>(read(std::int8_t{}));
+         return normalized ? std::max(v / 127.0f, -1.0f) : v;
+      }
+      case ComponentType::Short: {
+         const auto v = static_cast<float>(read(std::int16_t{}));
+         return normalized ? std::max(v / 32767.0f, -1.0f) : v;
+      }
+      case ComponentType::UnsignedInt: default:
+         return static_cast<float>(read(std::uint32_t{}));
+   }
+}
+
+auto GltfAccessor::indexAt(const size_t i) const -> std::uint32_t {
+   const auto p = bytes.data() + i * stride;
+   switch (componentType) {
+      case ComponentType::UnsignedByte: return static_cast<std::uint32_t>(*p);
+      case ComponentType::UnsignedShort: {
+         auto value = std::uint16_t{0};
+         std::memcpy(&value, p, sizeof(value));
+         return value;
+      }
+      default: {
+         auto value = std::uint32_t{0};
+         std::memcpy(&value, p, sizeof(value));
+         return value;
+      }
+   }
+}
+
+auto GltfMesh::vertexCount() const -> size_t {
+   return std::transform_reduce(primitives.begin(), primitives.end(), size_t{0}, std::plus{},
+      [](const GltfPrimitive& p) {return p.vertexCount();});
+}
+
+auto GltfMesh::indexCount() const -> size_t {
+   return std::transform_reduce(primitives.begin(), primitives.end(), size_t{0}, std::plus{},
+      [](const GltfPrimitive& p) {return p.indexCount();});
+}
+
+auto GltfMesh::hasTangents() const -> bool {
+   return std::ranges::all_of(primitives, [](const GltfPrimitive& p) {return p.tangents.has_value();});
+}
+
+auto GltfFile::open(const std::filesystem::path& path) -> GltfFile {
+   auto file = MappedFile::open(path);
+   const auto data = std::span<const std::byte>{file.bytes()};
+
+   auto json_text = std::string_view{reinterpret_cast<const char*>(data.data()), data.size()};
+   auto binary = std::span<const std::byte>{};
+   if (data.size() >= 12 and readU32(data, 0) == GLB_MAGIC) {
+      ensure(readU32(data, 4) == 2, std::format("{} is not glTF 2.0", path.string()));
+      const auto length = std::min<size_t>(readU32(data, 8), data.size());
+      auto offset = size_t{12};
+      auto chunk = 0;
+      while (offset + 8 <= length) {
+         const auto size = size_t{readU32(data, offset)};
+         const auto type = readU32(data, offset + 4);
+         ensure(offset + 8 + size <= length, std::format("{} has a truncated chunk", path.string()));
+         const auto contents = data.subspan(offset + 8, size);
+         if (chunk == 0) {
+            ensure(type == GLB_JSON_CHUNK, std::format("{} does not start with its JSON chunk", path.string()));
+            json_text = {reinterpret_cast<const char*>(contents.data()), contents.size()};
+         } else if (chunk == 1 and type == GLB_BIN_CHUNK) {
+            binary = contents;
+         }
+         /// chunks are 4 byte aligned
+         offset += 8 + (size + 3) / 4 * 4;
+         ++chunk;
+      }
+      ensure(chunk > 0, std::format("{} has no JSON chunk", path.string()));
+   }
+
+   auto json = Json::parse(json_text);
+   const auto asset = json.find("asset");
+   ensure(asset != nullptr and asset->find("version") != nullptr and asset->at("version").asString().starts_with("2."),
+      std::format("{} is not glTF 2.0", path.string()));
+
+   auto result = GltfFile{std::move(file), std::move(json)};
+   result._mapBuffers(path.parent_path(), binary);
+   return result;
+}
+
+auto GltfFile::_mapBuffers(const std::filesystem::path& directory, const std::span<const std::byte> binary) -> void {
+   const auto buffers = _json.find("buffers");
+   if (buffers == nullptr) {
+      return;
+   }
+   for (const auto& [index, buffer]: ::enumerate(buffers->asArray())) {
+      const auto length = buffer.at("byteLength").asIndex();
+      auto bytes = std::span<const std::byte>{};
+      if (const auto uri = buffer.find("uri"); uri == nullptr) {
+         /// only the first buffer of a .glb may leave out its uri
+         ensure(index == 0 and binary.data() != nullptr, "buffer without uri outside of a .glb");
+         bytes = binary;
+      } else {
+         ensure(not uri->asString().starts_with("data:"),
+            "embedded base64 buffers are not supported, export as .glb or with a .bin");
+         _external.push_back(MappedFile::open(directory / uri->asString()));
+         bytes = _external.back().bytes();
+      }
+      ensure(bytes.size() >= length, std::format("buffer {} is shorter than its byteLength", index));
+      _buffers.push_back(bytes.first(length));
+   }
+}
+
+auto GltfFile::accessor(const size_t index) const -> GltfAccessor {
+   const auto& json = _json.at("accessors").at(index);
+   ensure(json.find("sparse") == nullptr, std::format("accessor {} is sparse, which is not supported", index));
+   ensure(json.find("bufferView") != nullptr, std::format("accessor {} has no buffer view", index));
+   const auto component_type = json.at("componentType").asIndex();
+   ensure(isComponentType(component_type), std::format("accessor {} has component type {}", index, component_type));
+
+   auto accessor = GltfAccessor{
+      .bytes = {},
+      .count = json.at("count").asIndex(),
+      .stride = 0,
+      .componentType = static_cast<GltfAccessor::ComponentType>(component_type),
+      .components = componentsOf(json.at("type").asString()),
+      .normalized = json.find("normalized") != nullptr and json.at("normalized").asBool()
+   };
+
+   const auto& view = _json.at("bufferViews").at(json.at("bufferView").asIndex());
+   const auto buffer_index = view.at("buffer").asIndex();
+   ensure(buffer_index < _buffers.size(), std::format("buffer {} does not exist", buffer_index));
+   const auto view_offset = view.find("byteOffset") ? view.at("byteOffset").asIndex() : size_t{0};
+   const auto view_length = view.at("byteLength").asIndex();
+   const auto& buffer = _buffers[buffer_index];
+   ensure(view_offset + view_length <= buffer.size(), std::format("buffer view of accessor {} is out of its buffer", index));
+
+   accessor.stride = view.find("byteStride") ? view.at("byteStride").asIndex() : accessor.elementSize();
+   const auto offset = json.find("byteOffset") ? json.at("byteOffset").asIndex() : size_t{0};
+   const auto size = accessor.count == 0 ? 0 : (accessor.count - 1) * accessor.stride + accessor.elementSize();
+   ensure(accessor.stride >= accessor.elementSize() and offset + size <= view_length,
+      std::format("accessor {} is out of its buffer view", index));
+   accessor.bytes = buffer.subspan(view_offset + offset, size);
+   return accessor;
+}
+
+auto GltfFile::findMesh(const std::string_view name) const -> std::optional<GltfMesh> {
+   const auto meshes = _json.find("meshes");
+   if (meshes == nullptr) {
+      return std::nullopt;
+   }
+   const auto& all = meshes->asArray();
+   const auto json = std::ranges::find_if(all, [&](const Json& m) {
+      const auto n = m.find("name");
+      return n != nullptr and n->asString() == name;
+   });
+   if (json == all.end()) {
+      return std::nullopt;
+   }
+
+   auto mesh = GltfMesh{};
+   for (const auto& p: json->at("primitives").asArray()) {
+      const auto mode = p.find("mode") ? p.at("mode").asIndex() : size_t{MODE_TRIANGLES};
+      ensure(mode == MODE_TRIANGLES, std::format("{} has primitives of mode {}, only triangles are drawn", name, mode));
+      const auto& attributes = p.at("attributes");
+      auto positions = attribute(*this, attributes, "POSITION", 3);
+      auto normals = attribute(*this, attributes, "NORMAL", 3);
+      auto uvs = attribute(*this, attributes, "TEXCOORD_0", 2);
+      ensure(positions and normals and uvs, std::format("{} needs positions, normals and texture coords", name));
+      ensure(normals->count == positions->count and uvs->count == positions->count,
+         std::format("{} has attributes of different lengths", name));
+
+      const auto& position_json = _json.at("accessors").at(attributes.at("POSITION").asIndex());
+      auto primitive = GltfPrimitive{
+         .positions = *positions,
+         .positionMin = corner(position_json, "min", name),
+         .positionMax = corner(position_json, "max", name),
+         .normals = *normals,
+         .uvs = *uvs,
+         .tangents = attribute(*this, attributes, "TANGENT", 4),
+         .indexes = std::nullopt
+      };
+      ensure(not primitive.tangents or primitive.tangents->count == positions->count,
+         std::format("{} has attributes of different lengths", name));
+      if (const auto indexes = p.find("indices")) {
+         primitive.indexes = accessor(indexes->asIndex());
+         ensure(primitive.indexes->components == 1 and
+            (primitive.indexes->componentType == GltfAccessor::ComponentType::UnsignedByte or
+             primitive.indexes->componentType == GltfAccessor::ComponentType::UnsignedShort or
+             primitive.indexes->componentType == GltfAccessor::ComponentType::UnsignedInt),
+            std::format("{} has indexes that are not unsigned integers", name));
+      }
+      ensure(primitive.indexCount() % 3 == 0, std::format("{} has a partial triangle", name));
+      mesh.primitives.push_back(std::move(primitive));
+   }
+   return mesh;
+}
+
+}
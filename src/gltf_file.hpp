@@ -0,0 +1,111 @@
+#ifndef GAME_TUTORIAL_GLTF_FILE_HPP
+#define GAME_TUTORIAL_GLTF_FILE_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "json.hpp"
+#include "mapped_file.hpp"
+
+namespace game {
+
+/// A glTF accessor as a strided view over the mapped buffer, checked
+/// against the bounds of its buffer view when it is created.
+struct GltfAccessor {
+   enum class ComponentType : std::uint32_t {
+      Byte = 5120, UnsignedByte = 5121, Short = 5122, UnsignedShort = 5123, UnsignedInt = 5125, Float = 5126
+   };
+
+   /// from the first byte of the first element to the last byte of the last one
+   std::span<const std::byte> bytes;
+   size_t count{0};
+   size_t stride{0};
+   ComponentType componentType{ComponentType::Float};
+   std::uint32_t components{1};
+   bool normalized{false};
+
+   [[nodiscard]] static constexpr auto componentSize(const ComponentType type) -> size_t {
+      switch (type) {
+         case ComponentType::Byte: case ComponentType::UnsignedByte: return 1;
+         case ComponentType::Short: case ComponentType::UnsignedShort: return 2;
+         case ComponentType::UnsignedInt: case ComponentType::Float: default: return 4;
+      }
+   }
+   [[nodiscard]] constexpr auto elementSize() const -> size_t {return componentSize(componentType) * components;}
+   /// elements follow each other without gaps, the view is a plain array
+   [[nodiscard]] constexpr auto isTight() const -> bool {return stride == elementSize();}
+
+   /// component c of element i, normalized integers mapped to [0,1] or [-1,1]
+   [[nodiscard]] auto floatAt(size_t i, size_t c) const -> float;
+   [[nodiscard]] auto indexAt(size_t i) const -> std::uint32_t;
+   /// element i when the accessor holds components floats
+   template <class T>
+   [[nodiscard]] auto as(const size_t i) const -> T {
+      auto value = T{};
+      std::memcpy(&value, bytes.data() + i * stride, sizeof(T));
+      return value;
+   }
+};
+
+/// The parts of a glTF mesh we draw: triangles with positions, normals
+/// and uvs, optionally tangents and indexes.
+struct GltfPrimitive {
+   GltfAccessor positions;
+   /// the box around the positions, from the min and max glTF requires of them
+   std::array<float, 3> positionMin{};
+   std::array<float, 3> positionMax{};
+   GltfAccessor normals;
+   GltfAccessor uvs;
+   std::optional<GltfAccessor> tangents;
+   std::optional<GltfAccessor> indexes;
+
+   [[nodiscard]] constexpr auto vertexCount() const -> size_t {return positions.count;}
+   [[nodiscard]] constexpr auto indexCount() const -> size_t {return indexes ? indexes->count : positions.count;}
+};
+
+/// All the primitives of one mesh, drawn as a single mesh one after the other.
+struct GltfMesh {
+   std::vector<GltfPrimitive> primitives;
+
+   [[nodiscard]] auto vertexCount() const -> size_t;
+   [[nodiscard]] auto indexCount() const -> size_t;
+   /// every primitive has its tangents, nothing has to be generated
+   [[nodiscard]] auto hasTangents() const -> bool;
+};
+
+/// A .glb, or a .gltf with its .bin buffers, mapped in memory. Accessors
+/// view the mapped buffers directly, nothing is copied until the data is
+/// decoded to its destination.
+class GltfFile {
+public:
+   /// throws if the file is not glTF 2.0 or a buffer cannot be mapped
+   static auto open(const std::filesystem::path& path) -> GltfFile;
+
+   /// nullopt if there is no mesh of that name; throws if it has
+   /// primitives that are not triangles or miss normals or uvs
+   [[nodiscard]] auto findMesh(std::string_view name) const -> std::optional<GltfMesh>;
+   [[nodiscard]] auto accessor(size_t index) const -> GltfAccessor;
+   [[nodiscard]] constexpr auto getJson() const -> const Json& {return _json;}
+
+private:
+   GltfFile(MappedFile file, Json json) : _file(std::move(file)), _json(std::move(json)) {}
+
+   auto _mapBuffers(const std::filesystem::path& directory, std::span<const std::byte> binary) -> void;
+
+   MappedFile _file;
+   /// .bin files of a .gltf
+   std::vector<MappedFile> _external;
+   Json _json;
+   std::vector<std::span<const std::byte>> _buffers;
+};
+
+}
+
+#endif // GAME_TUTORIAL_GLTF_FILE_HPP
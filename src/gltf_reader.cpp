@@ -0,0 +1,150 @@
+#include "mesh_factory.hpp"
+#include "error.hpp"
+#include "gltf_file.hpp"
+#include "parallel_for.hpp"
+
+#include <algorithm>
+#include <array>
+#include <limits>
+
+namespace game {
+
+namespace {
+
+constexpr size_t VERTEX_GRAIN = 8192;
+
+/// float accessors are read element by element through a typed view,
+/// anything else (normalized integers) component by component
+template <size_t N>
+auto readFloats(const GltfAccessor& accessor, const size_t i) -> std::array<float, N> {
+   if (accessor.componentType == GltfAccessor::ComponentType::Float) {
+      return accessor.as<std::array<float, N>>(i);
+   }
+   auto value = std::array<float, N>{};
+   for (auto c = size_t{0}; c < N; ++c) {
+      value[c] = accessor.floatAt(i, c);
+   }
+   return value;
+}
+
+auto decodeVertices(const GltfPrimitive& primitive, const std::span<VertexData> vertices) -> void {
+   parallelFor(primitive.vertexCount(), VERTEX_GRAIN, [&](const size_t begin, const size_t end) {
+      for (auto v = begin; v < end; ++v) {
+         const auto p = readFloats<3>(primitive.positions, v);
+         const auto n = readFloats<3>(primitive.normals, v);
+         const auto uv = readFloats<2>(primitive.uvs, v);
+         const auto normal = simd::float3{n[0], n[1], n[2]};
+         auto tangent = normal;
+         auto bitangent = normal;
+         if (primitive.tangents) {
+            /// w is the handedness of the tangent frame
+            const auto t = readFloats<4>(*primitive.tangents, v);
+            tangent = simd::float3{t[0], t[1], t[2]};
+            bitangent = simd::cross(normal, tangent) * t[3];
+         }
+         /// a single store, the destination is not read
+         vertices[v] = VertexData{
+            .position = {p[0], p[1], p[2], 1.0f},
+            .normal = normal,
+            .tangent = tangent,
+            .bitangent = bitangent,
+            .uv = {uv[0], uv[1]}
+         };
+      }
+   });
+}
+
+/// Indexes of a primitive, base added. A tight accessor of the destination
+/// width with nothing to add is a single copy. Returns the largest index
+/// read, from the source: out may be memory that is slow to read back.
+template <class Index>
+auto decodeIndexes(const GltfPrimitive& primitive, const std::uint32_t base, const std::span<Index> out) -> std::uint32_t {
+   if (not primitive.indexes) {
+      for (auto i = size_t{0}; i < out.size(); ++i) {
+         out[i] = static_cast<Index>(base + i);
+      }
+      return out.empty() ? 0 : static_cast<std::uint32_t>(out.size() - 1);
+   }
+   const auto& indexes = *primitive.indexes;
+   if (base == 0 and indexes.isTight() and indexes.elementSize() == sizeof(Index)
+      and reinterpret_cast<std::uintptr_t>(indexes.bytes.data()) % alignof(Index) == 0) {
+      const auto source = std::span{reinterpret_cast<const Index*>(indexes.bytes.data()), out.size()};
+      std::memcpy(out.data(), source.data(), out.size_bytes());
+      return source.empty() ? 0 : static_cast<std::uint32_t>(std::ranges::max(source));
+   }
+   auto largest = std::uint32_t{0};
+   for (auto i = size_t{0}; i < out.size(); ++i) {
+      const auto index = indexes.indexAt(i);
+      largest = std::max(largest, index);
+      out[i] = static_cast<Index>(base + index);
+   }
+   return largest;
+}
+
+template <class Index>
+auto decodeMeshIndexes(const GltfMesh& mesh, const std::span<Index> indexes) -> void {
+   ensure(indexes.size() == mesh.indexCount(), std::format("glTF mesh needs {} indexes", mesh.indexCount()));
+   ensure(mesh.vertexCount() <= size_t{std::numeric_limits<Index>::max()} + 1,
+      std::format("glTF mesh has too many vertices for {} bit indexes", sizeof(Index) * 8));
+   auto first_vertex = size_t{0};
+   auto first_index = size_t{0};
+   for (const auto& primitive: mesh.primitives) {
+      const auto largest = decodeIndexes(primitive, static_cast<std::uint32_t>(first_vertex),
+         indexes.subspan(first_index, primitive.indexCount()));
+      ensure(primitive.indexCount() == 0 or largest < primitive.vertexCount(),
+         std::format("glTF mesh has index {} past its {} vertices", largest, primitive.vertexCount()));
+      first_vertex += primitive.vertexCount();
+      first_index += primitive.indexCount();
+   }
+}
+
+}
+
+auto MeshFactory::decodeGltfVertices(const GltfMesh& mesh, const std::span<VertexData> vertices) -> void {
+   ensure(vertices.size() == mesh.vertexCount(), std::format("glTF mesh needs {} vertices", mesh.vertexCount()));
+   auto first_vertex = size_t{0};
+   for (const auto& primitive: mesh.primitives) {
+      decodeVertices(primitive, vertices.subspan(first_vertex, primitive.vertexCount()));
+      first_vertex += primitive.vertexCount();
+   }
+}
+
+auto MeshFactory::boundingSphere(const GltfMesh& mesh) -> simd::float4 {
+   if (mesh.primitives.empty()) {
+      return simd::make_float4(0.0f, 0.0f, 0.0f, std::numeric_limits<float>::infinity());
+   }
+   auto low = simd::make_float3(std::numeric_limits<float>::max(), std::numeric_limits<float>::max(),
+      std::numeric_limits<float>::max());
+   auto high = -low;
+   for (const auto& primitive: mesh.primitives) {
+      for (auto c = 0; c < 3; ++c) {
+         low[c] = std::min(low[c], primitive.positionMin[c]);
+         high[c] = std::max(high[c], primitive.positionMax[c]);
+      }
+   }
+   return simd::make_float4((low + high) * 0.5f, simd::length(high - low) * 0.5f);
+}
+
+auto MeshFactory::decodeGltfIndexes(const GltfMesh& mesh, const std::span<std::uint32_t> indexes) -> void {
+   decodeMeshIndexes(mesh, indexes);
+}
+
+auto MeshFactory::decodeGltfIndexes(const GltfMesh& mesh, const std::span<std::uint16_t> indexes) -> void {
+   decodeMeshIndexes(mesh, indexes);
+}
+
+auto MeshFactory::readGltf(const std::string_view mesh_name, const GltfFile& file) -> std::optional<MeshData> {
+   const auto gltf = file.findMesh(mesh_name);
+   if (not gltf) {
+      return std::nullopt;
+   }
+   auto mesh = MeshData{std::vector<VertexData>(gltf->vertexCount()), std::vector<std::uint32_t>(gltf->indexCount())};
+   decodeGltfIndexes(*gltf, mesh.indexes);
+   decodeGltfVertices(*gltf, mesh.vertices);
+   if (not gltf->hasTangents()) {
+      generateTangents(mesh);
+   }
+   return mesh;
+}
+
+}
@@ -0,0 +1,124 @@
+#include "image.hpp"
+#include "error.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+
+namespace game {
+
+namespace {
+
+/// Where the decode running on this thread puts its pixels. The first
+/// allocation of exactly its size takes the destination, whatever stb
+/// wants it for; the others get the heap. When that one turns out to be
+/// scratch, it moves to the heap when reallocated (see reallocate) and the
+/// result is copied over once the decode is done (see decodeImage).
+struct Destination {
+   std::span<std::byte> memory;
+   bool taken{false};
+};
+
+thread_local Destination* t_destination = nullptr;
+
+auto isDestination(const void* const p) -> bool {
+   return t_destination != nullptr and p == t_destination->memory.data();
+}
+
+auto allocate(const size_t size) -> void* {
+   if (t_destination != nullptr and not t_destination->taken and size == t_destination->memory.size()) {
+      t_destination->taken = true;
+      return t_destination->memory.data();
+   }
+   return std::malloc(size);
+}
+
+auto reallocate(void* const p, const size_t size) -> void* {
+   if (not isDestination(p)) {
+      return std::realloc(p, size);
+   }
+   /// it was scratch after all, the result will be copied over
+   auto* const moved = std::malloc(size);
+   if (moved != nullptr) {
+      std::memcpy(moved, p, std::min(size, t_destination->memory.size()));
+   }
+   return moved;
+}
+
+auto release(void* const p) -> void {
+   if (not isDestination(p)) {
+      std::free(p);
+   }
+}
+
+}
+
+}
+
+#define STBI_MALLOC(size) ::game::allocate(size)
+#define STBI_REALLOC(p, size) ::game::reallocate(p, size)
+#define STBI_FREE(p) ::game::release(p)
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+namespace game {
+
+auto decodeImage(const std::span<const std::byte> data) -> Image {
+   const auto size = imageSize(data);
+   auto image = Image{size.width, size.height, {}};
+   image.pixels.resize(image.bytesPerRow() * image.height);
+   decodeImage(data, image.pixels);
+   return image;
+}
+
+auto imageSize(const std::span<const std::byte> data) -> ImageSize {
+   auto w = int{0};
+   auto h = int{0};
+   auto num_channels = int{0};
+   ensure(::stbi_info_from_memory(reinterpret_cast<const ::stbi_uc*>(data.data()), static_cast<int>(data.size()),
+      &w, &h, &num_channels) != 0,
+      std::format("Could not read texture: {}", ::stbi_failure_reason()));
+   return {static_cast<std::uint32_t>(w), static_cast<std::uint32_t>(h)};
+}
+
+auto decodeImage(const std::span<const std::byte> data, const std::span<std::byte> destination) -> ImageSize {
+   auto target = Destination{destination};
+   t_destination = &target;
+   auto w = int{0};
+   auto h = int{0};
+   auto num_channels = int{0};
+   auto* const pixels = ::stbi_load_from_memory(reinterpret_cast<const ::stbi_uc*>(data.data()),
+      static_cast<int>(data.size()), &w, &h, &num_channels, STBI_rgb_alpha);
+   t_destination = nullptr;
+   ensure(pixels != nullptr, std::format("Could not read texture: {}", ::stbi_failure_reason()));
+   const auto size = ImageSize{static_cast<std::uint32_t>(w), static_cast<std::uint32_t>(h)};
+   const auto bytes = size_t{size.width} * size.height * 4;
+   if (reinterpret_cast<std::byte*>(pixels) != destination.data()) {
+      /// the destination went to scratch, or the image is not the size it was given for
+      const auto result = std::unique_ptr<::stbi_uc, void (*)(void*)>(pixels, ::stbi_image_free);
+      ensure(bytes == destination.size(),
+         std::format("a {}x{} image does not fit {} bytes", size.width, size.height, destination.size()));
+      std::memcpy(destination.data(), pixels, bytes);
+   }
+   return size;
+}
+
+auto decodeHdrImage(const std::span<const std::byte> data) -> HdrImage {
+   const auto* const bytes = reinterpret_cast<const ::stbi_uc*>(data.data());
+   const auto size = static_cast<int>(data.size());
+   /// stb would happily tone map an 8 bit image up to floats
+   ensure(::stbi_is_hdr_from_memory(bytes, size) != 0, "not an HDR image");
+   auto w = int{0};
+   auto h = int{0};
+   auto num_channels = int{0};
+   const auto raw_data = std::unique_ptr<float, void (*)(void*)>(
+      ::stbi_loadf_from_memory(bytes, size, &w, &h, &num_channels, STBI_rgb_alpha), ::stbi_image_free);
+   ensure(raw_data != nullptr, std::format("Could not read HDR image: {}", ::stbi_failure_reason()));
+
+   auto image = HdrImage{static_cast<std::uint32_t>(w), static_cast<std::uint32_t>(h), {}};
+   image.pixels.assign(raw_data.get(), raw_data.get() + size_t{image.width} * image.height * 4);
+   return image;
+}
+
+}
@@ -0,0 +1,49 @@
+#ifndef GAME_TUTORIAL_IMAGE_HPP
+#define GAME_TUTORIAL_IMAGE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace game {
+
+/// decoded pixels, 4 bytes per pixel (RGBA8), rows tightly packed
+struct Image {
+   std::uint32_t width{0};
+   std::uint32_t height{0};
+   std::vector<std::byte> pixels;
+
+   [[nodiscard]] constexpr auto bytesPerRow() const -> size_t {return size_t{width} * 4;}
+};
+
+/// linear radiance, 4 floats per pixel (RGBA, alpha 1), rows tightly packed
+struct HdrImage {
+   std::uint32_t width{0};
+   std::uint32_t height{0};
+   std::vector<float> pixels;
+};
+
+/// what an image decodes to, see imageSize()
+struct ImageSize {
+   std::uint32_t width{0};
+   std::uint32_t height{0};
+
+   [[nodiscard]] constexpr auto operator==(const ImageSize&) const -> bool = default;
+};
+
+/// any format stb_image reads, expanded to RGBA8; throws if it cannot
+[[nodiscard]] auto decodeImage(std::span<const std::byte> data) -> Image;
+/// the size decodeImage() would decode to, only the header is read
+[[nodiscard]] auto imageSize(std::span<const std::byte> data) -> ImageSize;
+/// Decodes to RGBA8 rows, tightly packed, straight into destination
+/// (staging memory, say) rather than into memory of its own that would
+/// then be copied; destination has to be the size of the image, see
+/// imageSize(). Throws if it is not or the image cannot be read.
+auto decodeImage(std::span<const std::byte> data, std::span<std::byte> destination) -> ImageSize;
+/// Radiance .hdr, kept in floats; throws if data is not one
+[[nodiscard]] auto decodeHdrImage(std::span<const std::byte> data) -> HdrImage;
+
+}
+
+#endif // GAME_TUTORIAL_IMAGE_HPP
@@ -0,0 +1,329 @@
+#include "image_based_lighting.hpp"
+#include "error.hpp"
+#include "mapped_file.hpp"
+#include "parallel_for.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <numbers>
+#include <vector>
+
+namespace game {
+
+namespace {
+
+using Pixel = simd::float4;
+
+constexpr size_t ROW_GRAIN = 4;
+/// largest face the irradiance is projected from, it holds nothing finer than L2
+constexpr std::uint32_t IRRADIANCE_FACE_SIZE = 64;
+constexpr float PI = std::numbers::pi_v<float>;
+
+/// bilinear within the face the direction leaves through, clamped at its edges
+auto sampleLevel(const FloatCube& cube, const size_t level, const simd::float3 direction) -> Pixel {
+   const auto size = std::max(cube.size >> level, 1u);
+   const auto [face, s, t] = cubeCoordinates(direction);
+   const auto last = static_cast<float>(size - 1);
+   const auto x = std::clamp((s * 0.5f + 0.5f) * static_cast<float>(size) - 0.5f, 0.0f, last);
+   const auto y = std::clamp((t * 0.5f + 0.5f) * static_cast<float>(size) - 0.5f, 0.0f, last);
+   const auto x0 = static_cast<size_t>(x);
+   const auto y0 = static_cast<size_t>(y);
+   const auto x1 = std::min<size_t>(x0 + 1, size - 1);
+   const auto y1 = std::min<size_t>(y0 + 1, size - 1);
+   const auto fx = x - static_cast<float>(x0);
+   const auto fy = y - static_cast<float>(y0);
+
+   const auto* const texels = cube.levels[level].data() + face * size * size;
+   const auto top = texels[y0 * size + x0] + (texels[y0 * size + x1] - texels[y0 * size + x0]) * fx;
+   const auto bottom = texels[y1 * size + x0] + (texels[y1 * size + x1] - texels[y1 * size + x0]) * fx;
+   return top + (bottom - top) * fy;
+}
+
+/// trilinear, lod in levels of cube
+auto sampleLod(const FloatCube& cube, const float lod, const simd::float3 direction) -> Pixel {
+   const auto clamped = std::clamp(lod, 0.0f, static_cast<float>(cube.levels.size() - 1));
+   const auto level = static_cast<size_t>(clamped);
+   const auto fraction = clamped - static_cast<float>(level);
+   const auto fine = sampleLevel(cube, level, direction);
+   if (fraction == 0.0f or level + 1 == cube.levels.size()) {
+      return fine;
+   }
+   return fine + (sampleLevel(cube, level + 1, direction) - fine) * fraction;
+}
+
+/// the direction through the centre of texel (x, y) of face, size texels a side
+auto texelDirection(const size_t face, const size_t x, const size_t y, const std::uint32_t size) -> simd::float3 {
+   const auto s = (static_cast<float>(x) + 0.5f) / static_cast<float>(size) * 2.0f - 1.0f;
+   const auto t = (static_cast<float>(y) + 0.5f) / static_cast<float>(size) * 2.0f - 1.0f;
+   return simd::normalize(cubeDirection(face, s, t));
+}
+
+/// real L2 spherical harmonics at unit direction n
+auto basis(const simd::float3 n) -> std::array<float, 9> {
+   return {
+      0.282095f,
+      0.488603f * n.y, 0.488603f * n.z, 0.488603f * n.x,
+      1.092548f * n.x * n.y, 1.092548f * n.y * n.z, 0.315392f * (3.0f * n.z * n.z - 1.0f),
+      1.092548f * n.x * n.z, 0.546274f * (n.x * n.x - n.y * n.y)
+   };
+}
+
+/// the clamped cosine in each band, radiance to irradiance
+constexpr auto BAND_CONVOLUTION = std::array{
+   PI,
+   2.0f * PI / 3.0f, 2.0f * PI / 3.0f, 2.0f * PI / 3.0f,
+   PI / 4.0f, PI / 4.0f, PI / 4.0f, PI / 4.0f, PI / 4.0f
+};
+
+auto hammersley(const std::uint32_t i, const std::uint32_t count) -> std::array<float, 2> {
+   auto bits = i;
+   bits = (bits << 16u) | (bits >> 16u);
+   bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xaaaaaaaau) >> 1u);
+   bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xccccccccu) >> 2u);
+   bits = ((bits & 0x0f0f0f0fu) << 4u) | ((bits & 0xf0f0f0f0u) >> 4u);
+   bits = ((bits & 0x00ff00ffu) << 8u) | ((bits & 0xff00ff00u) >> 8u);
+   return {static_cast<float>(i) / static_cast<float>(count), static_cast<float>(bits) * 0x1p-32f};
+}
+
+/// a direction to gather from, in the frame of the normal (z up)
+struct LobeSample {
+   simd::float3 direction;
+   float weight;
+   float lod;
+};
+
+/// GGX importance samples for roughness, the same for every texel: only
+/// the frame they are turned into changes
+auto lobeSamples(const float roughness, const std::uint32_t sample_count, const std::uint32_t source_size,
+   const size_t source_levels) -> std::vector<LobeSample> {
+   const auto a = roughness * roughness;
+   const auto a2 = a * a;
+   const auto texel_solid_angle = 4.0f * PI / (6.0f * static_cast<float>(source_size) * static_cast<float>(source_size));
+   auto samples = std::vector<LobeSample>{};
+   for (auto i = 0u; i < sample_count; ++i) {
+      const auto [u, v] = hammersley(i, sample_count);
+      const auto phi = 2.0f * PI * u;
+      const auto cos_theta = std::sqrt((1.0f - v) / (1.0f + (a2 - 1.0f) * v));
+      const auto sin_theta = std::sqrt(1.0f - cos_theta * cos_theta);
+      const auto half = simd::float3{sin_theta * std::cos(phi), sin_theta * std::sin(phi), cos_theta};
+      /// the view is the normal, the light its reflection about the half vector
+      const auto light = half * (2.0f * cos_theta) - simd::float3{0.0f, 0.0f, 1.0f};
+      if (light.z <= 0.0f) {
+         continue;
+      }
+      /// pdf of the light direction: D(h) cos(h) / (4 v.h), and v.h = n.h here
+      const auto denominator = cos_theta * cos_theta * (a2 - 1.0f) + 1.0f;
+      const auto pdf = a2 / (PI * denominator * denominator) / 4.0f;
+      const auto sample_solid_angle = 1.0f / (static_cast<float>(sample_count) * pdf + 1e-4f);
+      const auto lod = std::clamp(0.5f * std::log2(sample_solid_angle / texel_solid_angle) + 1.0f, 0.0f,
+         static_cast<float>(source_levels - 1));
+      samples.push_back({light, light.z, lod});
+   }
+   return samples;
+}
+
+auto store(const Pixel& pixel, std::uint16_t* const destination) -> void {
+   for (auto c = 0; c < 4; ++c) {
+      destination[c] = toHalf(pixel[c]);
+   }
+}
+
+}
+
+auto evaluate(const IrradianceSH& sh, const simd::float3 normal) -> simd::float3 {
+   const auto y = basis(simd::normalize(normal));
+   auto irradiance = simd::float4{0.0f, 0.0f, 0.0f, 0.0f};
+   for (auto i = size_t{0}; i < y.size(); ++i) {
+      irradiance += sh.coefficients[i] * y[i];
+   }
+   return simd::float3{irradiance.x, irradiance.y, irradiance.z};
+}
+
+auto cubeFaces(const TextureFile& file, const std::uint32_t largest) -> std::array<HalfChain, 6> {
+   ensure(file.format() == TextureFileFormat::RGBA16F and file.faces() == CUBE_FACES and file.layers() == 1,
+      "not a texture file of half float cube faces");
+   auto first = size_t{0};
+   while (first + 1 < file.levelCount() and TextureFile::levelWidth(file.width(), first) > largest) {
+      ++first;
+   }
+   auto cube = std::array<HalfChain, 6>{};
+   for (auto face = size_t{0}; face < CUBE_FACES; ++face) {
+      cube[face].width = static_cast<std::uint32_t>(TextureFile::levelWidth(file.width(), first));
+      cube[face].height = static_cast<std::uint32_t>(TextureFile::levelWidth(file.height(), first));
+      for (auto level = first; level < file.levelCount(); ++level) {
+         const auto bytes = file.image(level, face);
+         auto& halves = cube[face].levels.emplace_back(bytes.size() / sizeof(std::uint16_t));
+         std::memcpy(halves.data(), bytes.data(), bytes.size());
+      }
+   }
+   return cube;
+}
+
+auto toFloats(const std::array<HalfChain, 6>& cube) -> FloatCube {
+   const auto& first = cube.front();
+   ensure(first.width != 0 and first.width == first.height and not first.levels.empty()
+      and std::ranges::all_of(cube, [&](const HalfChain& face) {
+         return face.width == first.width and face.height == first.height and face.levels.size() == first.levels.size();
+      }), "the faces of a cube are the same square size with the same levels");
+
+   auto floats = FloatCube{first.width, std::vector<std::vector<Pixel>>(first.levels.size())};
+   for (auto level = size_t{0}; level < first.levels.size(); ++level) {
+      const auto size = size_t{std::max(first.width >> level, 1u)};
+      auto& texels = floats.levels[level];
+      texels.resize(CUBE_FACES * size * size);
+      for (auto face = size_t{0}; face < CUBE_FACES; ++face) {
+         const auto& halves = cube[face].levels[level];
+         ensure(halves.size() == size * size * 4, std::format("level {} of face {} is not {} texels a side",
+            level, face, size));
+         for (auto i = size_t{0}; i < size * size; ++i) {
+            texels[face * size * size + i] = Pixel{fromHalf(halves[i * 4]), fromHalf(halves[i * 4 + 1]),
+               fromHalf(halves[i * 4 + 2]), fromHalf(halves[i * 4 + 3])};
+         }
+      }
+   }
+   return floats;
+}
+
+auto irradianceSH(const FloatCube& cube) -> IrradianceSH {
+   auto level = size_t{0};
+   while ((cube.size >> level) > IRRADIANCE_FACE_SIZE) {
+      ++level;
+   }
+   ensure(level < cube.levels.size(), std::format("a cube of {} levels has none of {} texels or less a side",
+      cube.levels.size(), IRRADIANCE_FACE_SIZE));
+   const auto size = std::max(cube.size >> level, 1u);
+   const auto& texels = cube.levels[level];
+
+   auto sum = std::array<Pixel, 9>{};
+   std::mutex sum_mutex;
+   parallelFor(CUBE_FACES * size, ROW_GRAIN, [&](const size_t begin, const size_t end) {
+      auto partial = std::array<Pixel, 9>{};
+      for (auto row = begin; row < end; ++row) {
+         const auto face = row / size;
+         const auto y = row % size;
+         for (auto x = size_t{0}; x < size; ++x) {
+            const auto s = (static_cast<float>(x) + 0.5f) / static_cast<float>(size) * 2.0f - 1.0f;
+            const auto t = (static_cast<float>(y) + 0.5f) / static_cast<float>(size) * 2.0f - 1.0f;
+            /// a texel of the face at distance 1 seen from the centre
+            const auto solid_angle = (2.0f / static_cast<float>(size)) * (2.0f / static_cast<float>(size))
+               / std::pow(1.0f + s * s + t * t, 1.5f);
+            const auto radiance = texels[row * size + x] * solid_angle;
+            const auto y_lm = basis(simd::normalize(cubeDirection(face, s, t)));
+            for (auto i = size_t{0}; i < y_lm.size(); ++i) {
+               partial[i] += radiance * y_lm[i];
+            }
+         }
+      }
+      const std::lock_guard lock{sum_mutex};
+      for (auto i = size_t{0}; i < sum.size(); ++i) {
+         sum[i] += partial[i];
+      }
+   });
+
+   auto sh = IrradianceSH{};
+   for (auto i = size_t{0}; i < sum.size(); ++i) {
+      sh.coefficients[i] = sum[i] * BAND_CONVOLUTION[i];
+      sh.coefficients[i].w = 0.0f;
+   }
+   return sh;
+}
+
+auto prefilterSpecular(const FloatCube& source, const std::uint32_t face_size, const std::uint32_t sample_count)
+   -> std::array<HalfChain, 6> {
+   ensure(std::has_single_bit(face_size), std::format("cube faces of {} texels do not halve down to one", face_size));
+   ensure(sample_count > 0, "prefiltering takes at least one sample");
+   const auto level_count = static_cast<size_t>(std::bit_width(face_size));
+
+   auto result = std::array<HalfChain, 6>{};
+   for (auto& face: result) {
+      face.width = face_size;
+      face.height = face_size;
+      face.levels.resize(level_count);
+   }
+   for (auto level = size_t{0}; level < level_count; ++level) {
+      const auto size = face_size >> level;
+      for (auto& face: result) {
+         face.levels[level].resize(size_t{size} * size * 4);
+      }
+      const auto roughness = std::min(1.0f,
+         static_cast<float>(level) / static_cast<float>(SPECULAR_ROUGHNESS_LEVELS - 1));
+      /// the mirror reads the source level its texels match
+      const auto mirror_lod = std::log2(static_cast<float>(source.size) / static_cast<float>(size));
+      const auto samples = roughness == 0.0f
+         ? std::vector<LobeSample>{}
+         : lobeSamples(roughness, sample_count, source.size, source.levels.size());
+
+      parallelFor(CUBE_FACES * size, ROW_GRAIN, [&](const size_t begin, const size_t end) {
+         for (auto row = begin; row < end; ++row) {
+            const auto face = row / size;
+            const auto y = row % size;
+            auto* const destination = result[face].levels[level].data() + y * size * 4;
+            for (auto x = size_t{0}; x < size; ++x) {
+               const auto normal = texelDirection(face, x, y, size);
+               if (samples.empty()) {
+                  store(sampleLod(source, mirror_lod, normal), destination + x * 4);
+                  continue;
+               }
+               /// a frame around the normal, any tangent will do for an isotropic lobe
+               const auto up = std::abs(normal.z) < 0.999f ? simd::float3{0.0f, 0.0f, 1.0f} : simd::float3{1.0f, 0.0f, 0.0f};
+               const auto tangent = simd::normalize(simd::cross(up, normal));
+               const auto bitangent = simd::cross(normal, tangent);
+               auto radiance = Pixel{0.0f, 0.0f, 0.0f, 0.0f};
+               auto weight = 0.0f;
+               for (const auto& sample: samples) {
+                  const auto light = tangent * sample.direction.x + bitangent * sample.direction.y
+                     + normal * sample.direction.z;
+                  radiance += sampleLod(source, sample.lod, light) * sample.weight;
+                  weight += sample.weight;
+               }
+               store(radiance * (1.0f / weight), destination + x * 4);
+            }
+         }
+      });
+   }
+   return result;
+}
+
+auto writeIrradianceCache(const std::filesystem::path& path, const std::uint64_t stamp, const IrradianceSH& sh) -> void {
+   const auto header = IrradianceCacheHeader{
+      .magic = IrradianceCacheHeader::MAGIC,
+      .version = IrradianceCacheHeader::VERSION,
+      .stamp = stamp
+   };
+
+   /// the header is written last so that an interrupted write never
+   /// looks like a valid cache
+   std::ofstream file{path, std::ios::binary | std::ios::trunc};
+   ensure(file.is_open(), std::format("could not create {}", path.string()));
+   const auto blank = IrradianceCacheHeader{.magic = 0, .version = 0, .stamp = 0};
+   file.write(reinterpret_cast<const char*>(&blank), sizeof(blank));
+   file.write(reinterpret_cast<const char*>(sh.coefficients.data()), sizeof(sh.coefficients));
+   file.seekp(0);
+   file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+   file.close();
+   ensure(not file.fail(), std::format("could not write {}", path.string()));
+}
+
+auto readIrradianceCache(const std::filesystem::path& path, const std::uint64_t stamp) -> std::optional<IrradianceSH> {
+   if (not std::filesystem::exists(path)) {
+      return std::nullopt;
+   }
+   const auto file = MappedFile::open(path);
+   if (file.size() != sizeof(IrradianceCacheHeader) + sizeof(IrradianceSH::coefficients)) {
+      return std::nullopt;
+   }
+   IrradianceCacheHeader h;
+   std::memcpy(&h, file.data(), sizeof(h));
+   if (h.magic != IrradianceCacheHeader::MAGIC or h.version != IrradianceCacheHeader::VERSION or h.stamp != stamp) {
+      return std::nullopt;
+   }
+   auto sh = IrradianceSH{};
+   std::memcpy(sh.coefficients.data(), file.data() + sizeof(h), sizeof(sh.coefficients));
+   return sh;
+}
+
+}
@@ -0,0 +1,77 @@
+#ifndef GAME_TUTORIAL_IMAGE_BASED_LIGHTING_HPP
+#define GAME_TUTORIAL_IMAGE_BASED_LIGHTING_HPP
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <vector>
+
+#include "environment_map.hpp"
+#include "simd_compat.hpp"
+#include "texture_file.hpp"
+
+namespace game {
+
+/// levels of a prefiltered specular cube from roughness 0 to 1, the ones
+/// below are as rough; textured.metal samples level roughness * (this - 1)
+constexpr std::uint32_t SPECULAR_ROUGHNESS_LEVELS = 6;
+
+/// Irradiance around a point as L2 spherical harmonics: 9 coefficients,
+/// RGB in xyz, of the radiance already convolved with the clamped cosine,
+/// so that E(n) is their sum weighted by the basis at n. The layout
+/// textured.metal reads.
+struct IrradianceSH {
+   std::array<simd::float4, 9> coefficients{};
+};
+
+/// the irradiance sh holds for normal, see IrradianceSH
+[[nodiscard]] auto evaluate(const IrradianceSH& sh, simd::float3 normal) -> simd::float3;
+
+/// the levels of a cube in floats, face after face, as the bakes below read them
+struct FloatCube {
+   /// texels a side of the first level
+   std::uint32_t size{0};
+   std::vector<std::vector<simd::float4>> levels;
+};
+
+/// the levels no larger than largest texels a side of a texture file of
+/// half float cube faces, as equirectToCube() makes them; the larger
+/// ones are not read
+[[nodiscard]] auto cubeFaces(const TextureFile& file, std::uint32_t largest) -> std::array<HalfChain, 6>;
+/// every level of cube, converted once for both bakes below
+[[nodiscard]] auto toFloats(const std::array<HalfChain, 6>& cube) -> FloatCube;
+
+/// Projects every texel of the level of cube no larger than 64 texels a
+/// side onto the basis, weighted by the solid angle it covers; rows are
+/// split across threads.
+[[nodiscard]] auto irradianceSH(const FloatCube& cube) -> IrradianceSH;
+
+/// GGX prefiltered radiance, split sum style with the view along the
+/// normal: level i of the result is cube convolved for roughness
+/// i / (SPECULAR_ROUGHNESS_LEVELS - 1), level 0 being the mirror. Every
+/// texel importance samples the GGX lobe with sample_count Hammersley
+/// points and reads the level of cube whose texels cover as much solid
+/// angle as a sample, which keeps low counts from sparkling. face_size is
+/// a power of two; rows of all faces are split across threads.
+[[nodiscard]] auto prefilterSpecular(const FloatCube& cube, std::uint32_t face_size, std::uint32_t sample_count)
+   -> std::array<HalfChain, 6>;
+
+/// On disk layout of cached irradiance: the header, then the coefficients.
+struct IrradianceCacheHeader {
+   static constexpr std::uint32_t MAGIC = 0x52524947; // "GIRR"
+   static constexpr std::uint32_t VERSION = 1;
+
+   std::uint32_t magic{MAGIC};
+   std::uint32_t version{VERSION};
+   std::uint64_t stamp{0};
+};
+
+auto writeIrradianceCache(const std::filesystem::path& path, std::uint64_t stamp, const IrradianceSH& sh) -> void;
+/// nullopt when the cache is missing, not an irradiance cache or was built from another source
+[[nodiscard]] auto readIrradianceCache(const std::filesystem::path& path, std::uint64_t stamp)
+   -> std::optional<IrradianceSH>;
+
+}
+
+#endif // GAME_TUTORIAL_IMAGE_BASED_LIGHTING_HPP
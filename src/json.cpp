@@ -0,0 +1,255 @@
+#include "json.hpp"
+#include "error.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+namespace game {
+
+/// recursive descent over the text, never copies more than the strings
+class JsonParser {
+public:
+   explicit JsonParser(const std::string_view text) : _text(text) {}
+
+   auto document() -> Json {
+      auto value = _value(0);
+      _skipSpaces();
+      _expect(_position == _text.size(), "trailing characters");
+      return value;
+   }
+
+private:
+   /// deeper than any sane asset header, keeps the stack bounded
+   static constexpr size_t MAX_DEPTH = 256;
+
+   auto _value(const size_t depth) -> Json {
+      _expect(depth < MAX_DEPTH, "nested too deep");
+      _skipSpaces();
+      _expect(_position < _text.size(), "unexpected end");
+      switch (_text[_position]) {
+         case '{': return _object(depth);
+         case '[': return _array(depth);
+         case '"': return Json{_string()};
+         case 't': _literal("true"); return Json{true};
+         case 'f': _literal("false"); return Json{false};
+         case 'n': _literal("null"); return Json{nullptr};
+         default: return Json{_number()};
+      }
+   }
+
+   auto _object(const size_t depth) -> Json {
+      auto members = Json::Object{};
+      ++_position;
+      _skipSpaces();
+      if (_consume('}')) {
+         return Json{std::move(members)};
+      }
+      do {
+         _skipSpaces();
+         _expect(_position < _text.size() and _text[_position] == '"', "expected a member name");
+         auto key = _string();
+         _skipSpaces();
+         _expect(_consume(':'), "expected ':'");
+         members.emplace_back(std::move(key), _value(depth + 1));
+         _skipSpaces();
+      } while (_consume(','));
+      _expect(_consume('}'), "expected '}'");
+      return Json{std::move(members)};
+   }
+
+   auto _array(const size_t depth) -> Json {
+      auto elements = Json::Array{};
+      ++_position;
+      _skipSpaces();
+      if (_consume(']')) {
+         return Json{std::move(elements)};
+      }
+      do {
+         elements.push_back(_value(depth + 1));
+         _skipSpaces();
+      } while (_consume(','));
+      _expect(_consume(']'), "expected ']'");
+      return Json{std::move(elements)};
+   }
+
+   auto _string() -> std::string {
+      auto result = std::string{};
+      ++_position;
+      while (true) {
+         _expect(_position < _text.size(), "unterminated string");
+         const auto c = _text[_position++];
+         if (c == '"') {
+            return result;
+         }
+         if (c != '\\') {
+            result += c;
+            continue;
+         }
+         _expect(_position < _text.size(), "unterminated escape");
+         switch (const auto e = _text[_position++]) {
+            case '"': case '\\': case '/': result += e; break;
+            case 'b': result += '\b'; break;
+            case 'f': result += '\f'; break;
+            case 'n': result += '\n'; break;
+            case 'r': result += '\r'; break;
+            case 't': result += '\t'; break;
+            case 'u': _codePoint(result); break;
+            default: _expect(false, "unknown escape");
+         }
+      }
+   }
+
+   /// \uXXXX, with surrogate pairs, written out as UTF-8
+   auto _codePoint(std::string& out) -> void {
+      auto code = _hex4();
+      if (code >= 0xd800 and code < 0xdc00) {
+         _expect(_consume('\\') and _consume('u'), "unpaired surrogate");
+         const auto low = _hex4();
+         _expect(low >= 0xdc00 and low < 0xe000, "unpaired surrogate");
+         code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+      }
+      if (code < 0x80) {
+         out += static_cast<char>(code);
+      } else if (code < 0x800) {
+         out += static_cast<char>(0xc0 | (code >> 6));
+         out += static_cast<char>(0x80 | (code & 0x3f));
+      } else if (code < 0x10000) {
+         out += static_cast<char>(0xe0 | (code >> 12));
+         out += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+         out += static_cast<char>(0x80 | (code & 0x3f));
+      } else {
+         out += static_cast<char>(0xf0 | (code >> 18));
+         out += static_cast<char>(0x80 | ((code >> 12) & 0x3f));
+         out += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+         out += static_cast<char>(0x80 | (code & 0x3f));
+      }
+   }
+
+   auto _hex4() -> std::uint32_t {
+      _expect(_position + 4 <= _text.size(), "short \\u escape");
+      auto value = std::uint32_t{0};
+      for (auto i = 0; i < 4; ++i) {
+         const auto c = _text[_position++];
+         const auto digit = c >= '0' and c <= '9' ? c - '0'
+                          : c >= 'a' and c <= 'f' ? c - 'a' + 10
+                          : c >= 'A' and c <= 'F' ? c - 'A' + 10 : -1;
+         _expect(digit >= 0, "bad \\u escape");
+         value = value * 16 + static_cast<std::uint32_t>(digit);
+      }
+      return value;
+   }
+
+   auto _number() -> double {
+      const auto start = _position;
+      const auto isNumeric = [](const char c) {
+         return (c >= '0' and c <= '9') or c == '-' or c == '+' or c == '.' or c == 'e' or c == 'E';
+      };
+      while (_position < _text.size() and isNumeric(_text[_position])) {
+         ++_position;
+      }
+      _expect(_position > start, "unexpected character");
+      /// headers hold few numbers, strtod needs them terminated
+      const auto text = std::string{_text.substr(start, _position - start)};
+      auto end = static_cast<char*>(nullptr);
+      const auto value = std::strtod(text.c_str(), &end);
+      _expect(end == text.c_str() + text.size() and std::isfinite(value), "bad number");
+      return value;
+   }
+
+   auto _literal(const std::string_view word) -> void {
+      _expect(_text.substr(_position, word.size()) == word, "unexpected character");
+      _position += word.size();
+   }
+
+   auto _consume(const char c) -> bool {
+      if (_position < _text.size() and _text[_position] == c) {
+         ++_position;
+         return true;
+      }
+      return false;
+   }
+
+   auto _skipSpaces() -> void {
+      while (_position < _text.size() and
+         (_text[_position] == ' ' or _text[_position] == '\n' or _text[_position] == '\r' or _text[_position] == '\t')) {
+         ++_position;
+      }
+   }
+
+   auto _expect(const bool condition, const std::string_view what) const -> void {
+      ensure(condition, std::format("invalid JSON at {}: {}", _position, what));
+   }
+
+   std::string_view _text;
+   size_t _position{0};
+};
+
+auto Json::parse(const std::string_view text) -> Json {
+   return JsonParser{text}.document();
+}
+
+auto Json::asBool() const -> bool {
+   ensure(std::holds_alternative<bool>(_value), "JSON value is not a boolean");
+   return std::get<bool>(_value);
+}
+
+auto Json::asNumber() const -> double {
+   ensure(std::holds_alternative<double>(_value), "JSON value is not a number");
+   return std::get<double>(_value);
+}
+
+auto Json::asIndex() const -> size_t {
+   const auto number = asNumber();
+   ensure(number >= 0.0 and number == std::floor(number) and number < 9007199254740992.0,
+      std::format("{} is not an index", number));
+   return static_cast<size_t>(number);
+}
+
+auto Json::asString() const -> const std::string& {
+   ensure(std::holds_alternative<std::string>(_value), "JSON value is not a string");
+   return std::get<std::string>(_value);
+}
+
+auto Json::asArray() const -> const Array& {
+   ensure(std::holds_alternative<Array>(_value), "JSON value is not an array");
+   return std::get<Array>(_value);
+}
+
+auto Json::asObject() const -> const Object& {
+   ensure(std::holds_alternative<Object>(_value), "JSON value is not an object");
+   return std::get<Object>(_value);
+}
+
+auto Json::find(const std::string_view key) const -> const Json* {
+   const auto object = std::get_if<Object>(&_value);
+   if (object == nullptr) {
+      return nullptr;
+   }
+   const auto member = std::ranges::find(*object, key, [](const auto& m) -> std::string_view {return m.first;});
+   return member == object->end() ? nullptr : &member->second;
+}
+
+auto Json::at(const std::string_view key) const -> const Json& {
+   const auto member = find(key);
+   ensure(member != nullptr, std::format("JSON object has no member {}", key));
+   return *member;
+}
+
+auto Json::at(const size_t index) const -> const Json& {
+   const auto& array = asArray();
+   ensure(index < array.size(), std::format("JSON index {} out of {} elements", index, array.size()));
+   return array[index];
+}
+
+auto Json::size() const -> size_t {
+   if (const auto array = std::get_if<Array>(&_value)) {
+      return array->size();
+   }
+   if (const auto object = std::get_if<Object>(&_value)) {
+      return object->size();
+   }
+   return 0;
+}
+
+}
@@ -0,0 +1,55 @@
+#ifndef GAME_TUTORIAL_JSON_HPP
+#define GAME_TUTORIAL_JSON_HPP
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace game {
+
+/// A parsed JSON document, just enough of it for asset headers such as
+/// glTF. Objects keep their members in file order and are searched
+/// linearly, they are small. Accessors of the wrong type throw.
+class Json {
+public:
+   using Array  = std::vector<Json>;
+   using Object = std::vector<std::pair<std::string, Json>>;
+
+   Json() = default;
+
+   /// throws on anything that is not exactly one JSON value
+   static auto parse(std::string_view text) -> Json;
+
+   [[nodiscard]] constexpr auto isNull() const -> bool {return std::holds_alternative<std::nullptr_t>(_value);}
+
+   [[nodiscard]] auto asBool() const -> bool;
+   [[nodiscard]] auto asNumber() const -> double;
+   /// a number that is a non negative integer
+   [[nodiscard]] auto asIndex() const -> size_t;
+   [[nodiscard]] auto asString() const -> const std::string&;
+   [[nodiscard]] auto asArray() const -> const Array&;
+   [[nodiscard]] auto asObject() const -> const Object&;
+
+   /// nullptr if this is not an object or has no such member
+   [[nodiscard]] auto find(std::string_view key) const -> const Json*;
+   [[nodiscard]] auto at(std::string_view key) const -> const Json&;
+   [[nodiscard]] auto at(size_t index) const -> const Json&;
+   /// elements of an array, members of an object, 0 otherwise
+   [[nodiscard]] auto size() const -> size_t;
+
+private:
+   using Value = std::variant<std::nullptr_t, bool, double, std::string, Array, Object>;
+
+   explicit Json(Value value) : _value(std::move(value)) {}
+
+   friend class JsonParser;
+
+   Value _value{nullptr};
+};
+
+}
+
+#endif // GAME_TUTORIAL_JSON_HPP
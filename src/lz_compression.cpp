@@ -0,0 +1,186 @@
+#include "lz_compression.hpp"
+#include "error.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+
+namespace game {
+
+namespace {
+
+constexpr size_t MIN_MATCH = 4;
+constexpr size_t MAX_OFFSET = 65535;
+constexpr size_t HASH_BITS = 16;
+/// as in LZ4: the block ends in literals and no match starts near the end,
+/// so that a decoder may copy whole words
+constexpr size_t LAST_LITERALS = 5;
+constexpr size_t MATCH_LIMIT = 12;
+/// probing every position of incompressible data is slow, the longer
+/// nothing matched the further ahead the next probe
+constexpr size_t SKIP_SHIFT = 6;
+
+static_assert(std::endian::native == std::endian::little, "matches are measured on little endian words");
+
+auto read32(const std::byte* const p) -> std::uint32_t {
+   std::uint32_t value;
+   std::memcpy(&value, p, sizeof(value));
+   return value;
+}
+
+auto read64(const std::byte* const p) -> std::uint64_t {
+   std::uint64_t value;
+   std::memcpy(&value, p, sizeof(value));
+   return value;
+}
+
+auto hash(const std::uint32_t value) -> size_t {
+   return (value * 2654435761u) >> (32 - HASH_BITS);
+}
+
+/// what is left of a length after the 15 in its token
+auto writeLength(std::vector<std::byte>& out, size_t length) -> void {
+   for (; length >= 255; length -= 255) {
+      out.push_back(std::byte{255});
+   }
+   out.push_back(static_cast<std::byte>(length));
+}
+
+auto writeSequence(std::vector<std::byte>& out, const std::span<const std::byte> literals, const size_t offset,
+   const size_t match) -> void {
+   const auto extra = match - MIN_MATCH;
+   out.push_back(static_cast<std::byte>((std::min<size_t>(literals.size(), 15) << 4) | std::min<size_t>(extra, 15)));
+   if (literals.size() >= 15) {
+      writeLength(out, literals.size() - 15);
+   }
+   out.insert(out.end(), literals.begin(), literals.end());
+   out.push_back(static_cast<std::byte>(offset & 0xffu));
+   out.push_back(static_cast<std::byte>(offset >> 8));
+   if (extra >= 15) {
+      writeLength(out, extra - 15);
+   }
+}
+
+/// bytes equal at a and b, up to limit
+auto matchLength(const std::byte* a, const std::byte* b, const std::byte* const limit) -> size_t {
+   const auto* const start = a;
+   while (a + sizeof(std::uint64_t) <= limit) {
+      if (const auto difference = read64(a) ^ read64(b); difference != 0) {
+         return static_cast<size_t>(a - start) + static_cast<size_t>(std::countr_zero(difference)) / 8;
+      }
+      a += sizeof(std::uint64_t);
+      b += sizeof(std::uint64_t);
+   }
+   while (a < limit and *a == *b) {
+      ++a;
+      ++b;
+   }
+   return static_cast<size_t>(a - start);
+}
+
+/// a length past the 15 of its token, bounded by what is left of the block
+auto readLength(const std::span<const std::byte> block, size_t& in) -> size_t {
+   auto length = size_t{0};
+   auto byte = std::uint8_t{255};
+   while (byte == 255) {
+      ensure(in < block.size(), "a compressed block ends inside a length");
+      byte = std::to_integer<std::uint8_t>(block[in++]);
+      length += byte;
+   }
+   return length;
+}
+
+}
+
+auto compressBlock(const std::span<const std::byte> source) -> std::vector<std::byte> {
+   auto out = std::vector<std::byte>{};
+   out.reserve(compressBound(source.size()));
+   const auto* const data = source.data();
+   const auto size = source.size();
+   auto anchor = size_t{0};
+   if (size >= MATCH_LIMIT) {
+      auto table = std::vector<std::uint32_t>(size_t{1} << HASH_BITS, 0);
+      const auto match_end = size - LAST_LITERALS;
+      auto position = size_t{1};
+      while (position + MATCH_LIMIT <= size) {
+         const auto value = read32(data + position);
+         auto& slot = table[hash(value)];
+         auto candidate = size_t{slot};
+         slot = static_cast<std::uint32_t>(position);
+         if (candidate >= position or position - candidate > MAX_OFFSET or read32(data + candidate) != value) {
+            position += 1 + ((position - anchor) >> SKIP_SHIFT);
+            continue;
+         }
+         /// the match may start among the literals before it
+         while (position > anchor and candidate > 0 and data[position - 1] == data[candidate - 1]) {
+            --position;
+            --candidate;
+         }
+         const auto length = MIN_MATCH + matchLength(data + position + MIN_MATCH, data + candidate + MIN_MATCH,
+            data + match_end);
+         writeSequence(out, source.subspan(anchor, position - anchor), position - candidate, length);
+         position += length;
+         anchor = position;
+         /// the position just before the next probe, matches often continue there
+         if (position + MATCH_LIMIT <= size) {
+            table[hash(read32(data + position - 2))] = static_cast<std::uint32_t>(position - 2);
+         }
+      }
+   }
+   const auto literals = size - anchor;
+   out.push_back(static_cast<std::byte>(std::min<size_t>(literals, 15) << 4));
+   if (literals >= 15) {
+      writeLength(out, literals - 15);
+   }
+   out.insert(out.end(), source.begin() + static_cast<std::ptrdiff_t>(anchor), source.end());
+   return out;
+}
+
+auto decompressBlock(const std::span<const std::byte> block, const std::span<std::byte> destination) -> void {
+   auto in = size_t{0};
+   auto out = size_t{0};
+   while (true) {
+      ensure(in < block.size(), "a compressed block ends before its last literals");
+      const auto token = std::to_integer<std::uint8_t>(block[in++]);
+      auto literals = static_cast<size_t>(token >> 4u);
+      if (literals == 15) {
+         literals += readLength(block, in);
+      }
+      ensure(literals <= block.size() - in and literals <= destination.size() - out,
+         "the literals of a compressed block run past its end");
+      if (literals > 0) {
+         std::memcpy(destination.data() + out, block.data() + in, literals);
+      }
+      in += literals;
+      out += literals;
+      if (in == block.size()) {
+         break;
+      }
+
+      ensure(block.size() - in >= 2, "a compressed block ends inside an offset");
+      const auto offset = std::to_integer<size_t>(block[in]) | std::to_integer<size_t>(block[in + 1]) << 8u;
+      in += 2;
+      ensure(offset > 0 and offset <= out, "a compressed block refers back past its start");
+      auto length = static_cast<size_t>(token & 15u);
+      if (length == 15) {
+         length += readLength(block, in);
+      }
+      length += MIN_MATCH;
+      ensure(length <= destination.size() - out, "a match of a compressed block runs past its end");
+      auto* const target = destination.data() + out;
+      if (offset >= length) {
+         std::memcpy(target, target - offset, length);
+      } else {
+         /// overlapping: a run repeating the last offset bytes
+         for (auto i = size_t{0}; i < length; ++i) {
+            target[i] = target[i - offset];
+         }
+      }
+      out += length;
+   }
+   ensure(out == destination.size(),
+      std::format("a compressed block decodes to {} bytes, not {}", out, destination.size()));
+}
+
+}
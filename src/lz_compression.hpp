@@ -0,0 +1,31 @@
+#ifndef GAME_TUTORIAL_LZ_COMPRESSION_HPP
+#define GAME_TUTORIAL_LZ_COMPRESSION_HPP
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+namespace game {
+
+/// Compresses source as one block in the layout of LZ4 blocks:
+/// sequences of a token (literal run length, match length - 4), the
+/// literals, a 16 bit little endian offset back into the output and
+/// length extensions of 255s. Greedy, one hash table probe per
+/// position: fast rather than small, for assets decoded at load time.
+/// The original size is not stored, the caller keeps it.
+[[nodiscard]] auto compressBlock(std::span<const std::byte> source) -> std::vector<std::byte>;
+
+/// the most compressBlock() can make of size bytes, for incompressible data
+[[nodiscard]] constexpr auto compressBound(const size_t size) -> size_t {return size + size / 255 + 16;}
+/// the most a block of size bytes decodes to: every length extension
+/// byte adds at most 255
+[[nodiscard]] constexpr auto decompressBound(const size_t size) -> size_t {return size * 255;}
+
+/// Decodes block into destination, which is exactly as large as what
+/// was compressed; throws if block is corrupt or decodes to another size.
+/// Every read and write is bounds checked, an archive may be damaged.
+auto decompressBlock(std::span<const std::byte> block, std::span<std::byte> destination) -> void;
+
+}
+
+#endif // GAME_TUTORIAL_LZ_COMPRESSION_HPP
@@ -0,0 +1,140 @@
+#include "mapped_file.hpp"
+#include "error.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <utility>
+
+namespace game {
+
+namespace {
+
+/// closes the descriptor on scope exit, the mapping survives it
+struct FileDescriptor {
+   int fd;
+   ~FileDescriptor() {
+      if (fd >= 0) {
+         ::close(fd);
+      }
+   }
+};
+
+}
+
+auto MappedFile::open(const std::filesystem::path& path, const MapHints hints) -> MappedFile {
+   const FileDescriptor file{::open(path.c_str(), O_RDONLY)};
+   ensure(file.fd >= 0, std::format("could not open {}: {}", path.string(), std::strerror(errno)));
+   const auto size = static_cast<size_t>(::lseek(file.fd, 0, SEEK_END));
+   if (size == 0) {
+      return MappedFile{nullptr, 0};
+   }
+   /// writable but private: Metal no-copy buffers want writable pages
+   auto* data = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, file.fd, 0);
+   ensure(data != MAP_FAILED, std::format("could not map {}: {}", path.string(), std::strerror(errno)));
+   auto mapped = MappedFile{static_cast<std::byte*>(data), size};
+   mapped.advise(hints);
+   return mapped;
+}
+
+auto MappedFile::create(const std::filesystem::path& path, const size_t size) -> MappedFile {
+   const FileDescriptor file{::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644)};
+   ensure(file.fd >= 0, std::format("could not create {}: {}", path.string(), std::strerror(errno)));
+   ensure(::ftruncate(file.fd, static_cast<off_t>(size)) == 0,
+      std::format("could not resize {} to {} bytes", path.string(), size));
+   if (size == 0) {
+      return MappedFile{nullptr, 0};
+   }
+   auto* data = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, file.fd, 0);
+   ensure(data != MAP_FAILED, std::format("could not map {}: {}", path.string(), std::strerror(errno)));
+   return MappedFile{static_cast<std::byte*>(data), size};
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+   : _data(std::exchange(other._data, nullptr)), _size(std::exchange(other._size, 0)) {
+}
+
+auto MappedFile::operator=(MappedFile&& other) noexcept -> MappedFile& {
+   MappedFile moved{std::move(other)};
+   std::swap(_data, moved._data);
+   std::swap(_size, moved._size);
+   return *this;
+}
+
+MappedFile::~MappedFile() {
+   if (_data != nullptr) {
+      ::munmap(_data, _size);
+   }
+}
+
+auto MappedFile::flush() const -> void {
+   if (_data != nullptr) {
+      ensure(::msync(_data, _size, MS_SYNC) == 0, "could not write back a mapped file");
+   }
+}
+
+auto MappedFile::advise(const MapHints hints) const -> void {
+   if (_data == nullptr) {
+      return;
+   }
+   if (hints.sequential) {
+      (void)::madvise(_data, _size, MADV_SEQUENTIAL);
+   }
+   if (hints.willNeed) {
+      (void)::madvise(_data, _size, MADV_WILLNEED);
+   }
+#ifdef MADV_HUGEPAGE
+   if (hints.hugePages) {
+      (void)::madvise(_data, _size, MADV_HUGEPAGE);
+   }
+#endif
+}
+
+auto MappedFile::pageSize() -> size_t {
+   static const auto page_size = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+   return page_size;
+}
+
+auto FileContents::open(const std::filesystem::path& path, const MapHints hints) -> FileContents {
+   auto contents = FileContents{};
+   {
+      const FileDescriptor file{::open(path.c_str(), O_RDONLY)};
+      ensure(file.fd >= 0, std::format("could not open {}: {}", path.string(), std::strerror(errno)));
+      const auto size = static_cast<size_t>(::lseek(file.fd, 0, SEEK_END));
+      if (size < MAPPING_THRESHOLD) {
+         contents._buffer.resize(size);
+         for (auto done = size_t{0}; done < size;) {
+            const auto read = ::pread(file.fd, contents._buffer.data() + done, size - done, static_cast<off_t>(done));
+            if (read < 0 and errno == EINTR) {
+               continue;
+            }
+            ensure(read > 0, std::format("could not read {}: {}", path.string(),
+               read == 0 ? "it got shorter" : std::strerror(errno)));
+            done += static_cast<size_t>(read);
+         }
+         return contents;
+      }
+   }
+   auto mapping = std::make_shared<const MappedFile>(MappedFile::open(path, hints));
+   const auto bytes = std::span<const std::byte>{mapping->bytes()};
+   return view(std::move(mapping), bytes);
+}
+
+auto FileContents::view(std::shared_ptr<const MappedFile> mapping, const std::span<const std::byte> bytes)
+   -> FileContents {
+   auto contents = FileContents{};
+   contents._mapping = std::move(mapping);
+   contents._view = bytes;
+   return contents;
+}
+
+auto FileContents::buffer(std::vector<std::byte> bytes) -> FileContents {
+   auto contents = FileContents{};
+   contents._buffer = std::move(bytes);
+   return contents;
+}
+
+}
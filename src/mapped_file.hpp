@@ -0,0 +1,90 @@
+#ifndef GAME_TUTORIAL_MAPPED_FILE_HPP
+#define GAME_TUTORIAL_MAPPED_FILE_HPP
+
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <vector>
+
+namespace game {
+
+/// how a mapping is going to be read, passed on to madvise; hints the
+/// system does not know are left out
+struct MapHints {
+   /// front to back once, read ahead aggressively and drop pages behind
+   bool sequential{false};
+   /// start reading the whole file in now
+   bool willNeed{false};
+   /// back the mapping with huge pages where the file system can (Linux)
+   bool hugePages{false};
+};
+
+/// A file mapped in memory. The mapping starts on a page boundary, so
+/// page aligned sections of the file can be handed to the GPU as is.
+class MappedFile {
+public:
+   /// private (copy on write) mapping of an existing file, writes never reach the file
+   static auto open(const std::filesystem::path& path, MapHints hints = {}) -> MappedFile;
+   /// creates or truncates the file to size bytes and maps it shared,
+   /// writes to the mapping end up in the file
+   static auto create(const std::filesystem::path& path, size_t size) -> MappedFile;
+
+   MappedFile(const MappedFile&) = delete;
+   auto operator=(const MappedFile&) -> MappedFile& = delete;
+   MappedFile(MappedFile&& other) noexcept;
+   auto operator=(MappedFile&& other) noexcept -> MappedFile&;
+   ~MappedFile();
+
+   [[nodiscard]] constexpr auto data() const -> std::byte* {return _data;}
+   [[nodiscard]] constexpr auto size() const -> size_t {return _size;}
+   [[nodiscard]] constexpr auto bytes() const -> std::span<std::byte> {return {_data, _size};}
+
+   /// writes dirty pages of a shared mapping back to the file
+   auto flush() const -> void;
+   /// hints about the reads to come, for the whole mapping; a hint the
+   /// system turns down is not an error
+   auto advise(MapHints hints) const -> void;
+
+   [[nodiscard]] static auto pageSize() -> size_t;
+   [[nodiscard]] static auto pageAligned(const size_t size) -> size_t {
+      return (size + pageSize() - 1) / pageSize() * pageSize();
+   }
+
+private:
+   MappedFile(std::byte* data, size_t size) : _data(data), _size(size) {}
+
+   std::byte* _data{nullptr};
+   size_t _size{0};
+};
+
+/// The bytes of a file, read only: mapped, or read into memory when the
+/// file is small enough that setting up and tearing down a mapping costs
+/// more than a copy. An archive entry is a view of the archive mapping,
+/// or a buffer once decompressed. The bytes live as long as it does.
+class FileContents {
+public:
+   /// files below this are read rather than mapped
+   static constexpr size_t MAPPING_THRESHOLD = size_t{64} << 10;
+
+   /// hints only apply to mapped files
+   static auto open(const std::filesystem::path& path, MapHints hints = {}) -> FileContents;
+   /// bytes within mapping, which is kept alive with them
+   static auto view(std::shared_ptr<const MappedFile> mapping, std::span<const std::byte> bytes) -> FileContents;
+   static auto buffer(std::vector<std::byte> bytes) -> FileContents;
+
+   [[nodiscard]] auto bytes() const -> std::span<const std::byte> {
+      return _mapping ? _view : std::span<const std::byte>{_buffer};
+   }
+   [[nodiscard]] auto size() const -> size_t {return bytes().size();}
+   [[nodiscard]] auto isMapped() const -> bool {return _mapping != nullptr;}
+
+private:
+   std::shared_ptr<const MappedFile> _mapping;
+   std::span<const std::byte> _view;
+   std::vector<std::byte> _buffer;
+};
+
+}
+
+#endif // GAME_TUTORIAL_MAPPED_FILE_HPP
@@ -4,11 +4,8 @@
 #include <span>
 #include <iomanip>
 #include <format>
-#include <simd/simd.h>
-#include <simd/math.h>
-#include <simd/matrix.h>
-#include <simd/matrix_types.h>
 
+#include "simd_compat.hpp"
 #include "vector3.hpp"
 
 namespace game {
@@ -0,0 +1,24 @@
+#ifndef GAME_TUTORIAL_MEMORY_STATS_HPP
+#define GAME_TUTORIAL_MEMORY_STATS_HPP
+
+#include <sys/resource.h>
+
+#include <cstddef>
+
+namespace game {
+
+/// high water mark of the resident set of the process, in bytes
+inline auto peakResidentBytes() -> size_t {
+   rusage usage{};
+   ::getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+   return static_cast<size_t>(usage.ru_maxrss);
+#else
+   /// kilobytes everywhere else
+   return static_cast<size_t>(usage.ru_maxrss) * 1024;
+#endif
+}
+
+}
+
+#endif // GAME_TUTORIAL_MEMORY_STATS_HPP
@@ -1,25 +1,134 @@
 #include <Metal/Metal.hpp>
 #include <QuartzCore/QuartzCore.hpp>
 #include "mesh.hpp"
+#include "mesh_factory.hpp"
+
+#include <algorithm>
+#include <limits>
 
 namespace game {
 
-Mesh::Mesh(MeshData * md)
-   : _vertices{md->vertices}, _indexes{md->indexes}
+namespace {
+
+/// frees the ranges a constructor allocated when it throws, the
+/// destructor of a mesh that was never constructed does not run
+struct RangeGuard {
+   MeshBufferPool& pool;
+   BufferRange& vertices;
+   BufferRange& indexes;
+   bool released{false};
+
+   ~RangeGuard() {
+      if (not released) {
+         pool.vertices.free(vertices);
+         pool.indexes.free(indexes);
+      }
+   }
+};
+
+}
+
+Mesh::Mesh(MeshData * md, MeshletData meshlets)
+   : _vertices{md->vertices}, _indexes{md->indexes}, _vertexCount{md->vertices.size()}, _indexCount{md->indexes.size()},
+     _meshlets{std::move(meshlets)}, _bounds{MeshFactory::boundingSphere(md->vertices)}
 {
 }
 
-auto Mesh::createBuffers(MTL::Device* const device) -> void {
-   ensure(static_cast<bool>(_mesh_buffer) == false,
+Mesh::Mesh(MeshBufferPool& pool, const MeshCache& cache)
+   : _vertices{cache.vertices()}, _vertexCount{cache.vertices().size()}, _indexCount{cache.indexCount()}, _meshlets{cache.meshlets()},
+     _bounds{MeshFactory::boundingSphere(cache.vertices())}, _pool{&pool},
+     _indexType{cache.indexSize() == sizeof(std::uint16_t) ? MTL::IndexTypeUInt16 : MTL::IndexTypeUInt32}
+{
+   _vertexRange = pool.vertices.adopt(cache.vertexSection(), static_cast<std::uint32_t>(n_verts()), cache.file());
+   /// the index pool counts 4 byte words
+   _indexRange = pool.indexes.adopt(cache.indexSection(),
+      static_cast<std::uint32_t>((_indexCount * cache.indexSize() + sizeof(std::uint32_t) - 1) / sizeof(std::uint32_t)),
+      cache.file());
+}
+
+Mesh::Mesh(MeshBufferPool& pool, UploadManager& uploads, const GltfMesh& mesh)
+   : _vertexCount{mesh.vertexCount()}, _indexCount{mesh.indexCount()} {
+   /// decoding throws on malformed accessors, after the ranges are taken
+   auto guard = RangeGuard{.pool = pool, .vertices = _vertexRange, .indexes = _indexRange};
+   if (not mesh.hasTangents()) {
+      /// generating tangents reads the vertices back, which staging memory
+      /// is not made for: decoded on the CPU and uploaded from there, the
+      /// spans only live for createBuffers
+      auto data = MeshData{std::vector<VertexData>(_vertexCount), std::vector<std::uint32_t>(_indexCount)};
+      MeshFactory::decodeGltfIndexes(mesh, data.indexes);
+      MeshFactory::decodeGltfVertices(mesh, data.vertices);
+      MeshFactory::generateTangents(data);
+      _bounds = MeshFactory::boundingSphere(data.vertices);
+      _vertices = data.vertices;
+      _indexes = data.indexes;
+      createBuffers(pool, uploads);
+      _vertices = {};
+      _indexes = {};
+      guard.released = true;
+      return;
+   }
+
+   ensure(_vertexCount > 0 and _indexCount > 0,
+      "mesh has no geometry to upload");
+   /// the vertices are never read back from staging memory, the accessors bound them
+   _bounds = MeshFactory::boundingSphere(mesh);
+   _pool = &pool;
+   /// every staging span is filled before the next one is asked for,
+   /// asking may flush; same choice of index width as createBuffers
+   if (_vertexCount < std::numeric_limits<std::uint16_t>::max()) {
+      _indexType = MTL::IndexTypeUInt16;
+      _indexRange = pool.indexes.allocate(static_cast<std::uint32_t>((_indexCount + 1) / 2));
+      const auto indexes = uploads.stage(pool.indexes.getBuffer(_indexRange), pool.indexes.byteOffset(_indexRange),
+         _indexRange.count * pool.indexes.getUnit());
+      MeshFactory::decodeGltfIndexes(mesh, std::span{reinterpret_cast<std::uint16_t*>(indexes.data()), _indexCount});
+   } else {
+      _indexType = MTL::IndexTypeUInt32;
+      _indexRange = pool.indexes.allocate(static_cast<std::uint32_t>(_indexCount));
+      const auto indexes = uploads.stage(pool.indexes.getBuffer(_indexRange), pool.indexes.byteOffset(_indexRange),
+         _indexCount * sizeof(std::uint32_t));
+      MeshFactory::decodeGltfIndexes(mesh, std::span{reinterpret_cast<std::uint32_t*>(indexes.data()), _indexCount});
+   }
+   _vertexRange = pool.vertices.allocate(static_cast<std::uint32_t>(_vertexCount));
+   const auto vertices = uploads.stage(pool.vertices.getBuffer(_vertexRange), pool.vertices.byteOffset(_vertexRange),
+      _vertexCount * sizeof(VertexData));
+   MeshFactory::decodeGltfVertices(mesh, std::span{reinterpret_cast<VertexData*>(vertices.data()), _vertexCount});
+   guard.released = true;
+}
+
+Mesh::~Mesh() {
+   if (_pool != nullptr) {
+      _pool->vertices.free(_vertexRange);
+      _pool->indexes.free(_indexRange);
+   }
+}
+
+auto Mesh::createBuffers(MeshBufferPool& pool, UploadManager& uploads) -> void {
+   ensure(_pool == nullptr,
       "mesh buffer already exists!");
-   _mesh_buffer = {
-      device->newBuffer(_vertices.data(),size(),MTL::ResourceStorageModeShared),
-      [](auto t) {t->release();}
-   };
-   _index_buffer = {
-      device->newBuffer(_indexes.data(),sizeof(std::uint32_t)*_indexes.size(),MTL::ResourceStorageModeShared),
-      [](auto t) {t->release();}
-   };
+   ensure(n_verts() > 0 and not _indexes.empty(),
+      "mesh has no geometry to upload");
+   _pool = &pool;
+   _vertexRange = pool.vertices.allocate(static_cast<std::uint32_t>(n_verts()));
+   uploads.upload(pool.vertices.getBuffer(_vertexRange), pool.vertices.byteOffset(_vertexRange),
+      std::as_bytes(std::span<const VertexData>{_vertices}));
+
+   /// 16 bit indexes whenever every vertex is addressable, 0xffff is left
+   /// out as it is the primitive restart value. The pool counts in 4 byte
+   /// words, two 16 bit indexes per word. Narrowing writes straight into
+   /// the staging memory.
+   if (n_verts() < std::numeric_limits<std::uint16_t>::max()) {
+      _indexType = MTL::IndexTypeUInt16;
+      _indexRange = pool.indexes.allocate(static_cast<std::uint32_t>((_indexes.size() + 1) / 2));
+      const auto staged = uploads.stage(pool.indexes.getBuffer(_indexRange), pool.indexes.byteOffset(_indexRange),
+         _indexRange.count * pool.indexes.getUnit());
+      std::ranges::transform(_indexes, reinterpret_cast<std::uint16_t*>(staged.data()),
+         [](const std::uint32_t i) {return static_cast<std::uint16_t>(i);});
+   } else {
+      _indexType = MTL::IndexTypeUInt32;
+      _indexRange = pool.indexes.allocate(static_cast<std::uint32_t>(_indexes.size()));
+      uploads.upload(pool.indexes.getBuffer(_indexRange), pool.indexes.byteOffset(_indexRange),
+         std::as_bytes(std::span<const std::uint32_t>{_indexes}));
+   }
 }
 
 }
@@ -1,104 +1,79 @@
 #ifndef GAME_TUTORIAL_MESH_HPP
 #define GAME_TUTORIAL_MESH_HPP
 #include <Metal/Metal.hpp>
-#include <simd/simd.h>
 #include <vector>
 #include <iostream>
+#include <limits>
 
 #include "auto_release.hpp"
+#include "buffer_pool.hpp"
+#include "gltf_file.hpp"
+#include "mesh_cache.hpp"
+#include "meshlet.hpp"
+#include "upload_manager.hpp"
 #include "vector3.hpp"
+#include "vertex_data.hpp"
 
 namespace game {
 
-struct VertexData {
-   simd::float4 position;
-   simd::float3 normal;
-   simd::float3 tangent;
-   simd::float3 bitangent;
-   simd::float2 uv;
-};
-
-struct MeshData {
-   std::vector<VertexData> vertices;
-   std::vector<std::uint32_t> indexes;
-};
-
-inline auto operator==(const VertexData& v1, const VertexData& v2) -> bool {
-   return v1.position.x == v2.position.x and v1.position.y == v2.position.y and v1.position.z == v2.position.z;
-}
-
 class Mesh {
 public:
-   Mesh(MeshData * md);
-   ~Mesh() = default;
+   Mesh(MeshData * md, MeshletData meshlets = {});
+   /// zero copy: the cache sections become pool arenas through no-copy buffers
+   Mesh(MeshBufferPool& pool, const MeshCache& cache);
+   /// decoded straight into staging memory for ranges of the pool when
+   /// the mesh has its tangents, through the CPU otherwise; the vertices
+   /// are not kept and getVertexArray() is empty. Usable once uploads has
+   /// been flushed
+   Mesh(MeshBufferPool& pool, UploadManager& uploads, const GltfMesh& mesh);
+   ~Mesh();
+   /// owns its ranges in the pool
+   Mesh(const Mesh&) = delete;
+   auto operator=(const Mesh&) -> Mesh& = delete;
 
    [[nodiscard]] auto getVertexArray() const             -> const std::span<VertexData>& {return _vertices;}
    [[nodiscard]] auto accessVertexArray()                -> std::span<VertexData>* {return &_vertices;}
-   [[nodiscard]] constexpr auto size() const             -> size_t {return _vertices.size()*sizeof(VertexData);}
-   [[nodiscard]] constexpr auto n_verts() const          -> size_t {return _vertices.size();}
-   auto createBuffers(MTL::Device* device)               -> void;
-   [[nodiscard]] constexpr auto getVertexBuffer() const  -> MTL::Buffer * {return _mesh_buffer.get();}
-   [[nodiscard]] constexpr auto getIndexBuffer() const   -> MTL::Buffer * {return _index_buffer.get();}
-   [[nodiscard]] constexpr auto getIndexCount() const    -> size_t {return _indexes.size();}
+   [[nodiscard]] constexpr auto size() const             -> size_t {return _vertexCount*sizeof(VertexData);}
+   [[nodiscard]] constexpr auto n_verts() const          -> size_t {return _vertexCount;}
+   /// stages vertices and indexes for ranges of the pool, which must outlive
+   /// the mesh; they are usable once uploads has been flushed
+   auto createBuffers(MeshBufferPool& pool, UploadManager& uploads) -> void;
+   [[nodiscard]] constexpr auto hasBuffers() const       -> bool {return _pool != nullptr;}
+   [[nodiscard]] auto getVertexBuffer() const            -> MTL::Buffer * {return _pool->vertices.getBuffer(_vertexRange);}
+   [[nodiscard]] auto getIndexBuffer() const             -> MTL::Buffer * {return _pool->indexes.getBuffer(_indexRange);}
+   /// the vertex buffer is bound at offset 0, draws add the base vertex
+   [[nodiscard]] constexpr auto getBaseVertex() const    -> NS::Integer {return _vertexRange.offset();}
+   [[nodiscard]] constexpr auto getIndexBufferOffset() const -> size_t {
+      return static_cast<size_t>(_indexRange.offset()) * sizeof(std::uint32_t);
+   }
+   [[nodiscard]] auto accessVertexRange()                -> BufferRange* {return &_vertexRange;}
+   [[nodiscard]] auto accessIndexRange()                 -> BufferRange* {return &_indexRange;}
+   [[nodiscard]] constexpr auto getIndexCount() const    -> size_t {return _indexCount;}
+   [[nodiscard]] constexpr auto getIndexType() const     -> MTL::IndexType {return _indexType;}
+   [[nodiscard]] constexpr auto getIndexSize() const     -> size_t {
+      return _indexType == MTL::IndexTypeUInt16 ? sizeof(std::uint16_t) : sizeof(std::uint32_t);
+   }
    [[nodiscard]] constexpr auto getPrimitiveType() const -> MTL::PrimitiveType {return _primitiveType;}
+   [[nodiscard]] constexpr auto getMeshlets() const      -> const MeshletData& {return _meshlets;}
+   /// in mesh space, see MeshFactory::boundingSphere; for glTF meshes
+   /// decoded straight to staging memory, the one around their boxes
+   [[nodiscard]] constexpr auto getBounds() const        -> simd::float4 {return _bounds;}
 
 private:
    std::span<VertexData> _vertices;
    std::span<std::uint32_t> _indexes;
-   AutoRelease<MTL::Buffer*> _mesh_buffer{};
-   AutoRelease<MTL::Buffer*> _index_buffer{};
+   size_t _vertexCount{0};
+   size_t _indexCount{0};
+   MeshletData _meshlets;
+   simd::float4 _bounds{simd::make_float4(0.0f, 0.0f, 0.0f, std::numeric_limits<float>::infinity())};
+   MeshBufferPool* _pool{nullptr};
+   BufferRange _vertexRange{};
+   BufferRange _indexRange{};
    MTL::PrimitiveType _primitiveType {MTL::PrimitiveTypeTriangle};
+   MTL::IndexType _indexType {MTL::IndexTypeUInt32};
 };
 }
 
-template<>
-struct std::formatter<simd::float4> {
-   static constexpr auto parse(const std::format_parse_context &ctx) {
-      return std::cbegin(ctx);
-   }
-
-   static auto format(const simd::float4 &vd, std::format_context &ctx) {
-      return std::format_to(ctx.out(),
-         "({}, {}, {}, {})", vd.x, vd.y,vd.z, vd.w);
-   }
-};
-
-template<>
-struct std::formatter<simd::float3> {
-   static constexpr auto parse(const std::format_parse_context &ctx) {
-      return std::cbegin(ctx);
-   }
-
-   static auto format(const simd::float3 &vd, std::format_context &ctx) {
-      return std::format_to(ctx.out(),
-         "({}, {}, {})", vd.x, vd.y, vd.z);
-   }
-};
-
-template<>
-struct std::formatter<simd::float2> {
-   static constexpr auto parse(const std::format_parse_context &ctx) {
-      return std::cbegin(ctx);
-   }
-
-   static auto format(const simd::float2 &vd, std::format_context &ctx) {
-      return std::format_to(ctx.out(),
-         "({}, {})", vd.x, vd.y);
-   }
-};
-
-template<>
-struct std::formatter<game::VertexData> {
-   static constexpr auto parse(const std::format_parse_context &ctx) {
-      return std::cbegin(ctx);
-   }
-
-   static auto format(const game::VertexData &vd, std::format_context &ctx) {
-      return std::format_to(ctx.out(),
-         "position = {}, normal = {}, uv = {}", vd.position, vd.normal, vd.uv);
-   }
-};
-
 template<>
 struct std::formatter<game::Mesh> {
    static constexpr auto parse(const std::format_parse_context &ctx) {
@@ -0,0 +1,145 @@
+#include "mesh_cache.hpp"
+#include "error.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <limits>
+
+namespace game {
+
+namespace {
+
+auto meshletBytes(const MeshCacheHeader& h) -> size_t {
+   return h.meshletCount * (sizeof(MeshletBounds) + sizeof(Meshlet)) +
+          h.meshletVertexCount * sizeof(std::uint32_t) + h.meshletTriangleCount;
+}
+
+template <class T>
+auto view(const std::span<const std::byte> bytes, size_t& offset, const size_t count) -> std::span<const T> {
+   const auto typed = std::span{reinterpret_cast<const T*>(bytes.data() + offset), count};
+   offset += count * sizeof(T);
+   return typed;
+}
+
+}
+
+auto MeshCache::stamp(const std::filesystem::path& source) -> std::uint64_t {
+   const auto time = std::filesystem::last_write_time(source).time_since_epoch().count();
+   return static_cast<std::uint64_t>(time) * 31 + std::filesystem::file_size(source);
+}
+
+auto MeshCache::open(const std::filesystem::path& path, const std::uint64_t stamp) -> std::optional<MeshCache> {
+   if (not std::filesystem::exists(path)) {
+      return std::nullopt;
+   }
+   auto file = std::make_shared<MappedFile>(MappedFile::open(path));
+   if (file->size() < sizeof(MeshCacheHeader)) {
+      return std::nullopt;
+   }
+   MeshCacheHeader h;
+   std::memcpy(&h, file->data(), sizeof(h));
+
+   /// the page size is part of the layout, a cache from another machine is rebuilt
+   const auto page = MappedFile::pageSize();
+   const auto valid =
+      h.magic == MeshCacheHeader::MAGIC and h.version == MeshCacheHeader::VERSION and h.stamp == stamp and
+      (h.indexSize == sizeof(std::uint16_t) or h.indexSize == sizeof(std::uint32_t)) and
+      h.vertexCount > 0 and h.indexCount > 0 and
+      h.vertexOffset % page == 0 and h.indexOffset % page == 0 and h.meshletOffset % page == 0 and
+      h.vertexOffset + MappedFile::pageAligned(h.vertexCount * sizeof(VertexData)) <= h.indexOffset and
+      h.indexOffset + MappedFile::pageAligned(h.indexCount * h.indexSize) <= h.meshletOffset and
+      h.meshletOffset + meshletBytes(h) <= file->size();
+   if (not valid) {
+      return std::nullopt;
+   }
+   return MeshCache{std::move(file), h};
+}
+
+auto MeshCache::vertices() const -> std::span<VertexData> {
+   return {reinterpret_cast<VertexData*>(_file->data() + _header.vertexOffset), _header.vertexCount};
+}
+
+auto MeshCache::vertexSection() const -> std::span<std::byte> {
+   return _file->bytes().subspan(_header.vertexOffset, MappedFile::pageAligned(_header.vertexCount * sizeof(VertexData)));
+}
+
+auto MeshCache::indexSection() const -> std::span<std::byte> {
+   return _file->bytes().subspan(_header.indexOffset, MappedFile::pageAligned(_header.indexCount * _header.indexSize));
+}
+
+auto MeshCache::meshlets() const -> MeshletData {
+   const auto bytes = std::span<const std::byte>{_file->bytes()};
+   auto offset = static_cast<size_t>(_header.meshletOffset);
+   const auto bounds = view<MeshletBounds>(bytes, offset, _header.meshletCount);
+   const auto meshlets = view<Meshlet>(bytes, offset, _header.meshletCount);
+   const auto vertices = view<std::uint32_t>(bytes, offset, _header.meshletVertexCount);
+   const auto triangles = view<std::uint8_t>(bytes, offset, _header.meshletTriangleCount);
+   return MeshletData{
+      .meshlets = {meshlets.begin(), meshlets.end()},
+      .bounds = {bounds.begin(), bounds.end()},
+      .vertices = {vertices.begin(), vertices.end()},
+      .triangles = {triangles.begin(), triangles.end()}
+   };
+}
+
+MeshCache::Writer::Writer(const std::filesystem::path& path, const std::uint32_t vertex_count,
+   const std::uint32_t index_count)
+   : _path(path),
+     _header{
+        .vertexCount = vertex_count,
+        .indexCount = index_count,
+        .indexSize = vertex_count < std::numeric_limits<std::uint16_t>::max() ?
+           static_cast<std::uint32_t>(sizeof(std::uint16_t)) : static_cast<std::uint32_t>(sizeof(std::uint32_t)),
+        .vertexOffset = MappedFile::pageAligned(sizeof(MeshCacheHeader))
+     },
+     _file{[&] {
+        ensure(vertex_count > 0 and index_count > 0, "cannot cache an empty mesh");
+        _header.indexOffset = _header.vertexOffset + MappedFile::pageAligned(vertex_count * sizeof(VertexData));
+        _header.meshletOffset = _header.indexOffset + MappedFile::pageAligned(index_count * _header.indexSize);
+        return MappedFile::create(path, _header.meshletOffset);
+     }()} {
+}
+
+auto MeshCache::Writer::vertices() const -> std::span<VertexData> {
+   return {reinterpret_cast<VertexData*>(_file.data() + _header.vertexOffset), _header.vertexCount};
+}
+
+auto MeshCache::Writer::setIndexes(const std::span<const std::uint32_t> indexes) -> void {
+   ensure(indexes.size() == _header.indexCount,
+      std::format("cache laid out for {} indexes, {} given", _header.indexCount, indexes.size()));
+   auto* destination = _file.data() + _header.indexOffset;
+   if (_header.indexSize == sizeof(std::uint16_t)) {
+      std::ranges::transform(indexes, reinterpret_cast<std::uint16_t*>(destination),
+         [](const std::uint32_t i) {return static_cast<std::uint16_t>(i);});
+   } else {
+      std::ranges::copy(indexes, reinterpret_cast<std::uint32_t*>(destination));
+   }
+}
+
+auto MeshCache::Writer::finish(const std::uint64_t stamp, const MeshletData& meshlets) -> void {
+   _header.stamp = stamp;
+   _header.meshletCount = static_cast<std::uint32_t>(meshlets.size());
+   _header.meshletVertexCount = static_cast<std::uint32_t>(meshlets.vertices.size());
+   _header.meshletTriangleCount = static_cast<std::uint32_t>(meshlets.triangles.size());
+
+   /// meshlets go after the mapped sections, the header is written last
+   /// so that an interrupted write never looks like a valid cache
+   std::ofstream file{_path, std::ios::binary | std::ios::app};
+   ensure(file.is_open(), std::format("could not append to {}", _path.string()));
+   const auto write = [&](const auto& values) {
+      file.write(reinterpret_cast<const char*>(values.data()),
+         static_cast<std::streamsize>(values.size() * sizeof(values[0])));
+   };
+   write(meshlets.bounds);
+   write(meshlets.meshlets);
+   write(meshlets.vertices);
+   write(meshlets.triangles);
+   file.close();
+   ensure(not file.fail(), std::format("could not write meshlets to {}", _path.string()));
+
+   std::memcpy(_file.data(), &_header, sizeof(_header));
+   _file.flush();
+}
+
+}
@@ -0,0 +1,84 @@
+#ifndef GAME_TUTORIAL_MESH_CACHE_HPP
+#define GAME_TUTORIAL_MESH_CACHE_HPP
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <span>
+
+#include "mapped_file.hpp"
+#include "meshlet.hpp"
+#include "vertex_data.hpp"
+
+namespace game {
+
+/// On disk layout of a cached mesh. The vertex and index sections start
+/// on page boundaries and are padded to whole pages so that they can be
+/// wrapped by no-copy GPU buffers, indexes are stored in the GPU format
+/// (16 bit when every vertex is addressable). Meshlets follow, CPU only.
+struct MeshCacheHeader {
+   static constexpr std::uint32_t MAGIC = 0x48534d47; // "GMSH"
+   static constexpr std::uint32_t VERSION = 1;
+
+   std::uint32_t magic{MAGIC};
+   std::uint32_t version{VERSION};
+   std::uint64_t stamp{0};
+   std::uint32_t vertexCount{0};
+   std::uint32_t indexCount{0};
+   std::uint32_t indexSize{0};
+   std::uint32_t meshletCount{0};
+   std::uint32_t meshletVertexCount{0};
+   std::uint32_t meshletTriangleCount{0};
+   std::uint64_t vertexOffset{0};
+   std::uint64_t indexOffset{0};
+   std::uint64_t meshletOffset{0};
+};
+
+/// a mesh cache file mapped in memory
+class MeshCache {
+public:
+   /// changes whenever the source file is rewritten
+   [[nodiscard]] static auto stamp(const std::filesystem::path& source) -> std::uint64_t;
+   /// nullopt when the cache is missing, not a mesh cache or built from another source
+   [[nodiscard]] static auto open(const std::filesystem::path& path, std::uint64_t stamp) -> std::optional<MeshCache>;
+
+   [[nodiscard]] auto vertices() const -> std::span<VertexData>;
+   /// page aligned, page padded sections
+   [[nodiscard]] auto vertexSection() const -> std::span<std::byte>;
+   [[nodiscard]] auto indexSection() const -> std::span<std::byte>;
+   [[nodiscard]] constexpr auto indexCount() const -> size_t {return _header.indexCount;}
+   [[nodiscard]] constexpr auto indexSize() const -> size_t {return _header.indexSize;}
+   /// copied out of the mapping, they are small
+   [[nodiscard]] auto meshlets() const -> MeshletData;
+   /// whoever wraps the sections keeps the mapping alive with this
+   [[nodiscard]] auto file() const -> std::shared_ptr<const void> {return _file;}
+
+   /// Lays out a cache for the given counts and maps it, so that decoders
+   /// write vertices straight into the file. finish() completes it.
+   class Writer {
+   public:
+      Writer(const std::filesystem::path& path, std::uint32_t vertex_count, std::uint32_t index_count);
+
+      [[nodiscard]] auto vertices() const -> std::span<VertexData>;
+      /// stored narrowed to 16 bit when possible
+      auto setIndexes(std::span<const std::uint32_t> indexes) -> void;
+      auto finish(std::uint64_t stamp, const MeshletData& meshlets) -> void;
+
+   private:
+      std::filesystem::path _path;
+      MeshCacheHeader _header;
+      MappedFile _file;
+   };
+
+private:
+   MeshCache(std::shared_ptr<MappedFile> file, const MeshCacheHeader& header)
+      : _file(std::move(file)), _header(header) {}
+
+   std::shared_ptr<MappedFile> _file;
+   MeshCacheHeader _header;
+};
+
+}
+
+#endif // GAME_TUTORIAL_MESH_CACHE_HPP
@@ -1,216 +1,313 @@
 #include "mesh_factory.hpp"
+#include "primitives.hpp"
 
 #include <assimp/Importer.hpp>
 #include <assimp/postprocess.h>
 #include <assimp/scene.h>
 
+#include <limits>
 
 
-namespace game {
-
-auto MeshFactory::getMeshData(const std::string_view mesh_name, [[maybe_unused]] const std::span<std::byte> data) -> MeshData * {
-   /// look up if we altrady loaded the mesh
-   if (const auto mesh_it = _loadedMeshes.find(mesh_name); mesh_it != std::ranges::cend(_loadedMeshes)) {
-      return &mesh_it->second;
-   }
-
-   if (mesh_name == "cube") {
-      const auto [fst, snd] = _loadedMeshes.emplace("cube", _cube(1.0f));
-      return &fst->second;
-   } else if (mesh_name == "sphere") {
-      const auto [fst, snd] = _loadedMeshes.emplace("sphere", _sphere(1.0f));
-      return &fst->second;
-   } else if (mesh_name == "cube_map") {
-      const auto [fst, snd] = _loadedMeshes.emplace("cube_map", _cubeMap());
-      return &fst->second;
-   }
 
+namespace game {
 
-   auto importer = ::Assimp::Importer{};
-   const auto scene =
-      importer.ReadFileFromMemory(data.data(),data.size(),::aiPostProcessSteps::
-         aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
-
-   ensure(scene!=nullptr and not (scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE),
-      "Could not init scene from data");
-
+namespace {
 
+auto findMesh(const ::aiScene* scene, const std::string_view mesh_name) -> const ::aiMesh* {
    for (const auto loadedMeshes = std::span<::aiMesh *>{scene->mMeshes, scene->mMeshes + scene->mNumMeshes};
         const auto& m: loadedMeshes) {
       if (m->mName.C_Str() == mesh_name) {
-         std::println("Found Mesh {}", m->mName.C_Str());
+         return m;
+      }
+   }
+   return nullptr;
+}
 
-         const auto tofloat4 = [](const ::aiVector3D& v) {return simd::float4{v.x,v.y,v.z,1.0f};};
-         const auto tofloat3 = [](const ::aiVector3D& v) {return simd::float3{v.x,v.y,v.z};};
+/// positions, normals and uvs written straight to their destination,
+/// tangent frames are filled in by generateTangents
+auto decodeVertices(const ::aiMesh* m, const std::span<VertexData> vertices) -> void {
+   ensure(m->HasTextureCoords(0),"texture coords not available");
+   for (auto v = 0u; v < m->mNumVertices; ++v) {
+      const auto& p = m->mVertices[v];
+      const auto n = simd::float3{m->mNormals[v].x, m->mNormals[v].y, m->mNormals[v].z};
+      vertices[v] = VertexData{
+         .position = {p.x, p.y, p.z, 1.0f},
+         .normal = n,
+         .tangent = n,
+         .bitangent = n,
+         .uv = {m->mTextureCoords[0][v].x, m->mTextureCoords[0][v].y}
+      };
+   }
+}
 
-         const auto positions = std::span{m->mVertices,m->mVertices+m->mNumVertices} |
-            std::views::transform(tofloat4) | std::ranges::to<std::vector>();
-         const auto normals = std::span{m->mNormals,m->mNormals+m->mNumVertices} |
-            std::views::transform(tofloat3) | std::ranges::to<std::vector>();
+auto decodeIndexes(const ::aiMesh* m) -> std::vector<std::uint32_t> {
+   std::vector<std::uint32_t> idxs;
+   idxs.reserve(static_cast<size_t>(m->mNumFaces) * 3);
+   for (const auto faces = std::span{m->mFaces, m->mFaces + m->mNumFaces}; const auto& f : faces) {
+      idxs.insert(idxs.end(), f.mIndices, f.mIndices + f.mNumIndices);
+   }
+   return idxs;
+}
 
-         ensure(m->HasTextureCoords(0),"texture coords not available");
+/// Importers are costly to set up and not thread safe, every thread keeps
+/// one and reuses it. The scene is freed once the lease goes out of scope.
+class ImportedScene {
+public:
+   explicit ImportedScene(const std::span<const std::byte> data)
+      : _scene(_importer().ReadFileFromMemory(data.data(),data.size(),::aiPostProcessSteps::
+         aiProcess_Triangulate | aiProcess_FlipUVs)) {
+      ensure(_scene!=nullptr and not (_scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE),
+         "Could not init scene from data");
+   }
+   ~ImportedScene() {_importer().FreeScene();}
+   ImportedScene(const ImportedScene&) = delete;
+   auto operator=(const ImportedScene&) -> ImportedScene& = delete;
 
-         const auto tangents = std::span{m->mTangents, m->mTangents+m->mNumVertices} |
-            std::views::transform(tofloat3) | std::ranges::to<std::vector>();
+   [[nodiscard]] auto get() const -> const ::aiScene* {return _scene;}
 
-         const auto bittangents = std::span{m->mBitangents, m->mBitangents+m->mNumVertices} |
-            std::views::transform(tofloat3) | std::ranges::to<std::vector>();
+private:
+   static auto _importer() -> ::Assimp::Importer& {
+      thread_local ::Assimp::Importer importer{};
+      return importer;
+   }
 
-         const auto uvs = std::span{m->mTextureCoords[0],m->mTextureCoords[0]+m->mNumVertices} |
-            std::views::transform([](const auto v) {return simd::float2{v.x,v.y};}) | std::ranges::to<std::vector>();
+   const ::aiScene* _scene;
+};
+
+auto toFloat4x4(const ::aiMatrix4x4& m) -> simd::float4x4 {
+   /// assimp matrices are row major
+   simd::float4x4 result;
+   result.columns[0] = simd::make_float4(m.a1, m.b1, m.c1, m.d1);
+   result.columns[1] = simd::make_float4(m.a2, m.b2, m.c2, m.d2);
+   result.columns[2] = simd::make_float4(m.a3, m.b3, m.c3, m.d3);
+   result.columns[3] = simd::make_float4(m.a4, m.b4, m.c4, m.d4);
+   return result;
+}
 
-         std::vector<std::uint32_t> idxs;
-         for (const auto faces = std::span{m->mFaces, m->mFaces + m->mNumFaces}; const auto& f : faces) {
-            for (auto j = 0u; j < f.mNumIndices; ++j) {
-               idxs.emplace_back(f.mIndices[j]);
-            }
+auto toTransform(const ::aiMatrix4x4& m) -> Transform {
+   auto scaling = ::aiVector3D{};
+   auto rotation = ::aiQuaternion{};
+   auto position = ::aiVector3D{};
+   m.Decompose(scaling, rotation, position);
+   return {
+      .translation = {position.x, position.y, position.z},
+      .rotation = {rotation.x, rotation.y, rotation.z, rotation.w},
+      .scale = {scaling.x, scaling.y, scaling.z}
+   };
+}
+
+/// depth first, so every parent comes before its children
+auto addJoints(const ::aiNode* node, const std::int32_t parent, Skeleton& skeleton,
+   std::vector<const ::aiNode*>& nodes) -> void {
+   const auto index = static_cast<std::int32_t>(skeleton.joints.size());
+   skeleton.joints.push_back({.name = node->mName.C_Str(), .parent = parent, .inverseBind = matrix_identity_float4x4});
+   nodes.push_back(node);
+   for (const auto& child: std::span{node->mChildren, node->mNumChildren}) {
+      addJoints(child, index, skeleton, nodes);
+   }
+}
+
+/// keeps the four strongest influences of every vertex, normalized
+auto decodeSkin(const ::aiMesh* m, const Skeleton& skeleton, const std::uint16_t unskinned) -> std::vector<SkinData> {
+   auto skin = std::vector<SkinData>(m->mNumVertices, SkinData{.weights = {0.0f, 0.0f, 0.0f, 0.0f}, .joints = {}});
+   for (const auto* bone: std::span{m->mBones, m->mNumBones}) {
+      const auto joint = skeleton.find(bone->mName.C_Str());
+      ensure(joint >= 0, std::format("bone {} is not a node of the scene", bone->mName.C_Str()));
+      for (const auto& [vertex, weight]: std::span{bone->mWeights, bone->mNumWeights}) {
+         auto& s = skin[vertex];
+         auto weakest = 0u;
+         for (auto i = 1u; i < 4u; ++i) {
+            weakest = s.weights[i] < s.weights[weakest] ? i : weakest;
+         }
+         if (weight > s.weights[weakest]) {
+            s.weights[weakest] = weight;
+            s.joints[weakest] = static_cast<std::uint16_t>(joint);
          }
-         const auto [fst, snd] = _loadedMeshes.emplace(m->mName.C_Str(),
-            MeshData{createModelData(positions,normals,tangents,bittangents,uvs),std::move(idxs)});
-         return &fst->second;
       }
    }
-   return nullptr;
+   for (auto& s: skin) {
+      const auto total = s.weights.x + s.weights.y + s.weights.z + s.weights.w;
+      if (total > 0.0f) {
+         s.weights /= total;
+      } else {
+         /// not weighted to any bone, it follows the node holding the mesh
+         s = SkinData{.weights = {1.0f, 0.0f, 0.0f, 0.0f}, .joints = {unskinned, 0, 0, 0}};
+      }
+   }
+   return skin;
 }
 
-auto MeshFactory::_cube(const float& length = 1.0f)   -> MeshData {
-
-   const simd::float4 positions[] = {
-         {-length/2.0f, -length/2.0f, length/2.0f, 1.0f}, {length/2.0f, -length/2.0f, length/2.0f, 1.0f},  {length/2.0f, length/2.0f, length/2.0f, 1.0f},
-         {-length/2.0f, length/2.0f, length/2.0f, 1.0f},  {length/2.0f, -length/2.0f, -length/2.0f, 1.0f}, {-length/2.0f, -length/2.0f, -length/2.0f, 1.0f},
-         {-length/2.0f, length/2.0f, -length/2.0f, 1.0f}, {length/2.0f, length/2.0f, -length/2.0f, 1.0f},  {-length/2.0f, -length/2.0f, -length/2.0f, 1.0f},
-         {-length/2.0f, -length/2.0f, length/2.0f, 1.0f}, {-length/2.0f, length/2.0f, length/2.0f, 1.0f},  {-length/2.0f, length/2.0f, -length/2.0f, 1.0f},
-         {length/2.0f, -length/2.0f, length/2.0f, 1.0f},  {length/2.0f, -length/2.0f, -length/2.0f, 1.0f}, {length/2.0f, length/2.0f, -length/2.0f, 1.0f},
-         {length/2.0f, length/2.0f, length/2.0f, 1.0f},   {-length/2.0f, length/2.0f, length/2.0f, 1.0f},  {length/2.0f, length/2.0f, length/2.0f, 1.0f},
-         {length/2.0f, length/2.0f, -length/2.0f, 1.0f},  {-length/2.0f, length/2.0f, -length/2.0f, 1.0f}, {-length/2.0f, -length/2.0f, -length/2.0f, 1.0f},
-         {length/2.0f, -length/2.0f, -length/2.0f, 1.0f}, {length/2.0f, -length/2.0f, length/2.0f, 1.0f},  {-length/2.0f, -length/2.0f, length/2.0f, 1.0f}};
-
-
-   constexpr simd::float3 normals[] = {
-         {0.0f, 0.0f, -1.0f}, {0.0f, 0.0f, -1.0f}, {0.0f, 0.0f, -1.0f}, {0.0f, 0.0f, -1.0f}, {0.0f, 0.0f, 1.0f},
-         {0.0f, 0.0f, 1.0f},  {0.0f, 0.0f, 1.0f},  {0.0f, 0.0f, 1.0f},  {-1.0f, 0.0f, 0.0f}, {-1.0f, 0.0f, 0.0f},
-         {-1.0f, 0.0f, 0.0f}, {-1.0f, 0.0f, 0.0f}, {1.0f, 0.0f, 0.0f},  {1.0f, 0.0f, 0.0f},  {1.0f, 0.0f, 0.0f},
-         {1.0f, 0.0f, 0.0f},  {0.0f, 1.0f, 0.0f},  {0.0f, 1.0f, 0.0f},  {0.0f, 1.0f, 0.0f},  {0.0f, 1.0f, 0.0f},
-         {0.0f, -1.0f, 0.0f}, {0.0f, -1.0f, 0.0f}, {0.0f, -1.0f, 0.0f}, {0.0f, -1.0f, 0.0f}};
-
-   constexpr simd::float2 uvs[] = {{0.0f, 0.0f}, {1.0f, 0.0f}, {1.0f, 1.0f}, {0.0f, 1.0f}, {0.0f, 0.0f},
-                                              {1.0f, 0.0f}, {1.0f, 1.0f}, {0.0f, 1.0f}, {0.0f, 0.0f}, {1.0f, 0.0f},
-                                              {1.0f, 1.0f}, {0.0f, 1.0f}, {0.0f, 0.0f}, {1.0f, 0.0f}, {1.0f, 1.0f},
-                                              {0.0f, 1.0f}, {0.0f, 0.0f}, {1.0f, 0.0f}, {1.0f, 1.0f}, {0.0f, 1.0f},
-                                              {0.0f, 0.0f}, {1.0f, 0.0f}, {1.0f, 1.0f}, {0.0f, 1.0f}};
-
-
-   auto indexes = std::vector<std::uint32_t>{
-         0,  1,  2,  2,  3,  0, // Front
-         4,  5,  6,  6,  7,  4, // Back
-         8,  9,  10, 10, 11, 8, // Left
-         12, 13, 14, 14, 15, 12, // Right
-         16, 17, 18, 18, 19, 16, // Top
-         20, 21, 22, 22, 23, 20 // Bottom
+auto decodeClip(const ::aiAnimation* animation, const Skeleton& skeleton,
+   const std::span<const ::aiNode*> nodes) -> AnimationClip {
+   const auto ticks = animation->mTicksPerSecond > 0.0 ? animation->mTicksPerSecond : 25.0;
+   auto clip = AnimationClip{
+      .name = animation->mName.C_Str(),
+      .duration = static_cast<float>(animation->mDuration / ticks),
+      .tracks = std::vector<JointTrack>(skeleton.size())
    };
-   return MeshData{createModelData(positions,normals,normals,normals,uvs),std::move(indexes)};
-}
+   /// joints the clip does not animate hold their bind pose
+   for (auto j = 0u; j < skeleton.size(); ++j) {
+      const auto bind = toTransform(nodes[j]->mTransformation);
+      clip.tracks[j] = {
+         .translations = {{0.0f}, {bind.translation}},
+         .rotations = {{0.0f}, {bind.rotation}},
+         .scales = {{0.0f}, {bind.scale}}
+      };
+   }
 
-auto MeshFactory::_cubeMap() -> MeshData {
-   constexpr simd::float4 positions[] = {
-      {-1.0f,-1.0f,1.0f,1.0f},
-      {1.0f,-1.0f,1.0f,1.0f},
-      {1.0f,1.0f,1.0f,1.0f},
-      {-1.0f,1.0f,1.0f,1.0f},
-      {-1.0f,-1.0f,-1.0f,1.0f},
-      {1.0f,-1.0f,-1.0f,1.0f},
-      {1.0f,1.0f,-1.0f,1.0f},
-      {-1.0f,1.0f,-1.0f,1.0f},
-   };
-   constexpr simd::float3 normals[] = {
-         // Front
-         { 0,  0, -1}, { 0,  0, -1}, { 0,  0, -1}, { 0,  0, -1},
-         // Back
-         { 0,  0,  1}, { 0,  0,  1}, { 0,  0,  1}, { 0,  0,  1},
-         // Right
-         { -1, 0,  0}, { -1, 0,  0}, { -1, 0,  0}, { -1, 0,  0},
-         // Left
-         { 1,  0,  0}, { 1,  0,  0}, { 1,  0,  0}, { 1,  0,  0},
-         // Top
-         { 0, -1, 0}, { 0, -1, 0}, { 0, -1, 0}, { 0, -1, 0},
-         // Bottom
-         { 0,  1, 0}, { 0,  1, 0}, { 0,  1, 0}, { 0,  1, 0}
-   };
+   const auto seconds = [&](const double time) {return static_cast<float>(time / ticks);};
+   for (const auto* channel: std::span{animation->mChannels, animation->mNumChannels}) {
+      const auto joint = skeleton.find(channel->mNodeName.C_Str());
+      if (joint < 0) {
+         continue;
+      }
+      auto& track = clip.tracks[static_cast<size_t>(joint)];
+      if (channel->mNumPositionKeys > 0) {
+         track.translations = {};
+         for (const auto& k: std::span{channel->mPositionKeys, channel->mNumPositionKeys}) {
+            track.translations.times.push_back(seconds(k.mTime));
+            track.translations.values.push_back({k.mValue.x, k.mValue.y, k.mValue.z});
+         }
+      }
+      if (channel->mNumRotationKeys > 0) {
+         track.rotations = {};
+         for (const auto& k: std::span{channel->mRotationKeys, channel->mNumRotationKeys}) {
+            track.rotations.times.push_back(seconds(k.mTime));
+            track.rotations.values.push_back({k.mValue.x, k.mValue.y, k.mValue.z, k.mValue.w});
+         }
+      }
+      if (channel->mNumScalingKeys > 0) {
+         track.scales = {};
+         for (const auto& k: std::span{channel->mScalingKeys, channel->mNumScalingKeys}) {
+            track.scales.times.push_back(seconds(k.mTime));
+            track.scales.values.push_back({k.mValue.x, k.mValue.y, k.mValue.z});
+         }
+      }
+   }
+   return clip;
+}
 
-   constexpr simd::float2 uvs[] = {
-      // Front
-      {0, 0}, {1, 0}, {1, 1}, {0, 1},
-      // Back
-      {1, 0}, {0, 0}, {0, 1}, {1, 1},
-      // Right
-      {0, 0}, {1, 0}, {1, 1}, {0, 1},
-      // Left
-      {1, 0}, {0, 0}, {0, 1}, {1, 1},
-      // Top
-      {0, 0}, {1, 0}, {1, 1}, {0, 1},
-      // Bottom
-      {0, 1}, {1, 1}, {1, 0}, {0, 0},
-  };
-
-   auto indexes = std::vector<std::uint32_t>{
-      // Front face
-      0, 2, 1,  0, 3, 2,
-      // Right face
-      1, 6, 5,  1, 2, 6,
-      // Back face
-      5, 7, 4,  5, 6, 7,
-      // Left face
-      4, 3, 0,  4, 7, 3,
-      // Top face
-      3, 6, 2,  3, 7, 6,
-      // Bottom face
-      4, 1, 5,  4, 0, 1
-   };
-   return MeshData{createModelData(positions,normals,normals,normals,uvs),std::move(indexes)};
 }
 
+auto MeshFactory::getMeshData(const std::string_view mesh_name, [[maybe_unused]] const std::span<const std::byte> data) -> MeshData * {
+   {
+      const std::lock_guard lock{_mutex};
+      /// look up if we altrady loaded the mesh
+      if (const auto mesh_it = _loadedMeshes.find(mesh_name); mesh_it != std::ranges::cend(_loadedMeshes)) {
+         return &mesh_it->second;
+      }
 
+      if (mesh_name == "cube") {
+         const auto [fst, snd] = _loadedMeshes.emplace("cube", _cube(1.0f));
+         return &fst->second;
+      } else if (mesh_name == "sphere") {
+         const auto [fst, snd] = _loadedMeshes.emplace("sphere", _sphere(1.0f));
+         return &fst->second;
+      } else if (mesh_name == "cube_map") {
+         const auto [fst, snd] = _loadedMeshes.emplace("cube_map", _cubeMap());
+         return &fst->second;
+      }
+   }
 
-auto MeshFactory::_sphere([[maybe_unused]]  const float& radius) -> MeshData {
-   std::vector<simd::float4> position;
-   std::vector<simd::float3> normals;
-   std::vector<simd::float2> uvs;
-   std::vector<std::uint32_t> idx;
+   /// unlocked, imports of different meshes overlap
+   auto mesh = importMesh(mesh_name, data);
+   if (not mesh) {
+      return nullptr;
+   }
+   const std::lock_guard lock{_mutex};
+   /// if another thread imported it meanwhile, the first one is kept
+   const auto [fst, snd] = _loadedMeshes.try_emplace(std::string{mesh_name}, std::move(*mesh));
+   return &fst->second;
+}
 
-   constexpr float PI = std::numbers::pi_v<float>;
-   constexpr std::uint32_t numLatitudeLines = 100;
+auto MeshFactory::importMesh(const std::string_view mesh_name, const std::span<const std::byte> data)
+   -> std::optional<MeshData> {
+   const auto scene = ImportedScene{data};
+   const auto m = findMesh(scene.get(), mesh_name);
+   if (m == nullptr) {
+      return std::nullopt;
+   }
+   std::println("Found Mesh {}", m->mName.C_Str());
 
-   for (std::uint32_t lat = 0; lat <= numLatitudeLines; ++lat) {
-      constexpr std::uint32_t numLongLines = 100;
-      const float theta = static_cast<float>(lat) * PI / numLatitudeLines;
-      const float sinTheta = simd::sin(theta);
-      const float cosTheta = simd::cos(theta);
+   auto mesh = MeshData{std::vector<VertexData>(m->mNumVertices), decodeIndexes(m)};
+   decodeVertices(m, mesh.vertices);
+   generateTangents(mesh);
+   return mesh;
+}
 
-      for (std::uint32_t lon = 0; lon <= numLongLines; ++lon) {
-         const float phi = static_cast<float>(lon) * 2.0f * PI / numLongLines;
-         const float sinPhi = simd::sin(phi);
-         const float cosPhi = simd::cos(phi);
+auto MeshFactory::importToCache(const std::string_view mesh_name, const std::span<const std::byte> data,
+   const std::filesystem::path& cache_path, const std::uint64_t stamp, const bool meshlets) -> bool {
+   const auto scene = ImportedScene{data};
+   const auto m = findMesh(scene.get(), mesh_name);
+   if (m == nullptr) {
+      return false;
+   }
 
-         const auto pos = simd::float4{cosPhi * sinTheta, cosTheta, sinPhi * sinTheta,1.0};
-         position.emplace_back(pos);
-         normals.emplace_back(simd::normalize(pos.xyz));
-         uvs.emplace_back(simd::float2{
-            static_cast<float>(lon)/numLongLines,
-            1.0f - static_cast<float>(lat)/numLatitudeLines
-         });
+   auto indexes = decodeIndexes(m);
+   MeshCache::Writer writer{cache_path, m->mNumVertices, static_cast<std::uint32_t>(indexes.size())};
+   const auto vertices = writer.vertices();
+   decodeVertices(m, vertices);
+   generateTangents(vertices, indexes);
+   const auto clusters = meshlets ? buildMeshlets(vertices, indexes) : MeshletData{};
+   writer.setIndexes(indexes);
+   writer.finish(stamp, clusters);
+   return true;
+}
 
-         const std::uint32_t first = lat * (numLongLines + 1) + lon;
-         const std::uint32_t second = (lat + 1) * (numLongLines + 1) + lon;
+auto MeshFactory::importSkinned(const std::string_view mesh_name, const std::span<const std::byte> data)
+   -> std::optional<SkinnedMeshData> {
+   const auto imported = ImportedScene{data};
+   const auto scene = imported.get();
+   const auto m = findMesh(scene, mesh_name);
+   if (m == nullptr) {
+      return std::nullopt;
+   }
 
-         idx.emplace_back(first);
-         idx.emplace_back(second);
-         idx.emplace_back(first + 1);
-         idx.emplace_back(second);
-         idx.emplace_back(second + 1);
-         idx.emplace_back(first + 1);
+   auto result = SkinnedMeshData{};
+   result.mesh = MeshData{std::vector<VertexData>(m->mNumVertices), decodeIndexes(m)};
+   decodeVertices(m, result.mesh.vertices);
+   generateTangents(result.mesh);
+
+   auto nodes = std::vector<const ::aiNode*>{};
+   addJoints(scene->mRootNode, -1, result.skeleton, nodes);
+   ensure(result.skeleton.size() <= std::numeric_limits<std::uint16_t>::max(),
+      std::format("{} nodes do not fit 16 bit joint indexes", result.skeleton.size()));
+   for (const auto* bone: std::span{m->mBones, m->mNumBones}) {
+      if (const auto joint = result.skeleton.find(bone->mName.C_Str()); joint >= 0) {
+         result.skeleton.joints[static_cast<size_t>(joint)].inverseBind = toFloat4x4(bone->mOffsetMatrix);
       }
    }
-   return MeshData{createModelData(position,normals, normals,normals,uvs),std::move(idx)};
+
+   const auto meshes = std::span{scene->mMeshes, scene->mNumMeshes};
+   const auto mesh_index = static_cast<std::uint32_t>(std::ranges::find(meshes, m) - meshes.begin());
+   const auto holder = std::ranges::find_if(nodes, [&](const ::aiNode* node) {
+      return std::ranges::contains(std::span{node->mMeshes, node->mNumMeshes}, mesh_index);
+   });
+   const auto unskinned = static_cast<std::uint16_t>(holder == nodes.end() ? 0 : holder - nodes.begin());
+   result.skin = decodeSkin(m, result.skeleton, unskinned);
+
+   for (const auto* animation: std::span{scene->mAnimations, scene->mNumAnimations}) {
+      /// the raw tracks only live until they are compressed
+      result.clips.push_back(CompressedClip::compress(decodeClip(animation, result.skeleton, nodes)));
+   }
+   return result;
+}
+
+/// primitives are generated at compile time, only copied (and scaled) here
+auto MeshFactory::_cube(const float& length = 1.0f)   -> MeshData {
+   static constexpr auto unit_cube = primitives::cube();
+   return primitives::toMeshData(unit_cube, length);
+}
+
+auto MeshFactory::_cubeMap() -> MeshData {
+   static constexpr auto sky_box = primitives::skyboxCube();
+   return primitives::toMeshData(sky_box);
+}
+
+/// the tessellation the sphere always had, too many vertices to generate
+/// at compile time
+auto MeshFactory::_sphere(const float& radius) -> MeshData {
+   return primitives::uvSphere(radius, 100, 100);
 }
 
 }
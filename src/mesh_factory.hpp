@@ -3,6 +3,9 @@
 
 #include <cstddef>
 
+#include <filesystem>
+#include <mutex>
+#include <optional>
 #include <span>
 #include <string>
 #include <ranges>
@@ -10,11 +13,17 @@
 #include <string_view>
 
 #include "auto_release.hpp"
-#include "mesh.hpp"
+#include "mesh_cache.hpp"
+#include "meshlet.hpp"
 #include "resource_reader.hpp"
+#include "skinning.hpp"
+#include "vertex_data.hpp"
 
 namespace game {
 
+class GltfFile;
+struct GltfMesh;
+
 template<class... Args>
 std::vector<VertexData> createModelData(Args && ...args) {
    return std::views::zip(std::forward<Args>(args)...) |
@@ -42,7 +51,9 @@ template <class T>
 using StringMap = std::unordered_map<std::string, T, StringHash, std::equal_to<>>;
 
 /// reads or creates meshes and owns them, then distribute them to
-/// entities (might need an entity factory as well)
+/// entities (might need an entity factory as well).
+/// Safe to use from several threads, every thread imports with an
+/// Assimp::Importer of its own.
 
 class MeshFactory {
 public:
@@ -51,7 +62,75 @@ public:
    MeshFactory(const MeshFactory&) = delete;
    MeshFactory(MeshFactory&&)      = delete;
 
-   [[nodiscard]] auto getMeshData(std::string_view mesh_name, std::span<std::byte>) -> MeshData *;
+   [[nodiscard]] auto getMeshData(std::string_view mesh_name, std::span<const std::byte>) -> MeshData *;
+
+   /// Imports a mesh without keeping it, nullopt if it is not in data.
+   static auto importMesh(std::string_view mesh_name, std::span<const std::byte> data)
+      -> std::optional<MeshData>;
+
+   /// Reads the faces of object mesh_name ("defaultobject" for faces before
+   /// any o line) straight from OBJ text, without going through assimp.
+   /// Large files are split at line boundaries and parsed in parallel,
+   /// corners with the same position/uv/normal share a vertex. Throws on
+   /// lines it cannot read, nullopt if there is no such object.
+   static auto readObj(std::string_view mesh_name, std::span<const std::byte> data)
+      -> std::optional<MeshData>;
+
+   /// Reads the mesh called mesh_name from a glTF file, all its primitives
+   /// one after the other. nullopt if there is no such mesh.
+   static auto readGltf(std::string_view mesh_name, const GltfFile& file)
+      -> std::optional<MeshData>;
+
+   /// Decode a glTF mesh straight to its destination, typically staging
+   /// memory, which is only written: vertexCount() vertices, tangents left
+   /// as the normals unless GltfMesh::hasTangents(), and indexCount()
+   /// indexes, offset for every primitive. Index accessors of the
+   /// destination width are copied as they are.
+   static auto decodeGltfVertices(const GltfMesh& mesh, std::span<VertexData> vertices) -> void;
+   static auto decodeGltfIndexes(const GltfMesh& mesh, std::span<std::uint32_t> indexes) -> void;
+   static auto decodeGltfIndexes(const GltfMesh& mesh, std::span<std::uint16_t> indexes) -> void;
+
+   /// Imports a mesh and decodes its vertices straight into a newly laid
+   /// out cache file (see MeshCache), which can then be mapped and handed
+   /// to the GPU without further copies. False if the mesh is not in data.
+   static auto importToCache(std::string_view mesh_name, std::span<const std::byte> data,
+      const std::filesystem::path& cache_path, std::uint64_t stamp, bool meshlets) -> bool;
+
+   /// Imports a mesh with its bone weights (the four strongest per
+   /// vertex), the node hierarchy as skeleton and every animation of the
+   /// scene as a compressed clip over that skeleton. nullopt if the mesh
+   /// is not in data.
+   static auto importSkinned(std::string_view mesh_name, std::span<const std::byte> data)
+      -> std::optional<SkinnedMeshData>;
+
+   /// Splits a mesh in meshlets of at most max_vertices vertices and
+   /// max_triangles triangles, each with its bounding sphere and normal cone.
+   /// The indexes of the mesh are reordered so that the triangles of every
+   /// meshlet are contiguous and in the same order as the meshlets.
+   static auto buildMeshlets(std::span<const VertexData> vertices, std::vector<std::uint32_t>& indexes,
+      size_t max_vertices = 64, size_t max_triangles = 124) -> MeshletData;
+   static auto buildMeshlets(MeshData& mesh, const size_t max_vertices = 64,
+      const size_t max_triangles = 124) -> MeshletData {
+      return buildMeshlets(mesh.vertices, mesh.indexes, max_vertices, max_triangles);
+   }
+
+   /// A sphere around every vertex, xyz the centre and w the radius: not
+   /// the smallest one, enough to size the mesh on screen. Infinite for
+   /// a mesh without vertices.
+   static auto boundingSphere(std::span<const VertexData> vertices) -> simd::float4;
+   /// The sphere around the boxes of the positions of every primitive,
+   /// centred on their union, from the accessors alone: nothing is read
+   /// back from where the vertices were decoded to. Looser than the one
+   /// above.
+   static auto boundingSphere(const GltfMesh& mesh) -> simd::float4;
+
+   /// Per vertex tangent and bitangent from positions, normals and uvs,
+   /// MikkTSpace style, computed in parallel over chunks of triangles.
+   static auto generateTangents(std::span<VertexData> vertices,
+      std::span<const std::uint32_t> indexes) -> void;
+   static auto generateTangents(MeshData& mesh) -> void {
+      generateTangents(mesh.vertices, mesh.indexes);
+   }
 
 
 private:
@@ -62,6 +141,7 @@ private:
 
    //an unordered map of mesh and a name
    StringMap<MeshData> _loadedMeshes;
+   std::mutex _mutex;
 };
 }
 
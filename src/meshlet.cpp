@@ -0,0 +1,291 @@
+#include "meshlet.hpp"
+#include "mesh_factory.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <ranges>
+
+namespace game {
+
+namespace {
+
+constexpr std::uint8_t UNUSED_LOCAL = std::numeric_limits<std::uint8_t>::max();
+
+/// Ritter's bounding sphere, good enough (within ~5-10%) for culling
+auto boundingSphere(const std::span<const VertexData> vertices,
+   const std::span<const std::uint32_t> meshlet_vertices) -> std::pair<simd::float3, float> {
+   const auto position = [&](const std::uint32_t i) -> simd::float3 {return vertices[meshlet_vertices[i]].position.xyz;};
+
+   const auto farthest = [&](const simd::float3& from) {
+      auto best = std::uint32_t{0};
+      auto best_distance = -1.0f;
+      for (auto i = 0u; i < meshlet_vertices.size(); ++i) {
+         if (const auto d = simd::length_squared(position(i) - from); d > best_distance) {
+            best_distance = d;
+            best = i;
+         }
+      }
+      return position(best);
+   };
+
+   const auto a = farthest(position(0));
+   const auto b = farthest(a);
+   auto center = (a + b) * 0.5f;
+   auto radius = simd::length(b - a) * 0.5f;
+
+   for (auto i = 0u; i < meshlet_vertices.size(); ++i) {
+      const auto p = position(i);
+      if (const auto d = simd::length(p - center); d > radius) {
+         const auto new_radius = (radius + d) * 0.5f;
+         center += (p - center) * ((new_radius - radius) / d);
+         radius = new_radius;
+      }
+   }
+   return {center, radius};
+}
+
+auto normalCone(const std::span<const VertexData> vertices,
+   const std::span<const std::uint32_t> triangles) -> std::pair<simd::float3, float> {
+   auto normals = std::vector<simd::float3>{};
+   normals.reserve(triangles.size() / 3);
+   auto axis = simd::float3{0.0f,0.0f,0.0f};
+   for (auto t = 0u; t + 2 < triangles.size(); t += 3) {
+      const auto p0 = vertices[triangles[t + 0]].position.xyz;
+      const auto p1 = vertices[triangles[t + 1]].position.xyz;
+      const auto p2 = vertices[triangles[t + 2]].position.xyz;
+      const auto n = simd::cross(p1 - p0, p2 - p0);
+      const auto area = simd::length(n);
+      if (area <= std::numeric_limits<float>::epsilon()) {
+         continue;
+      }
+      normals.emplace_back(n / area);
+      axis += normals.back();
+   }
+
+   /// no usable normals, or the normals cover more than a hemisphere:
+   /// the cluster can't be back-face culled
+   if (normals.empty() or simd::length(axis) <= std::numeric_limits<float>::epsilon()) {
+      return {simd::float3{0.0f,0.0f,1.0f}, 1.0f};
+   }
+   axis = simd::normalize(axis);
+   auto min_dot = 1.0f;
+   for (const auto& n: normals) {
+      min_dot = std::min(min_dot, simd::dot(n, axis));
+   }
+   if (min_dot <= 0.1f) {
+      return {axis, 1.0f};
+   }
+   return {axis, std::sqrt(1.0f - min_dot * min_dot)};
+}
+
+}
+
+auto MeshFactory::boundingSphere(const std::span<const VertexData> vertices) -> simd::float4 {
+   if (vertices.empty()) {
+      return simd::make_float4(0.0f, 0.0f, 0.0f, std::numeric_limits<float>::infinity());
+   }
+   auto all = std::vector<std::uint32_t>(vertices.size());
+   std::iota(all.begin(), all.end(), 0u);
+   /// the one of the meshlets, over every vertex
+   const auto [center, radius] = game::boundingSphere(vertices, all);
+   return simd::make_float4(center, radius);
+}
+
+auto MeshFactory::buildMeshlets(const std::span<const VertexData> vertices, std::vector<std::uint32_t>& mesh_indexes,
+   const size_t max_vertices, const size_t max_triangles) -> MeshletData {
+   ensure(max_vertices >= 3 and max_vertices < UNUSED_LOCAL,
+      std::format("meshlets need between 3 and {} vertices, {} requested", UNUSED_LOCAL - 1, max_vertices));
+   ensure(max_triangles >= 1 and mesh_indexes.size() % 3 == 0,
+      "meshlets are only built for triangle lists");
+
+   const auto n_vertices = vertices.size();
+   const auto n_triangles = mesh_indexes.size() / 3;
+   const auto& indexes = mesh_indexes;
+
+   /// vertex -> triangles adjacency, compressed in a single array
+   auto adjacency_offsets = std::vector<std::uint32_t>(n_vertices + 1, 0u);
+   ensure(std::ranges::all_of(indexes, [&](const auto i) {return i < n_vertices;}),
+      "mesh indexes a vertex out of range");
+   for (const auto i: indexes) {
+      ++adjacency_offsets[i + 1];
+   }
+   std::inclusive_scan(adjacency_offsets.begin(), adjacency_offsets.end(), adjacency_offsets.begin());
+   auto adjacency = std::vector<std::uint32_t>(indexes.size());
+   {
+      auto fill = std::vector<std::uint32_t>(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+      for (auto t = 0u; t < n_triangles; ++t) {
+         for (auto k = 0u; k < 3u; ++k) {
+            adjacency[fill[indexes[3 * t + k]]++] = t;
+         }
+      }
+   }
+
+   const auto centroids = std::views::iota(size_t{0}, n_triangles) | std::views::transform([&](const size_t t) {
+      return (vertices[indexes[3 * t]].position.xyz +
+              vertices[indexes[3 * t + 1]].position.xyz +
+              vertices[indexes[3 * t + 2]].position.xyz) / 3.0f;
+   }) | std::ranges::to<std::vector>();
+   /// triangles not yet emitted around every vertex, to skip exhausted ones
+   auto live_triangles = std::vector<std::uint32_t>(n_vertices);
+   for (auto v = 0u; v < n_vertices; ++v) {
+      live_triangles[v] = adjacency_offsets[v + 1] - adjacency_offsets[v];
+   }
+
+   auto result = MeshletData{};
+   result.meshlets.reserve(n_triangles / max_triangles + 1);
+   result.vertices.reserve(n_vertices + n_vertices / 2);
+   result.triangles.reserve(indexes.size());
+
+   auto reordered = std::vector<std::uint32_t>{};
+   reordered.reserve(indexes.size());
+
+   auto emitted = std::vector<bool>(n_triangles, false);
+   auto local_index = std::vector<std::uint8_t>(n_vertices, UNUSED_LOCAL);
+   auto seed_cursor = std::uint32_t{0};
+
+   while (reordered.size() < indexes.size()) {
+      while (emitted[seed_cursor]) {
+         ++seed_cursor;
+      }
+
+      auto meshlet = Meshlet{
+         .vertexOffset = static_cast<std::uint32_t>(result.vertices.size()),
+         .triangleOffset = static_cast<std::uint32_t>(result.triangles.size() / 3),
+         .vertexCount = 0,
+         .triangleCount = 0
+      };
+      auto meshlet_center = simd::float3{0.0f,0.0f,0.0f};
+
+      const auto newVertices = [&](const std::uint32_t t) {
+         return static_cast<size_t>(local_index[indexes[3 * t]] == UNUSED_LOCAL) +
+                static_cast<size_t>(local_index[indexes[3 * t + 1]] == UNUSED_LOCAL) +
+                static_cast<size_t>(local_index[indexes[3 * t + 2]] == UNUSED_LOCAL);
+      };
+
+      const auto addTriangle = [&](const std::uint32_t t) {
+         for (auto k = 0u; k < 3u; ++k) {
+            const auto v = indexes[3 * t + k];
+            if (local_index[v] == UNUSED_LOCAL) {
+               local_index[v] = static_cast<std::uint8_t>(meshlet.vertexCount++);
+               result.vertices.emplace_back(v);
+            }
+            result.triangles.emplace_back(local_index[v]);
+            reordered.emplace_back(v);
+            --live_triangles[v];
+         }
+         emitted[t] = true;
+         meshlet_center = (meshlet_center * static_cast<float>(meshlet.triangleCount) + centroids[t]) /
+                          static_cast<float>(meshlet.triangleCount + 1);
+         ++meshlet.triangleCount;
+      };
+
+      addTriangle(seed_cursor);
+
+      /// grow the cluster through its own vertices, preferring triangles that
+      /// add the fewest new vertices and, among those, the closest ones
+      while (meshlet.triangleCount < max_triangles) {
+         auto best = std::numeric_limits<std::uint32_t>::max();
+         auto best_new = size_t{4};
+         auto best_distance = std::numeric_limits<float>::max();
+         for (auto lv = meshlet.vertexOffset; lv < meshlet.vertexOffset + meshlet.vertexCount; ++lv) {
+            const auto v = result.vertices[lv];
+            if (live_triangles[v] == 0) {
+               continue;
+            }
+            for (auto a = adjacency_offsets[v]; a < adjacency_offsets[v + 1]; ++a) {
+               const auto t = adjacency[a];
+               if (emitted[t]) {
+                  continue;
+               }
+               const auto n_new = newVertices(t);
+               if (n_new > best_new) {
+                  continue;
+               }
+               const auto distance = simd::length_squared(centroids[t] - meshlet_center);
+               if (n_new < best_new or distance < best_distance) {
+                  best = t;
+                  best_new = n_new;
+                  best_distance = distance;
+               }
+            }
+         }
+         if (best == std::numeric_limits<std::uint32_t>::max() or
+             meshlet.vertexCount + best_new > max_vertices) {
+            break;
+         }
+         addTriangle(best);
+      }
+
+      const auto meshlet_vertices = std::span{result.vertices}.subspan(meshlet.vertexOffset, meshlet.vertexCount);
+      const auto meshlet_triangles = std::span{reordered}.subspan(
+         static_cast<size_t>(meshlet.triangleOffset) * 3, static_cast<size_t>(meshlet.triangleCount) * 3);
+      const auto [center, radius] = boundingSphere(vertices, meshlet_vertices);
+      const auto [axis, cutoff] = normalCone(vertices, meshlet_triangles);
+      result.bounds.emplace_back(MeshletBounds{
+         .center = center,
+         .radius = radius,
+         .coneAxis = axis,
+         .coneCutoff = cutoff
+      });
+      result.meshlets.emplace_back(meshlet);
+
+      for (const auto v: meshlet_vertices) {
+         local_index[v] = UNUSED_LOCAL;
+      }
+   }
+
+   mesh_indexes = std::move(reordered);
+   return result;
+}
+
+auto Frustum::fromMatrix(const simd::float4x4& clip) -> Frustum {
+   const auto row = [&](const int i) {
+      return simd::float4{clip.columns[0][i], clip.columns[1][i], clip.columns[2][i], clip.columns[3][i]};
+   };
+   const auto normalise = [](const simd::float4& plane) {
+      return plane / simd::length(plane.xyz);
+   };
+   const auto r0 = row(0);
+   const auto r1 = row(1);
+   const auto r2 = row(2);
+   const auto r3 = row(3);
+   /// the near plane uses the -w <= z convention, which is the conservative
+   /// one for both GL style and Metal style projections
+   return Frustum{{
+      normalise(r3 + r0), normalise(r3 - r0),
+      normalise(r3 + r1), normalise(r3 - r1),
+      normalise(r3 + r2), normalise(r3 - r2)
+   }};
+}
+
+auto Frustum::intersects(const simd::float3& center, const float radius) const -> bool {
+   return std::ranges::all_of(planes, [&](const simd::float4& plane) {
+      return simd::dot(plane.xyz, center) + plane.w >= -radius;
+   });
+}
+
+auto cullMeshlets(const MeshletData& data, const Frustum& frustum,
+   const simd::float3& eye, std::vector<MeshletRange>& visible) -> void {
+   visible.clear();
+   for (auto i = 0u; i < data.meshlets.size(); ++i) {
+      const auto& bounds = data.bounds[i];
+      if (not frustum.intersects(bounds.center, bounds.radius)) {
+         continue;
+      }
+      const auto view = bounds.center - eye;
+      if (simd::dot(view, bounds.coneAxis) >= bounds.coneCutoff * simd::length(view) + bounds.radius) {
+         continue;
+      }
+      const auto& meshlet = data.meshlets[i];
+      if (not visible.empty() and
+          visible.back().firstTriangle + visible.back().triangleCount == meshlet.triangleOffset) {
+         visible.back().triangleCount += meshlet.triangleCount;
+      } else {
+         visible.emplace_back(MeshletRange{meshlet.triangleOffset, meshlet.triangleCount});
+      }
+   }
+}
+
+}
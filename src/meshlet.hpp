@@ -0,0 +1,68 @@
+#ifndef GAME_TUTORIAL_MESHLET_HPP
+#define GAME_TUTORIAL_MESHLET_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "simd_compat.hpp"
+
+namespace game {
+
+/// A small cluster of triangles. Offsets index into the
+/// vertices/triangles arrays of the owning MeshletData, triangles
+/// are triplets of local (8 bit) indices into the meshlet vertices.
+struct Meshlet {
+   std::uint32_t vertexOffset;
+   std::uint32_t triangleOffset;
+   std::uint32_t vertexCount;
+   std::uint32_t triangleCount;
+};
+
+/// Bounding sphere and normal cone of a meshlet, in mesh space.
+/// A meshlet is back facing for every viewer satisfying
+/// dot(center - eye, coneAxis) >= coneCutoff * |center - eye| + radius
+struct MeshletBounds {
+   simd::float3 center;
+   float radius;
+   simd::float3 coneAxis;
+   float coneCutoff;
+};
+
+struct MeshletData {
+   std::vector<Meshlet> meshlets;
+   std::vector<MeshletBounds> bounds;
+   /// global vertex index for every local meshlet vertex
+   std::vector<std::uint32_t> vertices;
+   /// local triangle indices, 3 per triangle
+   std::vector<std::uint8_t> triangles;
+
+   [[nodiscard]] auto empty() const -> bool {return meshlets.empty();}
+   [[nodiscard]] auto size() const -> size_t {return meshlets.size();}
+};
+
+/// contiguous run of meshlets, i.e. one draw call over the reordered index buffer
+struct MeshletRange {
+   std::uint32_t firstTriangle;
+   std::uint32_t triangleCount;
+};
+
+/// Normalised frustum planes, plane.xyz points inside.
+struct Frustum {
+   simd::float4 planes[6];
+
+   /// extract the planes of a (column major) clip matrix, if the matrix
+   /// contains the model transform the planes end up in model space.
+   static auto fromMatrix(const simd::float4x4& clip) -> Frustum;
+   [[nodiscard]] auto intersects(const simd::float3& center, float radius) const -> bool;
+};
+
+/// Frustum and back-face cone test for every meshlet, visible meshlets
+/// are returned merged into ranges of consecutive triangles.
+auto cullMeshlets(const MeshletData& data, const Frustum& frustum,
+   const simd::float3& eye, std::vector<MeshletRange>& visible) -> void;
+
+}
+
+#endif // GAME_TUTORIAL_MESHLET_HPP
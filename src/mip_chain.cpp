@@ -0,0 +1,360 @@
+#include "mip_chain.hpp"
+#include "error.hpp"
+#include "mapped_file.hpp"
+#include "parallel_for.hpp"
+#include "simd_compat.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <numbers>
+
+namespace game {
+
+namespace {
+
+using Pixel = simd::float4;
+
+constexpr size_t ROW_GRAIN = 16;
+/// in texels of the level being built, 4 source texels either side
+constexpr float KAISER_RADIUS = 2.0f;
+constexpr float KAISER_ALPHA = 4.0f;
+constexpr float LANCZOS_RADIUS = 3.0f;
+constexpr float MITCHELL_RADIUS = 2.0f;
+constexpr float MITCHELL_B = 1.0f / 3.0f;
+constexpr float MITCHELL_C = 1.0f / 3.0f;
+/// linear to sRGB goes through a table, fine enough to round like pow()
+constexpr size_t SRGB_TABLE_SIZE = 16384;
+
+auto srgbToLinear(const float c) -> float {
+   return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+}
+
+auto linearToSrgb(const float c) -> float {
+   return c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+}
+
+auto decodeTable() -> const std::array<float, 256>& {
+   static const auto table = [] {
+      auto t = std::array<float, 256>{};
+      for (auto i = size_t{0}; i < t.size(); ++i) {
+         t[i] = srgbToLinear(static_cast<float>(i) / 255.0f);
+      }
+      return t;
+   }();
+   return table;
+}
+
+auto encodeTable() -> const std::array<std::uint8_t, SRGB_TABLE_SIZE>& {
+   static const auto table = [] {
+      auto t = std::array<std::uint8_t, SRGB_TABLE_SIZE>{};
+      for (auto i = size_t{0}; i < t.size(); ++i) {
+         const auto c = linearToSrgb(static_cast<float>(i) / static_cast<float>(SRGB_TABLE_SIZE - 1));
+         t[i] = static_cast<std::uint8_t>(std::lround(c * 255.0f));
+      }
+      return t;
+   }();
+   return table;
+}
+
+/// modified Bessel function of the first kind, the series converges
+/// quickly for the arguments a Kaiser window needs
+auto besselI0(const float x) -> float {
+   auto sum = 1.0f;
+   auto term = 1.0f;
+   for (auto k = 1; k < 20; ++k) {
+      term *= (x / (2.0f * static_cast<float>(k))) * (x / (2.0f * static_cast<float>(k)));
+      sum += term;
+   }
+   return sum;
+}
+
+auto sinc(const float t) -> float {
+   return t == 0.0f ? 1.0f : std::sin(std::numbers::pi_v<float> * t) / (std::numbers::pi_v<float> * t);
+}
+
+/// how far filter reaches, in texels of the destination
+auto radius(const MipFilter filter) -> float {
+   switch (filter) {
+      case MipFilter::Lanczos: return LANCZOS_RADIUS;
+      case MipFilter::Mitchell: return MITCHELL_RADIUS;
+      case MipFilter::Kaiser: case MipFilter::Box: default: return KAISER_RADIUS;
+   }
+}
+
+/// t in texels of the destination, within radius(filter)
+auto weight(const MipFilter filter, const float t) -> float {
+   const auto x = std::abs(t);
+   switch (filter) {
+      case MipFilter::Lanczos:
+         return sinc(t) * sinc(t / LANCZOS_RADIUS);
+      case MipFilter::Mitchell: {
+         constexpr auto B = MITCHELL_B;
+         constexpr auto C = MITCHELL_C;
+         const auto w = x < 1.0f
+            ? (12.0f - 9.0f * B - 6.0f * C) * x * x * x + (-18.0f + 12.0f * B + 6.0f * C) * x * x + (6.0f - 2.0f * B)
+            : (-B - 6.0f * C) * x * x * x + (6.0f * B + 30.0f * C) * x * x + (-12.0f * B - 48.0f * C) * x
+              + (8.0f * B + 24.0f * C);
+         return w / 6.0f;
+      }
+      case MipFilter::Kaiser: case MipFilter::Box: default: {
+         const auto r = t / KAISER_RADIUS;
+         return sinc(t) * besselI0(KAISER_ALPHA * std::sqrt(1.0f - r * r)) / besselI0(KAISER_ALPHA);
+      }
+   }
+}
+
+/// The source texels each destination texel of one direction reads and
+/// their weights, summing to one. Every destination texel has the same
+/// number of taps, unused ones weigh zero; reads past an edge are
+/// clamped to it. Scaling up, the filters keep their width in source
+/// texels and the box blends the one or two source texels under a
+/// destination texel by how much of it they cover.
+struct Kernel {
+   size_t taps{0};
+   std::vector<std::uint32_t> indexes;
+   std::vector<float> weights;
+
+   Kernel(const size_t source, const size_t destination, const MipFilter filter) {
+      const auto scale = static_cast<float>(source) / static_cast<float>(destination);
+      auto all = std::vector<std::vector<std::pair<std::int64_t, float>>>(destination);
+      for (auto d = size_t{0}; d < destination; ++d) {
+         auto& texel = all[d];
+         if (filter == MipFilter::Box) {
+            const auto lo = static_cast<float>(d) * scale;
+            const auto hi = static_cast<float>(d + 1) * scale;
+            for (auto i = static_cast<std::int64_t>(std::floor(lo)); static_cast<float>(i) < hi; ++i) {
+               const auto w = std::min(hi, static_cast<float>(i + 1)) - std::max(lo, static_cast<float>(i));
+               if (w > 0.0f) {
+                  texel.emplace_back(i, w);
+               }
+            }
+         } else {
+            const auto stretch = std::max(scale, 1.0f);
+            const auto center = (static_cast<float>(d) + 0.5f) * scale - 0.5f;
+            const auto support = radius(filter) * stretch;
+            const auto first = static_cast<std::int64_t>(std::ceil(center - support));
+            const auto last = static_cast<std::int64_t>(std::floor(center + support));
+            for (auto i = first; i <= last; ++i) {
+               const auto t = (static_cast<float>(i) - center) / stretch;
+               const auto w = std::abs(t) < radius(filter) ? weight(filter, t) : 0.0f;
+               if (w != 0.0f) {
+                  texel.emplace_back(i, w);
+               }
+            }
+         }
+         taps = std::max(taps, texel.size());
+      }
+
+      indexes.resize(destination * taps, 0);
+      weights.resize(destination * taps, 0.0f);
+      const auto last = static_cast<std::int64_t>(source) - 1;
+      for (auto d = size_t{0}; d < destination; ++d) {
+         auto sum = 0.0f;
+         for (const auto& [i, w]: all[d]) {
+            sum += w;
+         }
+         for (auto k = size_t{0}; k < all[d].size(); ++k) {
+            indexes[d * taps + k] = static_cast<std::uint32_t>(std::clamp(all[d][k].first, std::int64_t{0}, last));
+            weights[d * taps + k] = all[d][k].second / sum;
+         }
+      }
+   }
+};
+
+/// a level in linear floats
+struct Level {
+   size_t width{0};
+   size_t height{0};
+   std::vector<Pixel> pixels;
+};
+
+auto toLinear(const Image& image, const ColorSpace space) -> Level {
+   auto level = Level{image.width, image.height, std::vector<Pixel>(size_t{image.width} * image.height)};
+   const auto& table = decodeTable();
+   parallelFor(level.height, ROW_GRAIN, [&](const size_t begin, const size_t end) {
+      for (auto i = begin * level.width; i < end * level.width; ++i) {
+         const auto p = reinterpret_cast<const std::uint8_t*>(image.pixels.data()) + i * 4;
+         const auto a = static_cast<float>(p[3]) / 255.0f;
+         level.pixels[i] = space == ColorSpace::Srgb
+            ? Pixel{table[p[0]], table[p[1]], table[p[2]], a}
+            : Pixel{static_cast<float>(p[0]), static_cast<float>(p[1]), static_cast<float>(p[2]), static_cast<float>(p[3])}
+               * (1.0f / 255.0f);
+      }
+   });
+   return level;
+}
+
+auto toImage(const Level& level, const ColorSpace space) -> Image {
+   auto image = Image{static_cast<std::uint32_t>(level.width), static_cast<std::uint32_t>(level.height), {}};
+   image.pixels.resize(image.bytesPerRow() * image.height);
+   const auto& table = encodeTable();
+   parallelFor(level.height, ROW_GRAIN, [&](const size_t begin, const size_t end) {
+      for (auto i = begin * level.width; i < end * level.width; ++i) {
+         /// the sinc lobes can overshoot
+         const auto p = simd::clamp(level.pixels[i], Pixel{0.0f, 0.0f, 0.0f, 0.0f}, Pixel{1.0f, 1.0f, 1.0f, 1.0f});
+         const auto out = reinterpret_cast<std::uint8_t*>(image.pixels.data()) + i * 4;
+         if (space == ColorSpace::Srgb) {
+            const auto s = p * static_cast<float>(SRGB_TABLE_SIZE - 1) + 0.5f;
+            out[0] = table[static_cast<size_t>(s.x)];
+            out[1] = table[static_cast<size_t>(s.y)];
+            out[2] = table[static_cast<size_t>(s.z)];
+         } else {
+            out[0] = static_cast<std::uint8_t>(p.x * 255.0f + 0.5f);
+            out[1] = static_cast<std::uint8_t>(p.y * 255.0f + 0.5f);
+            out[2] = static_cast<std::uint8_t>(p.z * 255.0f + 0.5f);
+         }
+         out[3] = static_cast<std::uint8_t>(p.w * 255.0f + 0.5f);
+      }
+   });
+   return image;
+}
+
+/// separable: across the rows first, then down the columns, where a
+/// whole row of the intermediate is scaled and added at a time
+auto resample(const Level& source, const size_t width, const size_t height, const MipFilter filter) -> Level {
+   const auto across = Kernel{source.width, width, filter};
+   const auto down = Kernel{source.height, height, filter};
+
+   auto rows = std::vector<Pixel>(width * source.height);
+   parallelFor(source.height, ROW_GRAIN, [&](const size_t begin, const size_t end) {
+      for (auto y = begin; y < end; ++y) {
+         const auto in = source.pixels.data() + y * source.width;
+         const auto out = rows.data() + y * width;
+         for (auto x = size_t{0}; x < width; ++x) {
+            auto sum = Pixel{0.0f, 0.0f, 0.0f, 0.0f};
+            for (auto k = x * across.taps; k < (x + 1) * across.taps; ++k) {
+               sum += in[across.indexes[k]] * across.weights[k];
+            }
+            out[x] = sum;
+         }
+      }
+   });
+
+   auto level = Level{width, height, std::vector<Pixel>(width * height, Pixel{0.0f, 0.0f, 0.0f, 0.0f})};
+   parallelFor(height, ROW_GRAIN, [&](const size_t begin, const size_t end) {
+      for (auto y = begin; y < end; ++y) {
+         const auto out = level.pixels.data() + y * width;
+         for (auto k = y * down.taps; k < (y + 1) * down.taps; ++k) {
+            const auto in = rows.data() + down.indexes[k] * width;
+            const auto w = down.weights[k];
+            for (auto x = size_t{0}; x < width; ++x) {
+               out[x] += in[x] * w;
+            }
+         }
+      }
+   });
+   return level;
+}
+
+auto downsample(const Level& source, const MipFilter filter) -> Level {
+   return resample(source, std::max<size_t>(source.width / 2, 1), std::max<size_t>(source.height / 2, 1), filter);
+}
+
+}
+
+auto buildMipChain(const Image& base, const MipFilter filter, const ColorSpace space) -> MipChain {
+   ensure(base.width > 0 and base.height > 0 and base.pixels.size() == base.bytesPerRow() * base.height,
+      std::format("cannot build the mips of a {}x{} image of {} bytes", base.width, base.height, base.pixels.size()));
+   const auto count = static_cast<size_t>(std::bit_width(std::max(base.width, base.height)));
+   auto chain = MipChain{{}, filter, space};
+   chain.levels.reserve(count);
+   chain.levels.push_back(base);
+
+   auto level = toLinear(base, space);
+   for (auto i = size_t{1}; i < count; ++i) {
+      level = downsample(level, filter);
+      chain.levels.push_back(toImage(level, space));
+   }
+   return chain;
+}
+
+auto resizeImage(const Image& image, const std::uint32_t width, const std::uint32_t height, const MipFilter filter,
+   const ColorSpace space) -> Image {
+   ensure(image.width > 0 and image.height > 0 and image.pixels.size() == image.bytesPerRow() * image.height
+      and width > 0 and height > 0,
+      std::format("cannot resize a {}x{} image of {} bytes to {}x{}", image.width, image.height, image.pixels.size(),
+         width, height));
+   if (image.width == width and image.height == height) {
+      return image;
+   }
+   return toImage(resample(toLinear(image, space), width, height, filter), space);
+}
+
+auto arraySize(const std::span<const ImageSize> layers, const TextureQuality quality) -> ImageSize {
+   auto size = ImageSize{};
+   for (const auto& layer: layers) {
+      size.width = std::max(size.width, layer.width);
+      size.height = std::max(size.height, layer.height);
+   }
+   const auto steps = static_cast<std::uint32_t>(quality);
+   return {std::max(size.width >> steps, 1u), std::max(size.height >> steps, 1u)};
+}
+
+auto writeMipCache(const std::filesystem::path& path, const std::uint64_t stamp, const MipChain& chain) -> void {
+   ensure(not chain.levels.empty(), "cannot cache an empty mip chain");
+   const auto header = MipCacheHeader{
+      .magic = MipCacheHeader::MAGIC,
+      .version = MipCacheHeader::VERSION,
+      .stamp = stamp,
+      .width = chain.levels.front().width,
+      .height = chain.levels.front().height,
+      .levelCount = static_cast<std::uint32_t>(chain.levels.size()),
+      .filter = chain.filter,
+      .space = chain.space,
+      .padding = 0
+   };
+
+   /// the header is written last so that an interrupted write never
+   /// looks like a valid cache
+   std::ofstream file{path, std::ios::binary | std::ios::trunc};
+   ensure(file.is_open(), std::format("could not create {}", path.string()));
+   const auto blank = MipCacheHeader{.magic = 0, .version = 0, .stamp = 0, .width = 0, .height = 0, .levelCount = 0,
+      .filter = MipFilter::Box, .space = ColorSpace::Srgb, .padding = 0};
+   file.write(reinterpret_cast<const char*>(&blank), sizeof(blank));
+   for (const auto& level: chain.levels) {
+      file.write(reinterpret_cast<const char*>(level.pixels.data()), static_cast<std::streamsize>(level.pixels.size()));
+   }
+   file.seekp(0);
+   file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+   file.close();
+   ensure(not file.fail(), std::format("could not write {}", path.string()));
+}
+
+auto readMipCache(const std::filesystem::path& path, const std::uint64_t stamp,
+   const MipFilter filter, const ColorSpace space) -> std::optional<MipChain> {
+   if (not std::filesystem::exists(path)) {
+      return std::nullopt;
+   }
+   const auto file = MappedFile::open(path);
+   if (file.size() < sizeof(MipCacheHeader)) {
+      return std::nullopt;
+   }
+   MipCacheHeader h;
+   std::memcpy(&h, file.data(), sizeof(h));
+   if (h.magic != MipCacheHeader::MAGIC or h.version != MipCacheHeader::VERSION or h.stamp != stamp or
+      h.filter != filter or h.space != space or h.width == 0 or h.height == 0 or
+      h.levelCount != static_cast<std::uint32_t>(std::bit_width(std::max(h.width, h.height)))) {
+      return std::nullopt;
+   }
+
+   auto chain = MipChain{{}, filter, space};
+   chain.levels.reserve(h.levelCount);
+   auto offset = sizeof(MipCacheHeader);
+   for (auto i = std::uint32_t{0}; i < h.levelCount; ++i) {
+      auto level = Image{std::max(h.width >> i, 1u), std::max(h.height >> i, 1u), {}};
+      const auto size = level.bytesPerRow() * level.height;
+      if (offset + size > file.size()) {
+         return std::nullopt;
+      }
+      level.pixels.assign(file.data() + offset, file.data() + offset + size);
+      offset += size;
+      chain.levels.push_back(std::move(level));
+   }
+   return chain;
+}
+
+}
@@ -0,0 +1,94 @@
+#ifndef GAME_TUTORIAL_MIP_CHAIN_HPP
+#define GAME_TUTORIAL_MIP_CHAIN_HPP
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include "image.hpp"
+
+namespace game {
+
+enum class MipFilter : std::uint32_t {
+   /// the average of the texels a level texel covers
+   Box,
+   /// windowed sinc, sharper than the box at the price of some ringing
+   Kaiser,
+   /// three lobes of sinc, the sharpest and the most ringing
+   Lanczos,
+   /// cubic with B = C = 1/3, soft with barely any ringing
+   Mitchell
+};
+
+/// how the RGB channels of an image are stored, alpha is always linear
+enum class ColorSpace : std::uint32_t {
+   /// colour maps (base colour): filtered on linear light, stored as sRGB
+   Srgb,
+   /// data maps (normals, roughness, metallic): filtered as they are
+   Linear
+};
+
+/// Every level of an image down to 1x1, level 0 first. Each level is
+/// half the one before in both directions, rounded down, as the GPU
+/// lays out a texture of that size.
+struct MipChain {
+   std::vector<Image> levels;
+   MipFilter filter{MipFilter::Box};
+   ColorSpace space{ColorSpace::Srgb};
+};
+
+/// Filters every level from the one before it, kept in floats so that
+/// rounding does not add up along the chain. The pixels of a level are
+/// processed four channels at a time, rows are split across threads.
+/// Level 0 is a copy of base.
+[[nodiscard]] auto buildMipChain(const Image& base, MipFilter filter, ColorSpace space) -> MipChain;
+
+/// Filters image to width x height in linear floats, four channels at a
+/// time, rows split across threads as for the mips; any filter scales up
+/// or down. A copy when image is that size already.
+[[nodiscard]] auto resizeImage(const Image& image, std::uint32_t width, std::uint32_t height, MipFilter filter,
+   ColorSpace space) -> Image;
+
+/// how far textures are scaled down at load time, for targets short of memory
+enum class TextureQuality : std::uint32_t {
+   /// as authored
+   High,
+   /// half the width and height
+   Medium,
+   /// a quarter of the width and height
+   Low
+};
+
+/// The size every layer of a texture array is brought to: the widest and
+/// the tallest of layers, halved once per tier below High, 1x1 at least.
+[[nodiscard]] auto arraySize(std::span<const ImageSize> layers, TextureQuality quality) -> ImageSize;
+
+/// On disk layout of a cached mip chain, the levels follow the header
+/// one after the other, tightly packed.
+struct MipCacheHeader {
+   static constexpr std::uint32_t MAGIC = 0x50494d47; // "GMIP"
+   static constexpr std::uint32_t VERSION = 1;
+
+   std::uint32_t magic{MAGIC};
+   std::uint32_t version{VERSION};
+   std::uint64_t stamp{0};
+   std::uint32_t width{0};
+   std::uint32_t height{0};
+   std::uint32_t levelCount{0};
+   MipFilter filter{MipFilter::Box};
+   ColorSpace space{ColorSpace::Srgb};
+   std::uint32_t padding{0};
+};
+
+/// stamp identifies the source, see MeshCache::stamp
+auto writeMipCache(const std::filesystem::path& path, std::uint64_t stamp, const MipChain& chain) -> void;
+/// nullopt when the cache is missing, not a mip cache or was built from
+/// another source, with another filter or for another colour space
+[[nodiscard]] auto readMipCache(const std::filesystem::path& path, std::uint64_t stamp,
+   MipFilter filter, ColorSpace space) -> std::optional<MipChain>;
+
+}
+
+#endif // GAME_TUTORIAL_MIP_CHAIN_HPP
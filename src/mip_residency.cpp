@@ -0,0 +1,139 @@
+#include "mip_residency.hpp"
+#include "error.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+namespace game {
+
+auto projectedSize(const float radius, const float distance, const float fov, const float viewport_height) -> float {
+   if (distance <= radius) {
+      return viewport_height;
+   }
+   /// the angle the sphere covers against the angle the viewport covers
+   const auto angle = 2.0f * std::asin(radius / distance);
+   return std::min(viewport_height, viewport_height * angle / fov);
+}
+
+auto footprintLevel(const size_t width, const size_t height, const float pixels) -> size_t {
+   const auto texels = static_cast<float>(std::max(width, height));
+   if (pixels >= texels or pixels <= 0.0f) {
+      return pixels <= 0.0f ? std::numeric_limits<size_t>::max() : 0;
+   }
+   return static_cast<size_t>(std::floor(std::log2(texels / pixels)));
+}
+
+auto MipResidency::add(const size_t width, const size_t height, std::vector<size_t> level_bytes) -> size_t {
+   ensure(not level_bytes.empty(), "a streamed texture needs at least one level");
+   auto tail = size_t{0};
+   while (tail + 1 < level_bytes.size() and std::max(width >> tail, height >> tail) > TAIL_SIZE) {
+      ++tail;
+   }
+   const auto bytes = std::accumulate(level_bytes.begin() + static_cast<std::ptrdiff_t>(tail), level_bytes.end(),
+      size_t{0});
+   _resident += bytes;
+   _tails += bytes;
+   const auto levels = level_bytes.size();
+   _textures.push_back(Entry{
+      .levelBytes = std::move(level_bytes),
+      .tail = tail,
+      .resident = tail,
+      .loading = tail,
+      .wanted = tail,
+      .lastWanted = std::vector<std::uint64_t>(levels, 0)
+   });
+   return _textures.size() - 1;
+}
+
+auto MipResidency::request(const size_t texture, const size_t level) -> void {
+   auto& t = _textures[texture];
+   t.wanted = std::min(t.wanted, level);
+}
+
+auto MipResidency::_evictOne(std::vector<Change>& evictions) -> bool {
+   auto victim = _textures.end();
+   for (auto t = _textures.begin(); t != _textures.end(); ++t) {
+      if (t->resident == t->tail or t->loading != t->resident or t->lastWanted[t->resident] == _frame) {
+         continue;
+      }
+      if (victim == _textures.end() or t->lastWanted[t->resident] < victim->lastWanted[victim->resident]) {
+         victim = t;
+      }
+   }
+   if (victim == _textures.end()) {
+      return false;
+   }
+   _resident -= victim->levelBytes[victim->resident];
+   victim->loading = ++victim->resident;
+   const auto texture = static_cast<size_t>(victim - _textures.begin());
+   if (auto change = std::ranges::find(evictions, texture, &Change::texture); change != evictions.end()) {
+      change->level = victim->resident;
+   } else {
+      evictions.push_back({texture, victim->resident});
+   }
+   return true;
+}
+
+auto MipResidency::update() -> Plan {
+   ++_frame;
+   auto in_flight = size_t{0};
+   auto candidates = std::vector<size_t>{};
+   for (auto i = size_t{0}; i < _textures.size(); ++i) {
+      auto& t = _textures[i];
+      for (auto level = std::min(t.wanted, t.tail); level < t.tail; ++level) {
+         t.lastWanted[level] = _frame;
+      }
+      if (t.loading != t.resident) {
+         ++in_flight;
+      } else if (t.wanted < t.resident) {
+         candidates.push_back(i);
+      }
+   }
+
+   /// the textures furthest from what they need first, the cheaper loads on a tie
+   std::ranges::sort(candidates, [&](const size_t a, const size_t b) {
+      const auto& ta = _textures[a];
+      const auto& tb = _textures[b];
+      const auto gap_a = ta.resident - ta.wanted;
+      const auto gap_b = tb.resident - tb.wanted;
+      return gap_a != gap_b ? gap_a > gap_b : ta.levelBytes[ta.resident - 1] < tb.levelBytes[tb.resident - 1];
+   });
+
+   auto plan = Plan{};
+   for (const auto i: candidates) {
+      if (in_flight == MAX_LOADS) {
+         break;
+      }
+      auto& t = _textures[i];
+      const auto level = t.resident - 1;
+      const auto cost = t.levelBytes[level];
+      while (committedBytes() + cost > _budget and _evictOne(plan.evictions)) {}
+      if (committedBytes() + cost > _budget) {
+         continue;
+      }
+      t.loading = level;
+      _loading += cost;
+      ++in_flight;
+      plan.loads.push_back({i, level});
+   }
+
+   for (auto& t: _textures) {
+      t.wanted = t.tail;
+   }
+   return plan;
+}
+
+auto MipResidency::loaded(const size_t texture, const size_t level) -> void {
+   auto& t = _textures[texture];
+   if (t.loading == t.resident or level > t.loading) {
+      return;
+   }
+   const auto bytes = t.levelBytes[t.loading];
+   _loading -= bytes;
+   _resident += bytes;
+   t.resident = t.loading;
+}
+
+}
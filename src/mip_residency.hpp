@@ -0,0 +1,94 @@
+#ifndef GAME_TUTORIAL_MIP_RESIDENCY_HPP
+#define GAME_TUTORIAL_MIP_RESIDENCY_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace game {
+
+/// Diameter in pixels of a bounding sphere of radius at distance from
+/// the eye, for a vertical field of view of fov radians and a viewport
+/// viewport_height pixels tall; the whole viewport once the eye is inside.
+[[nodiscard]] auto projectedSize(float radius, float distance, float fov, float viewport_height) -> float;
+/// The coarsest level with a texel for every pixel of an object pixels
+/// across that the texture covers once.
+[[nodiscard]] auto footprintLevel(size_t width, size_t height, float pixels) -> size_t;
+
+/// Decides which mip levels of streamed textures are resident. Every
+/// texture keeps its mip tail, the levels TAIL_SIZE texels across or
+/// less, for good. Finer levels are loaded one at a time as frames ask
+/// for them, and evicted, least recently wanted first, when loading
+/// would go over the budget. A texture always holds a whole chain from
+/// its finest resident level down, so sampling it never waits.
+/// Nothing here touches the GPU: whoever renders carries out the plan
+/// of update() and reports loads as they complete.
+class MipResidency {
+public:
+   static constexpr size_t TAIL_SIZE = 64;
+   /// loads in flight at once, across every texture
+   static constexpr size_t MAX_LOADS = 2;
+
+   explicit MipResidency(const size_t budget) : _budget(budget) {}
+
+   /// level_bytes has every level, finest first; returns the texture id
+   auto add(size_t width, size_t height, std::vector<size_t> level_bytes) -> size_t;
+
+   /// asks for level this frame, the finest level asked for wins
+   auto request(size_t texture, size_t level) -> void;
+
+   struct Change {
+      size_t texture;
+      /// the finest level resident once the change is carried out
+      size_t level;
+   };
+   struct Plan {
+      std::vector<Change> loads;
+      /// already out of the budget, at most one per texture
+      std::vector<Change> evictions;
+   };
+   /// ends the frame and plans the loads and evictions it asked for
+   [[nodiscard]] auto update() -> Plan;
+   /// the texture holds level and every coarser one; ignored unless it
+   /// completes the load of the texture
+   auto loaded(size_t texture, size_t level) -> void;
+
+   [[nodiscard]] auto tailLevel(const size_t texture) const -> size_t {return _textures[texture].tail;}
+   [[nodiscard]] auto residentLevel(const size_t texture) const -> size_t {return _textures[texture].resident;}
+   [[nodiscard]] auto isLoading(const size_t texture) const -> bool {
+      return _textures[texture].loading != _textures[texture].resident;
+   }
+   [[nodiscard]] constexpr auto residentBytes() const -> size_t {return _resident;}
+   /// resident or loading
+   [[nodiscard]] constexpr auto committedBytes() const -> size_t {return _resident + _loading;}
+   /// the tails of every texture, which the budget cannot evict
+   [[nodiscard]] constexpr auto tailBytes() const -> size_t {return _tails;}
+   [[nodiscard]] constexpr auto budget() const -> size_t {return _budget;}
+
+private:
+   struct Entry {
+      std::vector<size_t> levelBytes;
+      size_t tail;
+      size_t resident;
+      /// the level being loaded, resident when none is
+      size_t loading;
+      /// the finest level asked for this frame, the tail when none was
+      size_t wanted;
+      /// the last frame each level was wanted
+      std::vector<std::uint64_t> lastWanted;
+   };
+
+   /// evicts the finest level of the texture least recently wanted, false when every level is wanted
+   auto _evictOne(std::vector<Change>& evictions) -> bool;
+
+   std::vector<Entry> _textures;
+   size_t _budget;
+   size_t _resident{0};
+   size_t _loading{0};
+   size_t _tails{0};
+   std::uint64_t _frame{0};
+};
+
+}
+
+#endif // GAME_TUTORIAL_MIP_RESIDENCY_HPP
@@ -0,0 +1,397 @@
+#include "mesh_factory.hpp"
+#include "error.hpp"
+#include "parallel_for.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <limits>
+#include <string>
+#include <thread>
+
+namespace game {
+
+namespace {
+
+/// below this a chunk is not worth a thread of its own
+constexpr size_t CHUNK_BYTES = size_t{1} << 20;
+constexpr size_t VERTEX_GRAIN = 8192;
+/// what assimp calls the faces that come before any object
+constexpr auto DEFAULT_OBJECT = std::string_view{"defaultobject"};
+constexpr auto NO_VERTEX = std::numeric_limits<std::uint32_t>::max();
+
+enum Channel : size_t {POSITION, UV, NORMAL};
+
+/// A face corner as written in the file. Positive references are stored
+/// as absolute 0 based indexes, negative ones can only be resolved once
+/// the chunks before are counted, they are kept relative to the start of
+/// the chunk with their bit set in relative. -1 and no bit: not given.
+struct Corner {
+   std::array<std::int32_t, 3> index{-1, -1, -1};
+   std::uint8_t relative{0};
+};
+
+/// everything a chunk of the file declares, in file order
+struct Chunk {
+   std::vector<simd::float3> positions;
+   std::vector<simd::float2> uvs;
+   std::vector<simd::float3> normals;
+   /// every face, already as triangles, whatever object it belongs to
+   std::vector<Corner> corners;
+   /// objects starting in the chunk and the first corner they own
+   std::vector<std::pair<std::string_view, size_t>> objects;
+   /// first line that could not be read
+   std::string_view error;
+
+   [[nodiscard]] auto count(const size_t channel) const -> size_t {
+      return channel == POSITION ? positions.size() : channel == UV ? uvs.size() : normals.size();
+   }
+};
+
+constexpr auto isBlank(const char c) -> bool {return c == ' ' or c == '\t' or c == '\r';}
+constexpr auto isDigit(const char c) -> bool {return c >= '0' and c <= '9';}
+
+constexpr auto POWERS_OF_TEN = std::array{
+   1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+   1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+auto skipBlanks(const char*& p, const char* end) -> void {
+   while (p < end and isBlank(*p)) {
+      ++p;
+   }
+}
+
+/// Decimal floats the way exporters write them. Mantissas that fit a
+/// double exactly and small exponents take one multiplication or
+/// division by an exact power of ten (Clinger's fast path), which covers
+/// practically every OBJ; anything else goes to strtod.
+auto parseFloat(const char*& p, const char* end, bool& ok) -> float {
+   skipBlanks(p, end);
+   const auto start = p;
+   auto negative = false;
+   if (p < end and (*p == '-' or *p == '+')) {
+      negative = *p == '-';
+      ++p;
+   }
+   auto mantissa = std::uint64_t{0};
+   auto digits = 0;
+   auto exponent = 0;
+   auto any = false;
+   for (; p < end and isDigit(*p); ++p) {
+      any = true;
+      if (digits < 19) {
+         mantissa = mantissa * 10 + static_cast<std::uint64_t>(*p - '0');
+         digits += mantissa != 0;
+      } else {
+         ++exponent;
+      }
+   }
+   if (p < end and *p == '.') {
+      for (++p; p < end and isDigit(*p); ++p) {
+         any = true;
+         if (digits < 19) {
+            mantissa = mantissa * 10 + static_cast<std::uint64_t>(*p - '0');
+            digits += mantissa != 0;
+            --exponent;
+         }
+      }
+   }
+   if (not any) {
+      ok = false;
+      return 0.0f;
+   }
+   if (p < end and (*p == 'e' or *p == 'E')) {
+      ++p;
+      auto negative_exponent = false;
+      if (p < end and (*p == '-' or *p == '+')) {
+         negative_exponent = *p == '-';
+         ++p;
+      }
+      auto e = 0;
+      for (; p < end and isDigit(*p); ++p) {
+         e = std::min(e * 10 + (*p - '0'), 1000);
+      }
+      exponent += negative_exponent ? -e : e;
+   }
+
+   if (mantissa <= (std::uint64_t{1} << 53) and exponent >= -22 and exponent <= 22) {
+      const auto m = static_cast<double>(mantissa);
+      const auto value = exponent < 0 ? m / POWERS_OF_TEN[static_cast<size_t>(-exponent)]
+                                      : m * POWERS_OF_TEN[static_cast<size_t>(exponent)];
+      return static_cast<float>(negative ? -value : value);
+   }
+   const auto text = std::string{start, p};
+   return std::strtof(text.c_str(), nullptr);
+}
+
+auto parseInt(const char*& p, const char* end, std::int64_t& value) -> bool {
+   auto negative = false;
+   if (p < end and *p == '-') {
+      negative = true;
+      ++p;
+   }
+   const auto start = p;
+   value = 0;
+   for (; p < end and isDigit(*p); ++p) {
+      value = std::min<std::int64_t>(value * 10 + (*p - '0'), std::numeric_limits<std::int32_t>::max());
+   }
+   value = negative ? -value : value;
+   return p != start and value != 0;
+}
+
+/// one reference of a corner, seen counts how many of that channel the
+/// chunk declared so far
+auto parseReference(const char*& p, const char* end, const size_t seen, Corner& corner, const size_t channel) -> bool {
+   auto value = std::int64_t{0};
+   if (not parseInt(p, end, value)) {
+      return false;
+   }
+   if (value > 0) {
+      corner.index[channel] = static_cast<std::int32_t>(value - 1);
+   } else {
+      corner.index[channel] = static_cast<std::int32_t>(static_cast<std::int64_t>(seen) + value);
+      corner.relative |= static_cast<std::uint8_t>(1u << channel);
+   }
+   return true;
+}
+
+/// v, v/vt, v//vn or v/vt/vn
+auto parseCorner(const char*& p, const char* end, const Chunk& chunk, Corner& corner) -> bool {
+   corner = Corner{};
+   if (not parseReference(p, end, chunk.positions.size(), corner, POSITION)) {
+      return false;
+   }
+   if (p == end or *p != '/') {
+      return true;
+   }
+   ++p;
+   if (p < end and *p != '/' and not parseReference(p, end, chunk.uvs.size(), corner, UV)) {
+      return false;
+   }
+   if (p == end or *p != '/') {
+      return true;
+   }
+   ++p;
+   return parseReference(p, end, chunk.normals.size(), corner, NORMAL);
+}
+
+auto parseLine(const std::string_view line, Chunk& chunk) -> bool {
+   auto p = line.data();
+   const auto end = line.data() + line.size();
+   skipBlanks(p, end);
+   if (end - p < 2) {
+      return true;
+   }
+   auto ok = true;
+   if (p[0] == 'v' and isBlank(p[1])) {
+      p += 1;
+      const auto x = parseFloat(p, end, ok);
+      const auto y = parseFloat(p, end, ok);
+      const auto z = parseFloat(p, end, ok);
+      chunk.positions.push_back({x, y, z});
+   } else if (p[0] == 'v' and p[1] == 't' and end - p > 2 and isBlank(p[2])) {
+      p += 2;
+      const auto u = parseFloat(p, end, ok);
+      const auto v = parseFloat(p, end, ok);
+      /// flipped, as the assimp import does
+      chunk.uvs.push_back({u, 1.0f - v});
+   } else if (p[0] == 'v' and p[1] == 'n' and end - p > 2 and isBlank(p[2])) {
+      p += 2;
+      const auto x = parseFloat(p, end, ok);
+      const auto y = parseFloat(p, end, ok);
+      const auto z = parseFloat(p, end, ok);
+      chunk.normals.push_back({x, y, z});
+   } else if (p[0] == 'f' and isBlank(p[1])) {
+      p += 1;
+      /// polygons become fans around their first corner
+      auto first = Corner{};
+      auto previous = Corner{};
+      auto corners = 0;
+      for (skipBlanks(p, end); p < end; skipBlanks(p, end)) {
+         auto corner = Corner{};
+         if (not parseCorner(p, end, chunk, corner)) {
+            return false;
+         }
+         if (corners >= 2) {
+            chunk.corners.insert(chunk.corners.end(), {first, previous, corner});
+         }
+         first = corners == 0 ? corner : first;
+         previous = corner;
+         ++corners;
+      }
+      ok = corners >= 3;
+   } else if (p[0] == 'o' and isBlank(p[1])) {
+      auto name = std::string_view{p + 1, end};
+      while (not name.empty() and isBlank(name.front())) {
+         name.remove_prefix(1);
+      }
+      while (not name.empty() and isBlank(name.back())) {
+         name.remove_suffix(1);
+      }
+      chunk.objects.emplace_back(name, chunk.corners.size());
+   }
+   /// anything else (comments, groups, materials, smoothing) is not ours
+   return ok;
+}
+
+auto parseChunk(std::string_view text, Chunk& chunk) -> void {
+   while (not text.empty()) {
+      /// find is a memchr, vectorized by the C library
+      const auto newline = text.find('\n');
+      const auto line = text.substr(0, newline);
+      text.remove_prefix(newline == std::string_view::npos ? text.size() : newline + 1);
+      if (not parseLine(line, chunk) and chunk.error.empty()) {
+         chunk.error = line;
+      }
+   }
+}
+
+/// chunk boundaries, every chunk but the first starts at the beginning of a line
+auto split(const std::string_view text) -> std::vector<size_t> {
+   const auto hardware = std::max(1u, std::thread::hardware_concurrency());
+   const auto chunks = std::clamp<size_t>(text.size() / CHUNK_BYTES, 1, hardware);
+   auto bounds = std::vector<size_t>{0};
+   for (auto c = size_t{1}; c < chunks; ++c) {
+      const auto newline = text.find('\n', std::max(bounds.back(), c * text.size() / chunks));
+      if (newline == std::string_view::npos) {
+         break;
+      }
+      bounds.push_back(newline + 1);
+   }
+   bounds.push_back(text.size());
+   return bounds;
+}
+
+}
+
+auto MeshFactory::readObj(const std::string_view mesh_name, const std::span<const std::byte> data)
+   -> std::optional<MeshData> {
+   const auto text = std::string_view{reinterpret_cast<const char*>(data.data()), data.size()};
+   const auto bounds = split(text);
+   auto chunks = std::vector<Chunk>(bounds.size() - 1);
+   parallelFor(chunks.size(), 1, [&](const size_t begin, const size_t end) {
+      for (auto c = begin; c < end; ++c) {
+         parseChunk(text.substr(bounds[c], bounds[c + 1] - bounds[c]), chunks[c]);
+      }
+   });
+   for (const auto& chunk: chunks) {
+      ensure(chunk.error.empty(), std::format("could not read OBJ line '{}'", chunk.error));
+   }
+
+   /// where the declarations of every chunk start in the whole file
+   auto firsts = std::vector<std::array<size_t, 3>>(chunks.size() + 1);
+   for (auto c = size_t{0}; c < chunks.size(); ++c) {
+      for (const auto channel: {POSITION, UV, NORMAL}) {
+         firsts[c + 1][channel] = firsts[c][channel] + chunks[c].count(channel);
+      }
+   }
+   const auto totals = firsts.back();
+
+   /// which corners belong to the object, objects can span chunks
+   struct Range {
+      size_t chunk;
+      size_t begin;
+      size_t end;
+      size_t output;
+   };
+   auto ranges = std::vector<Range>{};
+   auto selected = size_t{0};
+   auto found = false;
+   auto current = DEFAULT_OBJECT;
+   for (auto c = size_t{0}; c < chunks.size(); ++c) {
+      auto begin = size_t{0};
+      const auto add = [&](const size_t end) {
+         if (current == mesh_name and end > begin) {
+            ranges.push_back({c, begin, end, selected});
+            selected += end - begin;
+         }
+      };
+      for (const auto& [name, first]: chunks[c].objects) {
+         add(first);
+         current = name;
+         begin = first;
+         found = found or name == mesh_name;
+      }
+      add(chunks[c].corners.size());
+   }
+   if (not found and selected == 0) {
+      return std::nullopt;
+   }
+
+   /// absolute references, checked once all of them are resolved
+   auto references = std::vector<std::array<std::uint32_t, 3>>(selected);
+   auto valid = std::vector<std::uint8_t>(ranges.size(), 1);
+   parallelFor(ranges.size(), 1, [&](const size_t begin, const size_t end) {
+      for (auto r = begin; r < end; ++r) {
+         const auto& range = ranges[r];
+         auto ok = true;
+         for (auto i = range.begin; i < range.end; ++i) {
+            const auto& corner = chunks[range.chunk].corners[i];
+            auto& resolved = references[range.output + i - range.begin];
+            for (const auto channel: {POSITION, UV, NORMAL}) {
+               const auto relative = (corner.relative >> channel) & 1u;
+               const auto index = static_cast<std::int64_t>(corner.index[channel])
+                  + (relative ? static_cast<std::int64_t>(firsts[range.chunk][channel]) : 0);
+               ok = ok and index >= 0 and static_cast<size_t>(index) < totals[channel];
+               resolved[channel] = static_cast<std::uint32_t>(index);
+            }
+         }
+         valid[r] = ok;
+      }
+   });
+   ensure(totals[UV] > 0 and totals[NORMAL] > 0, std::format("{} needs texture coords and normals", mesh_name));
+   ensure(std::ranges::all_of(valid, [](const auto v) {return v != 0;}),
+      std::format("{} references vertices it does not declare, or has corners without uv or normal", mesh_name));
+
+   auto positions = std::vector<simd::float3>(totals[POSITION]);
+   auto uvs = std::vector<simd::float2>(totals[UV]);
+   auto normals = std::vector<simd::float3>(totals[NORMAL]);
+   parallelFor(chunks.size(), 1, [&](const size_t begin, const size_t end) {
+      for (auto c = begin; c < end; ++c) {
+         std::ranges::copy(chunks[c].positions, positions.begin() + static_cast<std::ptrdiff_t>(firsts[c][POSITION]));
+         std::ranges::copy(chunks[c].uvs, uvs.begin() + static_cast<std::ptrdiff_t>(firsts[c][UV]));
+         std::ranges::copy(chunks[c].normals, normals.begin() + static_cast<std::ptrdiff_t>(firsts[c][NORMAL]));
+      }
+   });
+
+   /// The same position/uv/normal triple becomes the same vertex. Vertices
+   /// sharing a position are chained from it, so finding a triple walks a
+   /// handful of candidates, without hashing or allocations per corner.
+   auto mesh = MeshData{};
+   mesh.indexes.reserve(selected);
+   auto heads = std::vector<std::uint32_t>(totals[POSITION], NO_VERTEX);
+   auto next = std::vector<std::uint32_t>{};
+   auto triples = std::vector<std::array<std::uint32_t, 3>>{};
+   for (const auto& reference: references) {
+      auto vertex = heads[reference[POSITION]];
+      while (vertex != NO_VERTEX and triples[vertex] != reference) {
+         vertex = next[vertex];
+      }
+      if (vertex == NO_VERTEX) {
+         vertex = static_cast<std::uint32_t>(triples.size());
+         triples.push_back(reference);
+         next.push_back(heads[reference[POSITION]]);
+         heads[reference[POSITION]] = vertex;
+      }
+      mesh.indexes.push_back(vertex);
+   }
+
+   mesh.vertices.resize(triples.size());
+   parallelFor(triples.size(), VERTEX_GRAIN, [&](const size_t begin, const size_t end) {
+      for (auto v = begin; v < end; ++v) {
+         const auto& [p, t, n] = triples[v];
+         mesh.vertices[v] = VertexData{
+            .position = simd::make_float4(positions[p], 1.0f),
+            .normal = normals[n],
+            .tangent = normals[n],
+            .bitangent = normals[n],
+            .uv = uvs[t]
+         };
+      }
+   });
+   generateTangents(mesh);
+   return mesh;
+}
+
+}
@@ -0,0 +1,66 @@
+#include <algorithm>
+#include <filesystem>
+#include <format>
+#include <iostream>
+#include <print>
+#include <string_view>
+#include <vector>
+
+#include "asset_archive.hpp"
+#include "error.hpp"
+#include "exception.hpp"
+
+namespace {
+
+/// already compressed, another pass would only cost load time
+auto compressible(const std::filesystem::path& path) -> bool {
+   const auto extension = path.extension().string();
+   return extension != ".png" and extension != ".jpg" and extension != ".jpeg";
+}
+
+}
+
+/// pack_assets <archive> <root> <directory>...
+/// packs every file under the directories, named by their path relative
+/// to root the way a ResourceLoader on root asks for them
+auto main(const int argc, const char* const argv[]) -> int {
+   try {
+      game::ensure(argc >= 4, "usage: pack_assets <archive> <root> <directory>...");
+      const auto archive = std::filesystem::path(argv[1]);
+      const auto root = std::filesystem::path(argv[2]);
+      auto inputs = std::vector<game::ArchiveInput>{};
+      for (auto i = 3; i < argc; ++i) {
+         for (const auto& entry: std::filesystem::recursive_directory_iterator{root / argv[i]}) {
+            if (entry.is_regular_file()) {
+               inputs.push_back({
+                  .name = entry.path().lexically_relative(root).generic_string(),
+                  .source = entry.path(),
+                  .compress = compressible(entry.path())
+               });
+            }
+         }
+      }
+      /// the same archive for the same files, whatever order the directories list in
+      std::ranges::sort(inputs, {}, &game::ArchiveInput::name);
+      game::AssetArchive::write(archive, inputs);
+
+      const auto packed = game::AssetArchive::open(archive);
+      auto original = size_t{0};
+      auto compressed = size_t{0};
+      for (const auto& input: inputs) {
+         const auto* const entry = packed.find(input.name);
+         original += entry->originalSize;
+         compressed += entry->compression == game::ArchiveCompression::Lz ? 1 : 0;
+      }
+      std::println("{} files, {:.1f} MB, {} of them compressed, in {} of {:.1f} MB", inputs.size(),
+         static_cast<double>(original) / static_cast<double>(1u << 20), compressed, archive.string(),
+         static_cast<double>(std::filesystem::file_size(archive)) / static_cast<double>(1u << 20));
+   } catch (const game::Exception& exception) {
+      std::println(std::cerr, "{}", exception);
+      return 1;
+   } catch (const std::exception& error) {
+      std::println(std::cerr, "{}", error.what());
+      return 1;
+   }
+   return 0;
+}
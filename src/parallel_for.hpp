@@ -0,0 +1,62 @@
+#ifndef GAME_TUTORIAL_PARALLEL_FOR_HPP
+#define GAME_TUTORIAL_PARALLEL_FOR_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace game {
+
+/// Splits [0, count) in chunks of at least grain elements and calls
+/// f(begin, end) for each of them across the hardware threads.
+/// The calling thread takes the first chunk, the first exception thrown
+/// by any chunk is rethrown once all of them are done.
+template <class F>
+auto parallelFor(const size_t count, const size_t grain, F&& f) -> void {
+   const auto hardware = std::max(1u, std::thread::hardware_concurrency());
+   const auto chunks = std::min<size_t>(hardware, (count + std::max<size_t>(grain,1) - 1) / std::max<size_t>(grain,1));
+   if (chunks <= 1) {
+      if (count > 0) {
+         f(size_t{0}, count);
+      }
+      return;
+   }
+
+   const auto chunk_size = (count + chunks - 1) / chunks;
+   std::exception_ptr error{};
+   std::mutex error_mutex;
+   const auto run = [&](const size_t begin, const size_t end) {
+      try {
+         f(begin, end);
+      } catch (...) {
+         const std::lock_guard lock{error_mutex};
+         if (not error) {
+            error = std::current_exception();
+         }
+      }
+   };
+
+   {
+      std::vector<std::jthread> workers;
+      workers.reserve(chunks - 1);
+      for (auto c = size_t{1}; c < chunks; ++c) {
+         const auto begin = c * chunk_size;
+         const auto end = std::min(count, begin + chunk_size);
+         if (begin < end) {
+            workers.emplace_back(run, begin, end);
+         }
+      }
+      run(0, std::min(count, chunk_size));
+   }
+
+   if (error) {
+      std::rethrow_exception(error);
+   }
+}
+
+}
+
+#endif // GAME_TUTORIAL_PARALLEL_FOR_HPP
@@ -0,0 +1,53 @@
+#include "primitives.hpp"
+#include "error.hpp"
+
+namespace game::primitives {
+
+namespace {
+
+/// vertex and index storage sized once, the writers fill it in place
+auto allocate(const size_t n_vertices, const size_t n_indexes) -> MeshData {
+   auto mesh = MeshData{};
+   mesh.vertices.resize(n_vertices);
+   mesh.indexes.resize(n_indexes);
+   return mesh;
+}
+
+}
+
+auto uvSphere(const float radius, const std::uint32_t rings, const std::uint32_t segments) -> MeshData {
+   ensure(rings >= 2 and segments >= 3, "a sphere needs at least 2 rings and 3 segments");
+   auto mesh = allocate(uvSphereVertexCount(rings, segments), uvSphereIndexCount(rings, segments));
+   writeUvSphere(mesh.vertices, mesh.indexes, radius, rings, segments);
+   return mesh;
+}
+
+auto icosphere(const float radius, const std::uint32_t level) -> MeshData {
+   ensure(level <= 10, "icosphere subdivision level above 10");
+   auto mesh = allocate(icosphereVertexCount(level), icosphereIndexCount(level));
+   writeIcosphere(mesh.vertices, mesh.indexes, radius, level);
+   return mesh;
+}
+
+auto plane(const float width, const float depth, const std::uint32_t columns, const std::uint32_t rows) -> MeshData {
+   ensure(columns >= 1 and rows >= 1, "a plane needs at least one quad");
+   auto mesh = allocate(planeVertexCount(columns, rows), planeIndexCount(columns, rows));
+   writePlane(mesh.vertices, mesh.indexes, width, depth, columns, rows);
+   return mesh;
+}
+
+auto cylinder(const float radius, const float height, const std::uint32_t segments, const std::uint32_t stacks) -> MeshData {
+   ensure(segments >= 3 and stacks >= 1, "a cylinder needs at least 3 segments and 1 stack");
+   auto mesh = allocate(cylinderVertexCount(segments, stacks), cylinderIndexCount(segments, stacks));
+   writeCylinder(mesh.vertices, mesh.indexes, radius, height, segments, stacks);
+   return mesh;
+}
+
+auto cone(const float radius, const float height, const std::uint32_t segments) -> MeshData {
+   ensure(segments >= 3, "a cone needs at least 3 segments");
+   auto mesh = allocate(coneVertexCount(segments), coneIndexCount(segments));
+   writeCone(mesh.vertices, mesh.indexes, radius, height, segments);
+   return mesh;
+}
+
+}
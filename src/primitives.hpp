@@ -0,0 +1,567 @@
+#ifndef GAME_TUTORIAL_PRIMITIVES_HPP
+#define GAME_TUTORIAL_PRIMITIVES_HPP
+
+/// Procedural primitives. Every shape has one constexpr writer that fills
+/// pre-sized vertex/index spans, the template versions run it at compile
+/// time for a fixed tessellation, the MeshData versions (primitives.cpp)
+/// run the very same code at runtime for arbitrary tessellations.
+///
+/// All shapes are centred on the origin, wound counter-clockwise seen
+/// from outside, with tangent = dP/du and bitangent = dP/dv.
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <numbers>
+#include <span>
+#include <vector>
+
+#include "vertex_data.hpp"
+
+namespace game::primitives {
+
+namespace detail {
+
+constexpr double PI = std::numbers::pi;
+
+/// constexpr replacements for <cmath>, only used during constant evaluation
+constexpr auto sqrt(const double x) -> double {
+   if (x <= 0.0) {
+      return 0.0;
+   }
+   auto r = x > 1.0 ? x : 1.0;
+   for (auto i = 0; i < 64; ++i) {
+      const auto next = 0.5 * (r + x / r);
+      if (next == r) {
+         break;
+      }
+      r = next;
+   }
+   return r;
+}
+
+constexpr auto sin(double x) -> double {
+   const auto turns = x / (2.0 * PI);
+   x -= 2.0 * PI * static_cast<double>(static_cast<long long>(turns + (turns >= 0.0 ? 0.5 : -0.5)));
+   if (x > PI / 2.0) {
+      x = PI - x;
+   } else if (x < -PI / 2.0) {
+      x = -PI - x;
+   }
+   auto term = x;
+   auto sum = x;
+   for (auto n = 1; n < 12; ++n) {
+      term *= -x * x / static_cast<double>((2 * n) * (2 * n + 1));
+      sum += term;
+   }
+   return sum;
+}
+
+constexpr auto cos(const double x) -> double {
+   return sin(x + PI / 2.0);
+}
+
+constexpr auto atan(const double x) -> double {
+   if (x < 0.0) {
+      return -atan(-x);
+   }
+   if (x > 1.0) {
+      return PI / 2.0 - atan(1.0 / x);
+   }
+   /// atan(x) = 2 atan(x / (1 + sqrt(1 + x^2))), twice, before the series
+   const auto x1 = x / (1.0 + sqrt(1.0 + x * x));
+   const auto x2 = x1 / (1.0 + sqrt(1.0 + x1 * x1));
+   auto term = x2;
+   auto sum = x2;
+   for (auto n = 1; n < 12; ++n) {
+      term *= -x2 * x2;
+      sum += term / static_cast<double>(2 * n + 1);
+   }
+   return 4.0 * sum;
+}
+
+constexpr auto atan2(const double y, const double x) -> double {
+   if (x > 0.0) {
+      return atan(y / x);
+   }
+   if (x < 0.0) {
+      return y >= 0.0 ? atan(y / x) + PI : atan(y / x) - PI;
+   }
+   return y > 0.0 ? PI / 2.0 : (y < 0.0 ? -PI / 2.0 : 0.0);
+}
+
+constexpr auto fsin(const float x) -> float {
+   if consteval {
+      return static_cast<float>(sin(x));
+   } else {
+      return std::sin(x);
+   }
+}
+
+constexpr auto fcos(const float x) -> float {
+   if consteval {
+      return static_cast<float>(cos(x));
+   } else {
+      return std::cos(x);
+   }
+}
+
+constexpr auto fsqrt(const float x) -> float {
+   if consteval {
+      return static_cast<float>(sqrt(x));
+   } else {
+      return std::sqrt(x);
+   }
+}
+
+constexpr auto fatan2(const float y, const float x) -> float {
+   if consteval {
+      return static_cast<float>(atan2(y, x));
+   } else {
+      return std::atan2(y, x);
+   }
+}
+
+/// scalar vector, simd vectors are only built, never read, at compile time
+struct Vec3 {
+   float x, y, z;
+
+   constexpr auto operator+(const Vec3& o) const -> Vec3 {return {x + o.x, y + o.y, z + o.z};}
+   constexpr auto operator-(const Vec3& o) const -> Vec3 {return {x - o.x, y - o.y, z - o.z};}
+   constexpr auto operator*(const float s) const -> Vec3 {return {x * s, y * s, z * s};}
+   [[nodiscard]] constexpr auto dot(const Vec3& o) const -> float {return x * o.x + y * o.y + z * o.z;}
+   [[nodiscard]] constexpr auto cross(const Vec3& o) const -> Vec3 {
+      return {y * o.z - z * o.y, z * o.x - x * o.z, x * o.y - y * o.x};
+   }
+   [[nodiscard]] constexpr auto normalized() const -> Vec3 {
+      const auto l = fsqrt(dot(*this));
+      return l > 0.0f ? *this * (1.0f / l) : *this;
+   }
+};
+
+constexpr auto vertex(const Vec3& p, const Vec3& n, const Vec3& t, const Vec3& b,
+   const float u, const float v) -> VertexData {
+   return VertexData{
+      .position = simd::float4{p.x, p.y, p.z, 1.0f},
+      .normal = simd::float3{n.x, n.y, n.z},
+      .tangent = simd::float3{t.x, t.y, t.z},
+      .bitangent = simd::float3{b.x, b.y, b.z},
+      .uv = simd::float2{u, v}
+   };
+}
+
+/// uv, tangent and bitangent of the latitude/longitude parametrisation
+/// at a unit direction, shared by the uv sphere and the icosphere
+constexpr auto sphereVertex(const Vec3& n, const float radius) -> VertexData {
+   const auto ring = fsqrt(n.x * n.x + n.z * n.z);
+   const auto phi = fatan2(n.z, n.x);
+   const auto theta = fatan2(ring, n.y);
+   const auto u = (phi < 0.0f ? phi + 2.0f * static_cast<float>(PI) : phi) / (2.0f * static_cast<float>(PI));
+   const auto v = 1.0f - theta / static_cast<float>(PI);
+   const auto cos_phi = ring > 0.0f ? n.x / ring : 1.0f;
+   const auto sin_phi = ring > 0.0f ? n.z / ring : 0.0f;
+   const auto t = Vec3{-sin_phi, 0.0f, cos_phi};
+   const auto b = Vec3{-cos_phi * n.y, ring, -sin_phi * n.y};
+   return vertex(n * radius, n, t, b, u, v);
+}
+
+}
+
+template <size_t NVertices, size_t NIndexes>
+struct StaticMesh {
+   std::array<VertexData, NVertices> vertices{};
+   std::array<std::uint32_t, NIndexes> indexes{};
+};
+
+/// copies a compile time mesh into a MeshData, scaling its positions
+template <size_t NVertices, size_t NIndexes>
+auto toMeshData(const StaticMesh<NVertices, NIndexes>& mesh, const float scale = 1.0f) -> MeshData {
+   auto data = MeshData{
+      std::vector<VertexData>(mesh.vertices.begin(), mesh.vertices.end()),
+      std::vector<std::uint32_t>(mesh.indexes.begin(), mesh.indexes.end())
+   };
+   if (scale != 1.0f) {
+      for (auto& v: data.vertices) {
+         v.position.xyz *= scale;
+      }
+   }
+   return data;
+}
+
+/// -------------------------------------------------------------- cube
+
+constexpr size_t CUBE_VERTICES = 24;
+constexpr size_t CUBE_INDEXES = 36;
+
+constexpr auto writeCube(const std::span<VertexData> vertices, const std::span<std::uint32_t> indexes,
+   const float length) -> void {
+   using detail::Vec3;
+   constexpr Vec3 normals[] = {{0,0,1}, {0,0,-1}, {-1,0,0}, {1,0,0}, {0,1,0}, {0,-1,0}};
+   constexpr Vec3 tangents[] = {{1,0,0}, {-1,0,0}, {0,0,1}, {0,0,-1}, {1,0,0}, {1,0,0}};
+   constexpr float corners[4][2] = {{-1,-1}, {1,-1}, {1,1}, {-1,1}};
+   const auto h = length / 2.0f;
+   for (auto f = 0u; f < 6u; ++f) {
+      const auto& n = normals[f];
+      const auto& t = tangents[f];
+      const auto b = n.cross(t);
+      for (auto c = 0u; c < 4u; ++c) {
+         const auto p = (n + t * corners[c][0] + b * corners[c][1]) * h;
+         vertices[4 * f + c] = detail::vertex(p, n, t, b, (corners[c][0] + 1.0f) / 2.0f, (corners[c][1] + 1.0f) / 2.0f);
+      }
+      constexpr std::uint32_t quad[] = {0, 1, 2, 2, 3, 0};
+      for (auto i = 0u; i < 6u; ++i) {
+         indexes[6 * f + i] = 4 * f + quad[i];
+      }
+   }
+}
+
+constexpr auto cube(const float length = 1.0f) -> StaticMesh<CUBE_VERTICES, CUBE_INDEXES> {
+   StaticMesh<CUBE_VERTICES, CUBE_INDEXES> mesh{};
+   writeCube(mesh.vertices, mesh.indexes, length);
+   return mesh;
+}
+
+/// ----------------------------------------------------- sky box cube
+
+constexpr size_t SKYBOX_VERTICES = 8;
+constexpr size_t SKYBOX_INDEXES = 36;
+
+/// shared corners only, wound to be seen from the inside,
+/// normals point towards the centre
+constexpr auto skyboxCube() -> StaticMesh<SKYBOX_VERTICES, SKYBOX_INDEXES> {
+   using detail::Vec3;
+   constexpr Vec3 corners[] = {
+      {-1,-1,1}, {1,-1,1}, {1,1,1}, {-1,1,1},
+      {-1,-1,-1}, {1,-1,-1}, {1,1,-1}, {-1,1,-1}
+   };
+   StaticMesh<SKYBOX_VERTICES, SKYBOX_INDEXES> mesh{};
+   for (auto i = 0u; i < SKYBOX_VERTICES; ++i) {
+      const auto n = (corners[i] * -1.0f).normalized();
+      const auto t = Vec3{0,1,0}.cross(n).normalized();
+      mesh.vertices[i] = detail::vertex(corners[i], n, t, n.cross(t), 0.0f, 0.0f);
+   }
+   mesh.indexes = {
+      0, 2, 1,  0, 3, 2, // front
+      1, 6, 5,  1, 2, 6, // right
+      5, 7, 4,  5, 6, 7, // back
+      4, 3, 0,  4, 7, 3, // left
+      3, 6, 2,  3, 7, 6, // top
+      4, 1, 5,  4, 0, 1  // bottom
+   };
+   return mesh;
+}
+
+/// --------------------------------------------------------- uv sphere
+
+constexpr auto uvSphereVertexCount(const std::uint32_t rings, const std::uint32_t segments) -> size_t {
+   return static_cast<size_t>(rings + 1) * (segments + 1);
+}
+
+/// the first and last ring only get one triangle per quad, the other is degenerate
+constexpr auto uvSphereIndexCount(const std::uint32_t rings, const std::uint32_t segments) -> size_t {
+   return rings < 2 ? 0 : static_cast<size_t>(6) * segments * (rings - 1);
+}
+
+constexpr auto writeUvSphere(const std::span<VertexData> vertices, const std::span<std::uint32_t> indexes,
+   const float radius, const std::uint32_t rings, const std::uint32_t segments) -> void {
+   using detail::Vec3;
+   /// one sin/cos pair per segment instead of per vertex
+   auto segment_trig = std::vector<std::array<float, 2>>(segments + 1);
+   for (auto s = 0u; s <= segments; ++s) {
+      const auto phi = static_cast<float>(s) * 2.0f * static_cast<float>(detail::PI) / static_cast<float>(segments);
+      segment_trig[s] = {detail::fsin(phi), detail::fcos(phi)};
+   }
+   for (auto r = 0u; r <= rings; ++r) {
+      const auto theta = static_cast<float>(r) * static_cast<float>(detail::PI) / static_cast<float>(rings);
+      const auto sin_theta = detail::fsin(theta);
+      const auto cos_theta = detail::fcos(theta);
+      const auto v = 1.0f - static_cast<float>(r) / static_cast<float>(rings);
+      for (auto s = 0u; s <= segments; ++s) {
+         const auto [sin_phi, cos_phi] = segment_trig[s];
+         const auto n = Vec3{cos_phi * sin_theta, cos_theta, sin_phi * sin_theta};
+         const auto t = Vec3{-sin_phi, 0.0f, cos_phi};
+         const auto b = Vec3{-cos_phi * cos_theta, sin_theta, -sin_phi * cos_theta};
+         vertices[r * (segments + 1) + s] = detail::vertex(n * radius, n, t, b,
+            static_cast<float>(s) / static_cast<float>(segments), v);
+      }
+   }
+
+   auto i = size_t{0};
+   for (auto r = 0u; r < rings; ++r) {
+      for (auto s = 0u; s < segments; ++s) {
+         const auto first = r * (segments + 1) + s;
+         const auto second = first + segments + 1;
+         if (r != 0) {
+            indexes[i++] = first;
+            indexes[i++] = first + 1;
+            indexes[i++] = second;
+         }
+         if (r != rings - 1) {
+            indexes[i++] = second;
+            indexes[i++] = first + 1;
+            indexes[i++] = second + 1;
+         }
+      }
+   }
+}
+
+template <std::uint32_t Rings, std::uint32_t Segments>
+constexpr auto uvSphere(const float radius = 1.0f) {
+   static_assert(Rings >= 2 and Segments >= 3, "a sphere needs at least 2 rings and 3 segments");
+   StaticMesh<uvSphereVertexCount(Rings, Segments), uvSphereIndexCount(Rings, Segments)> mesh{};
+   writeUvSphere(mesh.vertices, mesh.indexes, radius, Rings, Segments);
+   return mesh;
+}
+
+/// -------------------------------------------------------- icosphere
+
+constexpr auto icosphereVertexCount(const std::uint32_t level) -> size_t {
+   const auto n = size_t{1} << level;
+   return 20 * (n + 1) * (n + 2) / 2;
+}
+
+constexpr auto icosphereIndexCount(const std::uint32_t level) -> size_t {
+   const auto n = size_t{1} << level;
+   return 20 * 3 * n * n;
+}
+
+/// every icosahedron face is split in a (2^level)^2 triangle grid
+/// projected on the sphere, vertices along the face edges are not shared
+constexpr auto writeIcosphere(const std::span<VertexData> vertices, const std::span<std::uint32_t> indexes,
+   const float radius, const std::uint32_t level) -> void {
+   using detail::Vec3;
+   constexpr auto g = static_cast<float>(std::numbers::phi);
+   constexpr Vec3 corners[] = {
+      {-1, g, 0}, {1, g, 0}, {-1, -g, 0}, {1, -g, 0},
+      {0, -1, g}, {0, 1, g}, {0, -1, -g}, {0, 1, -g},
+      {g, 0, -1}, {g, 0, 1}, {-g, 0, -1}, {-g, 0, 1}
+   };
+   constexpr std::uint32_t faces[20][3] = {
+      {0, 11, 5}, {0, 5, 1}, {0, 1, 7}, {0, 7, 10}, {0, 10, 11},
+      {1, 5, 9}, {5, 11, 4}, {11, 10, 2}, {10, 7, 6}, {7, 1, 8},
+      {3, 9, 4}, {3, 4, 2}, {3, 2, 6}, {3, 6, 8}, {3, 8, 9},
+      {4, 9, 5}, {2, 4, 11}, {6, 2, 10}, {8, 6, 7}, {9, 8, 1}
+   };
+   const auto n = std::uint32_t{1} << level;
+   const auto per_face = (n + 1) * (n + 2) / 2;
+   /// row i of a face holds n + 1 - i vertices
+   const auto local = [n](const std::uint32_t i, const std::uint32_t j) {
+      return i * (n + 1) - i * (i - 1) / 2 + j;
+   };
+
+   auto k = size_t{0};
+   for (auto f = 0u; f < 20u; ++f) {
+      const auto& a = corners[faces[f][0]];
+      const auto ab = corners[faces[f][1]] - a;
+      const auto ac = corners[faces[f][2]] - a;
+      const auto base = f * per_face;
+      for (auto i = 0u; i <= n; ++i) {
+         for (auto j = 0u; j <= n - i; ++j) {
+            const auto p = a + ab * (static_cast<float>(i) / static_cast<float>(n)) +
+                           ac * (static_cast<float>(j) / static_cast<float>(n));
+            vertices[base + local(i, j)] = detail::sphereVertex(p.normalized(), radius);
+         }
+      }
+      for (auto i = 0u; i < n; ++i) {
+         for (auto j = 0u; j < n - i; ++j) {
+            indexes[k++] = base + local(i, j);
+            indexes[k++] = base + local(i + 1, j);
+            indexes[k++] = base + local(i, j + 1);
+            if (j + 1 < n - i) {
+               indexes[k++] = base + local(i + 1, j);
+               indexes[k++] = base + local(i + 1, j + 1);
+               indexes[k++] = base + local(i, j + 1);
+            }
+         }
+      }
+   }
+}
+
+template <std::uint32_t Level>
+constexpr auto icosphere(const float radius = 1.0f) {
+   StaticMesh<icosphereVertexCount(Level), icosphereIndexCount(Level)> mesh{};
+   writeIcosphere(mesh.vertices, mesh.indexes, radius, Level);
+   return mesh;
+}
+
+/// ------------------------------------------------------- plane grid
+
+constexpr auto planeVertexCount(const std::uint32_t columns, const std::uint32_t rows) -> size_t {
+   return static_cast<size_t>(columns + 1) * (rows + 1);
+}
+
+constexpr auto planeIndexCount(const std::uint32_t columns, const std::uint32_t rows) -> size_t {
+   return static_cast<size_t>(6) * columns * rows;
+}
+
+/// grid on the xz plane facing +y, u along +x and v along +z
+constexpr auto writePlane(const std::span<VertexData> vertices, const std::span<std::uint32_t> indexes,
+   const float width, const float depth, const std::uint32_t columns, const std::uint32_t rows) -> void {
+   using detail::Vec3;
+   for (auto z = 0u; z <= rows; ++z) {
+      const auto v = static_cast<float>(z) / static_cast<float>(rows);
+      for (auto x = 0u; x <= columns; ++x) {
+         const auto u = static_cast<float>(x) / static_cast<float>(columns);
+         vertices[z * (columns + 1) + x] = detail::vertex(
+            Vec3{(u - 0.5f) * width, 0.0f, (v - 0.5f) * depth},
+            Vec3{0, 1, 0}, Vec3{1, 0, 0}, Vec3{0, 0, 1}, u, v);
+      }
+   }
+   auto i = size_t{0};
+   for (auto z = 0u; z < rows; ++z) {
+      for (auto x = 0u; x < columns; ++x) {
+         const auto first = z * (columns + 1) + x;
+         const auto next_row = first + columns + 1;
+         indexes[i++] = first;
+         indexes[i++] = next_row;
+         indexes[i++] = first + 1;
+         indexes[i++] = first + 1;
+         indexes[i++] = next_row;
+         indexes[i++] = next_row + 1;
+      }
+   }
+}
+
+template <std::uint32_t Columns, std::uint32_t Rows>
+constexpr auto plane(const float width = 1.0f, const float depth = 1.0f) {
+   static_assert(Columns >= 1 and Rows >= 1, "a plane needs at least one quad");
+   StaticMesh<planeVertexCount(Columns, Rows), planeIndexCount(Columns, Rows)> mesh{};
+   writePlane(mesh.vertices, mesh.indexes, width, depth, Columns, Rows);
+   return mesh;
+}
+
+/// ---------------------------------------------------------- cylinder
+
+constexpr auto cylinderVertexCount(const std::uint32_t segments, const std::uint32_t stacks) -> size_t {
+   return static_cast<size_t>(segments + 1) * (stacks + 1) + 2 * (segments + 2);
+}
+
+constexpr auto cylinderIndexCount(const std::uint32_t segments, const std::uint32_t stacks) -> size_t {
+   return static_cast<size_t>(6) * segments * stacks + 6 * segments;
+}
+
+/// disc of radius r at height y, facing +y or -y, centre first then the rim
+constexpr auto writeCap(const std::span<VertexData> vertices, const std::span<std::uint32_t> indexes,
+   const std::uint32_t base, const float radius, const float y, const bool up, const std::uint32_t segments) -> void {
+   using detail::Vec3;
+   const auto n = Vec3{0, up ? 1.0f : -1.0f, 0};
+   const auto b = Vec3{0, 0, up ? -1.0f : 1.0f};
+   const auto t = Vec3{1, 0, 0};
+   vertices[0] = detail::vertex(Vec3{0, y, 0}, n, t, b, 0.5f, 0.5f);
+   for (auto s = 0u; s <= segments; ++s) {
+      const auto phi = static_cast<float>(s) * 2.0f * static_cast<float>(detail::PI) / static_cast<float>(segments);
+      const auto c = detail::fcos(phi);
+      const auto sn = detail::fsin(phi);
+      vertices[1 + s] = detail::vertex(Vec3{c * radius, y, sn * radius}, n, t, b,
+         0.5f + 0.5f * c, up ? 0.5f - 0.5f * sn : 0.5f + 0.5f * sn);
+   }
+   for (auto s = 0u; s < segments; ++s) {
+      indexes[3 * s] = base;
+      indexes[3 * s + 1] = base + 1 + (up ? s + 1 : s);
+      indexes[3 * s + 2] = base + 1 + (up ? s : s + 1);
+   }
+}
+
+constexpr auto writeCylinder(const std::span<VertexData> vertices, const std::span<std::uint32_t> indexes,
+   const float radius, const float height, const std::uint32_t segments, const std::uint32_t stacks) -> void {
+   using detail::Vec3;
+   for (auto st = 0u; st <= stacks; ++st) {
+      const auto v = static_cast<float>(st) / static_cast<float>(stacks);
+      for (auto s = 0u; s <= segments; ++s) {
+         const auto phi = static_cast<float>(s) * 2.0f * static_cast<float>(detail::PI) / static_cast<float>(segments);
+         const auto c = detail::fcos(phi);
+         const auto sn = detail::fsin(phi);
+         vertices[st * (segments + 1) + s] = detail::vertex(
+            Vec3{c * radius, (v - 0.5f) * height, sn * radius},
+            Vec3{c, 0, sn}, Vec3{-sn, 0, c}, Vec3{0, 1, 0},
+            static_cast<float>(s) / static_cast<float>(segments), v);
+      }
+   }
+   auto i = size_t{0};
+   for (auto st = 0u; st < stacks; ++st) {
+      for (auto s = 0u; s < segments; ++s) {
+         const auto first = st * (segments + 1) + s;
+         const auto above = first + segments + 1;
+         indexes[i++] = first;
+         indexes[i++] = above;
+         indexes[i++] = first + 1;
+         indexes[i++] = first + 1;
+         indexes[i++] = above;
+         indexes[i++] = above + 1;
+      }
+   }
+   const auto side_vertices = (segments + 1) * (stacks + 1);
+   writeCap(vertices.subspan(side_vertices), indexes.subspan(i), side_vertices,
+      radius, height / 2.0f, true, segments);
+   writeCap(vertices.subspan(side_vertices + segments + 2), indexes.subspan(i + 3 * segments),
+      side_vertices + segments + 2, radius, -height / 2.0f, false, segments);
+}
+
+template <std::uint32_t Segments, std::uint32_t Stacks = 1>
+constexpr auto cylinder(const float radius = 0.5f, const float height = 1.0f) {
+   static_assert(Segments >= 3 and Stacks >= 1, "a cylinder needs at least 3 segments and 1 stack");
+   StaticMesh<cylinderVertexCount(Segments, Stacks), cylinderIndexCount(Segments, Stacks)> mesh{};
+   writeCylinder(mesh.vertices, mesh.indexes, radius, height, Segments, Stacks);
+   return mesh;
+}
+
+/// -------------------------------------------------------------- cone
+
+constexpr auto coneVertexCount(const std::uint32_t segments) -> size_t {
+   return static_cast<size_t>(segments + 1) + segments + (segments + 2);
+}
+
+constexpr auto coneIndexCount(const std::uint32_t segments) -> size_t {
+   return static_cast<size_t>(6) * segments;
+}
+
+/// one apex vertex per segment so that every side keeps its own normal
+constexpr auto writeCone(const std::span<VertexData> vertices, const std::span<std::uint32_t> indexes,
+   const float radius, const float height, const std::uint32_t segments) -> void {
+   using detail::Vec3;
+   const auto side = [&](const float phi) {
+      const auto c = detail::fcos(phi);
+      const auto sn = detail::fsin(phi);
+      const auto n = Vec3{c * height, radius, sn * height}.normalized();
+      const auto t = Vec3{-sn, 0, c};
+      const auto b = Vec3{-c * radius, height, -sn * radius}.normalized();
+      return std::array{n, t, b, Vec3{c, 0, sn}};
+   };
+   const auto step = 2.0f * static_cast<float>(detail::PI) / static_cast<float>(segments);
+   for (auto s = 0u; s <= segments; ++s) {
+      const auto [n, t, b, rim] = side(static_cast<float>(s) * step);
+      vertices[s] = detail::vertex(rim * radius + Vec3{0, -height / 2.0f, 0}, n, t, b,
+         static_cast<float>(s) / static_cast<float>(segments), 0.0f);
+   }
+   for (auto s = 0u; s < segments; ++s) {
+      const auto [n, t, b, rim] = side((static_cast<float>(s) + 0.5f) * step);
+      vertices[segments + 1 + s] = detail::vertex(Vec3{0, height / 2.0f, 0}, n, t, b,
+         (static_cast<float>(s) + 0.5f) / static_cast<float>(segments), 1.0f);
+      indexes[3 * s] = s;
+      indexes[3 * s + 1] = segments + 1 + s;
+      indexes[3 * s + 2] = s + 1;
+   }
+   const auto cap = 2 * segments + 1;
+   writeCap(vertices.subspan(cap), indexes.subspan(3 * segments), cap, radius, -height / 2.0f, false, segments);
+}
+
+template <std::uint32_t Segments>
+constexpr auto cone(const float radius = 0.5f, const float height = 1.0f) {
+   static_assert(Segments >= 3, "a cone needs at least 3 segments");
+   StaticMesh<coneVertexCount(Segments), coneIndexCount(Segments)> mesh{};
+   writeCone(mesh.vertices, mesh.indexes, radius, height, Segments);
+   return mesh;
+}
+
+/// ----------------------------------------------------- runtime path
+
+auto uvSphere(float radius, std::uint32_t rings, std::uint32_t segments) -> MeshData;
+auto icosphere(float radius, std::uint32_t level) -> MeshData;
+auto plane(float width, float depth, std::uint32_t columns, std::uint32_t rows) -> MeshData;
+auto cylinder(float radius, float height, std::uint32_t segments, std::uint32_t stacks) -> MeshData;
+auto cone(float radius, float height, std::uint32_t segments) -> MeshData;
+
+}
+
+#endif // GAME_TUTORIAL_PRIMITIVES_HPP
@@ -0,0 +1,197 @@
+#include "range_allocator.hpp"
+#include "error.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <utility>
+
+namespace game {
+
+namespace {
+
+struct SizeClass {
+   std::uint32_t fl;
+   std::uint32_t sl;
+};
+
+/// sizes below 16 get a class each, above that every power of two is
+/// split in 16 linear classes
+constexpr auto sizeClass(const std::uint64_t size, const std::uint32_t sl_bits) -> SizeClass {
+   if (size < (std::uint64_t{1} << sl_bits)) {
+      return {0, static_cast<std::uint32_t>(size)};
+   }
+   const auto msb = static_cast<std::uint32_t>(std::bit_width(size)) - 1;
+   return {msb - sl_bits + 1, static_cast<std::uint32_t>((size >> (msb - sl_bits)) - (std::uint64_t{1} << sl_bits))};
+}
+
+}
+
+RangeAllocator::RangeAllocator(const std::uint32_t capacity)
+   : _capacity(capacity) {
+   reset();
+}
+
+auto RangeAllocator::reset() -> void {
+   _blocks.clear();
+   _unusedNodes.clear();
+   _flBitmap = 0;
+   _slBitmaps.fill(0);
+   _heads.fill(INVALID);
+   _free = 0;
+   if (_capacity > 0) {
+      const auto node = _newNode();
+      _blocks[node] = Block{.offset = 0, .size = _capacity};
+      _insertFree(node);
+      _free = _capacity;
+   }
+}
+
+auto RangeAllocator::allocate(const std::uint32_t size) -> Allocation {
+   if (size == 0 or size > _free) {
+      return {};
+   }
+
+   /// round up to the next class so that any block of the class fits
+   auto rounded = std::uint64_t{size};
+   if (size >= SL_COUNT) {
+      rounded += (std::uint64_t{1} << (std::bit_width(size) - 1 - SL_BITS)) - 1;
+   }
+   auto [fl, sl] = sizeClass(rounded, SL_BITS);
+
+   auto node = INVALID;
+   auto sl_map = fl < FL_COUNT ? _slBitmaps[fl] & (~0u << sl) : 0u;
+   if (sl_map == 0 and fl + 1 < FL_COUNT) {
+      if (const auto fl_map = _flBitmap & (~0u << (fl + 1)); fl_map != 0) {
+         fl = static_cast<std::uint32_t>(std::countr_zero(fl_map));
+         sl_map = _slBitmaps[fl];
+      }
+   }
+   if (sl_map != 0) {
+      sl = static_cast<std::uint32_t>(std::countr_zero(sl_map));
+      node = _heads[fl * SL_COUNT + sl];
+   } else {
+      /// nothing in the larger classes, a block of the exact class may still fit
+      const auto [exact_fl, exact_sl] = sizeClass(size, SL_BITS);
+      for (auto n = _heads[exact_fl * SL_COUNT + exact_sl]; n != INVALID; n = _blocks[n].nextFree) {
+         if (_blocks[n].size >= size) {
+            node = n;
+            break;
+         }
+      }
+      if (node == INVALID) {
+         return {};
+      }
+   }
+
+   _removeFree(node);
+   if (_blocks[node].size > size) {
+      const auto rest = _newNode();
+      const auto next = _blocks[node].nextPhysical;
+      _blocks[rest] = Block{
+         .offset = _blocks[node].offset + size,
+         .size = _blocks[node].size - size,
+         .prevPhysical = node,
+         .nextPhysical = next
+      };
+      if (next != INVALID) {
+         _blocks[next].prevPhysical = rest;
+      }
+      _blocks[node].nextPhysical = rest;
+      _blocks[node].size = size;
+      _insertFree(rest);
+   }
+   _blocks[node].used = true;
+   _free -= size;
+   return {_blocks[node].offset, node};
+}
+
+auto RangeAllocator::free(const Allocation& allocation) -> void {
+   ensure(allocation.valid() and allocation.node < _blocks.size() and _blocks[allocation.node].used,
+      "freeing a range that is not allocated");
+   auto node = allocation.node;
+   _blocks[node].used = false;
+   _free += _blocks[node].size;
+
+   /// merge with the free neighbours, the merged nodes are recycled
+   const auto absorb = [this](const std::uint32_t into, const std::uint32_t from) {
+      const auto next = _blocks[from].nextPhysical;
+      _blocks[into].size += _blocks[from].size;
+      _blocks[into].nextPhysical = next;
+      if (next != INVALID) {
+         _blocks[next].prevPhysical = into;
+      }
+      _unusedNodes.push_back(from);
+   };
+   if (const auto prev = _blocks[node].prevPhysical; prev != INVALID and not _blocks[prev].used) {
+      _removeFree(prev);
+      absorb(prev, node);
+      node = prev;
+   }
+   if (const auto next = _blocks[node].nextPhysical; next != INVALID and not _blocks[next].used) {
+      _removeFree(next);
+      absorb(node, next);
+   }
+   _insertFree(node);
+}
+
+auto RangeAllocator::allocationSize(const Allocation& allocation) const -> std::uint32_t {
+   return allocation.valid() ? _blocks[allocation.node].size : 0;
+}
+
+auto RangeAllocator::largestFree() const -> std::uint32_t {
+   if (_flBitmap == 0) {
+      return 0;
+   }
+   const auto fl = 31u - static_cast<std::uint32_t>(std::countl_zero(_flBitmap));
+   const auto sl = 31u - static_cast<std::uint32_t>(std::countl_zero(_slBitmaps[fl]));
+   auto largest = 0u;
+   for (auto n = _heads[fl * SL_COUNT + sl]; n != INVALID; n = _blocks[n].nextFree) {
+      largest = std::max(largest, _blocks[n].size);
+   }
+   return largest;
+}
+
+auto RangeAllocator::_newNode() -> std::uint32_t {
+   if (not _unusedNodes.empty()) {
+      const auto node = _unusedNodes.back();
+      _unusedNodes.pop_back();
+      return node;
+   }
+   _blocks.emplace_back();
+   return static_cast<std::uint32_t>(_blocks.size() - 1);
+}
+
+auto RangeAllocator::_insertFree(const std::uint32_t node) -> void {
+   const auto [fl, sl] = sizeClass(_blocks[node].size, SL_BITS);
+   auto& head = _heads[fl * SL_COUNT + sl];
+   _blocks[node].prevFree = INVALID;
+   _blocks[node].nextFree = head;
+   if (head != INVALID) {
+      _blocks[head].prevFree = node;
+   }
+   head = node;
+   _flBitmap |= 1u << fl;
+   _slBitmaps[fl] |= 1u << sl;
+}
+
+auto RangeAllocator::_removeFree(const std::uint32_t node) -> void {
+   const auto [fl, sl] = sizeClass(_blocks[node].size, SL_BITS);
+   const auto prev = _blocks[node].prevFree;
+   const auto next = _blocks[node].nextFree;
+   if (prev != INVALID) {
+      _blocks[prev].nextFree = next;
+   } else {
+      _heads[fl * SL_COUNT + sl] = next;
+   }
+   if (next != INVALID) {
+      _blocks[next].prevFree = prev;
+   }
+   if (_heads[fl * SL_COUNT + sl] == INVALID) {
+      _slBitmaps[fl] &= ~(1u << sl);
+      if (_slBitmaps[fl] == 0) {
+         _flBitmap &= ~(1u << fl);
+      }
+   }
+}
+
+}
@@ -0,0 +1,68 @@
+#ifndef GAME_TUTORIAL_RANGE_ALLOCATOR_HPP
+#define GAME_TUTORIAL_RANGE_ALLOCATOR_HPP
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace game {
+
+/// Two level segregated fit (TLSF) allocator of ranges inside [0, capacity).
+/// It never touches memory, offsets and sizes are in whatever unit the
+/// owner decides (vertices, 4 byte words, ...). Allocation and free are
+/// O(1): free blocks are kept in 32 x 16 size classes found with two bit
+/// scans, neighbouring free blocks are merged on free.
+class RangeAllocator {
+public:
+   static constexpr std::uint32_t INVALID = 0xffffffff;
+
+   struct Allocation {
+      std::uint32_t offset{INVALID};
+      std::uint32_t node{INVALID};
+      [[nodiscard]] constexpr auto valid() const -> bool {return node != INVALID;}
+   };
+
+   explicit RangeAllocator(std::uint32_t capacity);
+
+   /// an invalid allocation when no free block is large enough
+   [[nodiscard]] auto allocate(std::uint32_t size) -> Allocation;
+   auto free(const Allocation& allocation) -> void;
+   /// back to a single free block, every allocation is forgotten
+   auto reset() -> void;
+
+   [[nodiscard]] auto allocationSize(const Allocation& allocation) const -> std::uint32_t;
+   [[nodiscard]] constexpr auto getCapacity() const -> std::uint32_t {return _capacity;}
+   [[nodiscard]] constexpr auto getFree() const -> std::uint32_t {return _free;}
+   [[nodiscard]] auto largestFree() const -> std::uint32_t;
+
+private:
+   static constexpr std::uint32_t SL_BITS = 4;
+   static constexpr std::uint32_t SL_COUNT = 1u << SL_BITS;
+   static constexpr std::uint32_t FL_COUNT = 32;
+
+   struct Block {
+      std::uint32_t offset{0};
+      std::uint32_t size{0};
+      std::uint32_t prevPhysical{INVALID};
+      std::uint32_t nextPhysical{INVALID};
+      std::uint32_t prevFree{INVALID};
+      std::uint32_t nextFree{INVALID};
+      bool used{false};
+   };
+
+   auto _newNode() -> std::uint32_t;
+   auto _insertFree(std::uint32_t node) -> void;
+   auto _removeFree(std::uint32_t node) -> void;
+
+   std::uint32_t _capacity;
+   std::uint32_t _free{0};
+   std::vector<Block> _blocks;
+   std::vector<std::uint32_t> _unusedNodes;
+   std::uint32_t _flBitmap{0};
+   std::array<std::uint32_t, FL_COUNT> _slBitmaps{};
+   std::array<std::uint32_t, FL_COUNT * SL_COUNT> _heads{};
+};
+
+}
+
+#endif // GAME_TUTORIAL_RANGE_ALLOCATOR_HPP
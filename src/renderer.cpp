@@ -96,6 +96,7 @@ auto Renderer::shadowPass(const Camera& camera,
       [[maybe_unused]]CA::MetalDrawable* surface, Scene& scene) const -> void {
    const auto commandQueue = _device->newCommandQueue();
    const auto buffer = commandQueue->commandBuffer();
+   scene.waitForUploads(buffer);
    const auto renderPassDescriptor = MTL::RenderPassDescriptor::alloc()->init();
    renderPassDescriptor->depthAttachment()->setTexture(_shadowPassTexture.get());
    renderPassDescriptor->depthAttachment()->setLoadAction(MTL::LoadActionClear);
@@ -127,6 +128,7 @@ auto Renderer::render(const Camera& camera,
    const MTL::ClearColor clear_color{0.,0.,0.,1.};
    const auto commandQueue = _device->newCommandQueue();
    const auto buffer = commandQueue->commandBuffer();
+   scene.waitForUploads(buffer);
 
    const auto renderPassDescriptor = MTL::RenderPassDescriptor::alloc()->init();
    const auto cd = renderPassDescriptor->colorAttachments()->object(0);
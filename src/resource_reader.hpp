@@ -1,13 +1,19 @@
 #ifndef GAME_TUTORIAL_RESOURCE_READER_HPP
 #define GAME_TUTORIAL_RESOURCE_READER_HPP
 
-#include "error.hpp"
+#include "asset_archive.hpp"
+#include "async_reader.hpp"
+#include "mapped_file.hpp"
 
 #include <filesystem>
-#include <fstream>
+#include <future>
+#include <memory>
+#include <optional>
 #include <ranges>
+#include <span>
+#include <string>
 #include <string_view>
-#include <sstream>
+#include <vector>
 
 namespace game {
 
@@ -15,27 +21,77 @@ class ResourceLoader {
 public:
    ResourceLoader(const std::filesystem::path &root) : _root(root) {}
 
-   [[nodiscard]] auto loadString(const std::string_view path) const -> std::string {
-      return loadFile(_root / path, std::ios::in);
+   /// Paths are looked up in the archives mounted last first, then as
+   /// loose files under the root: an archive may ship only some assets.
+   /// Development builds (without NDEBUG) skip entries packed from an
+   /// older loose file than the one under the root, so that edits show
+   /// without packing again.
+   auto mount(std::shared_ptr<const AssetArchive> archive) -> void {
+      _archives.push_back(std::move(archive));
    }
 
-   [[nodiscard]] auto loadBytes(const std::string_view path) const -> std::vector<std::byte> {
-      const auto data =  loadFile(_root / path, std::ios::in | std::ios::binary);
-      return data | std::views::transform([](auto b) -> std::byte{return static_cast<std::byte>(b);}) | std::ranges::to<std::vector>();
+   /// one copy, out of the mapping or the read buffer
+   [[nodiscard]] auto loadString(const std::string_view path) const -> std::string {
+      const auto contents = loadBytes(path, {.sequential = true, .willNeed = false, .hugePages = false});
+      return {reinterpret_cast<const char*>(contents.bytes().data()), contents.size()};
    }
 
-   auto static loadFile(const std::filesystem::path &path, auto open_mode) -> std::string {
-      const std::ifstream file{path,open_mode};
-      ensure(file.is_open(),
-         "Could not open file");
+   /// no copy for large files and stored archive entries, see FileContents:
+   /// bytes() views the mapping for as long as the result lives. Hints
+   /// only apply to loose files.
+   [[nodiscard]] auto loadBytes(const std::string_view path, const MapHints hints = {}) const -> FileContents {
+      if (auto contents = fromArchives(path)) {
+         return std::move(*contents);
+      }
+      return FileContents::open(_root / path, hints);
+   }
 
-      std::stringstream strm {};
-      strm << file.rdbuf();
-      return strm.str();
+   /// every loose path read at once, none of them waited on, see
+   /// AsyncReader; archive entries are ready when this returns
+   [[nodiscard]] auto loadBytes(const std::span<const std::string_view> paths, AsyncReader& reader) const
+      -> std::vector<std::future<std::vector<std::byte>>> {
+      auto reads = std::vector<std::future<std::vector<std::byte>>>(paths.size());
+      auto loose = std::vector<size_t>{};
+      for (auto i = size_t{0}; i < paths.size(); ++i) {
+         if (const auto contents = fromArchives(paths[i])) {
+            auto ready = std::promise<std::vector<std::byte>>{};
+            ready.set_value({contents->bytes().begin(), contents->bytes().end()});
+            reads[i] = ready.get_future();
+         } else {
+            loose.push_back(i);
+         }
+      }
+      const auto full = loose | std::views::transform([&](const auto i) {return _root / paths[i];})
+         | std::ranges::to<std::vector>();
+      auto loose_reads = reader.read(full);
+      for (auto i = size_t{0}; i < loose.size(); ++i) {
+         reads[loose[i]] = std::move(loose_reads[i]);
+      }
+      return reads;
    }
 
 private:
+   [[nodiscard]] auto fromArchives(const std::string_view path) const -> std::optional<FileContents> {
+      for (const auto& archive: _archives | std::views::reverse) {
+         if (const auto* const entry = archive->find(path); entry != nullptr and not stale(*entry, path)) {
+            return archive->read(*entry);
+         }
+      }
+      return std::nullopt;
+   }
+
+   [[nodiscard]] auto stale([[maybe_unused]] const ArchiveEntry& entry,
+      [[maybe_unused]] const std::string_view path) const -> bool {
+#ifdef NDEBUG
+      return false;
+#else
+      const auto loose = _root / path;
+      return std::filesystem::exists(loose) and AssetArchive::stamp(loose) != entry.stamp;
+#endif
+   }
+
    std::filesystem::path _root;
+   std::vector<std::shared_ptr<const AssetArchive>> _archives;
 };
 
 }
@@ -1,65 +1,150 @@
 #include "scene.hpp"
+#include <chrono>
 #include <filesystem>
+#include <string_view>
 
+#include "asset_archive.hpp"
+#include "asset_importer.hpp"
+#include "async_reader.hpp"
 #include "cube_map.hpp"
+#include "mapped_file.hpp"
+#include "memory_stats.hpp"
+#include "mesh_cache.hpp"
 #include "mesh_factory.hpp"
 #include "renderer.hpp"
 #include "resource_reader.hpp"
+#include "utils.hpp"
 
 namespace game {
 Scene::Scene(MTL::Device* device, CA::MetalLayer* layer)
-   : _device(device), _layer(layer) {
-   const ResourceLoader resourceLoader{ROOT_DIR};
+   : _uploads(device), _meshBuffers(device), _device(device), _layer(layer) {
+   ResourceLoader resourceLoader{ROOT_DIR};
+   /// packed by pack_assets, whatever it leaves out is read loose, as is,
+   /// in development builds, whatever was edited since
+   if (const auto archive = std::filesystem::path(ROOT_DIR) / CACHE_DIR / "assets.gpak";
+      std::filesystem::exists(archive)) {
+      resourceLoader.mount(std::make_shared<const AssetArchive>(AssetArchive::open(archive)));
+   }
    _entities.reserve(2);
 
    _unique_meshes.reserve(1);
    _unique_materials.reserve(1);
-   _unique_textures.reserve(1);
+   _unique_textures.reserve(2);
 
 
-   /// Can probably abstract this too
-   MeshFactory mf{};
-   //_unique_meshes.push_back(AutoRelease<Mesh *>{new Mesh{mf.getMeshData("cube",{})}, [](auto t) { t->~Mesh(); }});
+   /// everything that has to be decoded goes to the workers in one batch,
+   /// the mesh cache and the shader are dealt with here in the meantime
+   ThreadPool pool{};
+   /// one asset set for every device, those short of memory bake it smaller
+   AssetImporter importer{pool, _device->recommendedMaxWorkingSetSize() < LOW_MEMORY_WORKING_SET
+      ? TextureQuality::Medium : TextureQuality::High};
+   /// the reads nothing is decoded from go out at once, on a ring of their own
+   AsyncReader reader{pool};
+   const auto shader_path = (std::filesystem::path(SHADERS_DIR) / "textured.metal").string();
+   auto shader_read = resourceLoader.loadBytes(std::array{std::string_view{shader_path}}, reader);
+   const auto obj_path = std::filesystem::path(ROOT_DIR) / ASSETS_DIR / "Suzanne.obj";
+   const auto texture_dir = std::filesystem::path(ROOT_DIR) / ASSETS_DIR / "rustediron1-alt2-Unreal-Engine";
+   const auto mesh_requests = std::vector<MeshRequest>{{"Plane", obj_path}};
+   auto batch = importer.import(mesh_requests, {});
+   /// baked once with every mip in the GPU format, then uploaded from the
+   /// mapping of the file: colour averaged on linear light, the data maps
+   /// as they are and with the box filter, which does not ring. There is
+   /// no occlusion map, ORM leaves it white. The normals keep X and Y,
+   /// BC5 stores two channels at the size BC7 stores four.
+   const auto bc = _device->supportsBCTextureCompression();
+   const auto texture_layers = std::vector<TextureLayer>{
+      {{texture_dir / "rustediron2_basecolor.png"}, MipFilter::Kaiser, ColorSpace::Srgb, ChannelPacking::None},
+      {{{}, texture_dir / "rustediron2_roughness.png", texture_dir / "rustediron2_metallic.png"},
+         MipFilter::Box, ColorSpace::Linear, ChannelPacking::ORM}
+   };
+   auto texture_file = importer.textureFile(texture_layers,
+      bc ? TextureFileFormat::BC7 : TextureFileFormat::ASTC4x4,
+      std::filesystem::path(ROOT_DIR) / CACHE_DIR / "rustediron2.gtex");
+   auto normal_file = importer.textureFile(
+      {{{texture_dir / "rustediron2_normal.png"}, MipFilter::Box, ColorSpace::Linear, ChannelPacking::NormalXY}},
+      bc ? TextureFileFormat::BC5 : TextureFileFormat::ASTC4x4,
+      std::filesystem::path(ROOT_DIR) / CACHE_DIR / "rustediron2_normal.gtex");
+   /// the sky is the ambient light; there is no HDR sky, the skybox faces
+   /// are taken as linear radiance with white at 1
+   const auto skybox_dir = std::filesystem::path(ROOT_DIR) / ASSETS_DIR / "skybox";
+   auto environment_file = importer.environmentMap(
+      {skybox_dir / "right.jpg", skybox_dir / "left.jpg", skybox_dir / "top.jpg",
+         skybox_dir / "bottom.jpg", skybox_dir / "front.jpg", skybox_dir / "back.jpg"},
+      std::filesystem::path(ROOT_DIR) / CACHE_DIR / "skybox.gtex");
 
-   auto objdata = resourceLoader.loadBytes( (std::filesystem::path(ASSETS_DIR) / "Suzanne.obj").string());
-   _unique_meshes.push_back(AutoRelease<Mesh *>{new Mesh{mf.getMeshData("Suzanne",objdata)}, [](auto t) { t->~Mesh(); }});
-   _unique_meshes.push_back(AutoRelease<Mesh *>{new Mesh{mf.getMeshData("Plane",objdata)}, [](auto t) { t->~Mesh(); }});
+   /// mapped, not read: assimp only touches it when the cache is stale
+   const auto stamp = MeshCache::stamp(obj_path);
+   const auto cache_path = std::filesystem::path(ROOT_DIR) / CACHE_DIR / "Suzanne.mesh";
+   auto suzanne = MeshCache::open(cache_path, stamp);
+   if (not suzanne) {
+      const auto objdata = MappedFile::open(obj_path);
+      std::filesystem::create_directories(cache_path.parent_path());
+      /// big enough to be worth culling per meshlet
+      ensure(MeshFactory::importToCache("Suzanne", objdata.bytes(), cache_path, stamp, true),
+         "Suzanne not found in Suzanne.obj");
+      suzanne = MeshCache::open(cache_path, stamp);
+      ensure(suzanne.has_value(), "could not read back the Suzanne mesh cache");
+   }
+   _unique_meshes.push_back(AutoRelease<Mesh *>{new Mesh{_meshBuffers, *suzanne}, [](auto t) { t->~Mesh(); }});
 
-   const auto shader_path = std::filesystem::path(SHADERS_DIR) / "textured.metal";
-   const auto shader_string = resourceLoader.loadString(shader_path.string());
+   const auto shader_bytes = shader_read.front().get();
+   const auto shader_string = std::string{reinterpret_cast<const char*>(shader_bytes.data()), shader_bytes.size()};
    _unique_materials.push_back(
          AutoRelease<Material *>{new Material{shader_string, _device}, [](auto t) { t->~Material(); }});
 
-   const auto texture_paths = std::vector<std::filesystem::path>{
-      std::filesystem::path(ASSETS_DIR) / "rustediron1-alt2-Unreal-Engine" / "rustediron2_basecolor.png",
-      std::filesystem::path(ASSETS_DIR) / "rustediron1-alt2-Unreal-Engine" / "rustediron2_metallic.png",
-      std::filesystem::path(ASSETS_DIR) / "rustediron1-alt2-Unreal-Engine" / "rustediron2_roughness.png",
-      std::filesystem::path(ASSETS_DIR) / "rustediron1-alt2-Unreal-Engine" / "rustediron2_normal.png"
-   };
-
-   std::vector<std::vector<std::byte>> textures_data;
-   for (const auto& t: texture_paths) {
-      textures_data.emplace_back(resourceLoader.loadBytes(t.string()));
+   /// the meshes only view their data, it has to stay around until the
+   /// vertices are staged below
+   std::vector<MeshData> mesh_data;
+   mesh_data.reserve(batch.meshes.size());
+   for (auto& m: batch.meshes) {
+      mesh_data.push_back(m.get());
+      _unique_meshes.push_back(AutoRelease<Mesh *>{new Mesh{&mesh_data.back()}, [](auto t) { t->~Mesh(); }});
    }
 
-   _unique_textures.push_back(
-         AutoRelease<Texture *>{new Texture{
-            textures_data, 2048, 2048, _device}, [](auto t) { t->~Texture(); }});
+   auto lighting = importer.imageBasedLighting(environment_file.get(),
+      std::filesystem::path(ROOT_DIR) / CACHE_DIR / "skybox_specular.gtex",
+      std::filesystem::path(ROOT_DIR) / CACHE_DIR / "skybox.girr").get();
+   _specular = AutoRelease<Texture *>{new Texture{lighting.specular, _device, _uploads}, [](auto t) { t->~Texture(); }};
+   _irradiance = lighting.irradiance;
+
+   /// only the mip tail to begin with, render() streams in the rest
+   const auto upload_start = std::chrono::steady_clock::now();
+   for (const auto& file: {texture_file.get(), normal_file.get()}) {
+      auto level_bytes = std::vector<size_t>{};
+      for (auto level = size_t{0}; level < file.levelCount(); ++level) {
+         level_bytes.push_back(file.image(level, 0).size() * file.slices());
+      }
+      const auto texture_id = _residency.add(file.width(), file.height(), std::move(level_bytes));
+      _unique_textures.push_back(
+            AutoRelease<Texture *>{new Texture{
+               file, _residency.tailLevel(texture_id), _device, _uploads}, [](auto t) { t->~Texture(); }});
+      _streamed.push_back(_unique_textures.back().get());
+   }
+   std::println("Texture mip tails staged from the texture files in {:.2f} ms",
+      std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - upload_start).count());
 
    for (const auto &u: _unique_meshes) {
-      u->createBuffers(_device);
+      if (not u->hasBuffers()) {
+         u->createBuffers(_meshBuffers, _uploads);
+      }
    }
+   /// the copies run while the pipelines compile, the first frame waits on them
+   _uploads.flush();
+   std::println("Meshes loaded, peak resident memory {:.1f} MB",
+      static_cast<double>(peakResidentBytes()) / static_cast<double>(1u << 20));
    for (const auto &m: _unique_materials) {
       m->setUpRenderPipeLineState(_layer);
    }
 
-   _entities.emplace_back(_unique_meshes[0].get(),_unique_materials[0].get(), _unique_textures[0].get(),Vector3{0.0f,0.0f,0.0f});
-   _entities.emplace_back(_unique_meshes[1].get(), _unique_materials[0].get(),_unique_textures[0].get(),Vector3{0.0f,0.0f,0.0f});
+   _entities.emplace_back(_unique_meshes[0].get(),_unique_materials[0].get(), _unique_textures[0].get(),
+      _unique_textures[1].get(),Vector3{0.0f,0.0f,0.0f});
+   _entities.emplace_back(_unique_meshes[1].get(), _unique_materials[0].get(),_unique_textures[0].get(),
+      _unique_textures[1].get(),Vector3{0.0f,0.0f,0.0f});
 
    // for (auto i = 0u; i < 20u; ++i) {
    //    for (auto j = 0u; j < 20u; ++j) {
    //       _entities.emplace_back(_unique_meshes[0].get(),
-   //          _unique_materials[0].get(), _unique_textures[0].get(),
+   //          _unique_materials[0].get(), _unique_textures[0].get(), _unique_textures[1].get(),
    //          Vector3{static_cast<float>(i) * 3.0f-10.f, 0.0f, static_cast<float>(j) * 3.0f-10.0f});
    //    }
    // }
@@ -93,21 +178,63 @@ Scene::Scene(MTL::Device* device, CA::MetalLayer* layer)
    //                resourceLoader.loadBytes((std::filesystem::path(ASSETS_DIR) / "skybox" / "back.jpg").string())
    //             },
    //             resourceLoader.loadString(cubemapShaderPath),
-   //             2048u,2048u, _device, &mf
+   //             _device, &mf, _uploads
    //          },
    //       [](auto t){t->~CubeMap();}
    // };
    // _cubemap->setUpRenderPipeLineState(_layer);
-   // _cubemap->createBuffers(_device);
+   // _cubemap->createBuffers(_meshBuffers, _uploads);
+   // _uploads.flush();
+
 
+}
 
+auto Scene::_requestMips(const Entity& entity) -> void {
+   /// the mesh covered once by the textures, as wide on screen as its bounding sphere
+   const auto bounds = entity.getBounds();
+   const auto center = entity.getModel().data() * simd::make_float4(bounds.xyz, 1.0f);
+   const auto distance = simd::length(center.xyz - _camera->getPosition().data());
+   const auto pixels = projectedSize(bounds.w, distance, _camera->getFov(), _camera->getHeight());
+   for (const auto asset: {entity.getTextureAsset(), entity.getNormalMapAsset()}) {
+      const auto streamed = std::ranges::find(_streamed, asset);
+      if (streamed == _streamed.end()) {
+         continue;
+      }
+      const auto texture = (*streamed)->getTexture();
+      const auto level = (*streamed)->residentLevel();
+      /// the texture bound is level of the file, scaled back to the size of the file
+      _residency.request(static_cast<size_t>(streamed - _streamed.begin()),
+         footprintLevel(texture->width() << level, texture->height() << level, pixels));
+   }
 }
 
-auto Scene::render(MTL::RenderCommandEncoder *encoder, const RenderPasses renderPass) const -> void {
+auto Scene::_streamTextures() -> void {
+   for (const auto& [id, texture]: ::enumerate(_streamed)) {
+      if (texture->poll(_uploads)) {
+         _residency.loaded(id, texture->residentLevel());
+      }
+   }
+   const auto plan = _residency.update();
+   /// evictions first, their bytes are already spoken for
+   for (const auto& change: plan.evictions) {
+      _streamed[change.texture]->setResidentLevel(change.level, _uploads);
+   }
+   for (const auto& change: plan.loads) {
+      _streamed[change.texture]->setResidentLevel(change.level, _uploads);
+   }
+}
+
+auto Scene::render(MTL::RenderCommandEncoder *encoder, const RenderPasses renderPass) -> void {
+   std::vector<MeshletRange> visibleMeshlets;
+   /// meshes share the pool arenas, only rebind when the arena changes
+   const MTL::Buffer* boundVertexBuffer = nullptr;
    for (const auto& e: _entities) {
       encoder->setRenderPipelineState(
          e.getRenderPipelineState());
-      encoder->setVertexBuffer(e.getVertexBuffer(),0,0);
+      if (e.getVertexBuffer() != boundVertexBuffer) {
+         boundVertexBuffer = e.getVertexBuffer();
+         encoder->setVertexBuffer(boundVertexBuffer,0,0);
+      }
       encoder->setFrontFacingWinding(MTL::WindingCounterClockwise);
       encoder->setCullMode(MTL::CullModeBack);
       encoder->setDepthStencilState(e.getDepthStencilState());
@@ -130,6 +257,9 @@ auto Scene::render(MTL::RenderCommandEncoder *encoder, const RenderPasses render
             break;
          }
       }
+      if (renderPass == RenderPasses::MainPass) {
+         _requestMips(e);
+      }
       encoder->setFragmentTexture(e.getTexture(),0);
       if (_cubemap.get() == nullptr) {
          encoder->setFragmentTexture(nullptr,1);
@@ -137,6 +267,8 @@ auto Scene::render(MTL::RenderCommandEncoder *encoder, const RenderPasses render
          encoder->setFragmentTexture(_cubemap->getTextures(),1);
       }
       encoder->setFragmentTexture(_shadowTexture,2);
+      encoder->setFragmentTexture(e.getNormalMap(),3);
+      encoder->setFragmentTexture(_specular->getTexture(),4);
       /// could compress this into a unique buffer with offsets?
       encoder->setFragmentBuffer(_ambientLightBuffer.get(),0,3);
       encoder->setFragmentBuffer(_directionalLightBuffer.get(),0,4);
@@ -144,13 +276,46 @@ auto Scene::render(MTL::RenderCommandEncoder *encoder, const RenderPasses render
 
       encoder->setFragmentBytes(&_camera->getPosition().data(),sizeof(_camera->getPosition().data()),6);
       encoder->setFragmentBytes(&lightViewProjMatrix,sizeof(lightViewProjMatrix),7);
+      encoder->setFragmentBytes(&_irradiance,sizeof(_irradiance),8);
+
+      /// cull clusters in model space, the index buffer is in meshlet
+      /// order so every visible range is a single draw
+      if (const auto& meshlets = e.getMeshlets(); renderPass == RenderPasses::MainPass and not meshlets.empty()) {
+         const auto frustum = Frustum::fromMatrix(_camera->getCamera().data() * e.getModel().data());
+         const auto eye = simd::inverse(e.getModel().data()) * simd::make_float4(_camera->getPosition().data(), 1.0f);
+         cullMeshlets(meshlets, frustum, eye.xyz, visibleMeshlets);
+         for (auto [first, count]: visibleMeshlets) {
+            /// index buffer offsets must be 4 byte aligned, with 16 bit
+            /// indexes an odd range also draws the triangle before it
+            if (e.getIndexType() == MTL::IndexTypeUInt16 and first % 2 != 0) {
+               --first;
+               ++count;
+            }
+            encoder->drawIndexedPrimitives(
+               e.getPrimitive(),
+               count * 3,
+               e.getIndexType(),
+               e.getIndexBuffer(),
+               e.getIndexBufferOffset() + first * 3 * e.getIndexSize(),
+               1,
+               e.getBaseVertex(),
+               0);
+         }
+         continue;
+      }
       encoder->drawIndexedPrimitives(
          e.getPrimitive(),
          e.getIndexCount(),
-         MTL::IndexTypeUInt32,
+         e.getIndexType(),
          e.getIndexBuffer(),
+         e.getIndexBufferOffset(),
+         1,
+         e.getBaseVertex(),
          0);
    }
+   if (renderPass == RenderPasses::MainPass) {
+      _streamTextures();
+   }
 }
 
 auto Scene::renderSkyBox(MTL::RenderCommandEncoder * encoder) const -> void {
@@ -179,8 +344,11 @@ auto Scene::renderSkyBox(MTL::RenderCommandEncoder * encoder) const -> void {
 
    encoder->drawIndexedPrimitives(_cubemap->getPrimitive(),
       _cubemap->getIndexCount(),
-      MTL::IndexTypeUInt32,
+      _cubemap->getIndexType(),
       _cubemap->getIndexBuffer(),
+      _cubemap->getIndexBufferOffset(),
+      1,
+      _cubemap->getBaseVertex(),
       0);
 
 }
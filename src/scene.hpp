@@ -4,10 +4,14 @@
 #include <Metal/Metal.hpp>
 #include <QuartzCore/QuartzCore.hpp>
 
+#include "buffer_pool.hpp"
 #include "camera.hpp"
 #include "cube_map.hpp"
 #include "entity.hpp"
+#include "image_based_lighting.hpp"
 #include "light.hpp"
+#include "mip_residency.hpp"
+#include "upload_manager.hpp"
 
 namespace game {
 enum class RenderPasses;
@@ -21,8 +25,13 @@ class Scene {
 public:
    Scene(MTL::Device* device, CA::MetalLayer* layer);
    constexpr auto setCamera(Camera* camera) -> void {_camera = camera;}
-   auto render(MTL::RenderCommandEncoder * encoder,const RenderPasses renderPass) const -> void;
+   /// the main pass also streams the textures: every entity asks for the
+   /// mip level its footprint needs, the loads and evictions that follow
+   /// are recorded once every entity has been drawn
+   auto render(MTL::RenderCommandEncoder * encoder,const RenderPasses renderPass) -> void;
    auto renderSkyBox(MTL::RenderCommandEncoder * encoder) const -> void;
+   /// buffer will not start before the meshes and textures have landed
+   auto waitForUploads(MTL::CommandBuffer* buffer) -> void {_uploads.waitOnGPU(buffer);}
    [[nodiscard]] constexpr auto getCamera() const -> Camera* {return _camera;}
    [[nodiscard]] constexpr auto getTexture(const size_t& i) const -> MTL::Texture * {return _unique_textures[i].get()->getTexture();}
    constexpr auto setShadowTexture(const MTL::Texture* const texture) {_shadowTexture = texture;}
@@ -35,12 +44,29 @@ public:
    [[nodiscard]] constexpr auto getPointLight() const { return _pointLight;}
 
 private:
+   /// what streamed textures may hold beyond their mip tails
+   static constexpr size_t TEXTURE_BUDGET = size_t{128} << 20;
+   /// below this much GPU memory textures are baked at half size
+   static constexpr std::uint64_t LOW_MEMORY_WORKING_SET = std::uint64_t{4} << 30;
+
+   auto _requestMips(const Entity& entity) -> void;
+   auto _streamTextures() -> void;
+
    std::vector<Entity> _entities;
+   UploadManager _uploads;
+   /// declared before the meshes, which hand their ranges back on destruction
+   MeshBufferPool _meshBuffers;
    std::vector<AutoRelease<Mesh*>> _unique_meshes;
    std::vector<AutoRelease<Material*>>_unique_materials;
    std::vector<AutoRelease<Texture*>>_unique_textures;
+   MipResidency _residency{TEXTURE_BUDGET};
+   /// indexed by residency id
+   std::vector<Texture*> _streamed;
 
    AutoRelease<CubeMap*> _cubemap{};
+   /// the sky as ambient light, see AssetImporter::imageBasedLighting
+   AutoRelease<Texture*> _specular{};
+   IrradianceSH _irradiance{};
 
    AmbientLight _ambientLight{
       .strength = 0.1f,
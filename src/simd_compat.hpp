@@ -0,0 +1,93 @@
+#ifndef GAME_TUTORIAL_SIMD_COMPAT_HPP
+#define GAME_TUTORIAL_SIMD_COMPAT_HPP
+
+/// <simd/simd.h> only ships with the Apple SDKs. The cpu side of the
+/// asset pipeline (meshlets, tangents, ...) is also built and benchmarked
+/// on linux, so there we provide the small subset of the simd library
+/// that code uses, on top of the same clang vector extension Apple uses.
+
+#if defined(__APPLE__)
+
+#include <simd/simd.h>
+
+#else
+
+#include <cmath>
+#include <cstdint>
+
+namespace simd {
+
+using float2 = float __attribute__((ext_vector_type(2)));
+using float3 = float __attribute__((ext_vector_type(3)));
+using float4 = float __attribute__((ext_vector_type(4)));
+
+struct float4x4 {
+   float4 columns[4];
+};
+
+inline auto sin(const float x)  -> float {return std::sin(x);}
+inline auto cos(const float x)  -> float {return std::cos(x);}
+inline auto tan(const float x)  -> float {return std::tan(x);}
+inline auto sqrt(const float x) -> float {return std::sqrt(x);}
+inline auto atan2(const float y, const float x) -> float {return std::atan2(y,x);}
+
+inline auto dot(const float2 a, const float2 b) -> float {return a.x*b.x + a.y*b.y;}
+inline auto dot(const float3 a, const float3 b) -> float {return a.x*b.x + a.y*b.y + a.z*b.z;}
+inline auto dot(const float4 a, const float4 b) -> float {return a.x*b.x + a.y*b.y + a.z*b.z + a.w*b.w;}
+
+template <class V>
+inline auto length_squared(const V v) -> float {return dot(v,v);}
+
+template <class V>
+inline auto length(const V v) -> float {return std::sqrt(dot(v,v));}
+
+template <class V>
+inline auto distance(const V a, const V b) -> float {return length(a - b);}
+
+template <class V>
+inline auto normalize(const V v) -> V {return v * (1.0f / length(v));}
+
+inline auto cross(const float3 a, const float3 b) -> float3 {
+   return a.yzx * b.zxy - a.zxy * b.yzx;
+}
+
+template <class V>
+inline auto min(const V a, const V b) -> V {return __builtin_elementwise_min(a,b);}
+
+template <class V>
+inline auto max(const V a, const V b) -> V {return __builtin_elementwise_max(a,b);}
+
+template <class V>
+inline auto clamp(const V v, const V lo, const V hi) -> V {return min(max(v,lo),hi);}
+
+template <class V>
+inline auto abs(const V v) -> V {return __builtin_elementwise_abs(v);}
+
+template <class V>
+inline auto mix(const V a, const V b, const float t) -> V {return a + (b - a) * t;}
+
+inline auto make_float2(const float x, const float y) -> float2 {return float2{x,y};}
+inline auto make_float3(const float x, const float y, const float z) -> float3 {return float3{x,y,z};}
+inline auto make_float4(const float x, const float y, const float z, const float w) -> float4 {return float4{x,y,z,w};}
+inline auto make_float4(const float3 v, const float w) -> float4 {return float4{v.x,v.y,v.z,w};}
+
+inline auto operator*(const float4x4& m, const float4 v) -> float4 {
+   return m.columns[0]*v.x + m.columns[1]*v.y + m.columns[2]*v.z + m.columns[3]*v.w;
+}
+
+inline auto operator*(const float4x4& a, const float4x4& b) -> float4x4 {
+   return float4x4{{a*b.columns[0], a*b.columns[1], a*b.columns[2], a*b.columns[3]}};
+}
+
+}
+
+inline const simd::float4x4 matrix_identity_float4x4 {{
+   simd::float4{1.0f,0.0f,0.0f,0.0f},
+   simd::float4{0.0f,1.0f,0.0f,0.0f},
+   simd::float4{0.0f,0.0f,1.0f,0.0f},
+   simd::float4{0.0f,0.0f,0.0f,1.0f}
+}};
+
+#endif
+
+#endif // GAME_TUTORIAL_SIMD_COMPAT_HPP
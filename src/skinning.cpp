@@ -0,0 +1,106 @@
+#include "skinning.hpp"
+#include "error.hpp"
+#include "parallel_for.hpp"
+
+#include <algorithm>
+
+namespace game {
+
+namespace {
+
+/// vertices skinned per work item, enough to amortize the scheduling
+constexpr size_t VERTEX_GRAIN = 2048;
+
+auto transformVector(const simd::float4 c0, const simd::float4 c1, const simd::float4 c2,
+   const simd::float3 v) -> simd::float3 {
+   const auto r = c0 * v.x + c1 * v.y + c2 * v.z;
+   return simd::normalize(simd::make_float3(r.x, r.y, r.z));
+}
+
+}
+
+auto Skeleton::find(const std::string_view name) const -> std::int32_t {
+   const auto it = std::ranges::find(joints, name, &Joint::name);
+   return it == joints.end() ? -1 : static_cast<std::int32_t>(it - joints.begin());
+}
+
+auto buildPalette(const Skeleton& skeleton, const std::span<const Transform> pose,
+   const std::span<simd::float4x4> palette) -> void {
+   ensure(pose.size() == skeleton.size() and palette.size() >= skeleton.size(),
+      std::format("a skeleton of {} joints needs as many local transforms and palette entries, got {} and {}",
+         skeleton.size(), pose.size(), palette.size()));
+   /// model space first, parents are already done when a child is reached
+   for (auto j = 0u; j < skeleton.size(); ++j) {
+      const auto local = toMatrix(pose[j]);
+      const auto parent = skeleton.joints[j].parent;
+      palette[j] = parent < 0 ? local : palette[static_cast<size_t>(parent)] * local;
+   }
+   for (auto j = 0u; j < skeleton.size(); ++j) {
+      palette[j] = palette[j] * skeleton.joints[j].inverseBind;
+   }
+}
+
+auto skinVertices(const std::span<const VertexData> bind, const std::span<const SkinData> skin,
+   const std::span<const simd::float4x4> palette, const std::span<VertexData> skinned) -> void {
+   ensure(skin.size() == bind.size() and skinned.size() == bind.size(),
+      std::format("{} vertices with {} skin entries cannot be skinned into {}", bind.size(), skin.size(), skinned.size()));
+
+   for (auto v = 0u; v < bind.size(); ++v) {
+      const auto& s = skin[v];
+      const auto& m0 = palette[s.joints[0]];
+      const auto& m1 = palette[s.joints[1]];
+      const auto& m2 = palette[s.joints[2]];
+      const auto& m3 = palette[s.joints[3]];
+      const auto w = s.weights;
+      /// every column is one 4 wide multiply-add per influence
+      const auto c0 = m0.columns[0] * w.x + m1.columns[0] * w.y + m2.columns[0] * w.z + m3.columns[0] * w.w;
+      const auto c1 = m0.columns[1] * w.x + m1.columns[1] * w.y + m2.columns[1] * w.z + m3.columns[1] * w.w;
+      const auto c2 = m0.columns[2] * w.x + m1.columns[2] * w.y + m2.columns[2] * w.z + m3.columns[2] * w.w;
+      const auto c3 = m0.columns[3] * w.x + m1.columns[3] * w.y + m2.columns[3] * w.z + m3.columns[3] * w.w;
+
+      const auto& in = bind[v];
+      auto& out = skinned[v];
+      const auto p = in.position;
+      out.position = c0 * p.x + c1 * p.y + c2 * p.z + c3 * p.w;
+      /// joints are expected to scale uniformly, so the blended matrix
+      /// also transforms directions once they are renormalized
+      out.normal = transformVector(c0, c1, c2, in.normal);
+      out.tangent = transformVector(c0, c1, c2, in.tangent);
+      out.bitangent = transformVector(c0, c1, c2, in.bitangent);
+      out.uv = in.uv;
+   }
+}
+
+auto animate(const SkinnedMeshData& mesh, const std::span<const SkinningInstance> instances) -> void {
+   const auto joints = mesh.skeleton.size();
+   for (const auto& instance: instances) {
+      ensure(instance.clip != nullptr and instance.clip->getJointCount() == joints and
+         instance.palette.size() >= joints and instance.skinned.size() == mesh.mesh.vertices.size(),
+         "skinning instance does not match its mesh");
+   }
+
+   parallelFor(instances.size(), 16, [&](const size_t begin, const size_t end) {
+      auto pose = std::vector<Transform>(joints);
+      for (auto i = begin; i < end; ++i) {
+         instances[i].clip->sample(instances[i].time, pose);
+         buildPalette(mesh.skeleton, pose, instances[i].palette);
+      }
+   });
+
+   /// a few big meshes split as well as many small ones:
+   /// the work items are vertex chunks of every instance
+   const auto vertices = mesh.mesh.vertices.size();
+   const auto chunks = std::max<size_t>(1, (vertices + VERTEX_GRAIN - 1) / VERTEX_GRAIN);
+   parallelFor(instances.size() * chunks, 1, [&](const size_t begin, const size_t end) {
+      for (auto item = begin; item < end; ++item) {
+         const auto& instance = instances[item / chunks];
+         const auto first = (item % chunks) * VERTEX_GRAIN;
+         const auto count = std::min(VERTEX_GRAIN, vertices - first);
+         skinVertices(std::span{mesh.mesh.vertices}.subspan(first, count),
+            std::span{mesh.skin}.subspan(first, count),
+            instance.palette, instance.skinned.subspan(first, count));
+      }
+   });
+}
+
+}
@@ -0,0 +1,79 @@
+#ifndef GAME_TUTORIAL_SKINNING_HPP
+#define GAME_TUTORIAL_SKINNING_HPP
+
+/// Skeletons and linear blend skinning on the cpu. Skin weights live in a
+/// stream of their own next to the VertexData, so static meshes keep the
+/// same vertex layout and the same shaders.
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "animation.hpp"
+#include "compressed_clip.hpp"
+#include "simd_compat.hpp"
+#include "vertex_data.hpp"
+
+namespace game {
+
+/// Up to four joint influences per vertex, weights sum to one and unused
+/// slots have weight zero. Same layout as SkinData in skinning.metal.
+struct SkinData {
+   simd::float4 weights{1.0f, 0.0f, 0.0f, 0.0f};
+   std::array<std::uint16_t, 4> joints{};
+};
+
+struct Joint {
+   std::string name;
+   /// -1 for roots, otherwise lower than the index of the joint itself
+   std::int32_t parent{-1};
+   /// model space to joint space in the bind pose
+   simd::float4x4 inverseBind{matrix_identity_float4x4};
+};
+
+struct Skeleton {
+   /// parents come before their children
+   std::vector<Joint> joints;
+   [[nodiscard]] auto size() const -> size_t {return joints.size();}
+   /// -1 when there is no joint of that name
+   [[nodiscard]] auto find(std::string_view name) const -> std::int32_t;
+};
+
+struct SkinnedMeshData {
+   MeshData mesh;
+   /// one per vertex of mesh
+   std::vector<SkinData> skin;
+   Skeleton skeleton;
+   std::vector<CompressedClip> clips;
+};
+
+/// Concatenates the local pose down the hierarchy and applies the inverse
+/// bind matrices, giving the matrix each joint applies to bind pose vertices.
+auto buildPalette(const Skeleton& skeleton, std::span<const Transform> pose,
+   std::span<simd::float4x4> palette) -> void;
+
+/// Linear blend skinning of positions, normals, tangents and bitangents.
+/// The four weighted joint matrices are blended first, so each vertex pays
+/// for one matrix transform per attribute whatever its influence count.
+auto skinVertices(std::span<const VertexData> bind, std::span<const SkinData> skin,
+   std::span<const simd::float4x4> palette, std::span<VertexData> skinned) -> void;
+
+/// one animated copy of a skinned mesh, palette and skinned are written;
+/// palette may point into a GPU buffer that a compute pass skins from
+struct SkinningInstance {
+   const CompressedClip* clip;
+   float time;
+   std::span<simd::float4x4> palette;
+   std::span<VertexData> skinned;
+};
+
+/// samples, builds the palette of and skins every instance, across worker threads
+auto animate(const SkinnedMeshData& mesh, std::span<const SkinningInstance> instances) -> void;
+
+}
+
+#endif // GAME_TUTORIAL_SKINNING_HPP
@@ -0,0 +1,53 @@
+#include "skinning_pass.hpp"
+#include "error.hpp"
+
+#include <algorithm>
+
+namespace game {
+
+SkinningPass::SkinningPass(const std::string_view shader, MTL::Device* const device) {
+   const auto shader_source = NS::String::string(shader.data(),NS::ASCIIStringEncoding);
+   NS::Error * error = nullptr;
+   const auto library = AutoRelease<MTL::Library*>{
+      device->newLibrary(shader_source, {}, &error),
+      [](auto t) {t->release();}
+   };
+   ensure(library.get() != nullptr,
+      std::format("no library ->\n{}",
+               (error!=nullptr) ? error->localizedDescription()->utf8String():""));
+
+   const auto function = AutoRelease<MTL::Function*>{
+      library->newFunction(NS::String::string("skinVertices",NS::ASCIIStringEncoding)),
+      [](auto t) {t->release();}
+   };
+   ensure(function.get() != nullptr, "skinVertices not found in the skinning shader");
+
+   _pipeline = {
+      device->newComputePipelineState(function.get(), &error),
+      [](auto t) {t->release();}
+   };
+   ensure(_pipeline.get() != nullptr,
+      std::format("no skinning pipeline ->\n{}",
+               (error!=nullptr) ? error->localizedDescription()->utf8String():""));
+}
+
+auto SkinningPass::encode(MTL::ComputeCommandEncoder* const encoder, const Buffers& buffers,
+   const std::uint32_t vertex_count, const std::uint32_t joint_count, const std::uint32_t instance_count) const -> void {
+   struct {
+      std::uint32_t vertexCount;
+      std::uint32_t jointCount;
+   } const params{vertex_count, joint_count};
+
+   encoder->setComputePipelineState(_pipeline.get());
+   encoder->setBuffer(buffers.bind, buffers.bindOffset, 0);
+   encoder->setBuffer(buffers.skin, buffers.skinOffset, 1);
+   encoder->setBuffer(buffers.palettes, 0, 2);
+   encoder->setBuffer(buffers.skinned, buffers.skinnedOffset, 3);
+   encoder->setBytes(&params, sizeof(params), 4);
+
+   const auto width = std::min<NS::UInteger>(_pipeline->maxTotalThreadsPerThreadgroup(),
+      _pipeline->threadExecutionWidth() * 4);
+   encoder->dispatchThreads(MTL::Size{vertex_count, instance_count, 1}, MTL::Size{width, 1, 1});
+}
+
+}
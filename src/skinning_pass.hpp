@@ -0,0 +1,41 @@
+#ifndef GAME_TUTORIAL_SKINNING_PASS_HPP
+#define GAME_TUTORIAL_SKINNING_PASS_HPP
+
+#include <Metal/Metal.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#include "auto_release.hpp"
+
+namespace game {
+
+/// Skins on the GPU with skinning.metal. It reads the same palettes the
+/// cpu path writes (see SkinningInstance), packed per instance in a
+/// shared buffer, and writes the skinned vertices of every instance
+/// back to back.
+class SkinningPass {
+public:
+   SkinningPass(std::string_view shader, MTL::Device* device);
+
+   struct Buffers {
+      MTL::Buffer* bind;
+      size_t bindOffset;
+      MTL::Buffer* skin;
+      size_t skinOffset;
+      MTL::Buffer* palettes;
+      MTL::Buffer* skinned;
+      size_t skinnedOffset;
+   };
+
+   auto encode(MTL::ComputeCommandEncoder* encoder, const Buffers& buffers, std::uint32_t vertex_count,
+      std::uint32_t joint_count, std::uint32_t instance_count) const -> void;
+
+private:
+   AutoRelease<MTL::ComputePipelineState*> _pipeline{};
+};
+
+}
+
+#endif // GAME_TUTORIAL_SKINNING_PASS_HPP
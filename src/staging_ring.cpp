@@ -0,0 +1,70 @@
+#include "staging_ring.hpp"
+#include "error.hpp"
+
+namespace game {
+
+namespace {
+
+constexpr auto alignUp(const size_t value, const size_t alignment) -> size_t {
+   return (value + alignment - 1) / alignment * alignment;
+}
+
+}
+
+auto StagingRing::allocate(const size_t size, const size_t alignment) -> std::optional<size_t> {
+   ensure(alignment > 0, "staging allocations need a non zero alignment");
+   if (size == 0 or size > _capacity) {
+      return std::nullopt;
+   }
+   if (_used == 0) {
+      /// empty, start over to get the longest contiguous run
+      _head = _tail = 0;
+   } else if (_head == _tail) {
+      return std::nullopt;
+   }
+
+   const auto aligned = alignUp(_head, alignment);
+   auto offset = std::optional<size_t>{};
+   if (_head >= _tail) {
+      /// free space is [head, capacity) then [0, tail)
+      if (aligned + size <= _capacity) {
+         offset = aligned;
+      } else if (size <= _tail) {
+         /// wrap, the end of the buffer is wasted until this batch retires
+         _used += _capacity - _head;
+         _consumed += _capacity - _head;
+         _head = 0;
+         offset = 0;
+      }
+   } else if (aligned + size <= _tail) {
+      offset = aligned;
+   }
+   if (not offset) {
+      return std::nullopt;
+   }
+
+   const auto advance = *offset + size - _head;
+   _used += advance;
+   _consumed += advance;
+   _head = *offset + size;
+   if (_head == _capacity) {
+      _head = 0;
+   }
+   return offset;
+}
+
+auto StagingRing::close(const std::uint64_t batch) -> void {
+   ensure(_pending.empty() or _pending.back().batch < batch, "staging batches must be increasing");
+   _pending.push_back({batch, _head, _consumed});
+}
+
+auto StagingRing::retire(const std::uint64_t batch) -> void {
+   while (not _pending.empty() and _pending.front().batch <= batch) {
+      _tail = _pending.front().head;
+      _released = _pending.front().consumed;
+      _pending.pop_front();
+   }
+   _used = _consumed - _released;
+}
+
+}
@@ -0,0 +1,50 @@
+#ifndef GAME_TUTORIAL_STAGING_RING_HPP
+#define GAME_TUTORIAL_STAGING_RING_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <optional>
+
+namespace game {
+
+/// Ring allocator for a persistent staging buffer. Allocations are
+/// contiguous, an allocation that does not fit before the end wraps to the
+/// start and the skipped tail counts as used. Allocations are grouped in
+/// batches (one per GPU submission), a batch is freed as a whole once the
+/// GPU has consumed it. No memory is touched, only offsets are handed out.
+class StagingRing {
+public:
+   explicit StagingRing(size_t capacity) : _capacity(capacity) {}
+
+   /// nullopt when there is no room until older batches retire
+   [[nodiscard]] auto allocate(size_t size, size_t alignment) -> std::optional<size_t>;
+   /// everything allocated since the previous close belongs to batch,
+   /// batch values must increase
+   auto close(std::uint64_t batch) -> void;
+   /// frees every closed batch up to and including batch
+   auto retire(std::uint64_t batch) -> void;
+
+   [[nodiscard]] constexpr auto getCapacity() const -> size_t {return _capacity;}
+   [[nodiscard]] constexpr auto getUsed() const -> size_t {return _used;}
+
+private:
+   struct Pending {
+      std::uint64_t batch;
+      size_t head;
+      size_t consumed;
+   };
+
+   size_t _capacity;
+   size_t _head{0};
+   size_t _tail{0};
+   size_t _used{0};
+   /// bytes ever consumed (allocations and padding) and ever released
+   size_t _consumed{0};
+   size_t _released{0};
+   std::deque<Pending> _pending;
+};
+
+}
+
+#endif // GAME_TUTORIAL_STAGING_RING_HPP
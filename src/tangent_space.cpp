@@ -0,0 +1,121 @@
+#include "mesh_factory.hpp"
+#include "parallel_for.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+namespace game {
+
+namespace {
+
+constexpr size_t TRIANGLE_GRAIN = 8192;
+constexpr size_t VERTEX_GRAIN = 8192;
+constexpr float EPSILON = std::numeric_limits<float>::epsilon();
+
+/// tangent of a triangle corner, already projected on the corner normal
+/// and weighted by the corner angle, orientation carries the same weight
+/// with the sign of the uv mapping (negative for mirrored uvs)
+struct CornerTangent {
+   simd::float3 tangent;
+   float orientation;
+};
+
+auto projected(const simd::float3& v, const simd::float3& n) -> simd::float3 {
+   return v - n * simd::dot(n, v);
+}
+
+auto anyOrthogonal(const simd::float3& n) -> simd::float3 {
+   const auto axis = std::abs(n.x) < 0.9f ? simd::float3{1.0f,0.0f,0.0f} : simd::float3{0.0f,1.0f,0.0f};
+   return simd::normalize(simd::cross(n, axis));
+}
+
+auto safeNormalize(const simd::float3& v, const simd::float3& fallback) -> simd::float3 {
+   const auto length = simd::length(v);
+   return length > EPSILON ? v / length : fallback;
+}
+
+}
+
+/// Same construction as MikkTSpace: per triangle tangents from the uv
+/// gradients with magnitudes dropped, projected on the tangent plane of
+/// each vertex normal, weighted by the corner angle and flipped for
+/// mirrored uvs so that tangent always follows +u. The bitangent is
+/// rebuilt as sign * cross(normal, tangent). Unlike MikkTSpace vertices
+/// are never split, a vertex shared by mirrored and regular triangles
+/// takes the orientation of the larger total angle.
+auto MeshFactory::generateTangents(const std::span<VertexData> vertices,
+   const std::span<const std::uint32_t> indexes) -> void {
+   ensure(indexes.size() % 3 == 0,
+      "tangents can only be generated for triangle lists");
+   ensure(std::ranges::all_of(indexes, [&](const auto i) {return i < vertices.size();}),
+      "mesh indexes a vertex out of range");
+   const auto n_triangles = indexes.size() / 3;
+
+   auto corners = std::vector<CornerTangent>(indexes.size());
+   parallelFor(n_triangles, TRIANGLE_GRAIN, [&](const size_t begin, const size_t end) {
+      for (auto t = begin; t < end; ++t) {
+         const std::uint32_t idx[3] = {indexes[3 * t], indexes[3 * t + 1], indexes[3 * t + 2]};
+
+         const auto& v0 = vertices[idx[0]];
+         const auto& v1 = vertices[idx[1]];
+         const auto& v2 = vertices[idx[2]];
+         const auto e1 = v1.position.xyz - v0.position.xyz;
+         const auto e2 = v2.position.xyz - v0.position.xyz;
+         const auto d1 = v1.uv - v0.uv;
+         const auto d2 = v2.uv - v0.uv;
+         const auto signed_area = d1.x * d2.y - d1.y * d2.x;
+         const auto orientation = signed_area > 0.0f ? 1.0f : -1.0f;
+         const auto os = (e1 * d2.y - e2 * d1.y) * orientation;
+         const auto face_normal = safeNormalize(simd::cross(e1, e2), simd::float3{0.0f,0.0f,0.0f});
+         const auto degenerate = std::abs(signed_area) <= EPSILON or simd::length(os) <= EPSILON;
+
+         for (auto k = 0u; k < 3u; ++k) {
+            const auto& v = vertices[idx[k]];
+            const auto n = safeNormalize(v.normal, face_normal);
+            const auto to_next = safeNormalize(projected(vertices[idx[(k + 1) % 3]].position.xyz - v.position.xyz, n), n);
+            const auto to_prev = safeNormalize(projected(vertices[idx[(k + 2) % 3]].position.xyz - v.position.xyz, n), n);
+            const auto angle = std::acos(std::clamp(simd::dot(to_next, to_prev), -1.0f, 1.0f));
+            const auto weight = degenerate ? 0.0f : angle;
+            corners[3 * t + k] = CornerTangent{
+               .tangent = safeNormalize(projected(os, n), simd::float3{0.0f,0.0f,0.0f}) * weight,
+               .orientation = orientation * weight
+            };
+         }
+      }
+   });
+
+   /// vertex -> corners, so that every vertex is only written by one thread
+   auto offsets = std::vector<std::uint32_t>(vertices.size() + 1, 0u);
+   for (const auto i: indexes) {
+      ++offsets[i + 1];
+   }
+   std::inclusive_scan(offsets.begin(), offsets.end(), offsets.begin());
+   auto vertex_corners = std::vector<std::uint32_t>(indexes.size());
+   {
+      auto fill = std::vector<std::uint32_t>(offsets.begin(), offsets.end() - 1);
+      for (auto c = 0u; c < indexes.size(); ++c) {
+         vertex_corners[fill[indexes[c]]++] = c;
+      }
+   }
+
+   parallelFor(vertices.size(), VERTEX_GRAIN, [&](const size_t begin, const size_t end) {
+      for (auto v = begin; v < end; ++v) {
+         auto tangent = simd::float3{0.0f,0.0f,0.0f};
+         auto orientation = 0.0f;
+         for (auto c = offsets[v]; c < offsets[v + 1]; ++c) {
+            tangent += corners[vertex_corners[c]].tangent;
+            orientation += corners[vertex_corners[c]].orientation;
+         }
+         auto& vertex = vertices[v];
+         const auto n = safeNormalize(vertex.normal, simd::float3{0.0f,0.0f,1.0f});
+         const auto t = safeNormalize(projected(tangent, n), anyOrthogonal(n));
+         const auto sign = orientation < 0.0f ? -1.0f : 1.0f;
+         vertex.tangent = t;
+         vertex.bitangent = simd::cross(n, t) * sign;
+      }
+   });
+}
+
+}
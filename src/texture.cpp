@@ -1,75 +1,316 @@
 #include "texture.hpp"
 #include "error.hpp"
+#include "parallel_for.hpp"
 #include "utils.hpp"
 
-#define STB_IMAGE_IMPLEMENTATION
-#include "stb_image.h"
-
-#include <memory>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <print>
+#include <utility>
 
 namespace game {
 
+namespace {
+
+/// unorm, as the uncompressed textures: colour maps are not decoded to linear on sampling
+auto pixelFormat(const BlockFormat format) -> MTL::PixelFormat {
+   switch (format) {
+      case BlockFormat::BC4: return MTL::PixelFormatBC4_RUnorm;
+      case BlockFormat::BC5: return MTL::PixelFormatBC5_RGUnorm;
+      case BlockFormat::BC7: return MTL::PixelFormatBC7_RGBAUnorm;
+      case BlockFormat::ASTC4x4: default: return MTL::PixelFormatASTC_4x4_LDR;
+   }
+}
+
+/// levels [begin, end) of every slice of file into texture, whose first level is first_level of file
+auto uploadLevels(MTL::Texture* const texture, const TextureFile& file, const size_t first_level,
+   const size_t begin, const size_t end, UploadManager& uploads) -> void {
+   for (auto level = begin; level < end; ++level) {
+      const auto width = TextureFile::levelWidth(file.width(), level);
+      const auto height = TextureFile::levelWidth(file.height(), level);
+      for (auto slice = size_t{0}; slice < file.slices(); ++slice) {
+         uploads.upload(texture, static_cast<std::uint32_t>(slice), static_cast<std::uint32_t>(level - first_level),
+            MTL::Region{0, 0, 0, width, height, 1}, file.bytesPerRow(level), file.image(level, slice));
+      }
+   }
+}
+
+auto ensureSampleable(MTL::Device* const device, const BlockFormat format) -> void {
+   ensure(format == BlockFormat::ASTC4x4 ? device->supportsFamily(MTL::GPUFamilyApple2)
+                                         : device->supportsBCTextureCompression(),
+      "the device cannot sample this block format");
+}
+
+}
+
+auto arraySize(const std::span<const std::span<const std::byte>> encoded, const TextureQuality quality) -> ImageSize {
+   auto sizes = std::vector<ImageSize>{};
+   sizes.reserve(encoded.size());
+   for (const auto& image: encoded) {
+      sizes.push_back(imageSize(image));
+   }
+   return arraySize(sizes, quality);
+}
+
+auto uploadLayers(MTL::Texture* const texture, const std::span<const std::span<const std::byte>> encoded,
+   const ColorSpace space, UploadManager& uploads) -> void {
+   struct Timing {
+      double decode{0.0};
+      double resize{0.0};
+      double upload{0.0};
+   };
+   auto timings = std::vector<Timing>(encoded.size());
+   const auto width = static_cast<std::uint32_t>(texture->width());
+   const auto height = static_cast<std::uint32_t>(texture->height());
+
+   /// one layer per task, each goes to the GPU without waiting for the others
+   parallelFor(encoded.size(), 1, [&](const size_t begin, const size_t end) {
+      for (auto index = begin; index < end; ++index) {
+         const auto start = std::chrono::steady_clock::now();
+         const auto slice = static_cast<std::uint32_t>(index);
+         const auto region = MTL::Region{0, 0, 0, width, height, 1};
+         if (imageSize(encoded[index]) == ImageSize{width, height}) {
+            /// decoded where the GPU copies from, no pixels of its own and no copy into staging
+            auto reservation = uploads.reserve(texture, slice, 0, region, size_t{width} * 4);
+            (void)decodeImage(encoded[index], reservation.memory());
+            const auto decode_end = std::chrono::steady_clock::now();
+            uploads.commit(std::move(reservation));
+            const auto uploaded = std::chrono::steady_clock::now();
+            timings[index] = {
+               std::chrono::duration<double, std::milli>(decode_end - start).count(),
+               0.0,
+               std::chrono::duration<double, std::milli>(uploaded - decode_end).count()
+            };
+            continue;
+         }
+
+         auto layer = decodeImage(encoded[index]);
+         const auto decode_end = std::chrono::steady_clock::now();
+         /// the stride and the region are the ones of the texture, whatever the image was
+         layer = resizeImage(layer, width, height, MipFilter::Mitchell, space);
+         const auto resize_end = std::chrono::steady_clock::now();
+         uploads.upload(texture, slice, 0, region, layer.bytesPerRow(), layer.pixels);
+         const auto uploaded = std::chrono::steady_clock::now();
+         timings[index] = {
+            std::chrono::duration<double, std::milli>(decode_end - start).count(),
+            std::chrono::duration<double, std::milli>(resize_end - decode_end).count(),
+            std::chrono::duration<double, std::milli>(uploaded - resize_end).count()
+         };
+      }
+   });
+   /// the only point where the layers meet
+   uploads.generateMipmaps(texture);
+
+   for (const auto& [index, timing]: ::enumerate(timings)) {
+      std::println("texture layer {}: decoded in {:.2f} ms, resized in {:.2f} ms, staged in {:.2f} ms",
+         index, timing.decode, timing.resize, timing.upload);
+   }
+}
+
+auto pixelFormat(MTL::Device* const device, const TextureFileFormat format) -> MTL::PixelFormat {
+   if (format == TextureFileFormat::RGBA8) {
+      return MTL::PixelFormatRGBA8Unorm;
+   }
+   if (format == TextureFileFormat::RGBA16F) {
+      return MTL::PixelFormatRGBA16Float;
+   }
+   ensureSampleable(device, blockFormat(format));
+   return pixelFormat(blockFormat(format));
+}
+
+auto uploadTextureFile(MTL::Texture* const texture, const TextureFile& file, UploadManager& uploads) -> void {
+   ensure(texture->width() == file.width() and texture->height() == file.height()
+      and texture->mipmapLevelCount() == file.levelCount()
+      and texture->arrayLength() * (texture->textureType() == MTL::TextureTypeCube
+         or texture->textureType() == MTL::TextureTypeCubeArray ? 6 : 1) == file.slices(),
+      std::format("a texture file of {}x{} with {} levels and {} slices does not fit the texture",
+         file.width(), file.height(), file.levelCount(), file.slices()));
+   uploadLevels(texture, file, 0, 0, file.levelCount(), uploads);
+}
+
 Texture::Texture(const std::vector<std::vector<std::byte>>& datavec,
-   const size_t width,
-   const size_t height,
-   MTL::Device * device) {
+   const ColorSpace space,
+   MTL::Device * device,
+   UploadManager& uploads,
+   const TextureQuality quality) {
+   const auto encoded = std::vector<std::span<const std::byte>>(datavec.begin(), datavec.end());
+   const auto size = arraySize(encoded, quality);
+   _texture = {
+      _create(device, MTL::PixelFormatRGBA8Unorm, size.width, size.height, datavec.size()),
+      [](auto t) {return t;}
+   };
+   uploadLayers(_texture.get(), encoded, space, uploads);
+}
 
-   auto w = static_cast<int>(width);
-   auto h = static_cast<int>(height);
-   auto num_channels = int{4};
+Texture::Texture(const std::span<const Image> layers,
+   const ColorSpace space,
+   MTL::Device * device,
+   UploadManager& uploads,
+   const TextureQuality quality) {
+   ensure(not layers.empty(), "a texture needs at least one layer");
+   auto sizes = std::vector<ImageSize>{};
+   for (const auto& layer: layers) {
+      sizes.push_back({layer.width, layer.height});
+   }
+   const auto size = arraySize(sizes, quality);
 
-   const auto textureDescriptor = AutoRelease<MTL::TextureDescriptor*>{
-      MTL::TextureDescriptor::alloc()->init(),
-      [](auto t) {t->release();}
+   _texture = {
+      _create(device, MTL::PixelFormatRGBA8Unorm, size.width, size.height, layers.size()),
+      [](auto t) {return t;}
    };
-   const auto mipLevels = static_cast<size_t>(std::floor(std::log2(std::max(width,height)))+1);
-   textureDescriptor->setArrayLength(datavec.size());
-   textureDescriptor->setWidth(w);
-   textureDescriptor->setHeight(h);
-   textureDescriptor->setTextureType(MTL::TextureType2DArray);
-   textureDescriptor->setPixelFormat(MTL::PixelFormatRGBA8Unorm);
-   textureDescriptor->setUsage(MTL::TextureUsageShaderRead | MTL::TextureUsageRenderTarget);
-   textureDescriptor->setStorageMode(MTL::StorageModeShared);
-   textureDescriptor->setMipmapLevelCount(mipLevels);
+   for (const auto &[index, layer]: ::enumerate(layers)) {
+      const auto region = MTL::Region{0, 0, 0, size.width, size.height, 1};
+      if (layer.width == size.width and layer.height == size.height) {
+         uploads.upload(_texture.get(), static_cast<std::uint32_t>(index), 0, region, layer.bytesPerRow(),
+            layer.pixels);
+      } else {
+         const auto resized = resizeImage(layer, size.width, size.height, MipFilter::Mitchell, space);
+         uploads.upload(_texture.get(), static_cast<std::uint32_t>(index), 0, region, resized.bytesPerRow(),
+            resized.pixels);
+      }
+   }
+   /// once, after every layer is in
+   uploads.generateMipmaps(_texture.get());
+}
+
+Texture::Texture(const std::span<const MipChain> layers,
+   MTL::Device * device,
+   UploadManager& uploads) {
+   ensure(not layers.empty() and not layers.front().levels.empty(), "a texture needs at least one layer");
+   const auto width = size_t{layers.front().levels.front().width};
+   const auto height = size_t{layers.front().levels.front().height};
+   _texture = {
+      _create(device, MTL::PixelFormatRGBA8Unorm, width, height, layers.size()),
+      [](auto t) {return t;}
+   };
+   for (const auto &[index, layer]: ::enumerate(layers)) {
+      ensure(layer.levels.size() == _texture->mipmapLevelCount() and layer.levels.front().width == width
+         and layer.levels.front().height == height,
+         std::format("texture layer of {} levels, expected {}x{} and {} levels",
+            layer.levels.size(), width, height, _texture->mipmapLevelCount()));
+      for (const auto &[level, image]: ::enumerate(layer.levels)) {
+         uploads.upload(_texture.get(), static_cast<std::uint32_t>(index), static_cast<std::uint32_t>(level),
+            MTL::Region{0, 0, 0, image.width, image.height, 1}, image.bytesPerRow(), image.pixels);
+      }
+   }
+}
 
+Texture::Texture(const std::span<const CompressedChain> layers,
+   MTL::Device * device,
+   UploadManager& uploads) {
+   ensure(not layers.empty(), "a texture needs at least one layer");
+   const auto format = layers.front().format;
+   const auto width = size_t{layers.front().width};
+   const auto height = size_t{layers.front().height};
+   ensureSampleable(device, format);
    _texture = {
-      device->newTexture(textureDescriptor.get()),
+      _create(device, pixelFormat(format), width, height, layers.size()),
       [](auto t) {return t;}
    };
+   for (const auto &[index, layer]: ::enumerate(layers)) {
+      ensure(layer.format == format and layer.width == width and layer.height == height
+         and layer.levels.size() == _texture->mipmapLevelCount(),
+         std::format("texture layer is {}x{} with {} levels, expected {}x{} with {}",
+            layer.width, layer.height, layer.levels.size(), width, height, _texture->mipmapLevelCount()));
+      for (const auto &[level, blocks]: ::enumerate(layer.levels)) {
+         const auto level_width = std::max<size_t>(width >> level, 1);
+         const auto level_height = std::max<size_t>(height >> level, 1);
+         ensure(blocks.size() == compressedSize(format, level_width, level_height),
+            std::format("level {} of texture layer {} has {} bytes of blocks", level, index, blocks.size()));
+         /// rows of blocks, the region is in texels
+         uploads.upload(_texture.get(), static_cast<std::uint32_t>(index), static_cast<std::uint32_t>(level),
+            MTL::Region{0, 0, 0, level_width, level_height, 1}, (level_width + 3) / 4 * blockBytes(format), blocks);
+      }
+   }
+}
 
-   const AutoRelease<MTL::CommandQueue*> commandQueue = {
-      device->newCommandQueue(),
+Texture::Texture(const TextureFile& file,
+   MTL::Device * device,
+   UploadManager& uploads) {
+   _texture = {
+      _create(device, pixelFormat(device, file.format()), file.width(), file.height(), file.layers(), file.faces()),
+      [](auto t) {return t;}
+   };
+   uploadTextureFile(_texture.get(), file, uploads);
+}
+
+Texture::Texture(TextureFile file,
+   const size_t first_level,
+   MTL::Device * device,
+   UploadManager& uploads)
+   : _file(std::move(file)), _device(device), _residentLevel(first_level) {
+   ensure(_file->faces() == 1, "a texture file of cube maps is not a texture array");
+   ensure(first_level < _file->levelCount(),
+      std::format("no level {} in a texture file of {} levels", first_level, _file->levelCount()));
+   _texture = {
+      _create(device, pixelFormat(device, _file->format()), TextureFile::levelWidth(_file->width(), first_level),
+         TextureFile::levelWidth(_file->height(), first_level), _file->layers()),
       [](auto t) {t->release();}
    };
+   uploadLevels(_texture.get(), *_file, first_level, first_level, _file->levelCount(), uploads);
+}
 
-   AutoRelease<MTL::CommandBuffer*> commandBuffer = {
-      commandQueue->commandBuffer(),
+auto Texture::setResidentLevel(const size_t level, UploadManager& uploads) -> void {
+   ensure(_file.has_value(), "only streamed textures change their resident levels");
+   ensure(level < _file->levelCount(),
+      std::format("no level {} in a texture file of {} levels", level, _file->levelCount()));
+   /// a replacement still copying has the newest levels, the copies run in order
+   const auto& current = _next ? _next : _texture;
+   const auto current_level = _next ? _nextLevel : _residentLevel;
+   if (level == current_level) {
+      return;
+   }
+
+   auto next = AutoRelease<MTL::Texture*,{}>{
+      _create(_device, current->pixelFormat(), TextureFile::levelWidth(_file->width(), level),
+         TextureFile::levelWidth(_file->height(), level), _file->layers()),
       [](auto t) {t->release();}
    };
+   const auto shared = std::max(level, current_level);
+   uploads.copy(current.get(), static_cast<std::uint32_t>(shared - current_level), next.get(),
+      static_cast<std::uint32_t>(shared - level), static_cast<std::uint32_t>(_file->levelCount() - shared));
+   uploadLevels(next.get(), *_file, level, level, current_level, uploads);
+   /// the command buffer holds on to a replacement dropped before it is done
+   _nextBatch = uploads.flush();
+   _next = std::move(next);
+   _nextLevel = level;
+}
 
-   for (const auto &[index, data]: ::enumerate(datavec)) {
-      const auto raw_data = std::unique_ptr<::stbi_uc,void (*)(void*)>(
-         ::stbi_load_from_memory(
-            reinterpret_cast<const ::stbi_uc*> (data.data()),
-            static_cast<int>(data.size()),
-            &w, &h, &num_channels,STBI_rgb_alpha),
-         ::stbi_image_free);
-
-      ensure(raw_data!=nullptr,
-         "Could not read texture");
-
-      const auto region = MTL::Region{0, 0, 0, width, height, 1};
-      const NS::UInteger bytesPerRow = 4 * width;
-      _texture->replaceRegion(region, 0, index, raw_data.get(), bytesPerRow,0);
-      const AutoRelease<MTL::BlitCommandEncoder*> blitEncoder = {
-         commandBuffer->blitCommandEncoder(),
-         [](auto t) {t->release();}
-      };
-      blitEncoder->generateMipmaps(_texture.get());
-      blitEncoder->endEncoding();
+auto Texture::poll(const UploadManager& uploads) -> bool {
+   if (not _next or not uploads.isComplete(_nextBatch)) {
+      return false;
    }
-   commandBuffer->commit();
-   commandBuffer->waitUntilCompleted();
+   _texture = std::move(_next);
+   _residentLevel = _nextLevel;
+   return true;
 }
 
-}
\ No newline at end of file
+auto Texture::_create(MTL::Device* const device, const MTL::PixelFormat format, const size_t width, const size_t height,
+   const size_t layers, const size_t faces) -> MTL::Texture* {
+   ensure(layers > 0, "a texture needs at least one layer");
+   ensure(faces == 1 or faces == 6, std::format("a texture has 1 face or 6, not {}", faces));
+   const auto textureDescriptor = AutoRelease<MTL::TextureDescriptor*>{
+      MTL::TextureDescriptor::alloc()->init(),
+      [](auto t) {t->release();}
+   };
+   const auto mipLevels = static_cast<size_t>(std::floor(std::log2(std::max(width,height)))+1);
+   textureDescriptor->setArrayLength(layers);
+   textureDescriptor->setWidth(width);
+   textureDescriptor->setHeight(height);
+   /// the array length of a cube array counts cubes, not faces
+   textureDescriptor->setTextureType(faces == 1 ? MTL::TextureType2DArray
+      : layers == 1 ? MTL::TextureTypeCube : MTL::TextureTypeCubeArray);
+   textureDescriptor->setPixelFormat(format);
+   /// generating mipmaps renders into the levels, block formats come with theirs
+   textureDescriptor->setUsage(format == MTL::PixelFormatRGBA8Unorm
+      ? MTL::TextureUsageShaderRead | MTL::TextureUsageRenderTarget : MTL::TextureUsageShaderRead);
+   textureDescriptor->setStorageMode(MTL::StorageModePrivate);
+   textureDescriptor->setMipmapLevelCount(mipLevels);
+
+   const auto texture = device->newTexture(textureDescriptor.get());
+   ensure(texture != nullptr, "could not create the texture");
+   return texture;
+}
+
+}
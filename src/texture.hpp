@@ -4,21 +4,92 @@
 #include <Metal/Metal.hpp>
 
 #include <cstddef>
+#include <cstdint>
+#include <optional>
 #include <span>
+#include <vector>
 
 #include "auto_release.hpp"
+#include "block_compression.hpp"
+#include "image.hpp"
+#include "mip_chain.hpp"
+#include "texture_file.hpp"
+#include "upload_manager.hpp"
 
 namespace game {
 
+/// the size a texture of the encoded images is created at, see arraySize()
+[[nodiscard]] auto arraySize(std::span<const std::span<const std::byte>> encoded, TextureQuality quality) -> ImageSize;
+/// Decodes each encoded image on a worker thread and uploads it to its
+/// slice of texture as soon as it is decoded; the mipmaps are generated
+/// once, after every slice is in. An image of another size than texture
+/// is resized to it first, with the Mitchell filter in space, the one the
+/// images are encoded in. Prints the decode, resize and upload time of
+/// every slice.
+auto uploadLayers(MTL::Texture* texture, std::span<const std::span<const std::byte>> encoded, ColorSpace space,
+   UploadManager& uploads) -> void;
+
+/// the pixel format levels of a texture file go to the GPU as; throws if
+/// the device cannot sample it
+[[nodiscard]] auto pixelFormat(MTL::Device* device, TextureFileFormat format) -> MTL::PixelFormat;
+/// Copies every level of every slice of file straight from its mapping,
+/// nothing is decoded or generated. Slices are array layers, cube faces
+/// or both, as texture was created for.
+auto uploadTextureFile(MTL::Texture* texture, const TextureFile& file, UploadManager& uploads) -> void;
+
 class Texture {
 public:
-   Texture(const std::vector<std::vector<std::byte>>& datavec, size_t width,
-      size_t height, MTL::Device * device);
+   /// private storage, the layers are decoded concurrently (see
+   /// uploadLayers) and the texture is usable once uploads has been flushed;
+   /// as large as the largest image, scaled down for lower qualities
+   Texture(const std::vector<std::vector<std::byte>>& datavec, ColorSpace space, MTL::Device * device,
+      UploadManager& uploads, TextureQuality quality = TextureQuality::High);
+   /// one layer per image, already decoded (see AssetImporter); sized as
+   /// above, the images of another size are resized with the Mitchell
+   /// filter in space
+   Texture(std::span<const Image> layers, ColorSpace space, MTL::Device * device, UploadManager& uploads,
+      TextureQuality quality = TextureQuality::High);
+   /// one layer per chain, with the levels built on the CPU (see
+   /// buildMipChain): every level is uploaded, nothing is generated
+   Texture(std::span<const MipChain> layers, MTL::Device * device, UploadManager& uploads);
+   /// one layer per chain, all in the same block format (see
+   /// compressMipChain); throws if the device cannot sample it
+   Texture(std::span<const CompressedChain> layers, MTL::Device * device, UploadManager& uploads);
+   /// every layer and level as baked in file (see uploadTextureFile), which
+   /// is not needed once the constructor returns; a cube, or cube array,
+   /// when file has six faces
+   Texture(const TextureFile& file, MTL::Device * device, UploadManager& uploads);
+   /// streamed from file, which the texture keeps: created with
+   /// first_level and the levels below it only, see setResidentLevel()
+   Texture(TextureFile file, size_t first_level, MTL::Device * device, UploadManager& uploads);
 
+   /// the texture to bind: all of its levels are valid
    [[nodiscard]] auto getTexture() const -> MTL::Texture* {return _texture.get();}
 
+   /// Streamed textures only. Replaces the texture with one whose first
+   /// level is level of the file: the levels both have are copied on the
+   /// GPU, the others are uploaded from the file. getTexture() stays on
+   /// the current texture until poll() finds the copies done, so sampling
+   /// is clamped to the levels that are there and never waits.
+   auto setResidentLevel(size_t level, UploadManager& uploads) -> void;
+   /// swaps in the replacement once its copies are done, true when it did
+   auto poll(const UploadManager& uploads) -> bool;
+   /// the level of the file getTexture() starts at
+   [[nodiscard]] constexpr auto residentLevel() const -> size_t {return _residentLevel;}
+
 private:
+   static auto _create(MTL::Device* device, MTL::PixelFormat format, size_t width, size_t height,
+      size_t layers, size_t faces = 1) -> MTL::Texture*;
+
    AutoRelease<MTL::Texture*,{}> _texture;
+   /// what streamed textures stream from
+   std::optional<TextureFile> _file;
+   MTL::Device* _device{nullptr};
+   size_t _residentLevel{0};
+   /// the replacement while its copies run
+   AutoRelease<MTL::Texture*,{}> _next;
+   size_t _nextLevel{0};
+   std::uint64_t _nextBatch{0};
 };
 
 }
@@ -0,0 +1,172 @@
+#include "texture_file.hpp"
+#include "error.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+namespace game {
+
+namespace {
+
+constexpr size_t LEVEL_ALIGNMENT = 16;
+
+auto aligned(const size_t offset) -> size_t {
+   return (offset + LEVEL_ALIGNMENT - 1) / LEVEL_ALIGNMENT * LEVEL_ALIGNMENT;
+}
+
+auto isBlockFormat(const TextureFileFormat format) -> bool {
+   return format != TextureFileFormat::RGBA8 and format != TextureFileFormat::RGBA16F;
+}
+
+auto texelBytes(const TextureFileFormat format) -> size_t {
+   return format == TextureFileFormat::RGBA16F ? 8 : 4;
+}
+
+/// writes the header, the level table and the levels, level by level
+/// and slice by slice as image(level, slice) hands them out
+auto writeFile(const std::filesystem::path& path, TextureFileHeader header, auto&& image) -> void {
+   auto levels = std::vector<TextureFileLevel>(header.levelCount);
+   auto offset = aligned(sizeof(TextureFileHeader) + levels.size() * sizeof(TextureFileLevel));
+   const auto slices = size_t{header.layers} * header.faces;
+   for (auto i = size_t{0}; i < levels.size(); ++i) {
+      const auto size = TextureFile::imageSize(header.format, TextureFile::levelWidth(header.width, i),
+         TextureFile::levelWidth(header.height, i)) * slices;
+      levels[i] = TextureFileLevel{.offset = offset, .size = size};
+      offset = aligned(offset + size);
+   }
+
+   /// the header is written last so that an interrupted write never
+   /// looks like a valid texture file
+   std::ofstream file{path, std::ios::binary | std::ios::trunc};
+   ensure(file.is_open(), std::format("could not create {}", path.string()));
+   const auto blank = TextureFileHeader{.magic = 0, .version = 0, .stamp = 0, .format = TextureFileFormat::RGBA8,
+      .width = 0, .height = 0, .layers = 0, .faces = 0, .levelCount = 0};
+   file.write(reinterpret_cast<const char*>(&blank), sizeof(blank));
+   file.write(reinterpret_cast<const char*>(levels.data()),
+      static_cast<std::streamsize>(levels.size() * sizeof(TextureFileLevel)));
+   for (auto i = size_t{0}; i < levels.size(); ++i) {
+      file.seekp(static_cast<std::streamoff>(levels[i].offset));
+      for (auto slice = size_t{0}; slice < slices; ++slice) {
+         const std::span<const std::byte> bytes = image(i, slice);
+         ensure(bytes.size() * slices == levels[i].size,
+            std::format("level {} of slice {} does not fit {}", i, slice, path.string()));
+         file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+      }
+   }
+   file.seekp(0);
+   file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+   file.close();
+   ensure(not file.fail(), std::format("could not write {}", path.string()));
+}
+
+/// every slice is the same size with a full mip chain
+auto checkSlices(const auto slices, const std::uint32_t faces, auto&& extent) -> void {
+   ensure(not slices.empty() and faces != 0 and slices.size() % faces == 0,
+      std::format("{} slices do not make whole layers of {} faces", slices.size(), faces));
+   const auto [width, height, levels] = extent(slices.front());
+   ensure(width != 0 and height != 0 and levels == static_cast<size_t>(std::bit_width(std::max(width, height))),
+      "texture files hold whole mip chains");
+   ensure(std::ranges::all_of(slices, [&](const auto& slice) {return extent(slice) == extent(slices.front());}),
+      "every slice of a texture file has the same size");
+}
+
+}
+
+auto TextureFile::bytesPerRow(const TextureFileFormat format, const size_t width) -> size_t {
+   return isBlockFormat(format) ? (width + 3) / 4 * blockBytes(blockFormat(format)) : width * texelBytes(format);
+}
+
+auto TextureFile::imageSize(const TextureFileFormat format, const size_t width, const size_t height) -> size_t {
+   return bytesPerRow(format, width) * (isBlockFormat(format) ? (height + 3) / 4 : height);
+}
+
+auto TextureFile::image(const size_t level, const size_t slice) const -> std::span<const std::byte> {
+   ensure(level < levelCount() and slice < slices(),
+      std::format("no level {} of slice {} in a texture file of {} levels and {} slices",
+         level, slice, levelCount(), slices()));
+   TextureFileLevel entry;
+   std::memcpy(&entry, _file->data() + sizeof(TextureFileHeader) + level * sizeof(TextureFileLevel), sizeof(entry));
+   const auto size = entry.size / slices();
+   return {_file->data() + entry.offset + slice * size, size};
+}
+
+auto TextureFile::bytesPerRow(const size_t level) const -> size_t {
+   return bytesPerRow(format(), levelWidth(width(), level));
+}
+
+auto TextureFile::open(const std::filesystem::path& path, const std::uint64_t stamp) -> std::optional<TextureFile> {
+   if (not std::filesystem::exists(path)) {
+      return std::nullopt;
+   }
+   auto file = std::make_shared<MappedFile>(MappedFile::open(path));
+   if (file->size() < sizeof(TextureFileHeader)) {
+      return std::nullopt;
+   }
+   TextureFileHeader h;
+   std::memcpy(&h, file->data(), sizeof(h));
+   if (h.magic != TextureFileHeader::MAGIC or h.version != TextureFileHeader::VERSION or h.stamp != stamp or
+      h.format > TextureFileFormat::RGBA16F or h.width == 0 or h.height == 0 or h.layers == 0 or h.faces == 0 or
+      h.levelCount != static_cast<std::uint32_t>(std::bit_width(std::max(h.width, h.height))) or
+      file->size() < sizeof(TextureFileHeader) + h.levelCount * sizeof(TextureFileLevel)) {
+      return std::nullopt;
+   }
+
+   /// every level where the header says, and large enough for its slices
+   for (auto i = size_t{0}; i < h.levelCount; ++i) {
+      TextureFileLevel level;
+      std::memcpy(&level, file->data() + sizeof(TextureFileHeader) + i * sizeof(TextureFileLevel), sizeof(level));
+      const auto size = imageSize(h.format, levelWidth(h.width, i), levelWidth(h.height, i)) * h.layers * h.faces;
+      if (level.size != size or level.offset % LEVEL_ALIGNMENT != 0 or level.offset > file->size() or
+         level.size > file->size() - level.offset) {
+         return std::nullopt;
+      }
+   }
+   return TextureFile{std::move(file), h};
+}
+
+auto TextureFile::write(const std::filesystem::path& path, const std::uint64_t stamp,
+   const std::span<const MipChain> slices, const std::uint32_t faces) -> void {
+   checkSlices(slices, faces, [](const MipChain& chain) {
+      ensure(not chain.levels.empty(), "cannot write an empty mip chain");
+      return std::tuple{size_t{chain.levels.front().width}, size_t{chain.levels.front().height}, chain.levels.size()};
+   });
+   const auto& base = slices.front().levels.front();
+   writeFile(path, TextureFileHeader{.magic = TextureFileHeader::MAGIC, .version = TextureFileHeader::VERSION,
+      .stamp = stamp, .format = TextureFileFormat::RGBA8, .width = base.width, .height = base.height,
+      .layers = static_cast<std::uint32_t>(slices.size() / faces), .faces = faces,
+      .levelCount = static_cast<std::uint32_t>(slices.front().levels.size())},
+      [&](const size_t level, const size_t slice) {return std::span<const std::byte>{slices[slice].levels[level].pixels};});
+}
+
+auto TextureFile::write(const std::filesystem::path& path, const std::uint64_t stamp,
+   const std::span<const CompressedChain> slices, const std::uint32_t faces) -> void {
+   checkSlices(slices, faces, [](const CompressedChain& chain) {
+      return std::tuple{size_t{chain.width}, size_t{chain.height}, chain.levels.size()};
+   });
+   ensure(std::ranges::all_of(slices, [&](const auto& slice) {return slice.format == slices.front().format;}),
+      "every slice of a texture file has the same format");
+   const auto& first = slices.front();
+   writeFile(path, TextureFileHeader{.magic = TextureFileHeader::MAGIC, .version = TextureFileHeader::VERSION,
+      .stamp = stamp, .format = fileFormat(first.format), .width = first.width, .height = first.height,
+      .layers = static_cast<std::uint32_t>(slices.size() / faces), .faces = faces,
+      .levelCount = static_cast<std::uint32_t>(first.levels.size())},
+      [&](const size_t level, const size_t slice) {return std::span<const std::byte>{slices[slice].levels[level]};});
+}
+
+auto TextureFile::write(const std::filesystem::path& path, const std::uint64_t stamp,
+   const std::span<const HalfChain> slices, const std::uint32_t faces) -> void {
+   checkSlices(slices, faces, [](const HalfChain& chain) {
+      return std::tuple{size_t{chain.width}, size_t{chain.height}, chain.levels.size()};
+   });
+   const auto& first = slices.front();
+   writeFile(path, TextureFileHeader{.magic = TextureFileHeader::MAGIC, .version = TextureFileHeader::VERSION,
+      .stamp = stamp, .format = TextureFileFormat::RGBA16F, .width = first.width, .height = first.height,
+      .layers = static_cast<std::uint32_t>(slices.size() / faces), .faces = faces,
+      .levelCount = static_cast<std::uint32_t>(first.levels.size())},
+      [&](const size_t level, const size_t slice) {return std::as_bytes(std::span{slices[slice].levels[level]});});
+}
+
+}
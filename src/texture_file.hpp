@@ -0,0 +1,119 @@
+#ifndef GAME_TUTORIAL_TEXTURE_FILE_HPP
+#define GAME_TUTORIAL_TEXTURE_FILE_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <span>
+
+#include "block_compression.hpp"
+#include "environment_map.hpp"
+#include "mapped_file.hpp"
+#include "mip_chain.hpp"
+
+namespace game {
+
+/// what the levels of a texture file hold, as the GPU samples them
+enum class TextureFileFormat : std::uint32_t {
+   RGBA8,
+   BC4,
+   BC5,
+   BC7,
+   ASTC4x4,
+   /// RGBA half floats, for HDR cube maps
+   RGBA16F
+};
+
+[[nodiscard]] constexpr auto fileFormat(const BlockFormat format) -> TextureFileFormat {
+   switch (format) {
+      case BlockFormat::BC4: return TextureFileFormat::BC4;
+      case BlockFormat::BC5: return TextureFileFormat::BC5;
+      case BlockFormat::BC7: return TextureFileFormat::BC7;
+      case BlockFormat::ASTC4x4: default: return TextureFileFormat::ASTC4x4;
+   }
+}
+
+/// RGBA8 and RGBA16F are not block formats, they have to be checked for first
+[[nodiscard]] constexpr auto blockFormat(const TextureFileFormat format) -> BlockFormat {
+   switch (format) {
+      case TextureFileFormat::BC4: return BlockFormat::BC4;
+      case TextureFileFormat::BC5: return BlockFormat::BC5;
+      case TextureFileFormat::BC7: return BlockFormat::BC7;
+      case TextureFileFormat::ASTC4x4: default: return BlockFormat::ASTC4x4;
+   }
+}
+
+/// On disk layout of a texture file, in the spirit of KTX2: the header,
+/// one TextureFileLevel per mip level, then the levels in their final
+/// GPU format. A level holds the image of every slice one after the
+/// other, slices are layers times faces with the faces of a layer
+/// together. Levels start on 16 byte boundaries, a whole block.
+struct TextureFileHeader {
+   static constexpr std::uint32_t MAGIC = 0x58455447; // "GTEX"
+   static constexpr std::uint32_t VERSION = 1;
+
+   std::uint32_t magic{MAGIC};
+   std::uint32_t version{VERSION};
+   std::uint64_t stamp{0};
+   TextureFileFormat format{TextureFileFormat::RGBA8};
+   std::uint32_t width{0};
+   std::uint32_t height{0};
+   std::uint32_t layers{0};
+   /// 6 for cube maps, 1 otherwise
+   std::uint32_t faces{0};
+   std::uint32_t levelCount{0};
+};
+
+struct TextureFileLevel {
+   std::uint64_t offset{0};
+   std::uint64_t size{0};
+};
+
+/// A texture file mapped in memory; levels are handed out as views of
+/// the mapping, ready to be copied to the GPU.
+class TextureFile {
+public:
+   /// nullopt when the file is missing, not a texture file or built from another source
+   [[nodiscard]] static auto open(const std::filesystem::path& path, std::uint64_t stamp) -> std::optional<TextureFile>;
+
+   /// one slice per chain, every chain with all its levels
+   static auto write(const std::filesystem::path& path, std::uint64_t stamp, std::span<const MipChain> slices,
+      std::uint32_t faces) -> void;
+   static auto write(const std::filesystem::path& path, std::uint64_t stamp, std::span<const CompressedChain> slices,
+      std::uint32_t faces) -> void;
+   static auto write(const std::filesystem::path& path, std::uint64_t stamp, std::span<const HalfChain> slices,
+      std::uint32_t faces) -> void;
+
+   /// what it was built from, as passed to write()
+   [[nodiscard]] constexpr auto stamp() const -> std::uint64_t {return _header.stamp;}
+   [[nodiscard]] constexpr auto format() const -> TextureFileFormat {return _header.format;}
+   [[nodiscard]] constexpr auto width() const -> size_t {return _header.width;}
+   [[nodiscard]] constexpr auto height() const -> size_t {return _header.height;}
+   [[nodiscard]] constexpr auto layers() const -> size_t {return _header.layers;}
+   [[nodiscard]] constexpr auto faces() const -> size_t {return _header.faces;}
+   [[nodiscard]] constexpr auto slices() const -> size_t {return size_t{_header.layers} * _header.faces;}
+   [[nodiscard]] constexpr auto levelCount() const -> size_t {return _header.levelCount;}
+
+   [[nodiscard]] static auto levelWidth(size_t width, size_t level) -> size_t {return std::max<size_t>(width >> level, 1);}
+   /// rows of texels, or of blocks for block formats
+   [[nodiscard]] static auto bytesPerRow(TextureFileFormat format, size_t width) -> size_t;
+   [[nodiscard]] static auto imageSize(TextureFileFormat format, size_t width, size_t height) -> size_t;
+
+   /// the image of one slice at one level
+   [[nodiscard]] auto image(size_t level, size_t slice) const -> std::span<const std::byte>;
+   [[nodiscard]] auto bytesPerRow(size_t level) const -> size_t;
+
+private:
+   TextureFile(std::shared_ptr<MappedFile> file, const TextureFileHeader& header)
+      : _file(std::move(file)), _header(header) {}
+
+   std::shared_ptr<MappedFile> _file;
+   TextureFileHeader _header;
+};
+
+}
+
+#endif // GAME_TUTORIAL_TEXTURE_FILE_HPP
@@ -0,0 +1,86 @@
+#ifndef GAME_TUTORIAL_THREAD_POOL_HPP
+#define GAME_TUTORIAL_THREAD_POOL_HPP
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace game {
+
+/// A fixed set of worker threads taking tasks first in, first out.
+/// Unlike parallelFor, which splits one loop and returns when it is done,
+/// tasks are independent and their results come back through futures.
+/// Pending tasks still run on destruction before the workers are joined.
+class ThreadPool {
+public:
+   explicit ThreadPool(const size_t threads = std::max(1u, std::thread::hardware_concurrency())) {
+      _workers.reserve(threads);
+      for (auto t = size_t{0}; t < threads; ++t) {
+         _workers.emplace_back([this] {_work();});
+      }
+   }
+
+   ~ThreadPool() {
+      {
+         const std::lock_guard lock{_mutex};
+         _stopping = true;
+      }
+      _wake.notify_all();
+   }
+
+   ThreadPool(const ThreadPool&) = delete;
+   ThreadPool(ThreadPool&&)      = delete;
+
+   /// exceptions thrown by f are rethrown by get() on the future
+   template <class F>
+   [[nodiscard]] auto submit(F&& f) -> std::future<std::invoke_result_t<std::decay_t<F>>> {
+      using Result = std::invoke_result_t<std::decay_t<F>>;
+      /// std::function needs something copyable
+      auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(f));
+      auto future = task->get_future();
+      {
+         const std::lock_guard lock{_mutex};
+         _tasks.emplace_back([task] {(*task)();});
+      }
+      _wake.notify_one();
+      return future;
+   }
+
+   [[nodiscard]] auto size() const -> size_t {return _workers.size();}
+
+private:
+   auto _work() -> void {
+      while (true) {
+         auto task = std::function<void()>{};
+         {
+            std::unique_lock lock{_mutex};
+            _wake.wait(lock, [this] {return _stopping or not _tasks.empty();});
+            if (_tasks.empty()) {
+               return;
+            }
+            task = std::move(_tasks.front());
+            _tasks.pop_front();
+         }
+         task();
+      }
+   }
+
+   std::mutex _mutex;
+   std::condition_variable _wake;
+   std::deque<std::function<void()>> _tasks;
+   bool _stopping{false};
+   /// last, joined first on destruction while the queue is still alive
+   std::vector<std::jthread> _workers;
+};
+
+}
+
+#endif // GAME_TUTORIAL_THREAD_POOL_HPP
@@ -0,0 +1,223 @@
+#include "upload_manager.hpp"
+#include "error.hpp"
+
+#include <cstring>
+#include <utility>
+
+namespace game {
+
+namespace {
+
+/// rows of a region as the copy counts them: rows of 4x4 blocks for block formats
+auto rowsOf(const MTL::PixelFormat format, const size_t height) -> size_t {
+   const auto blocks = (format >= MTL::PixelFormatBC1_RGBA and format <= MTL::PixelFormatBC7_RGBAUnorm_sRGB)
+      or format == MTL::PixelFormatASTC_4x4_LDR or format == MTL::PixelFormatASTC_4x4_sRGB;
+   return blocks ? (height + 3) / 4 : height;
+}
+
+}
+
+UploadManager::UploadManager(MTL::Device* const device, const size_t staging_bytes)
+   : _device(device),
+     _queue{device->newCommandQueue(), [](auto t) {t->release();}},
+     /// cached: decoders read back what they write into reservations,
+     /// PNG rows are unfiltered against the row above
+     _staging{device->newBuffer(staging_bytes, MTL::ResourceStorageModeShared), [](auto t) {t->release();}},
+     _event{device->newSharedEvent(), [](auto t) {t->release();}},
+     _ring{staging_bytes} {
+   ensure(_staging.get() != nullptr, std::format("could not allocate a {} bytes staging buffer", staging_bytes));
+}
+
+UploadManager::~UploadManager() {
+   /// command buffers retain what they copy from and into,
+   /// nothing has to outlive this
+   flush();
+}
+
+auto UploadManager::_encoder() -> MTL::BlitCommandEncoder* {
+   if (_blit == nullptr) {
+      _commandBuffer = _queue->commandBuffer()->retain();
+      _blit = _commandBuffer->blitCommandEncoder();
+   }
+   return _blit;
+}
+
+auto UploadManager::_allocate(const size_t size) -> Staging {
+   _poll();
+   auto offset = _ring.allocate(size, STAGING_ALIGNMENT);
+   if (not offset and _blit != nullptr) {
+      /// part of the ring may only be waiting for this batch to go out
+      _flush();
+      _poll();
+      offset = _ring.allocate(size, STAGING_ALIGNMENT);
+   }
+   if (offset) {
+      return {_staging.get(), *offset, {static_cast<std::byte*>(_staging->contents()) + *offset, size}, false};
+   }
+
+   /// larger than the ring, or the ring is still in flight: a buffer of
+   /// its own, released with the batch rather than waiting for space
+   auto* const buffer = _device->newBuffer(size, MTL::ResourceStorageModeShared);
+   ensure(buffer != nullptr, std::format("could not allocate a {} bytes staging buffer", size));
+   return {buffer, 0, {static_cast<std::byte*>(buffer->contents()), size}, true};
+}
+
+auto UploadManager::_stage(const size_t size) -> Staging {
+   const auto staged = _allocate(size);
+   if (staged.owned) {
+      _encoder();
+      _commandBuffer->addCompletedHandler([buffer = staged.buffer](MTL::CommandBuffer*) {buffer->release();});
+   }
+   return staged;
+}
+
+auto UploadManager::_stage(MTL::Buffer* const destination, const size_t offset, const size_t size) -> std::span<std::byte> {
+   /// buffer copies move whole 4 byte words
+   const auto staged = _stage((size + 3) / 4 * 4);
+   _encoder()->copyFromBuffer(staged.buffer, staged.offset, destination, offset, staged.memory.size());
+   return staged.memory.first(size);
+}
+
+auto UploadManager::_stage(MTL::Texture* const destination, const std::uint32_t slice, const std::uint32_t level,
+   const MTL::Region& region, const size_t bytes_per_row) -> std::span<std::byte> {
+   const auto bytes_per_image = bytes_per_row * rowsOf(destination->pixelFormat(), region.size.height);
+   const auto staged = _stage(bytes_per_image * region.size.depth);
+   _encoder()->copyFromBuffer(staged.buffer, staged.offset, bytes_per_row, bytes_per_image, region.size,
+      destination, slice, level, region.origin);
+   return staged.memory;
+}
+
+auto UploadManager::stage(MTL::Buffer* const destination, const size_t offset, const size_t size) -> std::span<std::byte> {
+   const std::lock_guard lock{_mutex};
+   return _stage(destination, offset, size);
+}
+
+auto UploadManager::stage(MTL::Texture* const destination, const std::uint32_t slice, const std::uint32_t level,
+   const MTL::Region& region, const size_t bytes_per_row) -> std::span<std::byte> {
+   const std::lock_guard lock{_mutex};
+   return _stage(destination, slice, level, region, bytes_per_row);
+}
+
+auto UploadManager::upload(MTL::Buffer* const destination, const size_t offset,
+   const std::span<const std::byte> data) -> void {
+   const std::lock_guard lock{_mutex};
+   std::memcpy(_stage(destination, offset, data.size()).data(), data.data(), data.size());
+}
+
+auto UploadManager::upload(MTL::Texture* const destination, const std::uint32_t slice, const std::uint32_t level,
+   const MTL::Region& region, const size_t bytes_per_row, const std::span<const std::byte> data) -> void {
+   const std::lock_guard lock{_mutex};
+   const auto staged = _stage(destination, slice, level, region, bytes_per_row);
+   ensure(data.size() == staged.size(), std::format("{} bytes for a region of {} bytes", data.size(), staged.size()));
+   std::memcpy(staged.data(), data.data(), data.size());
+}
+
+auto UploadManager::copy(MTL::Texture* const source, const std::uint32_t source_level,
+   MTL::Texture* const destination, const std::uint32_t destination_level, const std::uint32_t level_count) -> void {
+   const auto cube = source->textureType() == MTL::TextureTypeCube or source->textureType() == MTL::TextureTypeCubeArray;
+   const std::lock_guard lock{_mutex};
+   _encoder()->copyFromTexture(source, 0, source_level, destination, 0, destination_level,
+      source->arrayLength() * (cube ? 6 : 1), level_count);
+}
+
+auto UploadManager::generateMipmaps(MTL::Texture* const texture) -> void {
+   const std::lock_guard lock{_mutex};
+   /// commands of a blit encoder run in order, the copies land first
+   _encoder()->generateMipmaps(texture);
+}
+
+UploadManager::Reservation::Reservation(UploadManager* const uploads, MTL::Buffer* const buffer, const size_t offset,
+   const std::span<std::byte> memory, const bool owned, MTL::Texture* const destination, const std::uint32_t slice,
+   const std::uint32_t level, const MTL::Region& region, const size_t bytes_per_row)
+   : _uploads(uploads), _buffer(buffer), _offset(offset), _memory(memory), _owned(owned), _destination(destination),
+     _slice(slice), _level(level), _region(region), _bytesPerRow(bytes_per_row) {}
+
+UploadManager::Reservation::Reservation(Reservation&& other) noexcept
+   : _uploads(std::exchange(other._uploads, nullptr)), _buffer(other._buffer), _offset(other._offset),
+     _memory(other._memory), _owned(other._owned), _destination(other._destination), _slice(other._slice),
+     _level(other._level), _region(other._region), _bytesPerRow(other._bytesPerRow) {}
+
+UploadManager::Reservation::~Reservation() {
+   if (_uploads != nullptr) {
+      const std::lock_guard lock{_uploads->_mutex};
+      _uploads->_release(*this);
+   }
+}
+
+auto UploadManager::reserve(MTL::Texture* const destination, const std::uint32_t slice, const std::uint32_t level,
+   const MTL::Region& region, const size_t bytes_per_row) -> Reservation {
+   const auto bytes_per_image = bytes_per_row * rowsOf(destination->pixelFormat(), region.size.height);
+   const std::lock_guard lock{_mutex};
+   const auto staged = _allocate(bytes_per_image * region.size.depth);
+   ++_reserved;
+   return {this, staged.buffer, staged.offset, staged.memory, staged.owned, destination, slice, level, region,
+      bytes_per_row};
+}
+
+auto UploadManager::commit(Reservation reservation) -> void {
+   ensure(reservation._uploads == this, "the reservation was not made here or was already committed");
+   const std::lock_guard lock{_mutex};
+   const auto bytes_per_image = reservation._bytesPerRow
+      * rowsOf(reservation._destination->pixelFormat(), reservation._region.size.height);
+   _encoder()->copyFromBuffer(reservation._buffer, reservation._offset, reservation._bytesPerRow, bytes_per_image,
+      reservation._region.size, reservation._destination, reservation._slice, reservation._level,
+      reservation._region.origin);
+   if (reservation._owned) {
+      _commandBuffer->addCompletedHandler([buffer = reservation._buffer](MTL::CommandBuffer*) {buffer->release();});
+      reservation._owned = false;
+   }
+   _release(reservation);
+}
+
+auto UploadManager::_release(Reservation& reservation) -> void {
+   /// ring space goes back with the batch the ring is next closed on
+   if (reservation._owned) {
+      reservation._buffer->release();
+   }
+   reservation._uploads = nullptr;
+   --_reserved;
+}
+
+auto UploadManager::flush() -> std::uint64_t {
+   const std::lock_guard lock{_mutex};
+   return _flush();
+}
+
+auto UploadManager::_flush() -> std::uint64_t {
+   if (_blit == nullptr) {
+      return _submitted;
+   }
+   _blit->endEncoding();
+   ++_submitted;
+   /// space reserved before this batch may only be copied from in a later
+   /// one, it is closed with the first batch after every reservation is in
+   if (_reserved == 0) {
+      _ring.close(_submitted);
+   }
+   _commandBuffer->encodeSignalEvent(_event.get(), _submitted);
+   _commandBuffer->commit();
+   _commandBuffer->release();
+   _commandBuffer = nullptr;
+   _blit = nullptr;
+   return _submitted;
+}
+
+auto UploadManager::poll() -> void {
+   const std::lock_guard lock{_mutex};
+   _poll();
+}
+
+auto UploadManager::_poll() -> void {
+   _ring.retire(_event->signaledValue());
+}
+
+auto UploadManager::waitOnGPU(MTL::CommandBuffer* const buffer) -> void {
+   const std::lock_guard lock{_mutex};
+   _flush();
+   _poll();
+   if (not isComplete(_submitted)) {
+      buffer->encodeWait(_event.get(), _submitted);
+   }
+}
+
+}
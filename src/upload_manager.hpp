@@ -0,0 +1,137 @@
+#ifndef GAME_TUTORIAL_UPLOAD_MANAGER_HPP
+#define GAME_TUTORIAL_UPLOAD_MANAGER_HPP
+
+#include <Metal/Metal.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <span>
+
+#include "auto_release.hpp"
+#include "staging_ring.hpp"
+
+namespace game {
+
+/// Uploads into private storage resources through a persistent shared
+/// staging buffer. Every stage call hands out staging memory and records a
+/// blit from it into the destination; the blits of a batch go out together
+/// on flush, on a queue of their own, and signal a shared event when done.
+/// Nothing waits on the CPU: command buffers that read the uploaded
+/// resources encode a wait on the event instead.
+/// Every member can be called from several threads. Memory handed out by
+/// stage() has to be filled before any other call, from any thread, as
+/// that call may flush; threads uploading concurrently use upload(),
+/// which copies while it holds the manager, or reserve(), whose memory is
+/// filled at leisure and copied once committed.
+class UploadManager {
+public:
+   /// offsets in the staging buffer, enough for buffer to buffer copies
+   /// and for buffer to texture copies of every pixel format
+   static constexpr size_t STAGING_ALIGNMENT = 256;
+   static constexpr size_t STAGING_BYTES = size_t{64} << 20;
+
+   explicit UploadManager(MTL::Device* device, size_t staging_bytes = STAGING_BYTES);
+   ~UploadManager();
+   UploadManager(const UploadManager&) = delete;
+   UploadManager(UploadManager&&)      = delete;
+
+   /// staging memory that ends up at offset in destination, it must be
+   /// filled before the next flush
+   [[nodiscard]] auto stage(MTL::Buffer* destination, size_t offset, size_t size) -> std::span<std::byte>;
+   /// staging memory for region of a texture slice and level, rows are
+   /// bytes_per_row apart; for block formats a row is a row of blocks
+   [[nodiscard]] auto stage(MTL::Texture* destination, std::uint32_t slice, std::uint32_t level,
+      const MTL::Region& region, size_t bytes_per_row) -> std::span<std::byte>;
+   auto upload(MTL::Buffer* destination, size_t offset, std::span<const std::byte> data) -> void;
+   /// data holds region as laid out by stage()
+   auto upload(MTL::Texture* destination, std::uint32_t slice, std::uint32_t level,
+      const MTL::Region& region, size_t bytes_per_row, std::span<const std::byte> data) -> void;
+   /// level_count levels of every slice, from source_level of source on;
+   /// like every command of a batch, after the uploads recorded before it
+   auto copy(MTL::Texture* source, std::uint32_t source_level, MTL::Texture* destination,
+      std::uint32_t destination_level, std::uint32_t level_count) -> void;
+   /// fills the remaining levels once all the uploads recorded so far are done
+   auto generateMipmaps(MTL::Texture* texture) -> void;
+
+   /// Staging memory for region of a texture slice and level, as from
+   /// stage(), that is filled without holding the manager: decoded straight
+   /// into, say. Flushes keep its space from being handed out again until it
+   /// is committed; dropped uncommitted, nothing is copied.
+   class Reservation {
+   public:
+      Reservation(Reservation&& other) noexcept;
+      Reservation& operator=(Reservation&&) = delete;
+      ~Reservation();
+
+      [[nodiscard]] auto memory() const -> std::span<std::byte> {return _memory;}
+
+   private:
+      friend class UploadManager;
+      Reservation(UploadManager* uploads, MTL::Buffer* buffer, size_t offset, std::span<std::byte> memory,
+         bool owned, MTL::Texture* destination, std::uint32_t slice, std::uint32_t level, const MTL::Region& region,
+         size_t bytes_per_row);
+
+      /// null once committed or moved from
+      UploadManager* _uploads;
+      MTL::Buffer* _buffer;
+      size_t _offset;
+      std::span<std::byte> _memory;
+      /// a buffer of its own rather than part of the ring
+      bool _owned;
+      MTL::Texture* _destination;
+      std::uint32_t _slice;
+      std::uint32_t _level;
+      MTL::Region _region;
+      size_t _bytesPerRow;
+   };
+   [[nodiscard]] auto reserve(MTL::Texture* destination, std::uint32_t slice, std::uint32_t level,
+      const MTL::Region& region, size_t bytes_per_row) -> Reservation;
+   /// records the copy of the filled reservation into its texture
+   auto commit(Reservation reservation) -> void;
+
+   /// commits the recorded blits, returns the event value they signal
+   auto flush() -> std::uint64_t;
+   /// hands back the staging space of every batch the GPU has finished
+   auto poll() -> void;
+   /// flushes and makes buffer wait for every upload so far
+   auto waitOnGPU(MTL::CommandBuffer* buffer) -> void;
+   [[nodiscard]] auto isComplete(std::uint64_t batch) const -> bool {return _event->signaledValue() >= batch;}
+
+private:
+   struct Staging {
+      MTL::Buffer* buffer;
+      size_t offset;
+      std::span<std::byte> memory;
+      /// a buffer of its own, released once the batch that copies from it is done
+      bool owned;
+   };
+
+   /// the callers hold _mutex
+   auto _allocate(size_t size) -> Staging;
+   auto _stage(size_t size) -> Staging;
+   auto _stage(MTL::Buffer* destination, size_t offset, size_t size) -> std::span<std::byte>;
+   auto _stage(MTL::Texture* destination, std::uint32_t slice, std::uint32_t level,
+      const MTL::Region& region, size_t bytes_per_row) -> std::span<std::byte>;
+   auto _encoder() -> MTL::BlitCommandEncoder*;
+   auto _flush() -> std::uint64_t;
+   auto _poll() -> void;
+   auto _release(Reservation& reservation) -> void;
+
+   MTL::Device* _device;
+   AutoRelease<MTL::CommandQueue*> _queue;
+   AutoRelease<MTL::Buffer*> _staging;
+   AutoRelease<MTL::SharedEvent*> _event;
+   StagingRing _ring;
+   /// the batch being recorded
+   MTL::CommandBuffer* _commandBuffer{nullptr};
+   MTL::BlitCommandEncoder* _blit{nullptr};
+   std::uint64_t _submitted{0};
+   /// reservations not yet committed, the ring is not closed while there are any
+   size_t _reserved{0};
+   std::mutex _mutex;
+};
+
+}
+
+#endif // GAME_TUTORIAL_UPLOAD_MANAGER_HPP
@@ -2,7 +2,7 @@
 #define GAME_TUTORIAL_VECTOR3_HPP
 
 #include "error.hpp"
-#include <simd/vector.h>
+#include "simd_compat.hpp"
 #include <numbers>
 
 namespace game {
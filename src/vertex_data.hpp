@@ -0,0 +1,82 @@
+#ifndef GAME_TUTORIAL_VERTEX_DATA_HPP
+#define GAME_TUTORIAL_VERTEX_DATA_HPP
+
+/// Plain cpu side mesh layout, kept free of any Metal dependency so the
+/// mesh processing code can be shared with the tests.
+
+#include <cstdint>
+#include <format>
+#include <vector>
+
+#include "simd_compat.hpp"
+
+namespace game {
+
+struct VertexData {
+   simd::float4 position;
+   simd::float3 normal;
+   simd::float3 tangent;
+   simd::float3 bitangent;
+   simd::float2 uv;
+};
+
+struct MeshData {
+   std::vector<VertexData> vertices;
+   std::vector<std::uint32_t> indexes;
+};
+
+inline auto operator==(const VertexData& v1, const VertexData& v2) -> bool {
+   return v1.position.x == v2.position.x and v1.position.y == v2.position.y and v1.position.z == v2.position.z;
+}
+
+}
+
+template<>
+struct std::formatter<simd::float4> {
+   static constexpr auto parse(const std::format_parse_context &ctx) {
+      return std::cbegin(ctx);
+   }
+
+   static auto format(const simd::float4 &vd, std::format_context &ctx) {
+      return std::format_to(ctx.out(),
+         "({}, {}, {}, {})", vd.x, vd.y,vd.z, vd.w);
+   }
+};
+
+template<>
+struct std::formatter<simd::float3> {
+   static constexpr auto parse(const std::format_parse_context &ctx) {
+      return std::cbegin(ctx);
+   }
+
+   static auto format(const simd::float3 &vd, std::format_context &ctx) {
+      return std::format_to(ctx.out(),
+         "({}, {}, {})", vd.x, vd.y, vd.z);
+   }
+};
+
+template<>
+struct std::formatter<simd::float2> {
+   static constexpr auto parse(const std::format_parse_context &ctx) {
+      return std::cbegin(ctx);
+   }
+
+   static auto format(const simd::float2 &vd, std::format_context &ctx) {
+      return std::format_to(ctx.out(),
+         "({}, {})", vd.x, vd.y);
+   }
+};
+
+template<>
+struct std::formatter<game::VertexData> {
+   static constexpr auto parse(const std::format_parse_context &ctx) {
+      return std::cbegin(ctx);
+   }
+
+   static auto format(const game::VertexData &vd, std::format_context &ctx) {
+      return std::format_to(ctx.out(),
+         "position = {}, normal = {}, uv = {}", vd.position, vd.normal, vd.uv);
+   }
+};
+
+#endif // GAME_TUTORIAL_VERTEX_DATA_HPP
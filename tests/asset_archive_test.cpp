@@ -0,0 +1,256 @@
+#include <gtest/gtest.h>
+
+#include "asset_archive.cpp"
+#include "resource_reader.hpp"
+
+#include <chrono>
+#include <fstream>
+#include <print>
+
+namespace {
+
+auto writeFile(const std::filesystem::path& path, const std::string_view text) -> void {
+   std::filesystem::create_directories(path.parent_path());
+   std::ofstream file{path, std::ios::binary | std::ios::trunc};
+   file.write(text.data(), static_cast<std::streamsize>(text.size()));
+}
+
+/// lines of a shader or an OBJ file, compressible
+auto text(const size_t size, const size_t seed) -> std::string {
+   auto lines = std::string{};
+   for (auto i = seed; lines.size() < size; ++i) {
+      lines += std::format("float4 value{} = float4({}, {}, 0.0, 1.0);\n", i % 97, i * 13 % 1000, i * 7 % 100);
+   }
+   lines.resize(size);
+   return lines;
+}
+
+/// bytes no compressor gets anywhere with
+auto noise(const size_t size) -> std::string {
+   auto bytes = std::string(size, '\0');
+   auto state = std::uint32_t{12345};
+   for (auto& b: bytes) {
+      state = state * 1664525u + 1013904223u;
+      b = static_cast<char>(state >> 24);
+   }
+   return bytes;
+}
+
+auto asText(const game::FileContents& contents) -> std::string_view {
+   return {reinterpret_cast<const char*>(contents.bytes().data()), contents.size()};
+}
+
+struct Directory {
+   std::filesystem::path path;
+
+   explicit Directory(const std::string_view name) : path(std::filesystem::temp_directory_path() / name) {
+      std::filesystem::remove_all(path);
+      std::filesystem::create_directories(path);
+   }
+   ~Directory() {
+      std::filesystem::remove_all(path);
+   }
+};
+
+}
+
+TEST(asset_archive, entries_read_back_stored_or_compressed) {
+   const auto directory = Directory{"asset_archive_test"};
+   const auto files = std::vector<std::pair<std::string, std::string>>{
+      {"shaders/small.metal", text(300, 1)},
+      {"shaders/large.metal", text(200000, 2)},
+      {"assets/noise.bin", noise(100000)},
+      {"assets/tiny.bin", noise(40)},
+      {"assets/empty.txt", ""},
+   };
+   auto inputs = std::vector<game::ArchiveInput>{};
+   for (const auto& [name, contents]: files) {
+      writeFile(directory.path / name, contents);
+      inputs.push_back({.name = name, .source = directory.path / name, .compress = true});
+   }
+   /// stored as asked, even if it compresses
+   writeFile(directory.path / "assets/stored.txt", text(50000, 3));
+   inputs.push_back({.name = "assets/stored.txt", .source = directory.path / "assets/stored.txt", .compress = false});
+
+   const auto path = directory.path / "assets.gpak";
+   game::AssetArchive::write(path, inputs);
+   const auto archive = game::AssetArchive::open(path);
+   ASSERT_EQ(archive.size(), inputs.size());
+   for (const auto& [name, contents]: files) {
+      const auto read = archive.read(name);
+      ASSERT_TRUE(read.has_value()) << name;
+      ASSERT_EQ(asText(*read), contents) << name;
+   }
+
+   const auto* const large = archive.find("shaders/large.metal");
+   ASSERT_EQ(large->compression, game::ArchiveCompression::Lz);
+   ASSERT_LT(large->size, large->originalSize / 2);
+   ASSERT_FALSE(archive.read("shaders/large.metal")->isMapped());
+   /// stored entries are views of the mapping, page aligned once a page or more
+   for (const auto name: {"assets/noise.bin", "assets/stored.txt"}) {
+      const auto* const entry = archive.find(name);
+      ASSERT_EQ(entry->compression, game::ArchiveCompression::None) << name;
+      ASSERT_EQ(entry->offset % game::AssetArchive::ENTRY_ALIGNMENT, 0u) << name;
+      const auto read = archive.read(name);
+      ASSERT_TRUE(read->isMapped()) << name;
+      ASSERT_EQ(reinterpret_cast<std::uintptr_t>(read->bytes().data()) % game::MappedFile::pageSize(), 0u) << name;
+   }
+   ASSERT_EQ(archive.find("assets/tiny.bin")->compression, game::ArchiveCompression::None);
+   ASSERT_EQ(archive.name(*archive.find("assets/tiny.bin")), "assets/tiny.bin");
+
+   ASSERT_EQ(archive.find("assets/missing.bin"), nullptr);
+   ASSERT_FALSE(archive.read("assets").has_value());
+   ASSERT_FALSE(archive.read("").has_value());
+}
+
+TEST(asset_archive, bad_inputs_and_damaged_archives_throw) {
+   const auto directory = Directory{"asset_archive_test_damaged"};
+   writeFile(directory.path / "a.txt", text(5000, 4));
+   const auto path = directory.path / "assets.gpak";
+   const auto twice = std::vector<game::ArchiveInput>{
+      {.name = "a.txt", .source = directory.path / "a.txt", .compress = false},
+      {.name = "a.txt", .source = directory.path / "a.txt", .compress = true}
+   };
+   ASSERT_THROW(game::AssetArchive::write(path, twice), game::Exception);
+   ASSERT_THROW(game::AssetArchive::write(path, std::array{game::ArchiveInput{.name = "b.txt",
+      .source = directory.path / "b.txt", .compress = false}}), game::Exception);
+
+   game::AssetArchive::write(path, std::span{twice}.first(1));
+   ASSERT_EQ(asText(*game::AssetArchive::open(path).read("a.txt")), text(5000, 4));
+   /// a compressed entry claiming more than its block can decode to, rather than a huge allocation
+   game::AssetArchive::write(path, std::span{twice}.last(1));
+   {
+      auto file = std::fstream{path, std::ios::binary | std::ios::in | std::ios::out};
+      auto header = game::ArchiveHeader{};
+      file.read(reinterpret_cast<char*>(&header), sizeof(header));
+      for (auto slot = std::uint64_t{0}; slot < header.slotCount; ++slot) {
+         const auto offset = static_cast<std::streamoff>(header.tableOffset + slot * sizeof(game::ArchiveEntry));
+         auto entry = game::ArchiveEntry{};
+         file.seekg(offset);
+         file.read(reinterpret_cast<char*>(&entry), sizeof(entry));
+         if (entry.hash != 0) {
+            ASSERT_EQ(entry.compression, game::ArchiveCompression::Lz);
+            entry.originalSize = game::decompressBound(entry.size) + 1;
+            file.seekp(offset);
+            file.write(reinterpret_cast<const char*>(&entry), sizeof(entry));
+         }
+      }
+   }
+   ASSERT_THROW((void)game::AssetArchive::open(path), game::Exception);
+   game::AssetArchive::write(path, std::span{twice}.first(1));
+   /// cut short, the table is gone
+   std::filesystem::resize_file(path, std::filesystem::file_size(path) - 8);
+   ASSERT_THROW((void)game::AssetArchive::open(path), game::Exception);
+   writeFile(path, "not an archive");
+   ASSERT_THROW((void)game::AssetArchive::open(path), game::Exception);
+   ASSERT_THROW((void)game::AssetArchive::open(directory.path / "missing.gpak"), game::Exception);
+}
+
+TEST(asset_archive, loaders_look_in_archives_mounted_last_first) {
+   const auto directory = Directory{"asset_archive_test_mounts"};
+   /// entries packed from other files than the loose ones would be stale
+   /// in a development build, a.txt and c.txt are only packed
+   writeFile(directory.path / "loose/b.txt", "loose b");
+   writeFile(directory.path / "first/a.txt", "first a");
+   writeFile(directory.path / "first/c.txt", "first c");
+   writeFile(directory.path / "second/a.txt", "second a");
+   game::AssetArchive::write(directory.path / "first.gpak", std::array{
+      game::ArchiveInput{.name = "loose/a.txt", .source = directory.path / "first/a.txt", .compress = false},
+      game::ArchiveInput{.name = "loose/c.txt", .source = directory.path / "first/c.txt", .compress = false}});
+   game::AssetArchive::write(directory.path / "second.gpak", std::array{
+      game::ArchiveInput{.name = "loose/a.txt", .source = directory.path / "second/a.txt", .compress = false}});
+
+   auto loader = game::ResourceLoader{directory.path};
+   ASSERT_EQ(loader.loadString("loose/b.txt"), "loose b");
+   loader.mount(std::make_shared<const game::AssetArchive>(game::AssetArchive::open(directory.path / "first.gpak")));
+   ASSERT_EQ(loader.loadString("loose/a.txt"), "first a");
+   ASSERT_EQ(loader.loadString("loose/c.txt"), "first c");
+   ASSERT_EQ(loader.loadString("loose/b.txt"), "loose b");
+   loader.mount(std::make_shared<const game::AssetArchive>(game::AssetArchive::open(directory.path / "second.gpak")));
+   ASSERT_EQ(asText(loader.loadBytes("loose/a.txt")), "second a");
+   ASSERT_EQ(asText(loader.loadBytes("loose/c.txt")), "first c");
+
+   /// a batch reads what the archives lack and hands the rest over at once
+   game::ThreadPool pool{2};
+   game::AsyncReader reader{pool};
+   auto reads = loader.loadBytes(std::array{std::string_view{"loose/b.txt"}, std::string_view{"loose/a.txt"}}, reader);
+   const auto b = reads[0].get();
+   const auto a = reads[1].get();
+   ASSERT_EQ(std::string_view(reinterpret_cast<const char*>(b.data()), b.size()), "loose b");
+   ASSERT_EQ(std::string_view(reinterpret_cast<const char*>(a.data()), a.size()), "second a");
+}
+
+TEST(asset_archive, edited_loose_files_win_over_their_entries) {
+   const auto directory = Directory{"asset_archive_test_stale"};
+   writeFile(directory.path / "shaders/a.metal", text(3000, 1));
+   game::AssetArchive::write(directory.path / "assets.gpak", std::array{
+      game::ArchiveInput{.name = "shaders/a.metal", .source = directory.path / "shaders/a.metal", .compress = true}});
+   const auto archive = game::AssetArchive::open(directory.path / "assets.gpak");
+   ASSERT_EQ(archive.find("shaders/a.metal")->stamp, game::AssetArchive::stamp(directory.path / "shaders/a.metal"));
+
+   auto loader = game::ResourceLoader{directory.path};
+   loader.mount(std::make_shared<const game::AssetArchive>(archive));
+   ASSERT_EQ(loader.loadString("shaders/a.metal"), text(3000, 1));
+   /// another size, whatever the resolution of modification times
+   writeFile(directory.path / "shaders/a.metal", "edited");
+#ifdef NDEBUG
+   ASSERT_EQ(loader.loadString("shaders/a.metal"), text(3000, 1));
+#else
+   ASSERT_EQ(loader.loadString("shaders/a.metal"), "edited");
+#endif
+   /// without a loose file there is nothing newer
+   std::filesystem::remove(directory.path / "shaders/a.metal");
+   ASSERT_EQ(loader.loadString("shaders/a.metal"), text(3000, 1));
+}
+
+TEST(asset_archive, DISABLED_thousands_of_small_assets_against_loose_files) {
+   const auto directory = Directory{"asset_archive_test_small"};
+   constexpr auto COUNT = size_t{2000};
+   auto names = std::vector<std::string>{};
+   auto inputs = std::vector<game::ArchiveInput>{};
+   for (auto i = size_t{0}; i < COUNT; ++i) {
+      names.push_back(std::format("assets/{}/{}.txt", i % 20, i));
+      writeFile(directory.path / names.back(), text(512 + i * 37 % 7000, i));
+      inputs.push_back({.name = names.back(), .source = directory.path / names.back(), .compress = i % 2 == 0});
+   }
+   const auto path = directory.path / "assets.gpak";
+   game::AssetArchive::write(path, inputs);
+
+   /// every byte touched, both ways read from the page cache
+   const auto sum = [](const game::FileContents& contents) {
+      auto total = size_t{0};
+      for (const auto b: contents.bytes()) {
+         total += std::to_integer<size_t>(b);
+      }
+      return total;
+   };
+   auto loose_sum = size_t{0};
+   auto loose_bytes = size_t{0};
+   const auto loose_start = std::chrono::steady_clock::now();
+   {
+      const auto loader = game::ResourceLoader{directory.path};
+      for (const auto& name: names) {
+         const auto contents = loader.loadBytes(name);
+         loose_sum += sum(contents);
+         loose_bytes += contents.size();
+      }
+   }
+   const auto loose = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - loose_start);
+
+   auto packed_sum = size_t{0};
+   const auto packed_start = std::chrono::steady_clock::now();
+   auto loader = game::ResourceLoader{directory.path};
+   loader.mount(std::make_shared<const game::AssetArchive>(game::AssetArchive::open(path)));
+   const auto opened = std::chrono::steady_clock::now();
+   for (const auto& name: names) {
+      packed_sum += sum(loader.loadBytes(name));
+   }
+   const auto packed_end = std::chrono::steady_clock::now();
+   std::println("{} small files: loose {:.2f} ms, archive opened in {:.2f} ms and read in {:.2f} ms "
+      "(half of it compressed, {:.1f} of {:.1f} MB on disk)", COUNT, loose.count(),
+      std::chrono::duration<double, std::milli>(opened - packed_start).count(),
+      std::chrono::duration<double, std::milli>(packed_end - opened).count(),
+      static_cast<double>(std::filesystem::file_size(path)) / static_cast<double>(1u << 20),
+      static_cast<double>(loose_bytes) / static_cast<double>(1u << 20));
+   ASSERT_EQ(packed_sum, loose_sum);
+}
@@ -0,0 +1,141 @@
+#include <gtest/gtest.h>
+
+#include "async_reader.cpp"
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <print>
+
+namespace {
+
+auto writeFile(const std::filesystem::path& path, const size_t size, const size_t seed) -> std::vector<std::byte> {
+   auto bytes = std::vector<std::byte>(size);
+   for (auto i = size_t{0}; i < size; ++i) {
+      bytes[i] = static_cast<std::byte>(i * 13 + seed);
+   }
+   std::ofstream file{path, std::ios::binary | std::ios::trunc};
+   file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(size));
+   return bytes;
+}
+
+constexpr auto BACKENDS = std::array{game::AsyncBackend::IoUring, game::AsyncBackend::ThreadPool};
+
+/// more files than the ring takes at once, of sizes from nothing to a few MB
+struct Files {
+   std::vector<std::filesystem::path> paths;
+   std::vector<std::vector<std::byte>> contents;
+
+   Files() {
+      const auto directory = std::filesystem::temp_directory_path() / "async_reader_test";
+      std::filesystem::create_directories(directory);
+      for (auto i = size_t{0}; i < 40; ++i) {
+         paths.push_back(directory / std::format("{}.bin", i));
+         contents.push_back(writeFile(paths.back(), i % 5 == 0 ? 0 : (i * 97731) % (size_t{3} << 20), i));
+      }
+   }
+   ~Files() {
+      std::filesystem::remove_all(paths.front().parent_path());
+   }
+};
+
+}
+
+TEST(async_reader, futures_hold_whole_files) {
+   const auto files = Files{};
+   game::ThreadPool pool{4};
+   for (const auto backend: BACKENDS) {
+      game::AsyncReader reader{pool, backend, 8};
+      auto reads = reader.read(files.paths);
+      ASSERT_EQ(reads.size(), files.paths.size());
+      for (auto i = size_t{0}; i < reads.size(); ++i) {
+         ASSERT_EQ(reads[i].get(), files.contents[i]) << i << (reader.backend() == game::AsyncBackend::IoUring ?
+            " through io_uring" : " through the thread pool");
+      }
+   }
+}
+
+TEST(async_reader, a_missing_file_fails_alone) {
+   const auto files = Files{};
+   game::ThreadPool pool{2};
+   for (const auto backend: BACKENDS) {
+      game::AsyncReader reader{pool, backend};
+      auto paths = std::vector{files.paths[1], files.paths.front().parent_path() / "missing.bin", files.paths[2]};
+      auto reads = reader.read(paths);
+      ASSERT_EQ(reads[0].get(), files.contents[1]);
+      ASSERT_THROW((void)reads[1].get(), game::Exception);
+      ASSERT_EQ(reads[2].get(), files.contents[2]);
+   }
+}
+
+TEST(async_reader, callbacks_see_every_file_once) {
+   const auto files = Files{};
+   game::ThreadPool pool{4};
+   for (const auto backend: BACKENDS) {
+      auto seen = std::vector<std::atomic<int>>(files.paths.size());
+      auto calls = std::atomic<size_t>{0};
+      auto matching = std::atomic<size_t>{0};
+      {
+         game::AsyncReader reader{pool, backend, 4};
+         reader.read(files.paths, [&](const size_t index, std::vector<std::byte> bytes, const std::exception_ptr error) {
+            ++seen[index];
+            if (not error and bytes == files.contents[index]) {
+               ++matching;
+            }
+            ++calls;
+         });
+         /// the reader finishes what is in flight before it goes
+      }
+      /// tasks on the pool are not the reader's to wait for
+      while (calls < files.paths.size()) {
+         std::this_thread::yield();
+      }
+      ASSERT_EQ(matching.load(), files.paths.size());
+      for (const auto& s: seen) {
+         ASSERT_EQ(s.load(), 1);
+      }
+   }
+}
+
+TEST(async_reader, DISABLED_batch_against_blocking_reads) {
+   const auto root = std::filesystem::path(ROOT_DIR);
+   auto paths = std::vector<std::filesystem::path>{};
+   for (const auto& directory: {root / ASSETS_DIR / "rustediron1-alt2-Unreal-Engine", root / ASSETS_DIR / "skybox",
+      root / ASSETS_DIR, root / "shaders"}) {
+      for (const auto& entry: std::filesystem::directory_iterator{directory}) {
+         if (entry.is_regular_file()) {
+            paths.push_back(entry.path());
+         }
+      }
+   }
+   const auto total = [&] {
+      auto bytes = size_t{0};
+      for (const auto& path: paths) {
+         bytes += std::filesystem::file_size(path);
+      }
+      return static_cast<double>(bytes) / static_cast<double>(1u << 20);
+   }();
+
+   const auto blocking_start = std::chrono::steady_clock::now();
+   for (const auto& path: paths) {
+      ASSERT_EQ(game::readFile(path).size(), std::filesystem::file_size(path));
+   }
+   const auto blocking = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - blocking_start);
+   std::println("{} files, {:.1f} MB, one after the other: {:.2f} ms", paths.size(), total, blocking.count());
+
+   game::ThreadPool pool{};
+   for (const auto backend: BACKENDS) {
+      game::AsyncReader reader{pool, backend};
+      const auto start = std::chrono::steady_clock::now();
+      auto reads = reader.read(paths);
+      const auto submitted = std::chrono::steady_clock::now();
+      for (auto i = size_t{0}; i < reads.size(); ++i) {
+         ASSERT_EQ(reads[i].get().size(), std::filesystem::file_size(paths[i]));
+      }
+      const auto end = std::chrono::steady_clock::now();
+      std::println("   in one batch through {}: submitted in {:.2f} ms, all read in {:.2f} ms",
+         reader.backend() == game::AsyncBackend::IoUring ? "io_uring" : "the thread pool",
+         std::chrono::duration<double, std::milli>(submitted - start).count(),
+         std::chrono::duration<double, std::milli>(end - start).count());
+   }
+}
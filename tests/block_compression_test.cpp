@@ -0,0 +1,147 @@
+#include <gtest/gtest.h>
+
+#include "block_compression.cpp"
+#include "image.hpp"
+#include "mapped_file.hpp"
+
+#include <chrono>
+#include <filesystem>
+#include <print>
+#include <random>
+
+namespace {
+
+constexpr auto FORMATS = {game::BlockFormat::BC4, game::BlockFormat::BC5, game::BlockFormat::BC7,
+   game::BlockFormat::ASTC4x4};
+constexpr auto QUALITIES = {game::EncodeQuality::Fast, game::EncodeQuality::Normal, game::EncodeQuality::High};
+
+auto channels(const game::BlockFormat format) -> size_t {
+   switch (format) {
+      case game::BlockFormat::BC4: return 1;
+      case game::BlockFormat::BC5: return 2;
+      default: return 4;
+   }
+}
+
+auto name(const game::BlockFormat format) -> std::string_view {
+   switch (format) {
+      case game::BlockFormat::BC4: return "BC4";
+      case game::BlockFormat::BC5: return "BC5";
+      case game::BlockFormat::BC7: return "BC7";
+      default: return "ASTC 4x4";
+   }
+}
+
+auto name(const game::EncodeQuality quality) -> std::string_view {
+   switch (quality) {
+      case game::EncodeQuality::Fast: return "fast";
+      case game::EncodeQuality::Normal: return "normal";
+      default: return "high";
+   }
+}
+
+/// smooth gradients with some noise on top, alpha from opaque to half
+auto gradient(const std::uint32_t width, const std::uint32_t height, const bool alpha) -> game::Image {
+   auto random = std::mt19937{3};
+   auto noise = std::uniform_int_distribution{-6, 6};
+   auto image = game::Image{width, height, std::vector<std::byte>(size_t{width} * height * 4)};
+   for (auto y = 0u; y < height; ++y) {
+      for (auto x = 0u; x < width; ++x) {
+         const auto p = (size_t{y} * width + x) * 4;
+         const auto value = [&](const float v) {
+            return static_cast<std::byte>(std::clamp(static_cast<int>(v) + noise(random), 0, 255));
+         };
+         image.pixels[p] = value(255.0f * static_cast<float>(x) / static_cast<float>(width));
+         image.pixels[p + 1] = value(255.0f * static_cast<float>(y) / static_cast<float>(height));
+         image.pixels[p + 2] = value(128.0f + 100.0f * std::sin(static_cast<float>(x + y) * 0.05f));
+         image.pixels[p + 3] = alpha ? value(128.0f + 127.0f * static_cast<float>(y) / static_cast<float>(height))
+                                     : std::byte{255};
+      }
+   }
+   return image;
+}
+
+auto asset(const std::string_view path) -> game::Image {
+   const auto file = game::MappedFile::open(std::filesystem::path(ROOT_DIR) / ASSETS_DIR / path);
+   return game::decodeImage(file.bytes());
+}
+
+}
+
+TEST(block_compression, sizes_count_whole_blocks) {
+   ASSERT_EQ(game::compressedSize(game::BlockFormat::BC4, 4, 4), 8u);
+   ASSERT_EQ(game::compressedSize(game::BlockFormat::BC7, 5, 4), 32u);
+   ASSERT_EQ(game::compressedSize(game::BlockFormat::ASTC4x4, 1, 1), 16u);
+   ASSERT_EQ(game::compressedSize(game::BlockFormat::BC5, 2048, 2048), size_t{2048} * 2048);
+
+   const auto image = gradient(13, 7, false);
+   for (const auto format: FORMATS) {
+      const auto blocks = game::encodeBlocks(image, format, game::EncodeQuality::Fast);
+      ASSERT_EQ(blocks.size(), game::compressedSize(format, 13, 7));
+      const auto decoded = game::decodeBlocks(blocks, format, 13, 7);
+      ASSERT_EQ(decoded.width, 13u);
+      ASSERT_EQ(decoded.height, 7u);
+      ASSERT_GT(game::psnr(image, decoded, channels(format)), 20.0) << name(format);
+   }
+   ASSERT_THROW((void)game::decodeBlocks(std::vector<std::byte>(8), game::BlockFormat::BC7, 4, 4), game::Exception);
+}
+
+TEST(block_compression, flat_blocks_are_exact) {
+   auto flat = game::Image{8, 8, {}};
+   for (auto i = 0; i < 64; ++i) {
+      flat.pixels.insert(flat.pixels.end(), {std::byte{201}, std::byte{37}, std::byte{90}, std::byte{255}});
+   }
+   for (const auto format: FORMATS) {
+      for (const auto quality: QUALITIES) {
+         const auto decoded = game::decodeBlocks(game::encodeBlocks(flat, format, quality), format, 8, 8);
+         /// BC7 endpoints have 7 bits and a shared p-bit: one off at most
+         ASSERT_GT(game::psnr(flat, decoded, channels(format)), format == game::BlockFormat::BC7 ? 45.0 : 99.0)
+            << name(format) << " " << name(quality);
+      }
+   }
+}
+
+TEST(block_compression, quality_levels_trade_time_for_error) {
+   for (const auto alpha: {false, true}) {
+      const auto image = gradient(128, 128, alpha);
+      for (const auto format: FORMATS) {
+         auto previous = 0.0;
+         for (const auto quality: QUALITIES) {
+            const auto decoded = game::decodeBlocks(game::encodeBlocks(image, format, quality), format, 128, 128);
+            const auto db = game::psnr(image, decoded, channels(format));
+            ASSERT_GT(db, 33.0) << name(format) << " " << name(quality);
+            ASSERT_GE(db, previous - 0.05) << name(format) << " " << name(quality);
+            previous = db;
+         }
+      }
+   }
+}
+
+TEST(block_compression, mip_chains_compress_level_by_level) {
+   const auto chain = game::buildMipChain(gradient(64, 32, false), game::MipFilter::Box, game::ColorSpace::Srgb);
+   const auto compressed = game::compressMipChain(chain, game::BlockFormat::BC7, game::EncodeQuality::Fast);
+   ASSERT_EQ(compressed.width, 64u);
+   ASSERT_EQ(compressed.height, 32u);
+   ASSERT_EQ(compressed.levels.size(), chain.levels.size());
+   for (auto i = size_t{0}; i < chain.levels.size(); ++i) {
+      ASSERT_EQ(compressed.levels[i].size(),
+         game::compressedSize(game::BlockFormat::BC7, chain.levels[i].width, chain.levels[i].height));
+   }
+}
+
+TEST(block_compression, DISABLED_encode_throughput_and_psnr) {
+   const auto colour = asset("container2.png");
+   const auto roughness = asset("rustediron1-alt2-Unreal-Engine/rustediron2_roughness.png");
+   for (const auto format: FORMATS) {
+      const auto& image = format == game::BlockFormat::BC4 ? roughness : colour;
+      for (const auto quality: QUALITIES) {
+         const auto start = std::chrono::steady_clock::now();
+         const auto blocks = game::encodeBlocks(image, format, quality);
+         const auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+         const auto decoded = game::decodeBlocks(blocks, format, image.width, image.height);
+         std::println("{} {} of {}x{}: {:.1f} Mtexel/s, {:.2f} dB", name(format), name(quality), image.width,
+            image.height, static_cast<double>(image.width) * image.height / seconds / 1e6,
+            game::psnr(image, decoded, channels(format)));
+      }
+   }
+}
@@ -0,0 +1,118 @@
+#include <gtest/gtest.h>
+
+#include "channel_packing.cpp"
+#include "mip_chain.hpp"
+#include "simd_compat.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+#include <random>
+#include <ranges>
+
+namespace {
+
+auto filled(const std::uint32_t width, const std::uint32_t height, const std::uint32_t seed) -> game::Image {
+   auto random = std::mt19937{seed};
+   auto image = game::Image{width, height, std::vector<std::byte>(size_t{width} * height * 4)};
+   for (auto& p: image.pixels) {
+      p = static_cast<std::byte>(random() % 256);
+   }
+   return image;
+}
+
+auto at(const game::Image& image, const size_t texel, const size_t channel) -> int {
+   return std::to_integer<int>(image.pixels[texel * 4 + channel]);
+}
+
+/// tangent space normals tilted up to 80 degrees away from Z
+auto normals(const std::uint32_t width, const std::uint32_t height) -> game::Image {
+   auto random = std::mt19937{7};
+   auto angle = std::uniform_real_distribution<float>{0.0f, 2.0f * std::numbers::pi_v<float>};
+   auto tilt = std::uniform_real_distribution<float>{0.0f, 80.0f * std::numbers::pi_v<float> / 180.0f};
+   auto image = game::Image{width, height, std::vector<std::byte>(size_t{width} * height * 4)};
+   const auto unorm = [](const float v) {return static_cast<std::byte>(std::lround((v * 0.5f + 0.5f) * 255.0f));};
+   for (auto i = size_t{0}; i < size_t{width} * height; ++i) {
+      const auto phi = angle(random);
+      const auto theta = tilt(random);
+      image.pixels[i * 4 + 0] = unorm(std::sin(theta) * std::cos(phi));
+      image.pixels[i * 4 + 1] = unorm(std::sin(theta) * std::sin(phi));
+      image.pixels[i * 4 + 2] = unorm(std::cos(theta));
+      image.pixels[i * 4 + 3] = std::byte{255};
+   }
+   return image;
+}
+
+/// the normal the shader rebuilds from a packed texel
+auto rebuilt(const game::Image& xy, const size_t texel) -> simd::float3 {
+   const auto x = static_cast<float>(at(xy, texel, 0)) / 255.0f * 2.0f - 1.0f;
+   const auto y = static_cast<float>(at(xy, texel, 1)) / 255.0f * 2.0f - 1.0f;
+   return simd::normalize(simd::float3{x, y, std::sqrt(std::clamp(1.0f - x * x - y * y, 0.0f, 1.0f))});
+}
+
+auto original(const game::Image& normal, const size_t texel) -> simd::float3 {
+   const auto channel = [&](const size_t c) {return static_cast<float>(at(normal, texel, c)) / 255.0f * 2.0f - 1.0f;};
+   return simd::normalize(simd::float3{channel(0), channel(1), channel(2)});
+}
+
+}
+
+TEST(channel_packing, orm_takes_the_red_channels) {
+   const auto occlusion = filled(33, 17, 1);
+   const auto roughness = filled(33, 17, 2);
+   const auto metallic = filled(33, 17, 3);
+
+   const auto orm = game::packOrm(&occlusion, roughness, metallic);
+   ASSERT_EQ(orm.width, 33u);
+   ASSERT_EQ(orm.height, 17u);
+   ASSERT_EQ(orm.pixels.size(), roughness.pixels.size());
+   for (auto i = size_t{0}; i < size_t{orm.width} * orm.height; ++i) {
+      ASSERT_EQ(at(orm, i, 0), at(occlusion, i, 0));
+      ASSERT_EQ(at(orm, i, 1), at(roughness, i, 0));
+      ASSERT_EQ(at(orm, i, 2), at(metallic, i, 0));
+      ASSERT_EQ(at(orm, i, 3), 255);
+   }
+
+   /// without occlusion nothing is shadowed
+   const auto unoccluded = game::packOrm(nullptr, roughness, metallic);
+   for (auto i = size_t{0}; i < size_t{orm.width} * orm.height; ++i) {
+      ASSERT_EQ(at(unoccluded, i, 0), 255);
+      ASSERT_EQ(at(unoccluded, i, 1), at(roughness, i, 0));
+   }
+
+   ASSERT_THROW((void)game::packOrm(nullptr, roughness, filled(32, 17, 3)), game::Exception);
+   ASSERT_THROW((void)game::packOrm(&metallic, filled(33, 16, 2), filled(33, 16, 3)), game::Exception);
+}
+
+TEST(channel_packing, normal_xy_rebuilds_z) {
+   const auto normal = normals(64, 64);
+   const auto xy = game::packNormalXY(normal);
+   ASSERT_EQ(xy.width, normal.width);
+   ASSERT_EQ(xy.height, normal.height);
+
+   auto worst = 1.0f;
+   for (auto i = size_t{0}; i < size_t{xy.width} * xy.height; ++i) {
+      ASSERT_EQ(at(xy, i, 2), 0);
+      ASSERT_EQ(at(xy, i, 3), 255);
+      worst = std::min(worst, simd::dot(rebuilt(xy, i), original(normal, i)));
+   }
+   /// within two degrees: at 80 degrees Z moves six times as fast as X and Y, 8 bits of them fall short
+   ASSERT_GT(worst, std::cos(2.0f * std::numbers::pi_v<float> / 180.0f));
+
+   /// pointing into the surface: kept on it, Z cannot be rebuilt negative
+   auto inward = game::Image{1, 1, {std::byte{255}, std::byte{128}, std::byte{0}, std::byte{255}}};
+   const auto flat = rebuilt(game::packNormalXY(inward), 0);
+   ASSERT_GT(flat.x, 0.99f);
+}
+
+/// filtered normals are shorter than one, packing every level puts them
+/// back on the sphere before Z is dropped
+TEST(channel_packing, normal_mips_stay_unit_length) {
+   const auto chain = game::buildMipChain(normals(64, 64), game::MipFilter::Box, game::ColorSpace::Linear);
+   for (const auto& level: chain.levels | std::views::drop(1)) {
+      const auto xy = game::packNormalXY(level);
+      for (auto i = size_t{0}; i < size_t{xy.width} * xy.height; ++i) {
+         ASSERT_GT(simd::dot(rebuilt(xy, i), original(level, i)), std::cos(2.0f * std::numbers::pi_v<float> / 180.0f));
+      }
+   }
+}
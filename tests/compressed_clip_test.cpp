@@ -0,0 +1,144 @@
+#include <gtest/gtest.h>
+
+#include "compressed_clip.cpp"
+
+#include <chrono>
+#include <cmath>
+#include <numbers>
+#include <print>
+#include <random>
+
+namespace {
+
+constexpr auto JOINTS = 60u;
+constexpr auto DURATION = 10.0f;
+
+auto axisAngle(const simd::float3 axis, const float angle) -> simd::float4 {
+   return simd::make_float4(simd::normalize(axis) * std::sin(angle / 2.0f), std::cos(angle / 2.0f));
+}
+
+/// keys at 30 per second like an FBX bake: a third of the joints never
+/// move, the others swing and some of them also translate
+auto rawClip() -> game::AnimationClip {
+   auto clip = game::AnimationClip{.name = "walk", .duration = DURATION, .tracks = std::vector<game::JointTrack>(JOINTS)};
+   constexpr auto keys = static_cast<std::uint32_t>(DURATION * 30.0f) + 1;
+   for (auto j = 0u; j < JOINTS; ++j) {
+      auto& track = clip.tracks[j];
+      const auto phase = static_cast<float>(j) * 0.37f;
+      const auto axis = simd::make_float3(std::sin(phase), 1.0f, std::cos(phase));
+      for (auto k = 0u; k < keys; ++k) {
+         const auto time = static_cast<float>(k) / 30.0f;
+         const auto moving = j % 3 != 0;
+         const auto swing = moving ? 0.6f * std::sin(2.0f * std::numbers::pi_v<float> * time + phase) : 0.3f;
+         track.rotations.times.push_back(time);
+         track.rotations.values.push_back(axisAngle(axis, swing));
+         track.translations.times.push_back(time);
+         track.translations.values.push_back({0.0f, 0.1f, j % 5 == 0 ? 0.2f * std::sin(time + phase) : 0.0f});
+         track.scales.times.push_back(time);
+         track.scales.values.push_back({1.0f, 1.0f, 1.0f});
+      }
+   }
+   return clip;
+}
+
+auto rawBytes(const game::AnimationClip& clip) -> size_t {
+   auto bytes = sizeof(clip) + clip.name.size() + clip.tracks.size() * sizeof(game::JointTrack);
+   for (const auto& t: clip.tracks) {
+      bytes += (t.translations.times.size() + t.rotations.times.size() + t.scales.times.size()) * sizeof(float) +
+         t.translations.values.size() * sizeof(simd::float3) +
+         t.rotations.values.size() * sizeof(simd::float4) +
+         t.scales.values.size() * sizeof(simd::float3);
+   }
+   return bytes;
+}
+
+auto rotationError(const simd::float4 a, const simd::float4 b) -> float {
+   return std::min(simd::length(a - b), simd::length(a + b));
+}
+
+}
+
+TEST(compressed_clip, within_tolerance) {
+   const auto clip = rawClip();
+   const auto settings = game::ClipCompression{};
+   const auto compressed = game::CompressedClip::compress(clip, settings);
+   ASSERT_EQ(compressed.getJointCount(), JOINTS);
+   ASSERT_GT(static_cast<double>(rawBytes(clip)) / static_cast<double>(compressed.byteSize()), 4.0);
+
+   auto expected = std::vector<game::Transform>(JOINTS);
+   auto sampled = std::vector<game::Transform>(JOINTS);
+   std::mt19937 rng{11};
+   std::uniform_real_distribution<float> times{0.0f, DURATION};
+   auto worst_rotation = 0.0f;
+   auto worst_translation = 0.0f;
+   for (auto i = 0; i < 2000; ++i) {
+      /// the ends and segment boundaries as well as random times
+      const auto time = i == 0 ? 0.0f : i == 1 ? DURATION : i < 40 ? static_cast<float>(i) * 16.0f / 30.0f : times(rng);
+      clip.sample(time, expected);
+      compressed.sample(time, sampled);
+      for (auto j = 0u; j < JOINTS; ++j) {
+         worst_rotation = std::max(worst_rotation, rotationError(expected[j].rotation, sampled[j].rotation));
+         worst_translation = std::max(worst_translation, simd::length(expected[j].translation - sampled[j].translation));
+         ASSERT_LT(simd::length(expected[j].scale - sampled[j].scale), 1e-6f);
+      }
+   }
+   /// reduction tolerance plus quantization
+   ASSERT_LT(worst_rotation, settings.rotationTolerance + 1e-4f);
+   ASSERT_LT(worst_translation, settings.translationTolerance + 1e-5f);
+}
+
+TEST(compressed_clip, fractional_frame_counts_end_on_the_last_key) {
+   /// 30.3 frames: the last one is a third of a frame after the one before
+   constexpr auto duration = 1.01f;
+   auto clip = game::AnimationClip{.name = "reach", .duration = duration, .tracks = std::vector<game::JointTrack>(1)};
+   clip.tracks[0].translations = {{0.0f, duration}, {{0.0f, 0.0f, 0.0f}, {duration, 0.0f, 0.0f}}};
+   const auto compressed = game::CompressedClip::compress(clip);
+   auto expected = std::vector<game::Transform>(1);
+   auto sampled = std::vector<game::Transform>(1);
+   for (const auto time: {0.0f, 0.5f, 29.0f / 30.0f, 0.99f, 1.0f, 1.005f, duration}) {
+      clip.sample(time, expected);
+      compressed.sample(time, sampled);
+      ASSERT_NEAR(sampled[0].translation.x, expected[0].translation.x, 1e-4f) << time;
+   }
+}
+
+TEST(compressed_clip, constant_clip_keeps_one_key) {
+   auto clip = game::AnimationClip{.name = "idle", .duration = 1.0f, .tracks = std::vector<game::JointTrack>(2)};
+   const auto q = axisAngle({1.0f, 0.0f, 0.0f}, 1.0f);
+   clip.tracks[1].rotations = {{0.0f, 0.5f, 1.0f}, {q, q, q}};
+   const auto compressed = game::CompressedClip::compress(clip);
+   auto pose = std::vector<game::Transform>(2);
+   compressed.sample(0.7f, pose);
+   ASSERT_LT(rotationError(pose[1].rotation, q), 1e-4f);
+   ASSERT_LT(simd::length(pose[0].translation), 1e-6f);
+   /// two segments, three channels of two joints with a single key each
+   ASSERT_LT(compressed.byteSize(), sizeof(compressed) + 2 * 2 * 3 * (1 + 1 + 6) + 256);
+}
+
+TEST(compressed_clip, DISABLED_benchmark_ratio_and_sampling) {
+   const auto clip = rawClip();
+   const auto start = std::chrono::steady_clock::now();
+   const auto compressed = game::CompressedClip::compress(clip);
+   const auto built = std::chrono::steady_clock::now();
+
+   const auto ratio = static_cast<double>(rawBytes(clip)) / static_cast<double>(compressed.byteSize());
+   ASSERT_GT(ratio, 4.0);
+
+   constexpr auto samples = 20000;
+   auto pose = std::vector<game::Transform>(JOINTS);
+   const auto time_sampling = [&](const auto& c) {
+      const auto begin = std::chrono::steady_clock::now();
+      for (auto i = 0; i < samples; ++i) {
+         c.sample(static_cast<float>(i) * 0.0137f, pose);
+      }
+      return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+   };
+   const auto raw_seconds = time_sampling(clip);
+   const auto compressed_seconds = time_sampling(compressed);
+
+   std::println("compressed clip: {} joints over {}s, {} KB raw, {} KB compressed ({:.1f}x) in {:.2f} ms",
+      JOINTS, DURATION, rawBytes(clip) / 1024, compressed.byteSize() / 1024, ratio,
+      std::chrono::duration<double, std::milli>(built - start).count());
+   std::println("compressed clip: {:.2f} M joint samples/s raw, {:.2f} M joint samples/s compressed",
+      samples * JOINTS / raw_seconds / 1e6, samples * JOINTS / compressed_seconds / 1e6);
+}
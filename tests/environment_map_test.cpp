@@ -0,0 +1,169 @@
+#include <gtest/gtest.h>
+
+#include "environment_map.cpp"
+
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <numbers>
+#include <print>
+#include <random>
+
+namespace {
+
+/// an equirectangular image whose texels hold the direction they look along
+auto directions(const std::uint32_t width, const std::uint32_t height) -> game::HdrImage {
+   auto image = game::HdrImage{width, height, std::vector<float>(size_t{width} * height * 4)};
+   for (auto y = size_t{0}; y < height; ++y) {
+      const auto theta = (static_cast<float>(y) + 0.5f) / static_cast<float>(height) * std::numbers::pi_v<float>;
+      for (auto x = size_t{0}; x < width; ++x) {
+         const auto phi = ((static_cast<float>(x) + 0.5f) / static_cast<float>(width) - 0.5f)
+            * 2.0f * std::numbers::pi_v<float>;
+         auto* const p = image.pixels.data() + (y * width + x) * 4;
+         p[0] = std::sin(theta) * std::cos(phi);
+         p[1] = std::cos(theta);
+         p[2] = std::sin(theta) * std::sin(phi);
+         p[3] = 1.0f;
+      }
+   }
+   return image;
+}
+
+auto texel(const game::HalfChain& face, const size_t level, const size_t x, const size_t y) -> simd::float4 {
+   const auto size = size_t{face.width >> level};
+   const auto* const p = face.levels[level].data() + (y * size + x) * 4;
+   return simd::float4{game::fromHalf(p[0]), game::fromHalf(p[1]), game::fromHalf(p[2]), game::fromHalf(p[3])};
+}
+
+auto direction(const simd::float4& t) -> simd::float3 {
+   return simd::normalize(simd::float3{t.x, t.y, t.z});
+}
+
+}
+
+TEST(environment_map, halves_round_to_nearest) {
+   for (const auto value: {0.0f, 1.0f, -2.5f, 0.5f, 65504.0f, std::ldexp(1.0f, -24), std::ldexp(1.0f, -14)}) {
+      ASSERT_EQ(game::fromHalf(game::toHalf(value)), value);
+   }
+   ASSERT_EQ(game::toHalf(1.0f), 0x3c00u);
+   ASSERT_EQ(game::toHalf(-0.0f), 0x8000u);
+   /// halfway between 1 and the next half: to the even one
+   ASSERT_EQ(game::toHalf(1.0f + std::ldexp(1.0f, -11)), 0x3c00u);
+   ASSERT_EQ(game::toHalf(1.0f + 3.0f * std::ldexp(1.0f, -11)), 0x3c02u);
+   ASSERT_TRUE(std::isinf(game::fromHalf(game::toHalf(70000.0f))));
+   ASSERT_TRUE(std::isinf(game::fromHalf(game::toHalf(std::numeric_limits<float>::infinity()))));
+   ASSERT_TRUE(std::isnan(game::fromHalf(game::toHalf(std::numeric_limits<float>::quiet_NaN()))));
+   ASSERT_EQ(game::toHalf(std::ldexp(1.0f, -26)), 0u);
+
+   /// within half a unit in the last place, relative, across the range a sky covers
+   auto random = std::mt19937{3};
+   auto exponent = std::uniform_real_distribution<float>{-14.0f, 15.0f};
+   for (auto i = 0; i < 100000; ++i) {
+      const auto value = std::exp2(exponent(random));
+      ASSERT_LE(std::abs(game::fromHalf(game::toHalf(value)) - value), value * std::ldexp(1.0f, -11)) << value;
+   }
+}
+
+TEST(environment_map, face_size_is_a_power_of_two) {
+   ASSERT_EQ(game::cubeFaceSize({2048, 1024}, game::TextureQuality::High), 512u);
+   ASSERT_EQ(game::cubeFaceSize({2048, 1024}, game::TextureQuality::Low), 128u);
+   ASSERT_EQ(game::cubeFaceSize({3000, 1500}, game::TextureQuality::Medium), 256u);
+   ASSERT_EQ(game::cubeFaceSize({2, 1}, game::TextureQuality::Low), 1u);
+   ASSERT_THROW((void)game::equirectToCube(directions(64, 32), 12), game::Exception);
+}
+
+TEST(environment_map, faces_look_along_their_axes) {
+   const auto faces = game::equirectToCube(directions(256, 128), 32);
+   const auto axes = std::array{
+      simd::float3{1.0f, 0.0f, 0.0f}, simd::float3{-1.0f, 0.0f, 0.0f},
+      simd::float3{0.0f, 1.0f, 0.0f}, simd::float3{0.0f, -1.0f, 0.0f},
+      simd::float3{0.0f, 0.0f, 1.0f}, simd::float3{0.0f, 0.0f, -1.0f}};
+   for (auto face = size_t{0}; face < faces.size(); ++face) {
+      ASSERT_EQ(faces[face].levels.size(), 6u);
+      /// the four centre texels lean a little off the axis, towards their corner
+      ASSERT_GT(simd::dot(direction(texel(faces[face], 0, 16, 16)), axes[face]), 0.99f) << face;
+      ASSERT_NEAR(texel(faces[face], 0, 16, 16).w, 1.0f, 1e-3f);
+   }
+   /// the side faces have up at the top; right is +X seen from +Z and -Z seen from +X
+   for (const auto face: {0, 1, 4, 5}) {
+      ASSERT_GT(direction(texel(faces[face], 0, 16, 0)).y, 0.6f) << face;
+   }
+   ASSERT_GT(direction(texel(faces[4], 0, 31, 16)).x, 0.6f);
+   ASSERT_LT(direction(texel(faces[0], 0, 31, 16)).z, -0.6f);
+   /// the top face: its bottom row borders +Z
+   ASSERT_GT(direction(texel(faces[2], 0, 16, 31)).z, 0.6f);
+}
+
+TEST(environment_map, levels_average_the_one_before) {
+   auto sky = directions(128, 64);
+   /// radiance well past what 8 bits hold
+   for (auto& p: sky.pixels) {
+      p = std::abs(p) * 1000.0f;
+   }
+   const auto faces = game::equirectToCube(sky, 16);
+   for (const auto& face: faces) {
+      for (auto level = size_t{1}; level < face.levels.size(); ++level) {
+         const auto size = size_t{face.width >> level};
+         for (auto y = size_t{0}; y < size; ++y) {
+            for (auto x = size_t{0}; x < size; ++x) {
+               const auto average = (texel(face, level - 1, x * 2, y * 2) + texel(face, level - 1, x * 2 + 1, y * 2)
+                  + texel(face, level - 1, x * 2, y * 2 + 1) + texel(face, level - 1, x * 2 + 1, y * 2 + 1)) * 0.25f;
+               const auto t = texel(face, level, x, y);
+               for (auto c = 0; c < 4; ++c) {
+                  /// both sides rounded to halves on their own
+                  ASSERT_NEAR(t[c], average[c], std::max(average[c], 1.0f) * 2e-3f);
+               }
+            }
+         }
+      }
+   }
+}
+
+TEST(environment_map, coordinates_invert_directions) {
+   for (auto face = size_t{0}; face < game::CUBE_FACES; ++face) {
+      for (const auto s: {-0.9f, -0.25f, 0.0f, 0.6f}) {
+         for (const auto t: {-0.7f, 0.1f, 0.95f}) {
+            /// the length of the direction does not matter
+            const auto [back, u, v] = game::cubeCoordinates(game::cubeDirection(face, s, t) * 3.0f);
+            ASSERT_EQ(back, face);
+            ASSERT_NEAR(u, s, 1e-6f);
+            ASSERT_NEAR(v, t, 1e-6f);
+         }
+      }
+   }
+}
+
+TEST(environment_map, faces_are_linearised_and_resized) {
+   auto faces = std::vector<game::Image>{};
+   for (auto face = size_t{0}; face < game::CUBE_FACES; ++face) {
+      /// one face larger than the cube, to be resized
+      const auto size = face == 3 ? 32u : 16u;
+      auto image = game::Image{size, size, std::vector<std::byte>(size_t{size} * size * 4)};
+      for (auto i = size_t{0}; i < image.pixels.size(); ++i) {
+         image.pixels[i] = std::byte{static_cast<std::uint8_t>(i % 4 == 3 ? 255 : face * 40)};
+      }
+      faces.push_back(std::move(image));
+   }
+   const auto cube = game::cubeFromFaces(faces, 16);
+   for (auto face = size_t{0}; face < game::CUBE_FACES; ++face) {
+      ASSERT_EQ(cube[face].levels.size(), 5u);
+      const auto expected = std::pow((static_cast<float>(face * 40) / 255.0f + 0.055f) / 1.055f, 2.4f);
+      for (const auto level: {size_t{0}, size_t{4}}) {
+         const auto t = texel(cube[face], level, 0, 0);
+         ASSERT_NEAR(t.x, face == 0 ? 0.0f : expected, 2e-3f) << face;
+         ASSERT_NEAR(t.w, 1.0f, 1e-3f);
+      }
+   }
+   ASSERT_THROW((void)game::cubeFromFaces(std::span{faces}.first(5), 16), game::Exception);
+}
+
+TEST(environment_map, DISABLED_conversion_time) {
+   const auto sky = directions(4096, 2048);
+   const auto face_size = game::cubeFaceSize({sky.width, sky.height}, game::TextureQuality::High);
+   const auto start = std::chrono::steady_clock::now();
+   const auto faces = game::equirectToCube(sky, face_size);
+   const auto ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+   std::println("equirectangular {}x{} to six {}x{} half float faces with mips: {:.1f} ms ({:.1f} Mtexel/s)",
+      sky.width, sky.height, face_size, face_size, ms, 6.0 * face_size * face_size / ms / 1000.0);
+   ASSERT_EQ(faces.front().levels.size(), 11u);
+}
@@ -0,0 +1,198 @@
+#include <gtest/gtest.h>
+
+#include "image_based_lighting.cpp"
+
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <numbers>
+#include <print>
+
+namespace {
+
+constexpr float PI = std::numbers::pi_v<float>;
+
+/// a cube whose radiance along every direction is radiance(direction),
+/// levels box filtered from the first as equirectToCube() does
+template <typename F>
+auto halfCube(const std::uint32_t face_size, F radiance) -> std::array<game::HalfChain, 6> {
+   auto faces = std::array<game::HalfChain, 6>{};
+   for (auto face = size_t{0}; face < faces.size(); ++face) {
+      faces[face].width = face_size;
+      faces[face].height = face_size;
+      auto values = std::vector<float>(size_t{face_size} * face_size);
+      for (auto y = size_t{0}; y < face_size; ++y) {
+         for (auto x = size_t{0}; x < face_size; ++x) {
+            values[y * face_size + x] = radiance(game::texelDirection(face, x, y, face_size));
+         }
+      }
+      for (auto size = size_t{face_size}; size > 0; size /= 2) {
+         if (size != face_size) {
+            auto next = std::vector<float>(size * size);
+            for (auto y = size_t{0}; y < size; ++y) {
+               for (auto x = size_t{0}; x < size; ++x) {
+                  const auto* const above = values.data() + y * 2 * size * 2 + x * 2;
+                  next[y * size + x] = (above[0] + above[1] + above[size * 2] + above[size * 2 + 1]) * 0.25f;
+               }
+            }
+            values = std::move(next);
+         }
+         auto& level = faces[face].levels.emplace_back(size * size * 4);
+         for (auto i = size_t{0}; i < size * size; ++i) {
+            for (auto c = 0; c < 4; ++c) {
+               level[i * 4 + c] = game::toHalf(c == 3 ? 1.0f : values[i]);
+            }
+         }
+      }
+   }
+   return faces;
+}
+
+template <typename F>
+auto cube(const std::uint32_t face_size, F radiance) -> game::FloatCube {
+   return game::toFloats(halfCube(face_size, radiance));
+}
+
+/// a sky lit from above only, brighter towards the zenith
+auto overcast(const simd::float3 direction) -> float {
+   return std::max(direction.y, 0.0f) * 4.0f;
+}
+
+/// the cosine weighted integral of radiance over the hemisphere around normal
+template <typename F>
+auto bruteForceIrradiance(const simd::float3 normal, F radiance) -> float {
+   constexpr auto STEPS = 512;
+   auto irradiance = 0.0f;
+   for (auto i = 0; i < STEPS; ++i) {
+      const auto theta = (static_cast<float>(i) + 0.5f) / STEPS * PI;
+      for (auto j = 0; j < STEPS * 2; ++j) {
+         const auto phi = (static_cast<float>(j) + 0.5f) / (STEPS * 2) * 2.0f * PI;
+         const auto direction = simd::float3{std::sin(theta) * std::cos(phi), std::cos(theta),
+            std::sin(theta) * std::sin(phi)};
+         const auto cosine = simd::dot(direction, normal);
+         if (cosine > 0.0f) {
+            irradiance += radiance(direction) * cosine * std::sin(theta) * (PI / STEPS) * (PI / STEPS);
+         }
+      }
+   }
+   return irradiance;
+}
+
+auto texel(const game::HalfChain& face, const size_t level, const size_t x, const size_t y) -> float {
+   const auto size = size_t{face.width >> level};
+   return game::fromHalf(face.levels[level][(y * size + x) * 4]);
+}
+
+}
+
+TEST(image_based_lighting, constant_sky_irradiance_is_pi_times_radiance) {
+   const auto sh = game::irradianceSH(cube(32, [](simd::float3) {return 2.0f;}));
+   for (const auto normal: {simd::float3{1.0f, 0.0f, 0.0f}, simd::float3{0.0f, -1.0f, 0.0f},
+      simd::float3{0.3f, 0.5f, -0.8f}}) {
+      const auto irradiance = game::evaluate(sh, normal);
+      for (const auto channel: {irradiance.x, irradiance.y, irradiance.z}) {
+         ASSERT_NEAR(channel, 2.0f * PI, 2.0f * PI * 1e-2f);
+      }
+   }
+   /// the alpha channel is not light
+   ASSERT_EQ(sh.coefficients[0].w, 0.0f);
+}
+
+TEST(image_based_lighting, irradiance_matches_brute_force) {
+   /// a cube larger than the projection reads, to cover picking a smaller level
+   const auto sh = game::irradianceSH(cube(128, overcast));
+   for (const auto normal: {simd::float3{0.0f, 1.0f, 0.0f}, simd::float3{1.0f, 0.0f, 0.0f},
+      simd::normalize(simd::float3{0.2f, 0.7f, -0.4f})}) {
+      const auto expected = bruteForceIrradiance(normal, overcast);
+      /// L2 keeps the low frequencies of the clamped cosine, all but a few percent
+      ASSERT_NEAR(game::evaluate(sh, normal).x, expected, expected * 0.05f);
+   }
+   /// facing the unlit ground: L2 rings a little around zero
+   ASSERT_NEAR(game::evaluate(sh, {0.0f, -1.0f, 0.0f}).x, 0.0f, bruteForceIrradiance({0.0f, 1.0f, 0.0f}, overcast) * 0.05f);
+}
+
+TEST(image_based_lighting, prefiltering_keeps_a_constant_sky) {
+   const auto specular = game::prefilterSpecular(cube(32, [](simd::float3) {return 3.0f;}), 16, 64);
+   for (const auto& face: specular) {
+      ASSERT_EQ(face.levels.size(), 5u);
+      for (auto level = size_t{0}; level < face.levels.size(); ++level) {
+         const auto size = size_t{face.width >> level};
+         for (auto y = size_t{0}; y < size; ++y) {
+            for (auto x = size_t{0}; x < size; ++x) {
+               ASSERT_NEAR(texel(face, level, x, y), 3.0f, 3e-2f) << level;
+            }
+         }
+      }
+   }
+   ASSERT_THROW((void)game::prefilterSpecular(cube(8, overcast), 12, 16), game::Exception);
+}
+
+TEST(image_based_lighting, rougher_levels_blur_more) {
+   /// a sun: the +Y face bright, nothing elsewhere
+   const auto sun = [](const simd::float3 direction) {return direction.y > 0.95f ? 100.0f : 0.0f;};
+   const auto specular = game::prefilterSpecular(cube(64, sun), 32, 128);
+   /// looking straight at it the peak falls as the lobe widens
+   auto peak = std::numeric_limits<float>::infinity();
+   for (auto level = size_t{0}; level < game::SPECULAR_ROUGHNESS_LEVELS; ++level) {
+      const auto size = size_t{32} >> level;
+      const auto centre = texel(specular[2], level, size / 2, size / 2);
+      ASSERT_LE(centre, peak * 1.01f) << level;
+      peak = centre;
+   }
+   ASSERT_GT(texel(specular[2], 0, 16, 16), 50.0f);
+   /// 45 degrees away from it the mirror sees nothing, a rough lobe reaches it
+   ASSERT_LT(texel(specular[4], 0, 16, 0), 1e-3f);
+   ASSERT_GT(texel(specular[4], 3, 2, 0), 1.0f);
+}
+
+TEST(image_based_lighting, cube_faces_skip_the_larger_levels) {
+   const auto path = std::filesystem::temp_directory_path() / "image_based_lighting_test.gtex";
+   const auto faces = halfCube(32, overcast);
+   game::TextureFile::write(path, 7, faces, game::CUBE_FACES);
+   const auto file = game::TextureFile::open(path, 7);
+   ASSERT_TRUE(file.has_value());
+   ASSERT_EQ(file->stamp(), 7u);
+
+   const auto small = game::cubeFaces(*file, 8);
+   for (auto face = size_t{0}; face < game::CUBE_FACES; ++face) {
+      ASSERT_EQ(small[face].width, 8u);
+      ASSERT_EQ(small[face].levels.size(), 4u);
+      for (auto level = size_t{0}; level < small[face].levels.size(); ++level) {
+         ASSERT_EQ(small[face].levels[level], faces[face].levels[level + 2]);
+      }
+   }
+   /// all of them when the first is small enough
+   ASSERT_EQ(game::cubeFaces(*file, 64).front().levels.size(), faces.front().levels.size());
+   std::filesystem::remove(path);
+}
+
+TEST(image_based_lighting, irradiance_cache_round_trips) {
+   const auto path = std::filesystem::temp_directory_path() / "image_based_lighting_test.girr";
+   const auto sh = game::irradianceSH(cube(16, overcast));
+   game::writeIrradianceCache(path, 42, sh);
+
+   const auto read = game::readIrradianceCache(path, 42);
+   ASSERT_TRUE(read.has_value());
+   for (auto i = size_t{0}; i < sh.coefficients.size(); ++i) {
+      for (auto c = 0; c < 4; ++c) {
+         ASSERT_EQ(read->coefficients[i][c], sh.coefficients[i][c]);
+      }
+   }
+   ASSERT_FALSE(game::readIrradianceCache(path, 43).has_value());
+   ASSERT_FALSE(game::readIrradianceCache(path.string() + ".missing", 42).has_value());
+   std::filesystem::remove(path);
+}
+
+TEST(image_based_lighting, DISABLED_bake_time) {
+   const auto sky = cube(256, overcast);
+   const auto start = std::chrono::steady_clock::now();
+   const auto specular = game::prefilterSpecular(sky, 128, 64);
+   const auto prefiltered = std::chrono::steady_clock::now();
+   const auto sh = game::irradianceSH(sky);
+   const auto end = std::chrono::steady_clock::now();
+   std::println("prefiltered six 256x256 faces to {}x{} with {} levels at 64 samples: {:.1f} ms, irradiance: {:.1f} ms",
+      specular.front().width, specular.front().height, specular.front().levels.size(),
+      std::chrono::duration<double, std::milli>(prefiltered - start).count(),
+      std::chrono::duration<double, std::milli>(end - prefiltered).count());
+   ASSERT_GT(game::evaluate(sh, {0.0f, 1.0f, 0.0f}).x, 0.0f);
+}
@@ -0,0 +1,107 @@
+#include <gtest/gtest.h>
+
+#include "lz_compression.cpp"
+
+#include <chrono>
+#include <print>
+#include <random>
+#include <string>
+
+namespace {
+
+auto roundTrip(const std::span<const std::byte> source) -> std::vector<std::byte> {
+   const auto block = game::compressBlock(source);
+   EXPECT_LE(block.size(), game::compressBound(source.size()));
+   auto decoded = std::vector<std::byte>(source.size());
+   game::decompressBlock(block, decoded);
+   return decoded;
+}
+
+/// text the way shaders and OBJ files look: short lines repeating with variations
+auto text(const size_t size) -> std::vector<std::byte> {
+   auto random = std::mt19937{11};
+   auto value = std::uniform_int_distribution<int>{-999, 999};
+   auto lines = std::string{};
+   while (lines.size() < size) {
+      lines += std::format("v {}.{} {}.{} {}.{}\n", value(random), std::abs(value(random)), value(random),
+         std::abs(value(random)), value(random), std::abs(value(random)));
+   }
+   lines.resize(size);
+   const auto bytes = std::as_bytes(std::span{lines});
+   return {bytes.begin(), bytes.end()};
+}
+
+auto noise(const size_t size) -> std::vector<std::byte> {
+   auto random = std::mt19937{5};
+   auto bytes = std::vector<std::byte>(size);
+   for (auto& b: bytes) {
+      b = static_cast<std::byte>(random());
+   }
+   return bytes;
+}
+
+}
+
+TEST(lz_compression, round_trips) {
+   for (const auto size: {size_t{0}, size_t{1}, size_t{11}, size_t{12}, size_t{13}, size_t{100}, size_t{70000},
+      size_t{1} << 20}) {
+      for (const auto& source: {text(size), noise(size), std::vector<std::byte>(size, std::byte{7})}) {
+         ASSERT_EQ(roundTrip(source), source) << size;
+      }
+   }
+   /// runs longer than the offsets reach, and matches far apart
+   auto far = noise(200000);
+   std::copy_n(far.begin(), 1000, far.begin() + 66000);
+   std::copy_n(far.begin() + 10, 1000, far.begin() + 150000);
+   ASSERT_EQ(roundTrip(far), far);
+}
+
+TEST(lz_compression, text_shrinks_noise_does_not_grow_much) {
+   const auto lines = text(1 << 20);
+   const auto compressed = game::compressBlock(lines);
+   ASSERT_LT(compressed.size(), lines.size() * 3 / 4);
+   ASSERT_LT(game::compressBlock(std::vector<std::byte>(1 << 20)).size(), size_t{5000});
+   ASSERT_LE(game::compressBlock(noise(1 << 20)).size(), game::compressBound(1 << 20));
+}
+
+TEST(lz_compression, corrupt_blocks_throw) {
+   const auto lines = text(5000);
+   const auto block = game::compressBlock(lines);
+   auto decoded = std::vector<std::byte>(lines.size());
+   /// cut short, or decoded to the wrong size
+   ASSERT_THROW(game::decompressBlock(std::span{block}.first(block.size() / 2), decoded), game::Exception);
+   auto small = std::vector<std::byte>(lines.size() - 1);
+   ASSERT_THROW(game::decompressBlock(block, small), game::Exception);
+   auto large = std::vector<std::byte>(lines.size() + 1);
+   ASSERT_THROW(game::decompressBlock(block, large), game::Exception);
+   /// an offset before the start of the output
+   const auto back = std::vector{std::byte{0x10}, std::byte{'a'}, std::byte{0x02}, std::byte{0x00}, std::byte{0x00}};
+   auto target = std::vector<std::byte>(5);
+   ASSERT_THROW(game::decompressBlock(back, target), game::Exception);
+   /// random damage never reads or writes out of bounds, at worst it throws
+   auto random = std::mt19937{9};
+   for (auto i = 0; i < 1000; ++i) {
+      auto damaged = block;
+      damaged[random() % damaged.size()] = static_cast<std::byte>(random());
+      try {
+         game::decompressBlock(damaged, decoded);
+      } catch (const game::Exception&) {
+      }
+   }
+}
+
+TEST(lz_compression, DISABLED_speed) {
+   const auto lines = text(16 << 20);
+   const auto start = std::chrono::steady_clock::now();
+   const auto block = game::compressBlock(lines);
+   const auto compressed = std::chrono::steady_clock::now();
+   auto decoded = std::vector<std::byte>(lines.size());
+   game::decompressBlock(block, decoded);
+   const auto end = std::chrono::steady_clock::now();
+   const auto mb = static_cast<double>(lines.size()) / static_cast<double>(1u << 20);
+   std::println("16 MB of text to {:.1f}%: compressed at {:.0f} MB/s, decompressed at {:.0f} MB/s",
+      100.0 * static_cast<double>(block.size()) / static_cast<double>(lines.size()),
+      mb / std::chrono::duration<double>(compressed - start).count(),
+      mb / std::chrono::duration<double>(end - compressed).count());
+   ASSERT_EQ(decoded, lines);
+}
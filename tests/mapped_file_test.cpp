@@ -0,0 +1,118 @@
+#include <gtest/gtest.h>
+
+#include "mapped_file.hpp"
+#include "resource_reader.hpp"
+
+#include <chrono>
+#include <fstream>
+#include <numeric>
+#include <print>
+#include <ranges>
+#include <sstream>
+
+namespace {
+
+auto writeFile(const std::filesystem::path& path, const size_t size) -> std::vector<std::byte> {
+   auto bytes = std::vector<std::byte>(size);
+   for (auto i = size_t{0}; i < size; ++i) {
+      bytes[i] = static_cast<std::byte>(i * 7 + i / 4096);
+   }
+   std::ofstream file{path, std::ios::binary | std::ios::trunc};
+   file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(size));
+   return bytes;
+}
+
+/// what loadBytes did before: a stream, a string and a vector, three copies
+auto streamBytes(const std::filesystem::path& path) -> std::vector<std::byte> {
+   const std::ifstream file{path, std::ios::in | std::ios::binary};
+   std::stringstream stream{};
+   stream << file.rdbuf();
+   return stream.str() | std::views::transform([](auto b) {return static_cast<std::byte>(b);})
+      | std::ranges::to<std::vector>();
+}
+
+/// reads every byte, so that a mapping is faulted in as a decoder would
+auto checksum(const std::span<const std::byte> bytes) -> std::uint64_t {
+   return std::accumulate(bytes.begin(), bytes.end(), std::uint64_t{0},
+      [](const std::uint64_t sum, const std::byte b) {return sum + std::to_integer<std::uint64_t>(b);});
+}
+
+}
+
+TEST(mapped_file, small_files_are_read_large_ones_mapped) {
+   const auto directory = std::filesystem::temp_directory_path();
+   for (const auto size: {size_t{0}, size_t{100}, game::FileContents::MAPPING_THRESHOLD - 1,
+      game::FileContents::MAPPING_THRESHOLD, size_t{3} << 20}) {
+      const auto path = directory / "mapped_file_test.bin";
+      const auto expected = writeFile(path, size);
+      const auto contents = game::FileContents::open(path);
+      ASSERT_EQ(contents.isMapped(), size >= game::FileContents::MAPPING_THRESHOLD) << size;
+      ASSERT_TRUE(std::ranges::equal(contents.bytes(), expected)) << size;
+      std::filesystem::remove(path);
+   }
+   ASSERT_THROW((void)game::FileContents::open(directory / "mapped_file_test.missing"), game::Exception);
+}
+
+TEST(mapped_file, hints_leave_the_contents_alone) {
+   const auto path = std::filesystem::temp_directory_path() / "mapped_file_test_hints.bin";
+   const auto expected = writeFile(path, size_t{5} << 20);
+   const auto contents = game::FileContents::open(path, {.sequential = true, .willNeed = true, .hugePages = true});
+   ASSERT_TRUE(contents.isMapped());
+   ASSERT_TRUE(std::ranges::equal(contents.bytes(), expected));
+
+   /// moved mappings keep their bytes where they are
+   auto mapped = game::MappedFile::open(path, {.sequential = false, .willNeed = true, .hugePages = false});
+   const auto* const data = mapped.data();
+   const auto moved = std::move(mapped);
+   ASSERT_EQ(moved.data(), data);
+   moved.advise({.sequential = true, .willNeed = false, .hugePages = false});
+   ASSERT_TRUE(std::ranges::equal(moved.bytes(), expected));
+   std::filesystem::remove(path);
+}
+
+TEST(mapped_file, loader_reads_what_the_stream_does) {
+   const game::ResourceLoader loader{ROOT_DIR};
+   const auto obj = (std::filesystem::path(ASSETS_DIR) / "Suzanne.obj").string();
+   ASSERT_TRUE(std::ranges::equal(loader.loadBytes(obj).bytes(),
+      streamBytes(std::filesystem::path(ROOT_DIR) / obj)));
+   const auto text = loader.loadString(obj);
+   ASSERT_TRUE(std::ranges::equal(std::as_bytes(std::span{text}), loader.loadBytes(obj).bytes()));
+}
+
+TEST(mapped_file, DISABLED_throughput) {
+   const auto root = std::filesystem::path(ROOT_DIR) / ASSETS_DIR;
+   auto paths = std::vector<std::filesystem::path>{};
+   for (const auto& directory: {root / "rustediron1-alt2-Unreal-Engine", root / "skybox"}) {
+      for (const auto& entry: std::filesystem::directory_iterator{directory}) {
+         if (entry.path().extension() == ".png" or entry.path().extension() == ".jpg") {
+            paths.push_back(entry.path());
+         }
+      }
+   }
+   ASSERT_FALSE(paths.empty());
+   const game::ResourceLoader loader{root};
+
+   /// each pass after a warm up one, so both read from the page cache
+   const auto time = [&](auto load) {
+      auto sum = std::uint64_t{0};
+      for (const auto& path: paths) {
+         sum += load(path);
+      }
+      const auto start = std::chrono::steady_clock::now();
+      auto bytes = size_t{0};
+      for (const auto& path: paths) {
+         sum -= load(path);
+         bytes += std::filesystem::file_size(path);
+      }
+      const auto ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+      EXPECT_EQ(sum, 0u);
+      return std::pair{ms, static_cast<double>(bytes) / static_cast<double>(1u << 20) / ms * 1000.0};
+   };
+   const auto [stream_ms, stream_rate] = time([](const auto& path) {return checksum(streamBytes(path));});
+   const auto [mapped_ms, mapped_rate] = time([&](const auto& path) {
+      return checksum(loader.loadBytes(path.lexically_relative(root).string(), {.sequential = true,
+         .willNeed = true, .hugePages = false}).bytes());
+   });
+   std::println("{} PNGs and JPEGs, stream and copies: {:.2f} ms ({:.0f} MB/s), mapped: {:.2f} ms ({:.0f} MB/s)",
+      paths.size(), stream_ms, stream_rate, mapped_ms, mapped_rate);
+}
@@ -0,0 +1,82 @@
+#include <gtest/gtest.h>
+
+#include "mapped_file.cpp"
+#include "mesh_cache.cpp"
+#include "mesh_factory.cpp"
+#include "memory_stats.hpp"
+#include "primitives.hpp"
+
+#include <chrono>
+#include <filesystem>
+#include <print>
+
+namespace {
+
+auto temporary(const std::string_view name) -> std::filesystem::path {
+   return std::filesystem::temp_directory_path() / std::format("game_tutorial_{}", name);
+}
+
+auto aligned(const void* p) -> bool {
+   return reinterpret_cast<std::uintptr_t>(p) % game::MappedFile::pageSize() == 0;
+}
+
+}
+
+TEST(mesh_cache, round_trip) {
+   auto mesh = game::primitives::uvSphere(1.0f, 32, 64);
+   const auto original = mesh;
+   const auto meshlets = game::MeshFactory::buildMeshlets(mesh);
+   const auto path = temporary("round_trip.mesh");
+
+   game::MeshCache::Writer writer{path, static_cast<std::uint32_t>(mesh.vertices.size()),
+      static_cast<std::uint32_t>(mesh.indexes.size())};
+   std::ranges::copy(mesh.vertices, writer.vertices().begin());
+   writer.setIndexes(mesh.indexes);
+   writer.finish(42, meshlets);
+
+   const auto cache = game::MeshCache::open(path, 42);
+   ASSERT_TRUE(cache.has_value());
+   ASSERT_TRUE(std::ranges::equal(cache->vertices(), original.vertices));
+   ASSERT_EQ(cache->indexSize(), sizeof(std::uint16_t));
+   const auto indexes = reinterpret_cast<const std::uint16_t*>(cache->indexSection().data());
+   for (auto i = 0u; i < mesh.indexes.size(); ++i) {
+      ASSERT_EQ(indexes[i], mesh.indexes[i]);
+   }
+   ASSERT_TRUE(aligned(cache->vertexSection().data()) and aligned(cache->indexSection().data()));
+   ASSERT_EQ(cache->vertexSection().size() % game::MappedFile::pageSize(), 0u);
+   ASSERT_EQ(cache->indexSection().size() % game::MappedFile::pageSize(), 0u);
+
+   const auto read = cache->meshlets();
+   ASSERT_EQ(read.size(), meshlets.size());
+   ASSERT_TRUE(std::ranges::equal(read.vertices, meshlets.vertices));
+   ASSERT_TRUE(std::ranges::equal(read.triangles, meshlets.triangles));
+
+   ASSERT_FALSE(game::MeshCache::open(path, 43).has_value());
+   ASSERT_FALSE(game::MeshCache::open(temporary("missing.mesh"), 42).has_value());
+   std::filesystem::remove(path);
+}
+
+TEST(mesh_cache, import_compared_to_mesh_data) {
+   const auto source = std::filesystem::path(ROOT_DIR) / ASSETS_DIR / "Suzanne.obj";
+   const auto path = temporary("suzanne.mesh");
+   const auto obj = game::MappedFile::open(source);
+
+   const auto start = std::chrono::steady_clock::now();
+   ASSERT_TRUE(game::MeshFactory::importToCache("Suzanne", obj.bytes(), path, game::MeshCache::stamp(source), false));
+   const auto imported = std::chrono::steady_clock::now();
+   const auto cache = game::MeshCache::open(path, game::MeshCache::stamp(source));
+   const auto opened = std::chrono::steady_clock::now();
+   ASSERT_TRUE(cache.has_value());
+
+   game::MeshFactory factory{};
+   const auto mesh = factory.getMeshData("Suzanne", obj.bytes());
+   ASSERT_NE(mesh, nullptr);
+   ASSERT_TRUE(std::ranges::equal(cache->vertices(), mesh->vertices));
+   ASSERT_EQ(cache->indexCount(), mesh->indexes.size());
+
+   std::println("mesh cache: import into the mapped cache {:.2f} ms, mapping it back {:.3f} ms, peak resident {:.1f} MB",
+      std::chrono::duration<double, std::milli>(imported - start).count(),
+      std::chrono::duration<double, std::milli>(opened - imported).count(),
+      static_cast<double>(game::peakResidentBytes()) / static_cast<double>(1u << 20));
+   std::filesystem::remove(path);
+}
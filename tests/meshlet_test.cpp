@@ -0,0 +1,152 @@
+#include <gtest/gtest.h>
+
+#include "meshlet.cpp"
+#include "matrix4.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <numbers>
+#include <print>
+#include <vector>
+
+namespace {
+
+/// latitude/longitude sphere with outward normals and ccw triangles
+auto makeSphere(const std::uint32_t rings, const std::uint32_t segments) -> game::MeshData {
+   auto mesh = game::MeshData{};
+   for (auto r = 0u; r <= rings; ++r) {
+      const auto theta = static_cast<float>(r) * std::numbers::pi_v<float> / static_cast<float>(rings);
+      for (auto s = 0u; s <= segments; ++s) {
+         const auto phi = static_cast<float>(s) * 2.0f * std::numbers::pi_v<float> / static_cast<float>(segments);
+         const auto n = simd::float3{std::cos(phi) * std::sin(theta), std::cos(theta), std::sin(phi) * std::sin(theta)};
+         mesh.vertices.emplace_back(game::VertexData{
+            .position = simd::make_float4(n, 1.0f), .normal = n, .tangent = n, .bitangent = n,
+            .uv = simd::float2{static_cast<float>(s), static_cast<float>(r)}});
+      }
+   }
+   for (auto r = 0u; r < rings; ++r) {
+      for (auto s = 0u; s < segments; ++s) {
+         const auto first = r * (segments + 1) + s;
+         const auto second = first + segments + 1;
+         mesh.indexes.insert(mesh.indexes.end(), {first, first + 1, second, second, first + 1, second + 1});
+      }
+   }
+   return mesh;
+}
+
+auto triangles(const std::vector<std::uint32_t>& indexes) {
+   auto tris = std::vector<std::array<std::uint32_t,3>>{};
+   for (auto i = 0u; i < indexes.size(); i += 3) {
+      tris.push_back({indexes[i], indexes[i + 1], indexes[i + 2]});
+   }
+   std::ranges::sort(tris);
+   return tris;
+}
+
+auto viewProjection(const game::Vector3& eye, const game::Vector3& target) -> simd::float4x4 {
+   const auto proj = game::Matrix4::perspective(std::numbers::pi_v<float> / 4.0f, 1200.0f, 800.0f, 0.1f, 100.0f);
+   const auto view = game::Matrix4::lookAt(eye, target, game::Vector3{0.0f,1.0f,0.0f});
+   return (proj * view).data();
+}
+
+}
+
+TEST(meshlet, limits_and_coverage) {
+   auto mesh = makeSphere(64, 128);
+   const auto original = triangles(mesh.indexes);
+   const auto meshlets = game::MeshFactory::buildMeshlets(mesh);
+
+   ASSERT_FALSE(meshlets.empty());
+   ASSERT_EQ(meshlets.meshlets.size(), meshlets.bounds.size());
+   ASSERT_EQ(triangles(mesh.indexes), original);
+
+   auto covered = size_t{0};
+   for (const auto& m: meshlets.meshlets) {
+      ASSERT_LE(m.vertexCount, 64u);
+      ASSERT_LE(m.triangleCount, 124u);
+      ASSERT_EQ(m.triangleOffset, covered);
+      for (auto t = 0u; t < m.triangleCount * 3; ++t) {
+         const auto local = meshlets.triangles[m.triangleOffset * 3 + t];
+         ASSERT_LT(local, m.vertexCount);
+         ASSERT_EQ(meshlets.vertices[m.vertexOffset + local], mesh.indexes[m.triangleOffset * 3 + t]);
+      }
+      covered += m.triangleCount;
+   }
+   ASSERT_EQ(covered * 3, mesh.indexes.size());
+}
+
+TEST(meshlet, bounds) {
+   auto mesh = makeSphere(32, 64);
+   const auto meshlets = game::MeshFactory::buildMeshlets(mesh);
+
+   for (const auto& [m, b]: std::views::zip(meshlets.meshlets, meshlets.bounds)) {
+      for (auto v = 0u; v < m.vertexCount; ++v) {
+         const auto p = mesh.vertices[meshlets.vertices[m.vertexOffset + v]].position.xyz;
+         ASSERT_LE(simd::length(p - b.center), b.radius * 1.0001f);
+      }
+      /// on a sphere every patch is small enough to have a proper cone
+      ASSERT_LT(b.coneCutoff, 1.0f);
+      ASSERT_GT(simd::dot(b.coneAxis, simd::normalize(b.center)), 0.9f);
+   }
+
+   /// the whole unit sphere, a little larger at most
+   const auto whole = game::MeshFactory::boundingSphere(mesh.vertices);
+   for (const auto& v: mesh.vertices) {
+      ASSERT_LE(simd::length(v.position.xyz - whole.xyz), whole.w * 1.0001f);
+   }
+   ASSERT_LT(whole.w, 1.1f);
+   ASSERT_TRUE(std::isinf(game::MeshFactory::boundingSphere({}).w));
+}
+
+TEST(meshlet, culling) {
+   auto mesh = makeSphere(64, 128);
+   const auto meshlets = game::MeshFactory::buildMeshlets(mesh);
+   std::vector<game::MeshletRange> visible;
+
+   const auto visibleTriangles = [&] {
+      auto count = size_t{0};
+      for (const auto& r: visible) {
+         count += r.triangleCount;
+      }
+      return count;
+   };
+
+   const auto eye = game::Vector3{0.0f,0.0f,5.0f};
+   game::cullMeshlets(meshlets, game::Frustum::fromMatrix(viewProjection(eye, {0.0f,0.0f,0.0f})), eye.data(), visible);
+   const auto front = visibleTriangles();
+   std::println("visible triangles {} of {} in {} draws", front, mesh.indexes.size() / 3, visible.size());
+   ASSERT_GT(front, 0u);
+   /// the back half can be rejected by the cones
+   ASSERT_LT(front, mesh.indexes.size() / 3 * 3 / 4);
+
+   game::cullMeshlets(meshlets, game::Frustum::fromMatrix(viewProjection(eye, {0.0f,0.0f,10.0f})), eye.data(), visible);
+   ASSERT_EQ(visibleTriangles(), 0u);
+}
+
+TEST(meshlet, DISABLED_benchmark) {
+   auto mesh = makeSphere(512, 1024);
+   const auto n_triangles = mesh.indexes.size() / 3;
+
+   const auto start = std::chrono::steady_clock::now();
+   const auto meshlets = game::MeshFactory::buildMeshlets(mesh);
+   const auto built = std::chrono::steady_clock::now();
+
+   constexpr auto frames = 100u;
+   std::vector<game::MeshletRange> visible;
+   auto draws = size_t{0};
+   for (auto f = 0u; f < frames; ++f) {
+      const auto angle = static_cast<float>(f) * 2.0f * std::numbers::pi_v<float> / frames;
+      const auto eye = game::Vector3{5.0f * std::cos(angle), 1.0f, 5.0f * std::sin(angle)};
+      game::cullMeshlets(meshlets, game::Frustum::fromMatrix(viewProjection(eye, {0.0f,0.0f,0.0f})), eye.data(), visible);
+      draws += visible.size();
+   }
+   const auto culled = std::chrono::steady_clock::now();
+
+   const auto build_ms = std::chrono::duration<double, std::milli>(built - start).count();
+   const auto cull_us = std::chrono::duration<double, std::micro>(culled - built).count() / frames;
+   std::println("meshlets: {} triangles -> {} meshlets in {:.2f} ms ({:.2f} Mtri/s)",
+      n_triangles, meshlets.size(), build_ms, static_cast<double>(n_triangles) / build_ms / 1000.0);
+   std::println("culling: {:.2f} us per frame, {:.1f} draws per frame", cull_us,
+      static_cast<double>(draws) / frames);
+   ASSERT_FALSE(meshlets.empty());
+}
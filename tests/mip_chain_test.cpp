@@ -0,0 +1,226 @@
+#include <gtest/gtest.h>
+
+#include "mip_chain.cpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <print>
+#include <random>
+
+namespace {
+
+auto temporary(const std::string_view name) -> std::filesystem::path {
+   return std::filesystem::temp_directory_path() / std::format("game_tutorial_{}", name);
+}
+
+auto image(const std::uint32_t width, const std::uint32_t height, auto&& pixel) -> game::Image {
+   auto result = game::Image{width, height, std::vector<std::byte>(size_t{width} * height * 4)};
+   for (auto y = 0u; y < height; ++y) {
+      for (auto x = 0u; x < width; ++x) {
+         const auto rgba = pixel(x, y);
+         for (auto c = 0u; c < 4; ++c) {
+            result.pixels[(size_t{y} * width + x) * 4 + c] = static_cast<std::byte>(rgba[c]);
+         }
+      }
+   }
+   return result;
+}
+
+auto at(const game::Image& image, const size_t x, const size_t y, const size_t c) -> int {
+   return static_cast<int>(image.pixels[(y * image.width + x) * 4 + c]);
+}
+
+auto noise(const std::uint32_t width, const std::uint32_t height) -> game::Image {
+   auto random = std::mt19937{7};
+   const auto byte = [&] {return static_cast<std::uint32_t>(random() % 256);};
+   return image(width, height, [&](auto, auto) {return std::array{byte(), byte(), byte(), byte()};});
+}
+
+constexpr auto FILTERS = {game::MipFilter::Box, game::MipFilter::Kaiser, game::MipFilter::Lanczos,
+   game::MipFilter::Mitchell};
+
+auto name(const game::MipFilter filter) -> std::string_view {
+   switch (filter) {
+      case game::MipFilter::Box: return "box";
+      case game::MipFilter::Kaiser: return "kaiser";
+      case game::MipFilter::Lanczos: return "lanczos";
+      case game::MipFilter::Mitchell: default: return "mitchell";
+   }
+}
+
+/// a horizontal ramp from 0 to 255, the same on every channel
+auto ramp(const std::uint32_t width, const std::uint32_t height) -> game::Image {
+   return image(width, height, [&](auto x, auto) {
+      const auto v = static_cast<std::uint32_t>(std::lround(255.0 * x / (width - 1)));
+      return std::array{v, v, v, v};
+   });
+}
+constexpr auto SPACES = {game::ColorSpace::Srgb, game::ColorSpace::Linear};
+
+}
+
+TEST(mip_chain, levels_are_laid_out_as_on_the_gpu) {
+   const auto chain = game::buildMipChain(noise(37, 10), game::MipFilter::Box, game::ColorSpace::Srgb);
+   const auto expected = std::vector<std::pair<std::uint32_t, std::uint32_t>>{{37, 10}, {18, 5}, {9, 2}, {4, 1}, {2, 1}, {1, 1}};
+   ASSERT_EQ(chain.levels.size(), expected.size());
+   for (auto i = size_t{0}; i < expected.size(); ++i) {
+      ASSERT_EQ(chain.levels[i].width, expected[i].first);
+      ASSERT_EQ(chain.levels[i].height, expected[i].second);
+      ASSERT_EQ(chain.levels[i].pixels.size(), chain.levels[i].bytesPerRow() * chain.levels[i].height);
+   }
+   ASSERT_EQ(chain.levels[0].pixels, noise(37, 10).pixels);
+   ASSERT_THROW((void)game::buildMipChain(game::Image{}, game::MipFilter::Box, game::ColorSpace::Srgb), game::Exception);
+}
+
+TEST(mip_chain, flat_images_stay_flat) {
+   const auto flat = image(33, 64, [](auto, auto) {return std::array{200u, 17u, 90u, 255u};});
+   for (const auto filter: FILTERS) {
+      for (const auto space: SPACES) {
+         for (const auto& level: game::buildMipChain(flat, filter, space).levels) {
+            for (auto i = size_t{0}; i < level.pixels.size(); ++i) {
+               ASSERT_LE(std::abs(static_cast<int>(level.pixels[i]) - static_cast<int>(flat.pixels[i % 4])), 1);
+            }
+         }
+      }
+   }
+}
+
+/// black and white stripes average to half the light: 188 in sRGB, 128 when taken as data
+TEST(mip_chain, colour_is_averaged_on_linear_light) {
+   const auto stripes = image(16, 16, [](auto x, auto) {
+      const auto v = x % 2 == 0 ? 0u : 255u;
+      return std::array{v, v, v, v};
+   });
+   const auto srgb = game::buildMipChain(stripes, game::MipFilter::Box, game::ColorSpace::Srgb);
+   const auto linear = game::buildMipChain(stripes, game::MipFilter::Box, game::ColorSpace::Linear);
+   for (auto c = size_t{0}; c < 3; ++c) {
+      ASSERT_EQ(at(srgb.levels[1], 3, 5, c), 188);
+      ASSERT_EQ(at(linear.levels[1], 3, 5, c), 128);
+   }
+   /// alpha is coverage, never gamma corrected
+   ASSERT_EQ(at(srgb.levels[1], 3, 5, 3), 128);
+}
+
+TEST(mip_chain, box_is_the_average_of_two_by_two) {
+   const auto source = noise(64, 32);
+   const auto chain = game::buildMipChain(source, game::MipFilter::Box, game::ColorSpace::Linear);
+   const auto& level = chain.levels[1];
+   for (auto y = size_t{0}; y < level.height; ++y) {
+      for (auto x = size_t{0}; x < level.width; ++x) {
+         for (auto c = size_t{0}; c < 4; ++c) {
+            const auto sum = at(source, 2 * x, 2 * y, c) + at(source, 2 * x + 1, 2 * y, c)
+                           + at(source, 2 * x, 2 * y + 1, c) + at(source, 2 * x + 1, 2 * y + 1, c);
+            ASSERT_LE(std::abs(at(level, x, y, c) * 4 - sum), 2);
+         }
+      }
+   }
+}
+
+TEST(mip_chain, cache_round_trip) {
+   const auto chain = game::buildMipChain(noise(40, 24), game::MipFilter::Kaiser, game::ColorSpace::Srgb);
+   const auto path = temporary("round_trip.mips");
+   game::writeMipCache(path, 42, chain);
+
+   const auto read = game::readMipCache(path, 42, game::MipFilter::Kaiser, game::ColorSpace::Srgb);
+   ASSERT_TRUE(read.has_value());
+   ASSERT_EQ(read->levels.size(), chain.levels.size());
+   for (auto i = size_t{0}; i < chain.levels.size(); ++i) {
+      ASSERT_EQ(read->levels[i].width, chain.levels[i].width);
+      ASSERT_EQ(read->levels[i].height, chain.levels[i].height);
+      ASSERT_EQ(read->levels[i].pixels, chain.levels[i].pixels);
+   }
+
+   ASSERT_FALSE(game::readMipCache(path, 43, game::MipFilter::Kaiser, game::ColorSpace::Srgb).has_value());
+   ASSERT_FALSE(game::readMipCache(path, 42, game::MipFilter::Box, game::ColorSpace::Srgb).has_value());
+   ASSERT_FALSE(game::readMipCache(path, 42, game::MipFilter::Kaiser, game::ColorSpace::Linear).has_value());
+   ASSERT_FALSE(game::readMipCache(temporary("missing.mips"), 42, game::MipFilter::Kaiser,
+      game::ColorSpace::Srgb).has_value());
+   std::filesystem::remove(path);
+}
+
+TEST(mip_chain, DISABLED_build_time) {
+   const auto source = noise(2048, 2048);
+   for (const auto filter: FILTERS) {
+      for (const auto space: SPACES) {
+         const auto start = std::chrono::steady_clock::now();
+         const auto chain = game::buildMipChain(source, filter, space);
+         const auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+         ASSERT_EQ(chain.levels.size(), 12u);
+         std::println("{} {} mips of 2048x2048: {:.1f} ms, {:.0f} MB/s",
+            name(filter), space == game::ColorSpace::Srgb ? "sRGB" : "linear",
+            seconds * 1e3, static_cast<double>(source.pixels.size()) / seconds / 1e6);
+      }
+   }
+}
+
+TEST(mip_chain, resizing_keeps_flat_images_flat) {
+   const auto flat = image(33, 64, [](auto, auto) {return std::array{200u, 17u, 90u, 255u};});
+   for (const auto filter: FILTERS) {
+      for (const auto space: SPACES) {
+         for (const auto& [width, height]: {std::pair{17u, 20u}, std::pair{80u, 129u}, std::pair{1u, 1u}}) {
+            const auto resized = game::resizeImage(flat, width, height, filter, space);
+            ASSERT_EQ(resized.width, width);
+            ASSERT_EQ(resized.height, height);
+            ASSERT_EQ(resized.pixels.size(), resized.bytesPerRow() * height);
+            for (auto i = size_t{0}; i < resized.pixels.size(); ++i) {
+               ASSERT_LE(std::abs(static_cast<int>(resized.pixels[i]) - static_cast<int>(flat.pixels[i % 4])), 1);
+            }
+         }
+      }
+   }
+   ASSERT_EQ(game::resizeImage(flat, 33, 64, game::MipFilter::Lanczos, game::ColorSpace::Srgb).pixels, flat.pixels);
+   ASSERT_THROW((void)game::resizeImage(flat, 0, 64, game::MipFilter::Box, game::ColorSpace::Srgb), game::Exception);
+}
+
+/// a ramp stays a ramp whichever way it is scaled, away from the clamped edges
+TEST(mip_chain, resizing_follows_a_ramp) {
+   for (const auto filter: {game::MipFilter::Lanczos, game::MipFilter::Mitchell}) {
+      for (const auto width: {71u, 300u}) {
+         const auto resized = game::resizeImage(ramp(128, 8), width, 5, filter, game::ColorSpace::Linear);
+         for (auto x = width / 8; x < width - width / 8; ++x) {
+            /// where the centre of the texel falls on the source
+            const auto source = (x + 0.5) * 128.0 / width - 0.5;
+            const auto expected = 255.0 * source / 127.0;
+            for (auto y = size_t{0}; y < resized.height; ++y) {
+               ASSERT_LE(std::abs(at(resized, x, y, 0) - expected), 1.5);
+            }
+         }
+      }
+   }
+}
+
+/// at exactly half size the box resize is the first mip
+TEST(mip_chain, box_resize_is_a_mip) {
+   const auto source = noise(64, 32);
+   const auto chain = game::buildMipChain(source, game::MipFilter::Box, game::ColorSpace::Srgb);
+   ASSERT_EQ(game::resizeImage(source, 32, 16, game::MipFilter::Box, game::ColorSpace::Srgb).pixels,
+      chain.levels[1].pixels);
+}
+
+TEST(mip_chain, array_size_takes_the_largest_layer) {
+   const auto layers = std::vector<game::ImageSize>{{2048, 1024}, {1024, 2048}, {512, 512}};
+   ASSERT_EQ(game::arraySize(layers, game::TextureQuality::High), (game::ImageSize{2048, 2048}));
+   ASSERT_EQ(game::arraySize(layers, game::TextureQuality::Medium), (game::ImageSize{1024, 1024}));
+   ASSERT_EQ(game::arraySize(layers, game::TextureQuality::Low), (game::ImageSize{512, 512}));
+   const auto tiny = std::vector<game::ImageSize>{{2, 1}};
+   ASSERT_EQ(game::arraySize(tiny, game::TextureQuality::Low), (game::ImageSize{1, 1}));
+}
+
+TEST(mip_chain, DISABLED_resize_time) {
+   const auto source = noise(2048, 2048);
+   const auto odd = noise(1000, 700);
+   for (const auto filter: {game::MipFilter::Lanczos, game::MipFilter::Mitchell}) {
+      const auto start = std::chrono::steady_clock::now();
+      const auto half = game::resizeImage(source, 1024, 1024, filter, game::ColorSpace::Srgb);
+      const auto halved = std::chrono::steady_clock::now();
+      const auto up = game::resizeImage(odd, 2048, 2048, filter, game::ColorSpace::Srgb);
+      const auto upscaled = std::chrono::steady_clock::now();
+      ASSERT_EQ(half.width, 1024u);
+      ASSERT_EQ(up.width, 2048u);
+      std::println("{} resize: 2048x2048 to 1024x1024 in {:.1f} ms, 1000x700 to 2048x2048 in {:.1f} ms", name(filter),
+         std::chrono::duration<double, std::milli>(halved - start).count(),
+         std::chrono::duration<double, std::milli>(upscaled - halved).count());
+   }
+}
@@ -0,0 +1,207 @@
+#include <gtest/gtest.h>
+
+#include "mip_residency.cpp"
+
+#include <cmath>
+#include <deque>
+#include <numbers>
+#include <numeric>
+#include <print>
+
+namespace {
+
+using game::MipResidency;
+
+constexpr auto FOV = std::numbers::pi_v<float> / 4.0f;
+constexpr auto VIEWPORT_HEIGHT = 800.0f;
+
+/// RGBA8 levels of a square texture
+auto levelBytes(const size_t size) -> std::vector<size_t> {
+   auto bytes = std::vector<size_t>{};
+   for (auto s = size; s > 0; s /= 2) {
+      bytes.push_back(s * s * 4);
+   }
+   return bytes;
+}
+
+auto sum(const std::vector<size_t>& bytes, const size_t first) -> size_t {
+   return std::accumulate(bytes.begin() + static_cast<std::ptrdiff_t>(first), bytes.end(), size_t{0});
+}
+
+/// Plays frames the way the scene does: every object asks for the level
+/// its footprint needs, the plan is carried out and loads land latency
+/// frames later. Checks after every frame that the budget holds.
+struct Simulation {
+   struct Object {
+      float position;
+      float radius;
+      size_t texture;
+   };
+
+   MipResidency residency;
+   std::vector<Object> objects;
+   size_t size;
+   size_t latency;
+   std::deque<std::pair<size_t, MipResidency::Change>> inFlight{};
+   size_t frame{0};
+
+   auto step(const float eye) -> void {
+      for (const auto& o: objects) {
+         const auto pixels = game::projectedSize(o.radius, std::abs(o.position - eye), FOV, VIEWPORT_HEIGHT);
+         residency.request(o.texture, game::footprintLevel(size, size, pixels));
+      }
+      const auto plan = residency.update();
+      for (const auto& load: plan.loads) {
+         inFlight.emplace_back(frame + latency, load);
+      }
+      while (not inFlight.empty() and inFlight.front().first <= frame) {
+         residency.loaded(inFlight.front().second.texture, inFlight.front().second.level);
+         inFlight.pop_front();
+      }
+      ASSERT_LE(residency.committedBytes(), std::max(residency.budget(), residency.tailBytes()));
+      ++frame;
+   }
+
+   auto wanted(const Object& o, const float eye) const -> size_t {
+      const auto pixels = game::projectedSize(o.radius, std::abs(o.position - eye), FOV, VIEWPORT_HEIGHT);
+      return std::min(game::footprintLevel(size, size, pixels), residency.tailLevel(o.texture));
+   }
+};
+
+auto simulation(const size_t budget, const size_t count, const size_t size, const size_t latency) -> Simulation {
+   auto s = Simulation{MipResidency{budget}, {}, size, latency};
+   for (auto i = size_t{0}; i < count; ++i) {
+      s.objects.push_back({static_cast<float>(i) * 20.0f, 1.0f, s.residency.add(size, size, levelBytes(size))});
+   }
+   return s;
+}
+
+}
+
+TEST(mip_residency, footprint_picks_a_texel_per_pixel) {
+   ASSERT_EQ(game::footprintLevel(2048, 2048, 4096.0f), 0u);
+   ASSERT_EQ(game::footprintLevel(2048, 2048, 1024.0f), 1u);
+   ASSERT_EQ(game::footprintLevel(2048, 1024, 100.0f), 4u);
+   ASSERT_EQ(game::projectedSize(1.0f, 0.5f, FOV, VIEWPORT_HEIGHT), VIEWPORT_HEIGHT);
+   /// halving the distance about doubles the footprint
+   const auto far = game::projectedSize(1.0f, 40.0f, FOV, VIEWPORT_HEIGHT);
+   const auto near = game::projectedSize(1.0f, 20.0f, FOV, VIEWPORT_HEIGHT);
+   ASSERT_NEAR(near / far, 2.0f, 0.01f);
+   ASSERT_EQ(game::footprintLevel(2048, 2048, near) + 1, game::footprintLevel(2048, 2048, far));
+}
+
+TEST(mip_residency, textures_start_with_their_tail) {
+   auto residency = MipResidency{0};
+   const auto texture = residency.add(2048, 2048, levelBytes(2048));
+   ASSERT_EQ(residency.tailLevel(texture), 5u);
+   ASSERT_EQ(residency.residentLevel(texture), 5u);
+   /// 64x64 and below
+   ASSERT_EQ(residency.residentBytes(), residency.tailBytes());
+   ASSERT_EQ(residency.residentBytes(), sum(levelBytes(2048), 5));
+   /// no budget: nothing streams, the tail stays
+   residency.request(texture, 0);
+   ASSERT_TRUE(residency.update().loads.empty());
+   ASSERT_EQ(residency.residentLevel(texture), 5u);
+   /// small textures are all tail
+   ASSERT_EQ(residency.tailLevel(residency.add(64, 32, levelBytes(64))), 0u);
+}
+
+TEST(mip_residency, levels_stream_in_one_at_a_time) {
+   auto residency = MipResidency{size_t{64} << 20};
+   const auto texture = residency.add(1024, 1024, levelBytes(1024));
+   auto loads = std::vector<size_t>{};
+   for (auto frame = 0; frame < 10; ++frame) {
+      residency.request(texture, 0);
+      for (const auto& load: residency.update().loads) {
+         ASSERT_EQ(load.texture, texture);
+         ASSERT_TRUE(residency.isLoading(texture));
+         loads.push_back(load.level);
+         /// sampling stays on the coarser levels until the load lands
+         ASSERT_EQ(residency.residentLevel(texture), load.level + 1);
+         residency.loaded(texture, load.level);
+      }
+   }
+   ASSERT_EQ(loads, (std::vector<size_t>{3, 2, 1, 0}));
+   ASSERT_EQ(residency.residentLevel(texture), 0u);
+   ASSERT_EQ(residency.residentBytes(), sum(levelBytes(1024), 0));
+}
+
+TEST(mip_residency, unwanted_levels_go_first_when_over_budget) {
+   /// room for one texture down to 512x512 besides the tails
+   const auto budget = sum(levelBytes(2048), 2) - sum(levelBytes(2048), 5) + 2 * sum(levelBytes(2048), 5);
+   auto residency = MipResidency{budget};
+   const auto a = residency.add(2048, 2048, levelBytes(2048));
+   const auto b = residency.add(2048, 2048, levelBytes(2048));
+   for (auto frame = 0; frame < 10; ++frame) {
+      residency.request(a, 2);
+      for (const auto& load: residency.update().loads) {
+         residency.loaded(load.texture, load.level);
+      }
+   }
+   ASSERT_EQ(residency.residentLevel(a), 2u);
+
+   /// b comes close, a stops being looked at: a shrinks back as b grows
+   auto evicted = false;
+   for (auto frame = 0; frame < 10; ++frame) {
+      residency.request(b, 2);
+      const auto plan = residency.update();
+      for (const auto& eviction: plan.evictions) {
+         ASSERT_EQ(eviction.texture, a);
+         evicted = true;
+      }
+      for (const auto& load: plan.loads) {
+         residency.loaded(load.texture, load.level);
+      }
+      ASSERT_LE(residency.committedBytes(), budget);
+   }
+   ASSERT_TRUE(evicted);
+   ASSERT_EQ(residency.residentLevel(b), 2u);
+   ASSERT_EQ(residency.residentLevel(a), residency.tailLevel(a));
+
+   /// levels wanted in the same frame are never evicted for one another
+   for (auto frame = 0; frame < 10; ++frame) {
+      residency.request(a, 0);
+      residency.request(b, 0);
+      const auto plan = residency.update();
+      ASSERT_TRUE(plan.evictions.empty());
+      for (const auto& load: plan.loads) {
+         residency.loaded(load.texture, load.level);
+      }
+   }
+   ASSERT_EQ(residency.residentLevel(b), 2u);
+}
+
+/// the camera flies past a row of objects and back: whatever is close
+/// ends up at the level its footprint needs, within the budget
+TEST(mip_residency, camera_path) {
+   const auto budget = size_t{24} << 20;
+   auto s = simulation(budget, 8, 2048, 3);
+   auto peak = size_t{0};
+   const auto path = [](const size_t frame) {
+      /// 0 to 140 and back, 600 frames each way
+      const auto t = static_cast<float>(frame % 1200) / 600.0f;
+      return 140.0f * (t <= 1.0f ? t : 2.0f - t);
+   };
+   for (auto frame = size_t{0}; frame < 2400; ++frame) {
+      s.step(path(frame));
+      peak = std::max(peak, s.residency.committedBytes());
+   }
+
+   /// parked in front of the fourth object: it gets what it needs
+   const auto eye = 62.0f;
+   for (auto frame = 0; frame < 60; ++frame) {
+      s.step(eye);
+   }
+   const auto& close = s.objects[3];
+   /// it fills the viewport, 800 pixels: 1024x1024 is enough
+   ASSERT_EQ(s.wanted(close, eye), 1u);
+   ASSERT_EQ(s.residency.residentLevel(close.texture), 1u);
+   /// its neighbours fit next to it
+   ASSERT_LE(s.residency.residentLevel(s.objects[2].texture), s.wanted(s.objects[2], eye));
+   ASSERT_LE(s.residency.residentLevel(s.objects[4].texture), s.wanted(s.objects[4], eye));
+   ASSERT_LE(peak, budget);
+   ASSERT_GT(peak, s.residency.tailBytes());
+   std::println("8 textures of 2048x2048 along a camera path: peak {:.1f} MB resident of a {:.1f} MB budget, "
+      "all levels would take {:.1f} MB", static_cast<double>(peak) / (1 << 20), static_cast<double>(budget) / (1 << 20),
+      8.0 * 2048 * 2048 * 4 * 4 / 3 / (1 << 20));
+}
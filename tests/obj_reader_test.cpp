@@ -0,0 +1,150 @@
+#include <gtest/gtest.h>
+
+#include "obj_reader.cpp"
+#include "mapped_file.hpp"
+#include "primitives.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <print>
+#include <string>
+
+namespace {
+
+auto bytes(const std::string_view text) -> std::span<const std::byte> {
+   return {reinterpret_cast<const std::byte*>(text.data()), text.size()};
+}
+
+auto toObj(const std::string_view name, const game::MeshData& mesh) -> std::string {
+   auto text = std::format("o {}\n", name);
+   for (const auto& v: mesh.vertices) {
+      text += std::format("v {} {} {}\nvt {} {}\nvn {} {} {}\n", v.position.x, v.position.y, v.position.z,
+         v.uv.x, v.uv.y, v.normal.x, v.normal.y, v.normal.z);
+   }
+   for (auto i = size_t{0}; i < mesh.indexes.size(); i += 3) {
+      text += std::format("f {0}/{0}/{0} {1}/{1}/{1} {2}/{2}/{2}\n",
+         mesh.indexes[i] + 1, mesh.indexes[i + 1] + 1, mesh.indexes[i + 2] + 1);
+   }
+   return text;
+}
+
+auto close(const float a, const float b) -> bool {
+   return std::abs(a - b) <= 1e-6f * std::max(1.0f, std::abs(a));
+}
+
+/// same triangles, corner by corner, however the vertices are shared
+auto sameCorners(const game::MeshData& a, const game::MeshData& b) -> bool {
+   if (a.indexes.size() != b.indexes.size()) {
+      return false;
+   }
+   for (auto i = size_t{0}; i < a.indexes.size(); ++i) {
+      const auto& u = a.vertices[a.indexes[i]];
+      const auto& v = b.vertices[b.indexes[i]];
+      if (not (close(u.position.x, v.position.x) and close(u.position.y, v.position.y)
+         and close(u.position.z, v.position.z) and close(u.uv.x, v.uv.x) and close(u.uv.y, v.uv.y)
+         and close(u.normal.x, v.normal.x) and close(u.normal.y, v.normal.y) and close(u.normal.z, v.normal.z))) {
+         return false;
+      }
+   }
+   return true;
+}
+
+auto megabytesPerSecond(const size_t size, const std::chrono::steady_clock::duration time) -> double {
+   return static_cast<double>(size) / static_cast<double>(1u << 20) / std::chrono::duration<double>(time).count();
+}
+
+}
+
+TEST(obj_reader, quads_negative_references_and_objects) {
+   constexpr auto text = std::string_view{
+      "# written by hand\r\n"
+      "v 0 0 0\r\nv 1 0 0\r\nv 1 1 0\nv 0 1 0\n"
+      "vt 0 0\nvt 1 0\nvt 1 1\nvt 0 1\nvn 0 0 1\n"
+      "f 1/1/1 2/2/1 3/3/1 4/4/1\n"
+      "o Second\n"
+      "v 5 5 5\nvt 0.5 0.25\nvn 0 1 0\n"
+      "f -1/-1/-1 1/1/1 2/2/-1\n"
+      "o Third \n"
+      "f 1/1/1 2/2/1 3/3/1"};
+
+   const auto quad = game::MeshFactory::readObj("defaultobject", bytes(text));
+   ASSERT_TRUE(quad.has_value());
+   ASSERT_EQ(quad->vertices.size(), 4u);
+   ASSERT_EQ(quad->indexes, (std::vector<std::uint32_t>{0, 1, 2, 0, 2, 3}));
+   ASSERT_EQ(quad->vertices[2].uv.y, 0.0f);
+
+   const auto second = game::MeshFactory::readObj("Second", bytes(text));
+   ASSERT_TRUE(second.has_value());
+   ASSERT_EQ(second->vertices.size(), 3u);
+   ASSERT_EQ(second->vertices[0].position.x, 5.0f);
+   ASSERT_EQ(second->vertices[0].uv.y, 0.75f);
+   ASSERT_EQ(second->vertices[2].normal.y, 1.0f);
+
+   const auto third = game::MeshFactory::readObj("Third", bytes(text));
+   ASSERT_TRUE(third.has_value());
+   ASSERT_EQ(third->indexes.size(), 3u);
+   ASSERT_FALSE(game::MeshFactory::readObj("Fourth", bytes(text)).has_value());
+}
+
+TEST(obj_reader, rejects_what_it_cannot_read) {
+   ASSERT_THROW((void)game::MeshFactory::readObj("defaultobject", bytes("v 1 2 x\nvt 0 0\nvn 0 0 1\nf 1/1/1 1/1/1 1/1/1\n")),
+      game::Exception);
+   ASSERT_THROW((void)game::MeshFactory::readObj("defaultobject", bytes("v 1 2 3\nvt 0 0\nvn 0 0 1\nf 1/1/1 2/1/1 1/1/1\n")),
+      game::Exception);
+   ASSERT_THROW((void)game::MeshFactory::readObj("defaultobject", bytes("v 1 2 3\nf 1 1 1\n")),
+      game::Exception);
+}
+
+TEST(obj_reader, parses_floats_like_strtof) {
+   for (const auto text: {"1.5", "-0.000123", "3.4028e38", "1e-40", "0.1", "123456789.123456789",
+                          "-7.25e-3", "0.333333333333333333333", "+2", "5."}) {
+      auto p = text;
+      auto ok = true;
+      const auto value = game::parseFloat(p, text + std::strlen(text), ok);
+      ASSERT_TRUE(ok);
+      ASSERT_EQ(value, std::strtof(text, nullptr)) << text;
+   }
+}
+
+TEST(obj_reader, reads_what_assimp_reads) {
+   const auto suzanne = game::MappedFile::open(std::filesystem::path(ROOT_DIR) / ASSETS_DIR / "Suzanne.obj");
+   const auto sphere = toObj("Sphere", game::primitives::uvSphere(1.0f, 16, 32));
+   for (const auto& [name, data]: {std::pair{"Suzanne", std::span<const std::byte>{suzanne.bytes()}},
+      std::pair{"Sphere", bytes(sphere)}}) {
+      const auto native = game::MeshFactory::readObj(name, data);
+      const auto imported = game::MeshFactory::importMesh(name, data);
+      ASSERT_TRUE(native.has_value() and imported.has_value());
+      ASSERT_TRUE(sameCorners(*native, *imported)) << name;
+      ASSERT_LE(native->vertices.size(), imported->vertices.size());
+   }
+}
+
+TEST(obj_reader, DISABLED_throughput_compared_to_assimp) {
+   const auto suzanne_path = std::filesystem::path(ROOT_DIR) / ASSETS_DIR / "Suzanne.obj";
+   const auto large_path = std::filesystem::temp_directory_path() / "game_tutorial_large.obj";
+   {
+      auto out = std::ofstream{large_path};
+      out << toObj("Large", game::primitives::uvSphere(1.0f, 256, 512));
+   }
+
+   for (const auto& [name, path]: {std::pair{"Suzanne", suzanne_path}, std::pair{"Large", large_path}}) {
+      const auto file = game::MappedFile::open(path);
+      const auto start = std::chrono::steady_clock::now();
+      const auto native = game::MeshFactory::readObj(name, file.bytes());
+      const auto read = std::chrono::steady_clock::now();
+      const auto imported = game::MeshFactory::importMesh(name, file.bytes());
+      const auto end = std::chrono::steady_clock::now();
+
+      ASSERT_TRUE(native.has_value() and imported.has_value());
+      ASSERT_TRUE(sameCorners(*native, *imported)) << name;
+      ASSERT_LE(native->vertices.size(), imported->vertices.size());
+      std::println("obj reader: {} {:.1f} MB, native {:.0f} MB/s ({} vertices), assimp {:.0f} MB/s ({} vertices)",
+         name, static_cast<double>(file.size()) / static_cast<double>(1u << 20),
+         megabytesPerSecond(file.size(), read - start), native->vertices.size(),
+         megabytesPerSecond(file.size(), end - read), imported->vertices.size());
+   }
+   std::filesystem::remove(large_path);
+}
@@ -0,0 +1,112 @@
+#include <gtest/gtest.h>
+
+#include "primitives.cpp"
+#include "mesh_factory.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <print>
+
+namespace {
+
+constexpr auto cube = game::primitives::cube();
+constexpr auto sphere = game::primitives::uvSphere<16, 32>();
+constexpr auto ico = game::primitives::icosphere<3>();
+constexpr auto grid = game::primitives::plane<8, 4>(2.0f, 1.0f);
+constexpr auto cylinder = game::primitives::cylinder<24, 2>();
+constexpr auto cone = game::primitives::cone<24>();
+
+static_assert(cube.vertices.size() == 24 and cube.indexes.size() == 36);
+static_assert(sphere.vertices.size() == 17 * 33 and sphere.indexes.size() == 6 * 32 * 15);
+static_assert(ico.indexes.size() == 20 * 3 * 64);
+static_assert(std::ranges::all_of(sphere.indexes, [](const auto i) {return i < sphere.vertices.size();}));
+static_assert(std::ranges::all_of(ico.indexes, [](const auto i) {return i < ico.vertices.size();}));
+static_assert(std::ranges::all_of(cylinder.indexes, [](const auto i) {return i < cylinder.vertices.size();}));
+static_assert(std::ranges::all_of(cone.indexes, [](const auto i) {return i < cone.vertices.size();}));
+
+/// unit normals, orthonormal tangent frames and, for the closed convex
+/// shapes centred on the origin, every triangle facing outwards
+auto checkMesh(const std::span<const game::VertexData> vertices, const std::span<const std::uint32_t> indexes,
+   const bool closed) -> void {
+   for (const auto& v: vertices) {
+      ASSERT_NEAR(simd::length(v.normal), 1.0f, 1e-4f);
+      ASSERT_NEAR(simd::length(v.tangent), 1.0f, 1e-4f);
+      ASSERT_NEAR(simd::length(v.bitangent), 1.0f, 1e-4f);
+      ASSERT_NEAR(simd::dot(v.normal, v.tangent), 0.0f, 1e-4f);
+      ASSERT_NEAR(simd::dot(v.normal, v.bitangent), 0.0f, 1e-4f);
+      ASSERT_NEAR(simd::dot(v.tangent, v.bitangent), 0.0f, 1e-4f);
+   }
+   for (auto t = 0u; t < indexes.size(); t += 3) {
+      const auto a = vertices[indexes[t]].position.xyz;
+      const auto b = vertices[indexes[t + 1]].position.xyz;
+      const auto c = vertices[indexes[t + 2]].position.xyz;
+      const auto n = simd::cross(b - a, c - a);
+      ASSERT_GT(simd::length(n), 0.0f);
+      if (closed) {
+         ASSERT_GT(simd::dot(n, a + b + c), 0.0f);
+      } else {
+         ASSERT_GT(simd::dot(n, vertices[indexes[t]].normal), 0.0f);
+      }
+   }
+}
+
+}
+
+TEST(primitives, compile_time_meshes) {
+   checkMesh(cube.vertices, cube.indexes, true);
+   checkMesh(sphere.vertices, sphere.indexes, true);
+   checkMesh(ico.vertices, ico.indexes, true);
+   checkMesh(grid.vertices, grid.indexes, false);
+   checkMesh(cylinder.vertices, cylinder.indexes, true);
+   checkMesh(cone.vertices, cone.indexes, true);
+}
+
+TEST(primitives, runtime_matches_compile_time) {
+   const auto runtime = game::primitives::uvSphere(1.0f, 16, 32);
+   ASSERT_EQ(runtime.vertices.size(), sphere.vertices.size());
+   ASSERT_TRUE(std::ranges::equal(runtime.indexes, sphere.indexes));
+   for (const auto& [r, c]: std::views::zip(runtime.vertices, sphere.vertices)) {
+      ASSERT_LT(simd::distance(r.position, c.position), 1e-5f);
+      ASSERT_LT(simd::distance(r.tangent, c.tangent), 1e-5f);
+      ASSERT_LT(simd::distance(r.uv, c.uv), 1e-5f);
+   }
+   ASSERT_THROW(game::primitives::uvSphere(1.0f, 1, 32), game::Exception);
+}
+
+TEST(primitives, tangents_match_generated) {
+   auto generated = game::primitives::icosphere(1.0f, 4);
+   const auto analytic = generated.vertices;
+   game::MeshFactory::generateTangents(generated);
+
+   /// away from the poles and the u seam both should follow +u and +v
+   auto checked = size_t{0};
+   auto agreeing = size_t{0};
+   for (const auto& [g, a]: std::views::zip(generated.vertices, analytic)) {
+      if (std::abs(a.normal.y) > 0.95f or a.uv.x < 0.05f or a.uv.x > 0.95f) {
+         continue;
+      }
+      ++checked;
+      agreeing += simd::dot(g.tangent, a.tangent) > 0.95f and simd::dot(g.bitangent, a.bitangent) > 0.95f ? 1 : 0;
+   }
+   ASSERT_GT(checked, 0u);
+   ASSERT_GT(static_cast<double>(agreeing) / static_cast<double>(checked), 0.95);
+}
+
+TEST(primitives, DISABLED_benchmark) {
+   constexpr auto rings = 512u;
+   constexpr auto segments = 1024u;
+
+   const auto start = std::chrono::steady_clock::now();
+   auto mesh = game::primitives::uvSphere(1.0f, rings, segments);
+   const auto generated = std::chrono::steady_clock::now();
+   game::MeshFactory::generateTangents(mesh);
+   const auto tangents = std::chrono::steady_clock::now();
+
+   const auto generate_ms = std::chrono::duration<double, std::milli>(generated - start).count();
+   std::println("primitives: {} vertices {} triangles in {:.2f} ms ({:.1f} Mvert/s), "
+      "recomputing the tangents alone takes {:.2f} ms",
+      mesh.vertices.size(), mesh.indexes.size() / 3, generate_ms,
+      static_cast<double>(mesh.vertices.size()) / generate_ms / 1000.0,
+      std::chrono::duration<double, std::milli>(tangents - generated).count());
+   ASSERT_EQ(mesh.indexes.size(), game::primitives::uvSphereIndexCount(rings, segments));
+}
@@ -0,0 +1,176 @@
+#include <gtest/gtest.h>
+
+#include "range_allocator.cpp"
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <print>
+#include <random>
+#include <vector>
+
+namespace {
+
+struct Live {
+   game::RangeAllocator::Allocation allocation;
+   std::uint32_t size;
+};
+
+/// no two live ranges overlap and every one of them is inside the capacity
+auto checkDisjoint(std::vector<Live> live, const std::uint32_t capacity) -> void {
+   std::ranges::sort(live, {}, [](const Live& l) {return l.allocation.offset;});
+   auto end = 0u;
+   for (const auto& l: live) {
+      ASSERT_GE(l.allocation.offset, end);
+      end = l.allocation.offset + l.size;
+   }
+   ASSERT_LE(end, capacity);
+}
+
+/// reference first fit allocator on a std::map, the usual free list
+class MapAllocator {
+public:
+   explicit MapAllocator(const std::uint32_t capacity) {_free.emplace(0u, capacity);}
+   auto allocate(const std::uint32_t size) -> std::uint32_t {
+      for (auto it = _free.begin(); it != _free.end(); ++it) {
+         if (it->second >= size) {
+            const auto [offset, available] = *it;
+            _free.erase(it);
+            if (available > size) {
+               _free.emplace(offset + size, available - size);
+            }
+            return offset;
+         }
+      }
+      return game::RangeAllocator::INVALID;
+   }
+   auto free(const std::uint32_t offset, std::uint32_t size) -> void {
+      auto next = _free.lower_bound(offset);
+      if (next != _free.end() and offset + size == next->first) {
+         size += next->second;
+         next = _free.erase(next);
+      }
+      if (next != _free.begin()) {
+         if (auto prev = std::prev(next); prev->first + prev->second == offset) {
+            prev->second += size;
+            return;
+         }
+      }
+      _free.emplace(offset, size);
+   }
+private:
+   std::map<std::uint32_t, std::uint32_t> _free;
+};
+
+}
+
+TEST(range_allocator, allocate_and_coalesce) {
+   game::RangeAllocator allocator{1000};
+   const auto a = allocator.allocate(100);
+   const auto b = allocator.allocate(200);
+   const auto c = allocator.allocate(300);
+   ASSERT_TRUE(a.valid() and b.valid() and c.valid());
+   ASSERT_EQ(allocator.getFree(), 400u);
+   ASSERT_EQ(allocator.allocationSize(b), 200u);
+   ASSERT_FALSE(allocator.allocate(401).valid());
+
+   allocator.free(b);
+   /// the hole left by b is reused
+   const auto d = allocator.allocate(150);
+   ASSERT_EQ(d.offset, b.offset);
+   allocator.free(a);
+   allocator.free(c);
+   allocator.free(d);
+   ASSERT_EQ(allocator.getFree(), 1000u);
+   ASSERT_EQ(allocator.largestFree(), 1000u);
+   ASSERT_THROW(allocator.free(d), game::Exception);
+
+   ASSERT_EQ(allocator.allocate(1000).offset, 0u);
+}
+
+TEST(range_allocator, exact_fit_when_full) {
+   /// every block of the rounded size class is too big, the exact class must be searched
+   game::RangeAllocator allocator{1000};
+   const auto a = allocator.allocate(1000 - 37);
+   ASSERT_TRUE(a.valid());
+   ASSERT_TRUE(allocator.allocate(37).valid());
+   ASSERT_EQ(allocator.getFree(), 0u);
+}
+
+TEST(range_allocator, random_operations) {
+   constexpr auto capacity = 1u << 20;
+   game::RangeAllocator allocator{capacity};
+   std::mt19937 rng{42};
+   std::uniform_int_distribution<std::uint32_t> sizes{1, 4096};
+   std::vector<Live> live;
+   auto used = 0u;
+
+   for (auto i = 0u; i < 20000; ++i) {
+      if (live.empty() or rng() % 3 != 0) {
+         const auto size = sizes(rng);
+         if (const auto a = allocator.allocate(size); a.valid()) {
+            live.push_back({a, size});
+            used += size;
+         }
+      } else {
+         const auto victim = rng() % live.size();
+         allocator.free(live[victim].allocation);
+         used -= live[victim].size;
+         live[victim] = live.back();
+         live.pop_back();
+      }
+      ASSERT_EQ(allocator.getFree(), capacity - used);
+      if (i % 1000 == 0) {
+         checkDisjoint(live, capacity);
+      }
+   }
+   checkDisjoint(live, capacity);
+   for (const auto& l: live) {
+      allocator.free(l.allocation);
+   }
+   ASSERT_EQ(allocator.largestFree(), capacity);
+}
+
+TEST(range_allocator, DISABLED_benchmark) {
+   constexpr auto capacity = 1u << 24;
+   constexpr auto operations = 1000000u;
+   std::mt19937 rng{7};
+   std::uniform_int_distribution<std::uint32_t> sizes{16, 65536};
+   auto ops = std::vector<std::uint32_t>(operations);
+   std::ranges::generate(ops, [&] {return sizes(rng);});
+
+   /// same pattern for both: keep 256 ranges alive, free the oldest
+   const auto run = [&](auto&& allocate, auto&& free) {
+      std::vector<std::pair<std::uint32_t, std::uint32_t>> ring(256, {game::RangeAllocator::INVALID, 0});
+      const auto start = std::chrono::steady_clock::now();
+      for (auto i = 0u; i < operations; ++i) {
+         auto& slot = ring[i % ring.size()];
+         if (slot.first != game::RangeAllocator::INVALID) {
+            free(slot);
+         }
+         slot = {allocate(ops[i]), ops[i]};
+      }
+      return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / operations;
+   };
+
+   game::RangeAllocator tlsf{capacity};
+   std::vector<game::RangeAllocator::Allocation> handles(capacity / 16);
+   const auto tlsf_ns = run(
+      [&](const std::uint32_t size) {
+         const auto a = tlsf.allocate(size);
+         if (a.valid()) {
+            handles[a.offset / 16] = a;
+         }
+         return a.offset;
+      },
+      [&](const auto& slot) {tlsf.free(handles[slot.first / 16]);});
+
+   MapAllocator reference{capacity};
+   const auto map_ns = run(
+      [&](const std::uint32_t size) {return reference.allocate(size);},
+      [&](const auto& slot) {reference.free(slot.first, slot.second);});
+
+   std::println("range allocator: TLSF {:.1f} ns, first fit std::map {:.1f} ns per alloc+free, largest free {}",
+      tlsf_ns, map_ns, tlsf.largestFree());
+   ASSERT_GT(tlsf.getFree(), 0u);
+}
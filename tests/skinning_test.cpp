@@ -0,0 +1,184 @@
+#include <gtest/gtest.h>
+
+#include "animation.cpp"
+#include "skinning.cpp"
+#include "primitives.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <numbers>
+#include <print>
+#include <random>
+
+namespace {
+
+constexpr auto HEIGHT = 2.0f;
+constexpr auto JOINTS = 32u;
+
+auto axisAngle(const simd::float3 axis, const float angle) -> simd::float4 {
+   return simd::make_float4(axis * std::sin(angle / 2.0f), std::cos(angle / 2.0f));
+}
+
+auto translation(const simd::float3 t) -> simd::float4x4 {
+   auto m = matrix_identity_float4x4;
+   m.columns[3] = simd::make_float4(t, 1.0f);
+   return m;
+}
+
+auto near(const simd::float4 a, const simd::float4 b, const float tolerance) -> bool {
+   return simd::length(a - b) < tolerance;
+}
+
+auto near(const simd::float3 a, const simd::float3 b, const float tolerance) -> bool {
+   return simd::length(a - b) < tolerance;
+}
+
+auto bindPose() -> std::vector<game::Transform> {
+   auto pose = std::vector<game::Transform>(JOINTS);
+   for (auto j = 0u; j < JOINTS; ++j) {
+      pose[j].translation = {0.0f, j == 0 ? -HEIGHT / 2.0f : HEIGHT / static_cast<float>(JOINTS - 1), 0.0f};
+   }
+   return pose;
+}
+
+/// a chain of joints up a cylinder, every vertex blended between the two
+/// joints around its height, and a clip that bends the chain back and forth
+auto character() -> game::SkinnedMeshData {
+   auto result = game::SkinnedMeshData{};
+   result.mesh = game::primitives::cylinder(0.2f, HEIGHT, 24, 64);
+   const auto spacing = HEIGHT / static_cast<float>(JOINTS - 1);
+   for (auto j = 0u; j < JOINTS; ++j) {
+      result.skeleton.joints.push_back({
+         .name = std::format("joint{}", j),
+         .parent = static_cast<std::int32_t>(j) - 1,
+         .inverseBind = translation({0.0f, HEIGHT / 2.0f - static_cast<float>(j) * spacing, 0.0f})
+      });
+   }
+   for (const auto& v: result.mesh.vertices) {
+      const auto along = std::clamp((v.position.y + HEIGHT / 2.0f) / spacing, 0.0f, static_cast<float>(JOINTS - 1));
+      const auto lower = std::min(static_cast<std::uint16_t>(along), static_cast<std::uint16_t>(JOINTS - 2));
+      const auto t = along - static_cast<float>(lower);
+      result.skin.push_back({
+         .weights = {1.0f - t, t, 0.0f, 0.0f},
+         .joints = {lower, static_cast<std::uint16_t>(lower + 1), 0, 0}
+      });
+   }
+
+   auto clip = game::AnimationClip{.name = "bend", .duration = 1.0f, .tracks = std::vector<game::JointTrack>(JOINTS)};
+   for (auto j = 0u; j < JOINTS; ++j) {
+      auto& track = clip.tracks[j];
+      track.translations = {{0.0f}, {{0.0f, j == 0 ? -HEIGHT / 2.0f : spacing, 0.0f}}};
+      for (auto k = 0u; k <= 30u; ++k) {
+         const auto time = static_cast<float>(k) / 30.0f;
+         track.rotations.times.push_back(time);
+         track.rotations.values.push_back(axisAngle({0.0f, 0.0f, 1.0f},
+            0.05f * std::sin(2.0f * std::numbers::pi_v<float> * time + static_cast<float>(j) * 0.2f)));
+      }
+   }
+   result.clips.push_back(game::CompressedClip::compress(clip));
+   return result;
+}
+
+}
+
+TEST(skinning, sampling_interpolates_and_loops) {
+   auto clip = game::AnimationClip{.name = "test", .duration = 2.0f, .tracks = std::vector<game::JointTrack>(1)};
+   clip.tracks[0].translations = {{0.0f, 1.0f}, {{0.0f, 0.0f, 0.0f}, {2.0f, 0.0f, 0.0f}}};
+   /// the second key is the same rotation with the opposite sign,
+   /// the shortest arc does not move at all
+   const auto q = axisAngle({0.0f, 1.0f, 0.0f}, 0.5f);
+   clip.tracks[0].rotations = {{0.0f, 1.0f}, {q, -q}};
+
+   auto pose = std::vector<game::Transform>(1);
+   clip.sample(0.25f, pose);
+   ASSERT_TRUE(near(pose[0].translation, {0.5f, 0.0f, 0.0f}, 1e-6f));
+   ASSERT_TRUE(near(pose[0].rotation, q, 1e-6f));
+   ASSERT_TRUE(near(pose[0].scale, {1.0f, 1.0f, 1.0f}, 1e-6f));
+   /// holds the last key, then wraps
+   clip.sample(1.5f, pose);
+   ASSERT_TRUE(near(pose[0].translation, {2.0f, 0.0f, 0.0f}, 1e-6f));
+   clip.sample(2.5f, pose);
+   ASSERT_TRUE(near(pose[0].translation, {1.0f, 0.0f, 0.0f}, 1e-6f));
+
+   const auto half = game::nlerp(axisAngle({0.0f, 0.0f, 1.0f}, 0.0f), axisAngle({0.0f, 0.0f, 1.0f}, 1.0f), 0.5f);
+   ASSERT_TRUE(near(half, axisAngle({0.0f, 0.0f, 1.0f}, 0.5f), 1e-6f));
+}
+
+TEST(skinning, bind_pose_is_identity) {
+   const auto mesh = character();
+   /// straight up
+   const auto pose = bindPose();
+   auto palette = std::vector<simd::float4x4>(JOINTS);
+   game::buildPalette(mesh.skeleton, pose, palette);
+   for (const auto& m: palette) {
+      for (auto c = 0u; c < 4u; ++c) {
+         ASSERT_TRUE(near(m.columns[c], matrix_identity_float4x4.columns[c], 1e-5f));
+      }
+   }
+
+   auto skinned = std::vector<game::VertexData>(mesh.mesh.vertices.size());
+   game::skinVertices(mesh.mesh.vertices, mesh.skin, palette, skinned);
+   for (auto v = 0u; v < skinned.size(); ++v) {
+      ASSERT_TRUE(near(skinned[v].position, mesh.mesh.vertices[v].position, 1e-5f));
+      ASSERT_TRUE(near(skinned[v].normal, mesh.mesh.vertices[v].normal, 1e-5f));
+   }
+}
+
+TEST(skinning, blended_matrix_matches_blended_positions) {
+   const auto mesh = character();
+   std::mt19937 rng{3};
+   std::uniform_real_distribution<float> angles{-1.0f, 1.0f};
+   auto pose = bindPose();
+   for (auto j = 0u; j < JOINTS; ++j) {
+      pose[j].rotation = axisAngle(simd::normalize(simd::make_float3(angles(rng), angles(rng), angles(rng))), angles(rng));
+   }
+   auto palette = std::vector<simd::float4x4>(JOINTS);
+   game::buildPalette(mesh.skeleton, pose, palette);
+
+   auto skinned = std::vector<game::VertexData>(mesh.mesh.vertices.size());
+   game::skinVertices(mesh.mesh.vertices, mesh.skin, palette, skinned);
+   for (auto v = 0u; v < skinned.size(); ++v) {
+      const auto& s = mesh.skin[v];
+      auto expected = simd::float4{0.0f, 0.0f, 0.0f, 0.0f};
+      for (auto i = 0u; i < 4u; ++i) {
+         expected += (palette[s.joints[i]] * mesh.mesh.vertices[v].position) * s.weights[i];
+      }
+      ASSERT_TRUE(near(skinned[v].position, expected, 1e-4f));
+      ASSERT_NEAR(simd::length(skinned[v].normal), 1.0f, 1e-4f);
+      ASSERT_EQ(skinned[v].uv.x, mesh.mesh.vertices[v].uv.x);
+   }
+}
+
+TEST(skinning, DISABLED_benchmark_thousand_characters) {
+   constexpr auto characters = 1000u;
+   const auto mesh = character();
+   const auto vertices = mesh.mesh.vertices.size();
+   auto palettes = std::vector<simd::float4x4>(characters * JOINTS);
+   auto skinned = std::vector<game::VertexData>(characters * vertices);
+   auto instances = std::vector<game::SkinningInstance>{};
+   for (auto c = 0u; c < characters; ++c) {
+      instances.push_back({
+         .clip = &mesh.clips[0],
+         .time = static_cast<float>(c) * 0.01f,
+         .palette = std::span{palettes}.subspan(c * JOINTS, JOINTS),
+         .skinned = std::span{skinned}.subspan(c * vertices, vertices)
+      });
+   }
+
+   constexpr auto frames = 10;
+   game::animate(mesh, instances);
+   const auto start = std::chrono::steady_clock::now();
+   for (auto f = 0; f < frames; ++f) {
+      for (auto& instance: instances) {
+         instance.time += 1.0f / 60.0f;
+      }
+      game::animate(mesh, instances);
+   }
+   const auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / frames;
+
+   /// a bent chain moves the top of the cylinder off axis
+   ASSERT_GT(std::abs(skinned[vertices - 1].position.x) + std::abs(skinned[0].position.x), 0.0f);
+   std::println("skinning: {} characters of {} vertices and {} joints, {:.2f} ms per frame, {:.1f} M vertices/s",
+      characters, vertices, JOINTS, elapsed,
+      static_cast<double>(characters * vertices) / elapsed / 1000.0);
+}
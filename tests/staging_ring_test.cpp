@@ -0,0 +1,81 @@
+#include <gtest/gtest.h>
+
+#include "staging_ring.cpp"
+
+#include <random>
+#include <vector>
+
+TEST(staging_ring, aligns_and_fills) {
+   game::StagingRing ring{1024};
+   ASSERT_EQ(ring.allocate(10, 256), 0u);
+   ASSERT_EQ(ring.allocate(10, 256), 256u);
+   ASSERT_EQ(ring.allocate(500, 256), 512u);
+   ASSERT_EQ(ring.getUsed(), 1012u);
+   ASSERT_FALSE(ring.allocate(20, 4).has_value());
+   ASSERT_FALSE(ring.allocate(0, 4).has_value());
+   ASSERT_FALSE(ring.allocate(2048, 4).has_value());
+}
+
+TEST(staging_ring, retires_whole_batches) {
+   game::StagingRing ring{1024};
+   ASSERT_EQ(ring.allocate(400, 4), 0u);
+   ring.close(1);
+   ASSERT_EQ(ring.allocate(400, 4), 400u);
+   ring.close(2);
+   ASSERT_FALSE(ring.allocate(400, 4).has_value());
+
+   /// nothing finished yet
+   ring.retire(0);
+   ASSERT_EQ(ring.getUsed(), 800u);
+   ring.retire(1);
+   ASSERT_EQ(ring.getUsed(), 400u);
+   /// does not fit at the end, wraps into the space batch 1 gave back
+   ASSERT_EQ(ring.allocate(300, 4), 0u);
+   ASSERT_EQ(ring.getUsed(), 1024u - 400u + 300u);
+   ring.close(3);
+   ASSERT_EQ(ring.allocate(100, 4), 300u);
+   ASSERT_FALSE(ring.allocate(4, 4).has_value());
+   ring.close(4);
+
+   ring.retire(4);
+   ASSERT_EQ(ring.getUsed(), 0u);
+   /// empty again, the whole ring is contiguous
+   ASSERT_EQ(ring.allocate(1024, 4), 0u);
+}
+
+TEST(staging_ring, random_batches_never_overlap) {
+   constexpr auto capacity = size_t{1} << 16;
+   game::StagingRing ring{capacity};
+   std::mt19937 rng{7};
+   std::uniform_int_distribution<size_t> sizes{1, 8000};
+   std::uniform_int_distribution<int> alignments{0, 8};
+
+   struct Live {size_t offset; size_t size; std::uint64_t batch;};
+   std::vector<Live> live;
+   std::uint64_t batch = 1;
+   std::uint64_t completed = 0;
+   for (auto i = 0; i < 20000; ++i) {
+      const auto size = sizes(rng);
+      const auto alignment = size_t{1} << alignments(rng);
+      if (const auto offset = ring.allocate(size, alignment); offset) {
+         ASSERT_EQ(*offset % alignment, 0u);
+         ASSERT_LE(*offset + size, capacity);
+         for (const auto& l: live) {
+            ASSERT_TRUE(*offset + size <= l.offset or l.offset + l.size <= *offset);
+         }
+         live.push_back({*offset, size, batch});
+      }
+      if (i % 7 == 0) {
+         ring.close(batch++);
+      }
+      /// the GPU lags a few batches behind
+      if (i % 11 == 0 and completed + 3 < batch) {
+         completed = batch - 3;
+         ring.retire(completed);
+         std::erase_if(live, [&](const Live& l) {return l.batch <= completed;});
+      }
+   }
+   ring.close(batch);
+   ring.retire(batch);
+   ASSERT_EQ(ring.getUsed(), 0u);
+}
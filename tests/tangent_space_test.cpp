@@ -0,0 +1,154 @@
+#include <gtest/gtest.h>
+
+#include "tangent_space.cpp"
+#include "resource_reader.hpp"
+
+#include <assimp/Importer.hpp>
+#include <assimp/postprocess.h>
+#include <assimp/scene.h>
+
+#include <chrono>
+#include <filesystem>
+#include <numbers>
+#include <print>
+#include <sstream>
+
+namespace {
+
+auto plane(const float u_sign) -> game::MeshData {
+   auto mesh = game::MeshData{};
+   constexpr auto n = 8u;
+   for (auto y = 0u; y <= n; ++y) {
+      for (auto x = 0u; x <= n; ++x) {
+         const auto fx = static_cast<float>(x);
+         const auto fy = static_cast<float>(y);
+         mesh.vertices.emplace_back(game::VertexData{
+            .position = {fx, fy, 0.0f, 1.0f}, .normal = {0.0f,0.0f,1.0f},
+            .tangent = {}, .bitangent = {}, .uv = {u_sign * fx, fy}});
+      }
+   }
+   for (auto y = 0u; y < n; ++y) {
+      for (auto x = 0u; x < n; ++x) {
+         const auto i = y * (n + 1) + x;
+         mesh.indexes.insert(mesh.indexes.end(), {i, i + 1, i + n + 1, i + n + 1, i + 1, i + n + 2});
+      }
+   }
+   return mesh;
+}
+
+auto toMeshData(const aiMesh* m) -> game::MeshData {
+   auto mesh = game::MeshData{};
+   for (auto v = 0u; v < m->mNumVertices; ++v) {
+      const auto& p = m->mVertices[v];
+      const auto& n = m->mNormals[v];
+      const auto& uv = m->mTextureCoords[0][v];
+      mesh.vertices.emplace_back(game::VertexData{
+         .position = {p.x, p.y, p.z, 1.0f}, .normal = {n.x, n.y, n.z},
+         .tangent = {}, .bitangent = {}, .uv = {uv.x, uv.y}});
+   }
+   for (auto f = 0u; f < m->mNumFaces; ++f) {
+      mesh.indexes.insert(mesh.indexes.end(), m->mFaces[f].mIndices, m->mFaces[f].mIndices + m->mFaces[f].mNumIndices);
+   }
+   return mesh;
+}
+
+/// a uv sphere written as obj, big enough to make the timings meaningful
+auto sphereObj(const std::uint32_t rings, const std::uint32_t segments) -> std::string {
+   std::ostringstream obj;
+   for (auto r = 0u; r <= rings; ++r) {
+      const auto theta = static_cast<float>(r) * std::numbers::pi_v<float> / static_cast<float>(rings);
+      for (auto s = 0u; s <= segments; ++s) {
+         const auto phi = static_cast<float>(s) * 2.0f * std::numbers::pi_v<float> / static_cast<float>(segments);
+         const auto x = std::cos(phi) * std::sin(theta);
+         const auto y = std::cos(theta);
+         const auto z = std::sin(phi) * std::sin(theta);
+         obj << "v " << x << ' ' << y << ' ' << z << "\nvn " << x << ' ' << y << ' ' << z << "\nvt "
+             << static_cast<float>(s) / static_cast<float>(segments) << ' '
+             << static_cast<float>(r) / static_cast<float>(rings) << '\n';
+      }
+   }
+   for (auto r = 0u; r < rings; ++r) {
+      for (auto s = 0u; s < segments; ++s) {
+         const auto a = r * (segments + 1) + s + 1;
+         const auto b = a + segments + 1;
+         obj << "f " << a << '/' << a << '/' << a << ' ' << b << '/' << b << '/' << b << ' '
+             << a + 1 << '/' << a + 1 << '/' << a + 1 << '\n';
+         obj << "f " << b << '/' << b << '/' << b << ' ' << b + 1 << '/' << b + 1 << '/' << b + 1 << ' '
+             << a + 1 << '/' << a + 1 << '/' << a + 1 << '\n';
+      }
+   }
+   return obj.str();
+}
+
+/// times our generator against assimp's aiProcess_CalcTangentSpace on the same
+/// imported data, returns the fraction of vertices whose tangents agree
+auto compareWithAssimp(const std::string_view name, const std::span<const std::byte> data) -> double {
+   Assimp::Importer importer;
+   const auto scene = importer.ReadFileFromMemory(data.data(), data.size(), aiProcess_Triangulate | aiProcess_FlipUVs);
+   EXPECT_NE(scene, nullptr);
+   auto meshes = std::span{scene->mMeshes, scene->mNumMeshes} |
+      std::views::transform(toMeshData) | std::ranges::to<std::vector>();
+
+   const auto start = std::chrono::steady_clock::now();
+   importer.ApplyPostProcessing(aiProcess_CalcTangentSpace);
+   const auto assimp_done = std::chrono::steady_clock::now();
+   for (auto& mesh: meshes) {
+      game::MeshFactory::generateTangents(mesh);
+   }
+   const auto ours_done = std::chrono::steady_clock::now();
+
+   auto vertices = size_t{0};
+   auto agreeing = size_t{0};
+   for (const auto& [m, mesh]: std::views::zip(std::span{scene->mMeshes, scene->mNumMeshes}, meshes)) {
+      for (auto v = 0u; v < m->mNumVertices; ++v) {
+         const auto t = simd::float3{m->mTangents[v].x, m->mTangents[v].y, m->mTangents[v].z};
+         agreeing += simd::dot(t, mesh.vertices[v].tangent) > 0.7f ? 1 : 0;
+         ++vertices;
+      }
+   }
+
+   std::println("{}: {} vertices, assimp {:.2f} ms, generateTangents {:.2f} ms", name, vertices,
+      std::chrono::duration<double, std::milli>(assimp_done - start).count(),
+      std::chrono::duration<double, std::milli>(ours_done - assimp_done).count());
+   return static_cast<double>(agreeing) / static_cast<double>(vertices);
+}
+
+}
+
+TEST(tangent_space, follows_uv_axes) {
+   auto mesh = plane(1.0f);
+   game::MeshFactory::generateTangents(mesh);
+   for (const auto& v: mesh.vertices) {
+      ASSERT_NEAR(v.tangent.x, 1.0f, 1e-5f);
+      ASSERT_NEAR(v.bitangent.y, 1.0f, 1e-5f);
+      ASSERT_NEAR(simd::dot(v.tangent, v.normal), 0.0f, 1e-5f);
+   }
+}
+
+TEST(tangent_space, mirrored_uvs) {
+   auto mesh = plane(-1.0f);
+   game::MeshFactory::generateTangents(mesh);
+   for (const auto& v: mesh.vertices) {
+      ASSERT_NEAR(v.tangent.x, -1.0f, 1e-5f);
+      ASSERT_NEAR(v.bitangent.y, 1.0f, 1e-5f);
+   }
+}
+
+TEST(tangent_space, out_of_range_indexes) {
+   auto mesh = plane(1.0f);
+   mesh.indexes.back() = static_cast<std::uint32_t>(mesh.vertices.size());
+   ASSERT_THROW(game::MeshFactory::generateTangents(mesh), game::Exception);
+}
+
+TEST(tangent_space, agrees_with_assimp) {
+   const game::ResourceLoader loader{ROOT_DIR};
+   const auto suzanne = loader.loadBytes((std::filesystem::path(ASSETS_DIR) / "Suzanne.obj").string());
+   ASSERT_GT(compareWithAssimp("Suzanne", suzanne.bytes()), 0.9);
+   const auto sphere = sphereObj(16, 32);
+   ASSERT_GT(compareWithAssimp("sphere", std::as_bytes(std::span{sphere})), 0.9);
+}
+
+TEST(tangent_space, DISABLED_benchmark_against_assimp) {
+   const auto sphere = sphereObj(512, 1024);
+   ASSERT_GT(compareWithAssimp("sphere", std::as_bytes(std::span{sphere})), 0.9);
+}
@@ -0,0 +1,182 @@
+#include <gtest/gtest.h>
+
+#include "texture_file.cpp"
+#include "image.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <print>
+#include <random>
+
+namespace {
+
+auto temporary(const std::string_view name) -> std::filesystem::path {
+   return std::filesystem::temp_directory_path() / std::format("game_tutorial_{}", name);
+}
+
+auto noise(const std::uint32_t width, const std::uint32_t height, const std::uint32_t seed) -> game::Image {
+   auto random = std::mt19937{seed};
+   auto image = game::Image{width, height, std::vector<std::byte>(size_t{width} * height * 4)};
+   for (auto& p: image.pixels) {
+      p = static_cast<std::byte>(random() % 256);
+   }
+   return image;
+}
+
+auto chains(const size_t count, const std::uint32_t width, const std::uint32_t height) -> std::vector<game::MipChain> {
+   auto result = std::vector<game::MipChain>{};
+   for (auto i = size_t{0}; i < count; ++i) {
+      result.push_back(game::buildMipChain(noise(width, height, static_cast<std::uint32_t>(i)),
+         game::MipFilter::Box, game::ColorSpace::Linear));
+   }
+   return result;
+}
+
+auto asBytes(const std::span<const std::byte> bytes) -> std::vector<std::byte> {
+   return {bytes.begin(), bytes.end()};
+}
+
+}
+
+TEST(texture_file, rgba8_layers_round_trip) {
+   const auto layers = chains(3, 40, 24);
+   const auto path = temporary("layers.gtex");
+   game::TextureFile::write(path, 42, layers, 1);
+
+   const auto file = game::TextureFile::open(path, 42);
+   ASSERT_TRUE(file.has_value());
+   ASSERT_EQ(file->format(), game::TextureFileFormat::RGBA8);
+   ASSERT_EQ(file->width(), 40u);
+   ASSERT_EQ(file->height(), 24u);
+   ASSERT_EQ(file->layers(), 3u);
+   ASSERT_EQ(file->faces(), 1u);
+   ASSERT_EQ(file->levelCount(), layers.front().levels.size());
+   for (auto level = size_t{0}; level < file->levelCount(); ++level) {
+      ASSERT_EQ(file->bytesPerRow(level), layers.front().levels[level].bytesPerRow());
+      for (auto layer = size_t{0}; layer < layers.size(); ++layer) {
+         const auto image = file->image(level, layer);
+         /// a whole number of texels from the start of the mapping, as the GPU copies want
+         ASSERT_EQ(reinterpret_cast<std::uintptr_t>(image.data()) % 4, 0u);
+         ASSERT_EQ(asBytes(image), layers[layer].levels[level].pixels);
+      }
+   }
+   ASSERT_THROW((void)file->image(file->levelCount(), 0), game::Exception);
+   ASSERT_THROW((void)file->image(0, 3), game::Exception);
+   std::filesystem::remove(path);
+}
+
+TEST(texture_file, compressed_cube_faces_round_trip) {
+   auto faces = std::vector<game::CompressedChain>{};
+   for (const auto& chain: chains(6, 20, 12)) {
+      faces.push_back(game::compressMipChain(chain, game::BlockFormat::BC7, game::EncodeQuality::Fast));
+   }
+   const auto path = temporary("cube.gtex");
+   game::TextureFile::write(path, 7, faces, 6);
+
+   const auto file = game::TextureFile::open(path, 7);
+   ASSERT_TRUE(file.has_value());
+   ASSERT_EQ(file->format(), game::TextureFileFormat::BC7);
+   ASSERT_EQ(file->layers(), 1u);
+   ASSERT_EQ(file->faces(), 6u);
+   ASSERT_EQ(file->slices(), 6u);
+   /// rows of blocks: 5 across at level 0, 1 once the level is narrower than a block
+   ASSERT_EQ(file->bytesPerRow(0), 80u);
+   ASSERT_EQ(file->bytesPerRow(file->levelCount() - 1), 16u);
+   for (auto level = size_t{0}; level < file->levelCount(); ++level) {
+      for (auto face = size_t{0}; face < faces.size(); ++face) {
+         ASSERT_EQ(asBytes(file->image(level, face)), faces[face].levels[level]);
+      }
+   }
+   std::filesystem::remove(path);
+}
+
+TEST(texture_file, half_float_cube_faces_round_trip) {
+   auto sky = game::HdrImage{64, 32, std::vector<float>(size_t{64} * 32 * 4)};
+   for (auto i = size_t{0}; i < sky.pixels.size(); ++i) {
+      sky.pixels[i] = static_cast<float>(i % 97) * 0.75f;
+   }
+   const auto faces = game::equirectToCube(sky, 16);
+   const auto path = temporary("sky.gtex");
+   game::TextureFile::write(path, 9, faces, 6);
+
+   const auto file = game::TextureFile::open(path, 9);
+   ASSERT_TRUE(file.has_value());
+   ASSERT_EQ(file->format(), game::TextureFileFormat::RGBA16F);
+   ASSERT_EQ(file->faces(), 6u);
+   ASSERT_EQ(file->levelCount(), 5u);
+   /// four halves a texel
+   ASSERT_EQ(file->bytesPerRow(0), 128u);
+   for (auto level = size_t{0}; level < file->levelCount(); ++level) {
+      for (auto face = size_t{0}; face < faces.size(); ++face) {
+         ASSERT_EQ(asBytes(file->image(level, face)), asBytes(std::as_bytes(std::span{faces[face].levels[level]})));
+      }
+   }
+   std::filesystem::remove(path);
+}
+
+TEST(texture_file, stale_or_broken_files_are_not_opened) {
+   const auto layers = chains(1, 16, 16);
+   const auto path = temporary("broken.gtex");
+   game::TextureFile::write(path, 42, layers, 1);
+   ASSERT_FALSE(game::TextureFile::open(path, 43).has_value());
+   ASSERT_FALSE(game::TextureFile::open(temporary("missing.gtex"), 42).has_value());
+
+   /// a level running past the end of the file
+   std::filesystem::resize_file(path, std::filesystem::file_size(path) - 1);
+   ASSERT_FALSE(game::TextureFile::open(path, 42).has_value());
+   std::filesystem::remove(path);
+
+   /// partial mip chains, slices of another size, faces that are not whole cubes
+   auto partial = chains(1, 16, 16);
+   partial.front().levels.pop_back();
+   ASSERT_THROW(game::TextureFile::write(path, 42, partial, 1), game::Exception);
+   auto mixed = chains(1, 16, 16);
+   mixed.push_back(chains(1, 16, 8).front());
+   ASSERT_THROW(game::TextureFile::write(path, 42, mixed, 1), game::Exception);
+   ASSERT_THROW(game::TextureFile::write(path, 42, chains(4, 8, 8), 6), game::Exception);
+}
+
+/// what a texture costs before it can be staged: decoding the PNG and
+/// building its mips, against mapping the baked file and touching every level
+TEST(texture_file, DISABLED_startup_against_decoding) {
+   const auto png = std::filesystem::path(ROOT_DIR) / ASSETS_DIR / "container2.png";
+   const auto path = temporary("startup.gtex");
+   constexpr auto RUNS = 5;
+
+   auto decode_ms = 0.0;
+   auto chain = game::MipChain{};
+   for (auto run = 0; run < RUNS; ++run) {
+      const auto start = std::chrono::steady_clock::now();
+      const auto source = game::MappedFile::open(png);
+      chain = game::buildMipChain(game::decodeImage(source.bytes()), game::MipFilter::Kaiser, game::ColorSpace::Srgb);
+      decode_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+   }
+   const auto compressed = game::compressMipChain(chain, game::BlockFormat::BC7, game::EncodeQuality::Normal);
+
+   for (const auto bc7: {false, true}) {
+      if (bc7) {
+         game::TextureFile::write(path, 1, std::span{&compressed, 1}, 1);
+      } else {
+         game::TextureFile::write(path, 1, std::span{&chain, 1}, 1);
+      }
+      auto staging = std::vector<std::byte>(std::filesystem::file_size(path));
+      auto file_ms = 0.0;
+      for (auto run = 0; run < RUNS; ++run) {
+         const auto start = std::chrono::steady_clock::now();
+         const auto file = game::TextureFile::open(path, 1);
+         ASSERT_TRUE(file.has_value());
+         auto offset = size_t{0};
+         for (auto level = size_t{0}; level < file->levelCount(); ++level) {
+            const auto image = file->image(level, 0);
+            std::memcpy(staging.data() + offset, image.data(), image.size());
+            offset += image.size();
+         }
+         file_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+      }
+      std::println("container2.png {}x{}: decoded with mips in {:.2f} ms, {} texture file staged in {:.2f} ms",
+         chain.levels.front().width, chain.levels.front().height, decode_ms / RUNS, bc7 ? "BC7" : "RGBA8",
+         file_ms / RUNS);
+   }
+   std::filesystem::remove(path);
+}